@@ -0,0 +1,70 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cstring>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+bool frc::ADIS16470ParseBenchArgs(int argc, char** argv, const std::vector<ADIS16470BenchOption>& options,
+                                  ADIS16470BenchArgs* args) {
+  for (int i = 1; i < argc; i++) {
+    bool known = false;
+    if (i + 1 < argc) {
+      if (!std::strcmp(argv[i], "--csv")) {
+        args->csv_path = argv[++i];
+        known = true;
+      } else if (!std::strcmp(argv[i], "--label")) {
+        args->label = argv[++i];
+        known = true;
+      } else {
+        for (const auto& option : options) {
+          if (!std::strcmp(argv[i], option.flag)) {
+            option.parse(argv[++i]);
+            known = true;
+            break;
+          }
+        }
+      }
+    }
+    if (!known) {
+      std::string usage;
+      for (const auto& option : options) {
+        usage += std::string("[") + option.flag + " " + option.value_name + "] ";
+      }
+      std::fprintf(stderr, "Usage: %s %s[--csv results.csv] [--label name]\n", argv[0], usage.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+int frc::ADIS16470WriteBenchCsv(const ADIS16470BenchArgs& args, const char* header,
+                                const std::function<void(std::FILE*)>& write_rows) {
+  if (args.csv_path.empty()) {
+    return 0;
+  }
+  FILE* existing = std::fopen(args.csv_path.c_str(), "r");
+  bool write_header = existing == nullptr;
+  if (existing) {
+    std::fclose(existing);
+  }
+  FILE* f = std::fopen(args.csv_path.c_str(), "a");
+  if (!f) {
+    std::fprintf(stderr, "Could not write %s\n", args.csv_path.c_str());
+    return 1;
+  }
+  if (write_header) {
+    std::fprintf(f, "%s\n", header);
+  }
+  write_rows(f);
+  std::fclose(f);
+  return 0;
+}
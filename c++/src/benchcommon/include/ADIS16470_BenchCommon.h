@@ -0,0 +1,64 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace frc {
+
+/**
+ * An option a desktop bench takes on top of --csv and --label, such as --seconds.
+ */
+struct ADIS16470BenchOption {
+  // Flag on the command line, for example "--seconds"
+  const char* flag;
+  // Name of the value in the usage line, for example "s"
+  const char* value_name;
+  // Parses the value that follows the flag
+  std::function<void(const char*)> parse;
+};
+
+/**
+ * Command line shared by every desktop bench.
+ */
+struct ADIS16470BenchArgs {
+  // CSV file the results are appended to, empty for none
+  std::string csv_path;
+  // Tag for the CSV rows, for example a commit hash
+  std::string label = "local";
+};
+
+/**
+ * @brief Parses [options...] [--csv results.csv] [--label name].
+ *
+ * @param options Options the bench takes on top of --csv and --label.
+ *
+ * @return False, after printing the usage, on an unknown argument or a flag without a value.
+ */
+bool ADIS16470ParseBenchArgs(int argc, char** argv, const std::vector<ADIS16470BenchOption>& options,
+                             ADIS16470BenchArgs* args);
+
+/**
+ * @brief Appends the results to the --csv file, writing the header first if the file is new.
+ *
+ * @param header Column names, with the label first and no trailing newline.
+ *
+ * @param write_rows Writes one line per result to the open file, each starting with args.label.
+ *
+ * @return The exit status for main(): 0 without --csv or once the rows are written, 1 if the file
+ * can't be opened.
+ */
+int ADIS16470WriteBenchCsv(const ADIS16470BenchArgs& args, const char* header,
+                           const std::function<void(std::FILE*)>& write_rows);
+
+}  // namespace frc
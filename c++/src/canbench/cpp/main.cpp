@@ -0,0 +1,247 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470canbench - heading frames forwarded to the CAN bus by the ADIS16470 driver.
+ *
+ * Usage: adis16470canbench [--seconds s] [--csv results.csv] [--label name]
+ *
+ * The driver is run against ADIS16470SimTransport while turning at 20 deg/s, with
+ * StartCANForwarding() on, for --seconds of simulated time (default 10). Every frame the HAL
+ * would put on the bus is caught with the simulated CAN send callback and decoded the way a
+ * motor controller would. Cases cover 1 kHz, 500 Hz and 100 Hz frames at the default 400 Hz IMU
+ * rate, 1 kHz frames at the full 2 kHz IMU rate, and 1 kHz frames with one transmit in ten
+ * rejected by the HAL (a full transmit buffer). For every case the bench prints the frame rate
+ * the receiver saw, the mean and largest time between frames, frames missing from the rolling
+ * counter, the mean and largest heading age, the largest heading error (the received angle
+ * against the simulated turn at the time of its sample), and the driver's own GetCANStats()
+ * counters. With --csv, one row per case is appended to the given file, tagged with --label
+ * (for example a commit hash).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <adi/ADIS16470_CANForwarder.h>
+#include <adi/ADIS16470_IMU.h>
+#include <adi/ADIS16470_SimTransport.h>
+#include <hal/HAL.h>
+#include <mockdata/CanData.h>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+namespace {
+
+/* Yaw rate during every case (deg/s) */
+constexpr double kRate = 20.0;
+
+/* Simulated time before forwarding starts (s) */
+constexpr double kSettle = 0.5;
+
+/* CAN device number used by the bench */
+constexpr int kDeviceId = 5;
+
+/* Status returned for a rejected transmit. Any non-zero status counts as a drop. */
+constexpr int32_t kRejectStatus = -1;
+
+struct Case {
+  std::string name;
+  double rate;
+  std::function<void(ADIS16470_IMU&)> configure;
+  // Every n-th transmit is rejected (0 for none)
+  int reject_every = 0;
+};
+
+/* What the simulated bus saw, filled in from the acquisition thread */
+struct Receiver {
+  const ADIS16470SimTransport* sim = nullptr;
+  int reject_every = 0;
+  uint64_t attempts = 0;
+  uint64_t rejected = 0;
+  uint64_t frames = 0;
+  uint64_t counter_gaps = 0;
+  uint64_t faults = 0;
+  double first_time = 0.0;
+  double last_time = 0.0;
+  double interval_sum = 0.0;
+  double max_interval = 0.0;
+  double age_sum = 0.0;
+  double max_age = 0.0;
+  double max_error = 0.0;
+  // Angle and sample time of the first frame, the origin of the simulated turn
+  double origin_angle = 0.0;
+  double origin_time = 0.0;
+  int last_counter = 0;
+};
+
+struct Result {
+  std::string name;
+  double rate = 0.0;
+  Receiver rx;
+  ADIS16470CANStats stats;
+};
+
+void OnSend(const char* name, void* param, uint32_t message_id, const uint8_t* data, uint8_t size, int32_t period,
+            int32_t* status) {
+  Receiver& rx = *static_cast<Receiver*>(param);
+  const uint32_t expected = (uint32_t(ADIS16470CANForwarder::kDeviceType) << 24) |
+                            (uint32_t(ADIS16470CANForwarder::kManufacturer) << 16) | kDeviceId;
+  if ((message_id & ~(uint32_t(0x3FF) << 6)) != expected) {
+    return;
+  }
+  rx.attempts++;
+  if (rx.reject_every > 0 && rx.attempts % rx.reject_every == 0) {
+    *status = kRejectStatus;
+    rx.rejected++;
+    return;
+  }
+  ADIS16470CANHeading heading;
+  if (!ADIS16470CANForwarder::Decode(data, size, &heading)) {
+    return;
+  }
+  const double now = rx.sim->GetVirtualTime();
+  const double sample_time = now - heading.age;
+  if (rx.frames == 0) {
+    rx.first_time = now;
+    rx.origin_angle = heading.angle;
+    rx.origin_time = sample_time;
+  }
+  else {
+    double interval = now - rx.last_time;
+    rx.interval_sum += interval;
+    rx.max_interval = std::max(rx.max_interval, interval);
+    rx.counter_gaps += (heading.counter - rx.last_counter - 1) & 0xF;
+  }
+  double error = heading.angle - (rx.origin_angle + kRate * (sample_time - rx.origin_time));
+  rx.max_error = std::max(rx.max_error, std::abs(error));
+  rx.age_sum += heading.age;
+  rx.max_age = std::max(rx.max_age, heading.age);
+  if (heading.flags & kADIS16470CANStreamFault) {
+    rx.faults++;
+  }
+  rx.last_time = now;
+  rx.last_counter = heading.counter;
+  rx.frames++;
+}
+
+Result Run(const Case& c, double seconds) {
+  auto sim_transport = std::make_unique<ADIS16470SimTransport>(1);
+  ADIS16470SimTransport& sim = *sim_transport;
+  sim.SetAngularRate(0.0, 0.0, kRate);
+  sim.SetAcceleration(0.0, 0.0, 1.0);
+  // The bench thread sleeps on the virtual clock too
+  sim.AttachThread();
+
+  Result result;
+  result.name = c.name;
+  result.rate = c.rate;
+  result.rx.sim = &sim;
+  result.rx.reject_every = c.reject_every;
+  int32_t callback = HALSIM_RegisterCanSendMessageCallback(OnSend, &result.rx);
+
+  auto imu = std::make_unique<ADIS16470_IMU>(ADIS16470_IMU::kZ, std::move(sim_transport),
+                                             ADIS16470CalibrationTime::_32ms);
+  c.configure(*imu);
+  sim.Sleep(kSettle);
+  if (imu->StartCANForwarding(kDeviceId, c.rate) != 0) {
+    std::fprintf(stderr, "%s: could not open the CAN device\n", c.name.c_str());
+  }
+  sim.Sleep(seconds);
+  imu->StopCANForwarding();
+  result.stats = imu->GetCANStats();
+  // The destructor joins the acquisition thread, which must still see this thread on the clock
+  imu.reset();
+  HALSIM_CancelCanSendMessageCallback(callback);
+  return result;
+}
+
+std::vector<Case> MakeCases() {
+  auto none = [](ADIS16470_IMU&) {};
+  auto full_rate = [](ADIS16470_IMU& imu) { imu.ConfigDecRate(0); };
+  std::vector<Case> cases;
+  cases.push_back({"1 kHz", 1000.0, none});
+  cases.push_back({"500 Hz", 500.0, none});
+  cases.push_back({"100 Hz", 100.0, none});
+  cases.push_back({"1 kHz, 2 kHz IMU", 1000.0, full_rate});
+  cases.push_back({"1 kHz, 10% rejected", 1000.0, none, 10});
+  return cases;
+}
+
+double ReceivedRate(const Receiver& rx) {
+  return rx.frames > 1 ? (rx.frames - 1) / (rx.last_time - rx.first_time) : 0.0;
+}
+
+double MeanInterval(const Receiver& rx) {
+  return rx.frames > 1 ? rx.interval_sum / (rx.frames - 1) : 0.0;
+}
+
+double MeanAge(const Receiver& rx) {
+  return rx.frames > 0 ? rx.age_sum / rx.frames : 0.0;
+}
+
+void PrintTable(const std::vector<Result>& results) {
+  std::printf("%-20s %8s %8s %9s %9s %5s %8s %8s %9s %7s %7s %7s %7s %9s\n", "case", "target", "rx Hz",
+              "mean ms", "max ms", "gaps", "age ms", "max age", "err deg", "sent", "dropped", "skipped", "faults",
+              "send us");
+  for (const auto& r : results) {
+    const Receiver& rx = r.rx;
+    std::printf("%-20s %8.0f %8.1f %9.3f %9.3f %5llu %8.2f %8.2f %9.4f %7llu %7llu %7llu %7llu %9.2f\n",
+                r.name.c_str(), r.rate, ReceivedRate(rx), MeanInterval(rx) * 1e3, rx.max_interval * 1e3,
+                (unsigned long long)rx.counter_gaps, MeanAge(rx) * 1e3, rx.max_age * 1e3, rx.max_error,
+                (unsigned long long)r.stats.sent, (unsigned long long)r.stats.dropped,
+                (unsigned long long)r.stats.skipped, (unsigned long long)rx.faults, r.stats.mean_send_time * 1e6);
+  }
+}
+
+constexpr char kCsvHeader[] =
+    "label,case,target_hz,received_hz,mean_interval_ms,max_interval_ms,counter_gaps,mean_age_ms,max_age_ms,"
+    "max_error_deg,sent,dropped,skipped,fault_frames,mean_send_us,max_send_us";
+
+void WriteCsvRows(std::FILE* f, const std::string& label, const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    const Receiver& rx = r.rx;
+    std::fprintf(f, "%s,%s,%.0f,%.2f,%.4f,%.4f,%llu,%.3f,%.3f,%.5f,%llu,%llu,%llu,%llu,%.3f,%.3f\n", label.c_str(),
+                 r.name.c_str(), r.rate, ReceivedRate(rx), MeanInterval(rx) * 1e3, rx.max_interval * 1e3,
+                 (unsigned long long)rx.counter_gaps, MeanAge(rx) * 1e3, rx.max_age * 1e3, rx.max_error,
+                 (unsigned long long)r.stats.sent, (unsigned long long)r.stats.dropped,
+                 (unsigned long long)r.stats.skipped, (unsigned long long)rx.faults, r.stats.mean_send_time * 1e6,
+                 r.stats.max_send_time * 1e6);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ADIS16470BenchArgs args;
+  double seconds = 10.0;
+  const std::vector<ADIS16470BenchOption> options = {
+      {"--seconds", "s", [&](const char* value) { seconds = std::max(0.1, std::atof(value)); }},
+  };
+  if (!ADIS16470ParseBenchArgs(argc, argv, options, &args)) {
+    return 1;
+  }
+
+  HAL_Initialize(500, 0);
+
+  std::vector<Result> results;
+  for (const Case& c : MakeCases()) {
+    results.push_back(Run(c, seconds));
+  }
+
+  PrintTable(results);
+  return ADIS16470WriteBenchCsv(args, kCsvHeader, [&](std::FILE* f) { WriteCsvRows(f, args.label, results); });
+}
@@ -0,0 +1,119 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470capicheck - exercises the C interface (ADIS16470_CAPI.h) from plain C.
+ *
+ * Usage: adis16470capicheck
+ *
+ * Runs the driver against the simulated IMU through the same calls the LabVIEW library makes:
+ * create, snapshot, history, configuration and destroy. Every check is printed, and the exit
+ * status is the number of failed checks, so the tool can gate a build on a desktop.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <adi/ADIS16470_CAPI.h>
+
+static int failures = 0;
+
+static void Check(int ok, const char* what) {
+  printf("%s  %s\n", ok ? "PASS" : "FAIL", what);
+  if (!ok) {
+    failures++;
+  }
+}
+
+/* Sample history rows: 4 s at the default 400 Hz */
+#define kMaxSamples 1600
+
+int main(void) {
+  static double samples[kMaxSamples * ADIS16470_SAMPLE_FIELDS];
+  ADIS16470_Handle imu = NULL;
+  ADIS16470_Snapshot snapshot;
+  ADIS16470_Config config;
+  uint64_t sequence = 0;
+  uint64_t latest = 0;
+  int32_t count = 0;
+  int32_t i;
+  int ordered = 1;
+
+  Check(ADIS16470_GetAPIVersion() == ADIS16470_API_VERSION, "API version matches the header");
+  Check(ADIS16470_CreateSim(3, 7, 0, 1, &imu) == ADIS16470_STATUS_INVALID_ARGUMENT, "bad yaw axis rejected");
+  Check(ADIS16470_CreateSim(2, 7, 0, 1, NULL) == ADIS16470_STATUS_INVALID_ARGUMENT, "null handle pointer rejected");
+  Check(ADIS16470_GetSnapshot(NULL, &snapshot) == ADIS16470_STATUS_INVALID_ARGUMENT, "null handle rejected");
+  Check(ADIS16470_Destroy(NULL) == ADIS16470_STATUS_OK, "null handle destroyed");
+  Check(ADIS16470_CreateSimWithProductID(2, 0, 0, 1, 16460, &imu) == ADIS16470_STATUS_FAILED && imu == NULL,
+        "wrong product ID fails the create");
+
+  /* Z yaw axis, 4 s calibration, wait for the IMU's bias null */
+  Check(ADIS16470_CreateSim(2, 7, 0, 1, &imu) == ADIS16470_STATUS_OK && imu != NULL, "simulated IMU created");
+  if (imu == NULL) {
+    return failures;
+  }
+
+  /* Lifecycle and snapshot */
+  ADIS16470_SimSleep(imu, 0.5);
+  Check(ADIS16470_GetLatestSequence(imu, &latest) == ADIS16470_STATUS_OK && latest > 150,
+        "samples acquired at 400 Hz");
+  ADIS16470_SimSetAngularRate(imu, 0.0, 0.0, 90.0);
+  ADIS16470_SimSleep(imu, 1.0);
+  Check(ADIS16470_GetSnapshot(imu, &snapshot) == ADIS16470_STATUS_OK, "snapshot read");
+  printf("      angle %.2f deg, rate %.2f deg/s, sequence %llu\n",
+         snapshot.angle, snapshot.rate, (unsigned long long)snapshot.sequence);
+  Check(fabs(snapshot.angle - 90.0) < 2.0, "angle integrates a 90 deg/s turn");
+  Check(fabs(snapshot.rate - 90.0) < 1.0 && fabs(snapshot.gyro_z - snapshot.rate) < 1e-9, "rate follows the yaw axis");
+  Check(fabs(snapshot.accel_z - 1.0) < 0.05, "gravity on Z");
+
+  /* History: everything since the start, in order, ending at the snapshot */
+  sequence = 0;
+  Check(ADIS16470_GetSamples(imu, &sequence, samples, kMaxSamples, &count) == ADIS16470_STATUS_OK, "history read");
+  Check(count > 500 && sequence == snapshot.sequence, "history covers every sample up to the snapshot");
+  for (i = 1; i < count; i++) {
+    if (samples[i * ADIS16470_SAMPLE_FIELDS + ADIS16470_SAMPLE_TIMESTAMP] <=
+        samples[(i - 1) * ADIS16470_SAMPLE_FIELDS + ADIS16470_SAMPLE_TIMESTAMP]) {
+      ordered = 0;
+    }
+  }
+  Check(ordered, "history timestamps increase");
+  Check(count > 0 && samples[(count - 1) * ADIS16470_SAMPLE_FIELDS + ADIS16470_SAMPLE_ANGLE] == snapshot.angle,
+        "last history angle matches the snapshot");
+  Check(ADIS16470_GetSamples(imu, &sequence, samples, kMaxSamples, &count) == ADIS16470_STATUS_OK && count == 0,
+        "nothing new without time passing");
+
+  /* Configuration */
+  config.dec_rate = 9;
+  config.filter = -1;
+  config.cal_time = -1;
+  config.yaw_axis = -1;
+  config.high_resolution_mask = -1;
+  config.read_diag_stat = -1;
+  Check(ADIS16470_Configure(imu, &config) == ADIS16470_STATUS_OK, "decimation changed");
+  Check(ADIS16470_Configure(imu, &config) == ADIS16470_STATUS_NO_CHANGE, "same decimation reports no change");
+  config.dec_rate = 2000;
+  Check(ADIS16470_Configure(imu, &config) == ADIS16470_STATUS_INVALID_ARGUMENT, "out of range decimation rejected");
+  ADIS16470_SimSleep(imu, 0.5);
+  ADIS16470_GetLatestSequence(imu, &latest);
+  sequence = latest - 10;
+  ADIS16470_GetSamples(imu, &sequence, samples, kMaxSamples, &count);
+  Check(count == 10 && fabs(samples[9 * ADIS16470_SAMPLE_FIELDS + ADIS16470_SAMPLE_DT] - 0.005) < 0.0005,
+        "samples arrive at 200 Hz");
+
+  ADIS16470_ResetAngle(imu);
+  ADIS16470_GetSnapshot(imu, &snapshot);
+  Check(snapshot.angle == 0.0, "angle reset");
+  Check(ADIS16470_SimSleep(imu, -1.0) == ADIS16470_STATUS_INVALID_ARGUMENT, "negative sleep rejected");
+
+  Check(ADIS16470_Destroy(imu) == ADIS16470_STATUS_OK, "simulated IMU destroyed");
+
+  printf("%d check(s) failed\n", failures);
+  return failures;
+}
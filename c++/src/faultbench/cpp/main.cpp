@@ -0,0 +1,236 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470faultbench - fault detection and recovery of the ADIS16470 driver.
+ *
+ * Usage: adis16470faultbench [--runs n] [--csv results.csv] [--label name]
+ *
+ * The driver is run against ADIS16470SimTransport wrapped in ADIS16470FaultTransport. Each case
+ * starts a fresh driver, lets it stream for 0.5 s, injects one fault and watches the next second
+ * of simulated time (ten seconds for the random mix). For every case the bench reports how often
+ * the driver noticed the fault (a corrupt frame, a stall or an overrun in GetStreamStats()), the
+ * time from the injection until it did and until the stream was clean again, the samples the IMU
+ * produced that never reached the history, the FIFO words thrown away, and the heading error the
+ * loss caused while turning at 20 deg/s. Every case runs --runs times (default 20) with different
+ * seeds, so a fault that lands in a random place is averaged over many places. With --csv, one
+ * row per case is appended to the given file, tagged with --label (for example a commit hash).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <adi/ADIS16470_FaultTransport.h>
+#include <adi/ADIS16470_IMU.h>
+#include <adi/ADIS16470_SimTransport.h>
+#include <hal/HAL.h>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+namespace {
+
+/* Yaw rate during every case (deg/s) */
+constexpr double kRate = 20.0;
+
+/* Sample period at the driver's default decimation (us) */
+constexpr double kPeriod = 2500.0;
+
+/* Simulated time before the fault and watched after it (s) */
+constexpr double kSettle = 0.5;
+constexpr double kWindow = 1.0;
+
+struct Case {
+  std::string name;
+  // Injects the fault (and runs whatever call it needs to show up)
+  std::function<void(ADIS16470FaultTransport&, ADIS16470_IMU&)> inject;
+  double window = kWindow;
+};
+
+struct Result {
+  std::string name;
+  int runs = 0;
+  int detected = 0;
+  int recovered = 0;
+  // Sums over the runs, averaged when printed
+  double detect_time = 0.0;
+  double recovery_time = 0.0;
+  double lost = 0.0;
+  double discarded = 0.0;
+  double angle_error = 0.0;
+};
+
+bool Noticed(const ADIS16470StreamStats& now, const ADIS16470StreamStats& before) {
+  return now.corrupt_frames > before.corrupt_frames || now.stalls > before.stalls || now.overruns > before.overruns;
+}
+
+/* One run of a case on a fresh driver */
+void Run(const Case& c, uint32_t seed, Result& result) {
+  auto sim_transport = std::make_unique<ADIS16470SimTransport>(seed);
+  ADIS16470SimTransport& sim = *sim_transport;
+  auto fault_transport = std::make_unique<ADIS16470FaultTransport>(std::move(sim_transport), seed);
+  ADIS16470FaultTransport& faults = *fault_transport;
+  sim.SetAngularRate(0.0, 0.0, kRate);
+  // The bench thread sleeps on the virtual clock too
+  sim.AttachThread();
+
+  auto imu = std::make_unique<ADIS16470_IMU>(ADIS16470_IMU::kZ, std::move(fault_transport),
+                                             ADIS16470CalibrationTime::_32ms);
+  sim.Sleep(kSettle);
+  const ADIS16470StreamStats before = imu->GetStreamStats();
+  const ADIS16470Snapshot first = imu->GetSnapshot();
+  const double start = sim.GetVirtualTime();
+
+  c.inject(faults, *imu);
+
+  double detected_at = -1.0;
+  double recovered_at = -1.0;
+  uint64_t detected_sequence = 0;
+  while (sim.GetVirtualTime() - start < c.window) {
+    sim.Sleep(0.001);
+    ADIS16470StreamStats stats = imu->GetStreamStats();
+    if (detected_at < 0.0 && Noticed(stats, before)) {
+      detected_at = sim.GetVirtualTime();
+      detected_sequence = imu->GetLatestSequence();
+    }
+    if (detected_at >= 0.0 && recovered_at < 0.0 && !stats.resyncing && !stats.stalled &&
+        imu->GetLatestSequence() > detected_sequence) {
+      recovered_at = sim.GetVirtualTime();
+    }
+  }
+
+  const ADIS16470StreamStats after = imu->GetStreamStats();
+  const ADIS16470Snapshot last = imu->GetSnapshot();
+  // Count and integrate between the two samples, so the FIFO contents at either end don't matter
+  const double elapsed = uint32_t(last.timestamp - first.timestamp) / 1e6;
+  result.runs++;
+  if (detected_at >= 0.0) {
+    result.detected++;
+    result.detect_time += detected_at - start;
+  }
+  if (recovered_at >= 0.0) {
+    result.recovered++;
+    result.recovery_time += recovered_at - start;
+  }
+  result.lost += std::round(elapsed * 1e6 / kPeriod) - double(last.sequence - first.sequence);
+  result.discarded += double(after.discarded_words - before.discarded_words);
+  result.angle_error += std::fabs(last.angle - first.angle - kRate * elapsed);
+  // The destructor joins the acquisition thread, which must still see this thread on the clock
+  imu.reset();
+}
+
+std::vector<Case> MakeCases() {
+  using Fault = ADIS16470FaultTransport;
+  auto one = [](Fault::Fault fault) {
+    return [fault](ADIS16470FaultTransport& faults, ADIS16470_IMU&) { faults.Inject(fault); };
+  };
+  // Faults that only show up around an auto SPI restart, which a filter change causes
+  auto restart = [](Fault::Fault fault, double probability) {
+    return [fault, probability](ADIS16470FaultTransport& faults, ADIS16470_IMU& imu) {
+      faults.SetProbability(fault, probability);
+      imu.ConfigFilter(1);
+      faults.SetProbability(fault, 0.0);
+    };
+  };
+  std::vector<Case> cases;
+  cases.push_back({"none", [](ADIS16470FaultTransport&, ADIS16470_IMU&) {}});
+  cases.push_back({"restart", restart(Fault::kStrayWords, 0.0)});
+  for (Fault::Fault fault : {Fault::kDropFrame, Fault::kBitFlip, Fault::kExtraWord, Fault::kMissingWord,
+                             Fault::kTimestampJump, Fault::kStall}) {
+    cases.push_back({Fault::GetFaultName(fault), one(fault)});
+  }
+  cases.push_back({"stall 2 s", [](ADIS16470FaultTransport& faults, ADIS16470_IMU&) {
+    faults.SetStallTime(2.0);
+    faults.Inject(Fault::kStall);
+  }, 3.0});
+  cases.push_back({"slow-read 0.5 s", [](ADIS16470FaultTransport& faults, ADIS16470_IMU&) {
+    faults.SetSlowReadTime(0.5);
+    faults.Inject(Fault::kSlowRead);
+  }});
+  // Longer than the FIFO holds
+  cases.push_back({"slow-read 2.5 s", [](ADIS16470FaultTransport& faults, ADIS16470_IMU&) {
+    faults.SetSlowReadTime(2.5);
+    faults.Inject(Fault::kSlowRead);
+  }, 3.0});
+  cases.push_back({"stray-words + restart", restart(Fault::kStrayWords, 1.0)});
+  cases.push_back({"register-bit-flip + restart", restart(Fault::kRegisterBitFlip, 0.3)});
+  // Every frame fault at once, at random, for ten seconds
+  cases.push_back({"random mix (1e-3/frame)", [](ADIS16470FaultTransport& faults, ADIS16470_IMU&) {
+    for (Fault::Fault fault : {Fault::kDropFrame, Fault::kBitFlip, Fault::kExtraWord, Fault::kMissingWord,
+                               Fault::kTimestampJump}) {
+      faults.SetProbability(fault, 0.001);
+    }
+  }, 10.0});
+  return cases;
+}
+
+void PrintTable(const std::vector<Result>& results) {
+  std::printf("%-28s %9s %10s %10s %9s %10s %11s\n",
+              "case", "detected", "detect ms", "recover ms", "lost", "discarded", "angle err");
+  for (const auto& r : results) {
+    char detect[16] = "-";
+    char recover[16] = "-";
+    if (r.detected > 0) {
+      std::snprintf(detect, sizeof(detect), "%.1f", r.detect_time / r.detected * 1000.0);
+    }
+    if (r.recovered > 0) {
+      std::snprintf(recover, sizeof(recover), "%.1f", r.recovery_time / r.recovered * 1000.0);
+    }
+    std::printf("%-28s %5d/%-3d %10s %10s %9.1f %10.1f %11.3f\n",
+                r.name.c_str(), r.detected, r.runs, detect, recover, r.lost / r.runs,
+                r.discarded / r.runs, r.angle_error / r.runs);
+  }
+}
+
+constexpr char kCsvHeader[] = "label,case,runs,detected,detect_ms,recovered,recover_ms,lost,discarded,angle_err_deg";
+
+void WriteCsvRows(std::FILE* f, const std::string& label, const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    std::fprintf(f, "%s,%s,%d,%d,%.3f,%d,%.3f,%.2f,%.2f,%.4f\n",
+                 label.c_str(), r.name.c_str(), r.runs, r.detected,
+                 r.detected > 0 ? r.detect_time / r.detected * 1000.0 : 0.0, r.recovered,
+                 r.recovered > 0 ? r.recovery_time / r.recovered * 1000.0 : 0.0,
+                 r.lost / r.runs, r.discarded / r.runs, r.angle_error / r.runs);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ADIS16470BenchArgs args;
+  int runs = 20;
+  const std::vector<ADIS16470BenchOption> options = {
+      {"--runs", "n", [&](const char* value) { runs = std::max(1, std::atoi(value)); }},
+  };
+  if (!ADIS16470ParseBenchArgs(argc, argv, options, &args)) {
+    return 1;
+  }
+
+  HAL_Initialize(500, 0);
+
+  std::vector<Result> results;
+  for (const Case& c : MakeCases()) {
+    Result result;
+    result.name = c.name;
+    for (int run = 0; run < runs; run++) {
+      Run(c, run + 1, result);
+    }
+    results.push_back(result);
+  }
+
+  PrintTable(results);
+  return ADIS16470WriteBenchCsv(args, kCsvHeader, [&](std::FILE* f) { WriteCsvRows(f, args.label, results); });
+}
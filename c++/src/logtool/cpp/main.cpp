@@ -0,0 +1,468 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470logtool - offline analysis of raw ADIS16470 logs recorded with ADIS16470_IMU::StartRawLog().
+ *
+ * Usage: adis16470logtool [-j threads] [--csv summary.csv] [--columns dir]
+ *                         [--accel-threshold g] [--jump-threshold dps] log1.adislog [log2.adislog ...]
+ *
+ * Every log is memory mapped and decoded with the same frame decode and complementary filter code
+ * the driver runs on the RoboRIO. Logs are spread across all cores (one log per task). A summary
+ * table is printed for every log, and can also be written as CSV. With --columns, the decoded
+ * samples of each log are written to <dir>/<log name>.cols in a simple columnar layout: a header
+ * followed by one contiguous float64 array per column.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <adi/ADIS16470_Log.h>
+#include <adi/ADIS16470_NoiseStats.h>
+#include <adi/ADIS16470_Processing.h>
+
+using namespace frc;
+
+namespace {
+
+struct Options {
+  int threads = 0;
+  std::string csv_path;
+  std::string columns_dir;
+  // Horizontal acceleration (g) counted as a collision
+  double accel_threshold = 2.0;
+  // Change in yaw rate between two samples (deg/s) counted as a heading jump
+  double jump_threshold = 200.0;
+  std::vector<std::string> logs;
+};
+
+/* Minimum time (s) between two events of the same kind */
+constexpr double kEventHoldoff = 0.25;
+
+/* Latency histogram: 100us bins up to 100ms */
+constexpr int kLatencyBins = 1000;
+constexpr double kLatencyBinUs = 100.0;
+
+/* Rest detection thresholds used for the drift estimate */
+constexpr double kRestRate = 1.0;
+constexpr double kRestAccel = 0.05;
+
+struct Summary {
+  std::string name;
+  std::string error;
+  double duration = 0.0;
+  uint64_t samples = 0;
+  uint64_t lost_frames = 0;
+  uint64_t overruns = 0;
+  uint64_t records = 0;
+  double latency_mean = 0.0;
+  double latency_p99 = 0.0;
+  double latency_max = 0.0;
+  double final_heading = 0.0;
+  double rest_time = 0.0;
+  double drift = 0.0;
+  ADIS16470NoiseStatistics yaw_noise;
+  uint64_t collisions = 0;
+  uint64_t heading_jumps = 0;
+  // Black box captures: ADIS16470BlackBoxTrigger causes and the log time of the trigger (s)
+  uint32_t trigger_causes = 0;
+  double trigger_time = 0.0;
+};
+
+/* Columns written with --columns */
+enum Column { kTime, kGyroX, kGyroY, kGyroZ, kAccelX, kAccelY, kAccelZ, kHeading, kCompX, kCompY, kNumColumns };
+const char* kColumnNames[kNumColumns] = {
+  "time", "gyro_x", "gyro_y", "gyro_z", "accel_x", "accel_y", "accel_z", "heading", "comp_angle_x", "comp_angle_y"
+};
+
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || st.st_size == 0) {
+      return;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+      return;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = st.st_size;
+  }
+
+  ~MappedFile() {
+    if (m_data != nullptr) {
+      munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+    if (m_fd >= 0) {
+      close(m_fd);
+    }
+  }
+
+  const uint8_t* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  int m_fd = -1;
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+};
+
+std::string BaseName(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+  size_t dot = name.find_last_of('.');
+  return (dot == std::string::npos || dot == 0) ? name : name.substr(0, dot);
+}
+
+bool WriteColumns(const std::string& path, const std::vector<double> (&columns)[kNumColumns]) {
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const char magic[8] = {'A', 'D', 'I', 'S', 'C', 'O', 'L', '\0'};
+  uint32_t num_columns = kNumColumns;
+  uint64_t num_rows = columns[0].size();
+  std::fwrite(magic, sizeof(magic), 1, file);
+  std::fwrite(&num_columns, sizeof(num_columns), 1, file);
+  std::fwrite(&num_rows, sizeof(num_rows), 1, file);
+  for (int c = 0; c < kNumColumns; c++) {
+    char name[32] = {0};
+    std::strncpy(name, kColumnNames[c], sizeof(name) - 1);
+    std::fwrite(name, sizeof(name), 1, file);
+  }
+  for (int c = 0; c < kNumColumns; c++) {
+    std::fwrite(columns[c].data(), sizeof(double), columns[c].size(), file);
+  }
+  return std::fclose(file) == 0;
+}
+
+/**
+ * Decodes one log and accumulates its statistics. Mirrors the per-frame work done in
+ * ADIS16470_IMU::Acquire().
+ */
+Summary AnalyzeLog(const std::string& path, const Options& options) {
+  Summary summary;
+  summary.name = path;
+
+  MappedFile file(path);
+  if (file.data() == nullptr) {
+    summary.error = "could not map file";
+    return summary;
+  }
+  if (file.size() < sizeof(ADIS16470LogHeader)) {
+    summary.error = "file too short";
+    return summary;
+  }
+  ADIS16470LogHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, kADIS16470LogMagic, sizeof(header.magic)) != 0 ||
+      header.version != kADIS16470LogVersion || header.frame_len > (uint32_t)kADIS16470MaxFrameLen) {
+    summary.error = "not a supported ADIS16470 log";
+    return summary;
+  }
+
+  const bool want_columns = !options.columns_dir.empty();
+  std::vector<double> columns[kNumColumns];
+
+  ADIS16470ComplementaryFilter comp_filter;
+  ADIS16470WelfordStats welford;
+  ADIS16470AllanDeviation allan;
+  std::vector<uint64_t> latency_hist(kLatencyBins + 1, 0);
+  double latency_sum = 0.0;
+
+  uint32_t yaw_axis = 2;
+  double scaled_sample_rate = 2500.0;
+  ADIS16470FrameLayout layout = ADIS16470MakeFrameLayout(yaw_axis, 0);
+  bool first_run = true;
+  uint32_t previous_timestamp = 0;
+  double heading = 0.0;
+  double time = 0.0;
+  double rest_heading = 0.0;
+  double previous_yaw_rate = 0.0;
+  double last_collision = -kEventHoldoff;
+  double last_jump = -kEventHoldoff;
+  ADIS16470Sample sample;
+
+  size_t offset = sizeof(ADIS16470LogHeader);
+  while (offset + sizeof(ADIS16470LogRecord) <= file.size()) {
+    ADIS16470LogRecord record;
+    std::memcpy(&record, file.data() + offset, sizeof(record));
+    offset += sizeof(record);
+    size_t payload = size_t(record.word_count) * sizeof(uint32_t);
+    if (offset + payload > file.size()) {
+      // Truncated tail, most likely the robot lost power mid-write
+      break;
+    }
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(file.data() + offset);
+    offset += payload;
+    summary.records++;
+
+    if (record.type == kADIS16470LogConfig) {
+      if (record.word_count >= 2) {
+        yaw_axis = words[0];
+        scaled_sample_rate = words[1] / 1000.0;
+        layout = ADIS16470MakeFrameLayout(yaw_axis, record.word_count >= 3 ? words[2] : 0,
+                                          record.word_count >= 4 && words[3] != 0);
+      }
+      first_run = true;
+      continue;
+    }
+    if (record.type == kADIS16470LogEvent) {
+      if (record.word_count >= 1) {
+        summary.trigger_causes |= words[0];
+        summary.trigger_time = time;
+      }
+      continue;
+    }
+    const uint32_t frame_len = layout.frame_len;
+    if (record.type != kADIS16470LogData || record.word_count < frame_len) {
+      continue;
+    }
+    if (record.flags & kADIS16470LogOverrun) {
+      summary.overruns++;
+    }
+
+    // Age of the newest frame when the FIFO was drained
+    const uint32_t* newest = words + (record.word_count / frame_len - 1) * frame_len;
+    double latency = uint32_t(uint32_t(record.host_time) - newest[0]);
+    latency_sum += latency;
+    summary.latency_max = std::max(summary.latency_max, latency);
+    latency_hist[std::min(int(latency / kLatencyBinUs), kLatencyBins)]++;
+
+    for (uint32_t i = 0; i + frame_len <= record.word_count; i += frame_len) {
+      ADIS16470DecodeFrame(&words[i], layout, previous_timestamp, scaled_sample_rate, &sample);
+      previous_timestamp = words[i];
+
+      if (first_run) {
+        comp_filter.Reset();
+      }
+      else {
+        heading += sample.delta_angle;
+        time += sample.dt;
+        // Anything longer than 1.5 sample periods means frames went missing
+        double periods = sample.dt * 1000000.0 / scaled_sample_rate;
+        if (periods > 1.5) {
+          summary.lost_frames += uint64_t(std::lround(periods)) - 1;
+        }
+      }
+      comp_filter.Process(sample);
+
+      double yaw_rate = (yaw_axis == 0) ? sample.gyro_x : (yaw_axis == 1) ? sample.gyro_y : sample.gyro_z;
+      welford.Update(yaw_rate);
+      allan.Update(yaw_rate);
+
+      if (!first_run) {
+        double accel_norm = std::sqrt(sample.accel_x * sample.accel_x + sample.accel_y * sample.accel_y +
+                                      sample.accel_z * sample.accel_z);
+        bool at_rest = std::fabs(sample.gyro_x) < kRestRate && std::fabs(sample.gyro_y) < kRestRate &&
+                       std::fabs(sample.gyro_z) < kRestRate && std::fabs(accel_norm - 1.0) < kRestAccel;
+        if (at_rest) {
+          summary.rest_time += sample.dt;
+          rest_heading += sample.delta_angle;
+        }
+        double horizontal = std::sqrt(sample.accel_x * sample.accel_x + sample.accel_y * sample.accel_y);
+        if (horizontal > options.accel_threshold && time - last_collision >= kEventHoldoff) {
+          summary.collisions++;
+          last_collision = time;
+        }
+        if (std::fabs(yaw_rate - previous_yaw_rate) > options.jump_threshold && time - last_jump >= kEventHoldoff) {
+          summary.heading_jumps++;
+          last_jump = time;
+        }
+      }
+      previous_yaw_rate = yaw_rate;
+      first_run = false;
+      summary.samples++;
+
+      if (want_columns) {
+        columns[kTime].push_back(time);
+        columns[kGyroX].push_back(sample.gyro_x);
+        columns[kGyroY].push_back(sample.gyro_y);
+        columns[kGyroZ].push_back(sample.gyro_z);
+        columns[kAccelX].push_back(sample.accel_x);
+        columns[kAccelY].push_back(sample.accel_y);
+        columns[kAccelZ].push_back(sample.accel_z);
+        columns[kHeading].push_back(heading);
+        columns[kCompX].push_back(comp_filter.GetCompAngleX() * rad_to_deg);
+        columns[kCompY].push_back(comp_filter.GetCompAngleY() * rad_to_deg);
+      }
+    }
+  }
+
+  summary.duration = time;
+  summary.final_heading = heading;
+  if (summary.rest_time > 0.0) {
+    summary.drift = rest_heading / summary.rest_time * 60.0;
+  }
+  uint64_t data_records = 0;
+  for (uint64_t count : latency_hist) {
+    data_records += count;
+  }
+  if (data_records > 0) {
+    summary.latency_mean = latency_sum / data_records;
+    uint64_t target = (data_records * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b <= kLatencyBins; b++) {
+      seen += latency_hist[b];
+      if (seen >= target) {
+        summary.latency_p99 = (b + 1) * kLatencyBinUs;
+        break;
+      }
+    }
+  }
+  summary.yaw_noise.samples = welford.GetCount();
+  summary.yaw_noise.mean = welford.GetMean();
+  summary.yaw_noise.std_dev = welford.GetStdDev();
+  allan.Summarize(scaled_sample_rate / 1000000.0, &summary.yaw_noise);
+
+  if (want_columns) {
+    std::string out = options.columns_dir + "/" + BaseName(path) + ".cols";
+    if (!WriteColumns(out, columns)) {
+      summary.error = "could not write " + out;
+    }
+  }
+  return summary;
+}
+
+void PrintTable(const std::vector<Summary>& summaries) {
+  std::printf("%-28s %9s %9s %6s %5s %8s %8s %8s %10s %10s %10s %10s %5s %5s\n",
+              "log", "dur(s)", "samples", "lost", "ovr", "lat(ms)", "p99(ms)", "max(ms)",
+              "heading", "drift/min", "ARW", "bias inst", "hits", "jumps");
+  for (const auto& s : summaries) {
+    std::string name = BaseName(s.name);
+    if (name.size() > 28) {
+      name = name.substr(name.size() - 28);
+    }
+    if (!s.error.empty()) {
+      std::printf("%-28s error: %s\n", name.c_str(), s.error.c_str());
+      continue;
+    }
+    std::printf("%-28s %9.2f %9llu %6llu %5llu %8.2f %8.2f %8.2f %10.3f %10.4f %10.5f %10.5f %5llu %5llu\n",
+                name.c_str(), s.duration, (unsigned long long)s.samples, (unsigned long long)s.lost_frames,
+                (unsigned long long)s.overruns, s.latency_mean / 1000.0, s.latency_p99 / 1000.0,
+                s.latency_max / 1000.0, s.final_heading, s.drift, s.yaw_noise.random_walk,
+                s.yaw_noise.bias_instability, (unsigned long long)s.collisions,
+                (unsigned long long)s.heading_jumps);
+  }
+}
+
+bool WriteCSV(const std::string& path, const std::vector<Summary>& summaries) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file, "log,error,duration_s,samples,lost_frames,overruns,records,latency_mean_ms,latency_p99_ms,"
+                     "latency_max_ms,final_heading_deg,rest_time_s,drift_deg_per_min,yaw_mean_dps,yaw_std_dps,"
+                     "yaw_random_walk,yaw_bias_instability_dps,yaw_bias_instability_tau_s,collisions,heading_jumps,"
+                     "trigger_causes,trigger_time_s\n");
+  for (const auto& s : summaries) {
+    std::fprintf(file, "%s,%s,%.6f,%llu,%llu,%llu,%llu,%.4f,%.4f,%.4f,%.6f,%.3f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%llu,%llu,%u,%.6f\n",
+                 s.name.c_str(), s.error.c_str(), s.duration, (unsigned long long)s.samples,
+                 (unsigned long long)s.lost_frames, (unsigned long long)s.overruns, (unsigned long long)s.records,
+                 s.latency_mean / 1000.0, s.latency_p99 / 1000.0, s.latency_max / 1000.0, s.final_heading,
+                 s.rest_time, s.drift, s.yaw_noise.mean, s.yaw_noise.std_dev, s.yaw_noise.random_walk,
+                 s.yaw_noise.bias_instability, s.yaw_noise.bias_instability_tau,
+                 (unsigned long long)s.collisions, (unsigned long long)s.heading_jumps,
+                 (unsigned)s.trigger_causes, s.trigger_time);
+  }
+  return std::fclose(file) == 0;
+}
+
+void Usage() {
+  std::fprintf(stderr,
+               "usage: adis16470logtool [-j threads] [--csv summary.csv] [--columns dir]\n"
+               "                        [--accel-threshold g] [--jump-threshold dps] log...\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "-j" && has_value) {
+      options->threads = std::atoi(argv[++i]);
+    }
+    else if (arg == "--csv" && has_value) {
+      options->csv_path = argv[++i];
+    }
+    else if (arg == "--columns" && has_value) {
+      options->columns_dir = argv[++i];
+    }
+    else if (arg == "--accel-threshold" && has_value) {
+      options->accel_threshold = std::atof(argv[++i]);
+    }
+    else if (arg == "--jump-threshold" && has_value) {
+      options->jump_threshold = std::atof(argv[++i]);
+    }
+    else if (!arg.empty() && arg[0] == '-') {
+      return false;
+    }
+    else {
+      options->logs.push_back(arg);
+    }
+  }
+  return !options->logs.empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, &options)) {
+    Usage();
+    return 1;
+  }
+
+  int threads = options.threads > 0 ? options.threads : int(std::thread::hardware_concurrency());
+  threads = std::max(1, std::min(threads, int(options.logs.size())));
+
+  // Logs vary a lot in length, so workers pull the next log as they finish instead of splitting up front
+  std::vector<Summary> summaries(options.logs.size());
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&] {
+      for (size_t i = next++; i < options.logs.size(); i = next++) {
+        summaries[i] = AnalyzeLog(options.logs[i], options);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  PrintTable(summaries);
+  if (!options.csv_path.empty() && !WriteCSV(options.csv_path, summaries)) {
+    std::fprintf(stderr, "could not write %s\n", options.csv_path.c_str());
+    return 1;
+  }
+  for (const auto& s : summaries) {
+    if (!s.error.empty()) {
+      return 2;
+    }
+  }
+  return 0;
+}
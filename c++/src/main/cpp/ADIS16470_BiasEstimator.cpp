@@ -0,0 +1,88 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <adi/ADIS16470_BiasEstimator.h>
+
+using namespace frc;
+
+void ADIS16470BiasEstimator::Configure(double target_std_error, double motion_threshold, double max_time) {
+  m_target_std_error = target_std_error;
+  m_motion_threshold = motion_threshold;
+  m_max_time = max_time;
+}
+
+void ADIS16470BiasEstimator::Reset() {
+  m_total_time = 0.0;
+  m_bias = ADIS16470HostBias();
+  for (auto& stats : m_stats) {
+    stats.Reset();
+  }
+}
+
+void ADIS16470BiasEstimator::Restart() {
+  for (auto& stats : m_stats) {
+    stats.Reset();
+  }
+  m_bias.samples = 0;
+  m_bias.time = 0.0;
+  m_bias.restarts++;
+}
+
+/**
+  * @brief Folds one sample into the estimate.
+  *
+  * @return True on the sample that makes the estimate converge. Later samples are ignored.
+  *
+  * The yaw bias is taken from the delta angle rather than the gyro output, because the delta
+  * angle is what gets integrated into the heading and it carries 32 bits of resolution.
+ **/
+bool ADIS16470BiasEstimator::Update(const ADIS16470Sample& sample) {
+  if (m_bias.converged || sample.dt <= 0.0) {
+    return false;
+  }
+  m_total_time += sample.dt;
+  const double values[4] = {sample.gyro_x, sample.gyro_y, sample.gyro_z, sample.delta_angle / sample.dt};
+
+  // Anything far from the running mean is the robot moving, not noise
+  if (m_stats[0].GetCount() >= kMinSamples) {
+    for (int i = 0; i < 3; i++) {
+      if (std::fabs(values[i] - m_stats[i].GetMean()) > m_motion_threshold) {
+        Restart();
+        break;
+      }
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    m_stats[i].Update(values[i]);
+  }
+  m_bias.samples++;
+  m_bias.time += sample.dt;
+
+  double std_error = 0.0;
+  for (int i = 0; i < 4; i++) {
+    std_error = std::max(std_error, m_stats[i].GetStdDev() / std::sqrt(double(m_stats[i].GetCount())));
+  }
+  m_bias.std_error = std_error;
+  m_bias.gyro_x = m_stats[0].GetMean();
+  m_bias.gyro_y = m_stats[1].GetMean();
+  m_bias.gyro_z = m_stats[2].GetMean();
+  m_bias.yaw = m_stats[3].GetMean();
+
+  if (m_bias.samples >= kMinSamples && std_error <= m_target_std_error) {
+    m_bias.converged = true;
+  }
+  else if (m_total_time >= m_max_time && m_bias.samples >= kMinSamples) {
+    m_bias.converged = true;
+    m_bias.timed_out = true;
+  }
+  return m_bias.converged;
+}
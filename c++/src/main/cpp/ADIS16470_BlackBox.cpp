@@ -0,0 +1,231 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <adi/ADIS16470_BlackBox.h>
+
+using namespace frc;
+
+ADIS16470BlackBox::~ADIS16470BlackBox() {
+  Close();
+}
+
+/**
+  * @brief Allocates both rings and starts the writer thread.
+  *
+  * Every slot is sized for the longest frame and touched once here, so Append() never allocates
+  * or faults in a page however the frame layout changes later.
+ **/
+void ADIS16470BlackBox::Open(const std::string& path_prefix, int pre_frames, int post_frames) {
+  Close();
+  m_prefix = path_prefix;
+  m_pre_frames = std::max(pre_frames, 0);
+  m_post_frames = std::max(post_frames, 1);
+  m_capacity = m_pre_frames + m_post_frames;
+  for (auto& capture : m_captures) {
+    capture.words.assign(size_t(m_capacity) * kADIS16470MaxFrameLen, 0);
+    capture.read_time.assign(m_capacity, 0);
+    capture.flags.assign(m_capacity, 0);
+    capture.head = 0;
+    capture.start = 0;
+    capture.config_words = 0;
+  }
+  m_active = &m_captures[0];
+  m_capturing = false;
+  m_pending = nullptr;
+  m_stop = false;
+  m_stats = ADIS16470BlackBoxStats();
+  m_thread = std::thread(&ADIS16470BlackBox::WriterLoop, this);
+}
+
+void ADIS16470BlackBox::Close() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> sync(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+void ADIS16470BlackBox::Reset(int frame_len, const uint32_t* config, int config_words) {
+  if (m_capturing) {
+    Complete();
+  }
+  m_active->frame_len = std::min(std::max(frame_len, 1), kADIS16470MaxFrameLen);
+  m_active->config_words = std::min(config_words, kMaxConfigWords);
+  std::copy(config, config + m_active->config_words, m_active->config);
+  m_active->start = m_active->head;
+}
+
+void ADIS16470BlackBox::Append(const uint32_t* words, int frames, uint64_t read_time, uint16_t flags) {
+  if (m_capacity == 0) {
+    return;
+  }
+  Capture& capture = *m_active;
+  for (int i = 0; i < frames; i++) {
+    size_t slot = capture.head % m_capacity;
+    std::memcpy(&capture.words[slot * kADIS16470MaxFrameLen], &words[i * capture.frame_len],
+                capture.frame_len * sizeof(uint32_t));
+    capture.read_time[slot] = read_time;
+    capture.flags[slot] = flags;
+    capture.head++;
+  }
+  if (m_capturing && capture.head - capture.trigger_frame >= uint64_t(m_post_frames)) {
+    Complete();
+  }
+}
+
+void ADIS16470BlackBox::Trigger(uint32_t causes, uint32_t timestamp, uint64_t host_time) {
+  if (m_capacity == 0 || m_capturing) {
+    return;
+  }
+  m_active->trigger_frame = m_active->head;
+  m_active->causes = causes;
+  m_active->trigger_timestamp = timestamp;
+  m_active->trigger_host_time = host_time;
+  m_capturing = true;
+}
+
+ADIS16470BlackBoxStats ADIS16470BlackBox::GetStats() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  ADIS16470BlackBoxStats stats = m_stats;
+  stats.capturing = m_capturing;
+  return stats;
+}
+
+/**
+  * @brief Hands the finished capture to the writer and carries on recording into the other ring.
+  *
+  * The new ring starts empty, with the same frame layout. If the writer still owns the other ring,
+  * the capture is dropped instead and the current ring keeps recording.
+ **/
+void ADIS16470BlackBox::Complete() {
+  m_capturing = false;
+  {
+    std::lock_guard<std::mutex> sync(m_mutex);
+    if (m_pending != nullptr) {
+      m_stats.captures_dropped++;
+      return;
+    }
+    m_pending = m_active;
+  }
+  m_cv.notify_one();
+  Capture* next = (m_active == &m_captures[0]) ? &m_captures[1] : &m_captures[0];
+  next->frame_len = m_active->frame_len;
+  next->config_words = m_active->config_words;
+  std::copy(m_active->config, m_active->config + kMaxConfigWords, next->config);
+  next->head = 0;
+  next->start = 0;
+  m_active = next;
+}
+
+/**
+  * @brief Writes one capture as a raw log.
+  *
+  * Frames are grouped back into one data record per acquisition pass, and the event record
+  * ([causes, trigger timestamp]) goes in at the trigger point.
+ **/
+bool ADIS16470BlackBox::Write(const Capture& capture, const std::string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  ADIS16470LogHeader header;
+  std::memcpy(header.magic, kADIS16470LogMagic, sizeof(header.magic));
+  header.version = kADIS16470LogVersion;
+  header.frame_len = capture.frame_len;
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  auto write_record = [&](uint16_t type, uint16_t flags, uint64_t host_time, const uint32_t* words, uint32_t count) {
+    ADIS16470LogRecord record;
+    record.type = type;
+    record.flags = flags;
+    record.word_count = count;
+    record.host_time = host_time;
+    std::fwrite(&record, sizeof(record), 1, file);
+    std::fwrite(words, sizeof(uint32_t), count, file);
+  };
+  const uint64_t first = std::max(capture.start, capture.head > uint64_t(m_capacity) ? capture.head - m_capacity : 0);
+  write_record(kADIS16470LogConfig, 0, capture.read_time[first % m_capacity], capture.config, capture.config_words);
+
+  const uint32_t event[2] = {capture.causes, capture.trigger_timestamp};
+  std::vector<uint32_t> pass;
+  for (uint64_t seq = first; seq < capture.head;) {
+    if (seq == capture.trigger_frame) {
+      write_record(kADIS16470LogEvent, 0, capture.trigger_host_time, event, 2);
+    }
+    size_t slot = seq % m_capacity;
+    const uint64_t read_time = capture.read_time[slot];
+    const uint16_t flags = capture.flags[slot];
+    pass.clear();
+    do {
+      const uint32_t* frame = &capture.words[(seq % m_capacity) * kADIS16470MaxFrameLen];
+      pass.insert(pass.end(), frame, frame + capture.frame_len);
+      seq++;
+    } while (seq < capture.head && seq != capture.trigger_frame && capture.read_time[seq % m_capacity] == read_time);
+    write_record(kADIS16470LogData, flags, read_time, pass.data(), uint32_t(pass.size()));
+  }
+  if (capture.trigger_frame >= capture.head) {
+    write_record(kADIS16470LogEvent, 0, capture.trigger_host_time, event, 2);
+  }
+  bool ok = !std::ferror(file);
+  return std::fclose(file) == 0 && ok;
+}
+
+/**
+  * @brief Returns path_prefix-NNN.adislog for the first index from *index on whose file doesn't exist yet, and moves *index past it.
+  *
+  * Earlier captures with the same prefix, from this run or an earlier one, are never overwritten.
+ **/
+static std::string NextCapturePath(const std::string& prefix, int* index) {
+  while (true) {
+    // Big enough for any int
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "-%03d.adislog", (*index)++);
+    std::string path = prefix + suffix;
+    FILE* existing = std::fopen(path.c_str(), "r");
+    if (!existing) {
+      return path;
+    }
+    std::fclose(existing);
+  }
+}
+
+/**
+  * @brief Background loop that writes finished captures. A pending capture is still written when closing.
+ **/
+void ADIS16470BlackBox::WriterLoop() {
+  int index = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_cv.wait(lock, [this] { return m_stop || m_pending != nullptr; });
+    if (m_pending == nullptr) {
+      break;
+    }
+    const Capture* capture = m_pending;
+    lock.unlock();
+    std::string path = NextCapturePath(m_prefix, &index);
+    bool ok = Write(*capture, path);
+    lock.lock();
+    if (ok) {
+      m_stats.captures_written++;
+      m_stats.last_file = path;
+    }
+    else {
+      m_stats.write_errors++;
+    }
+    m_pending = nullptr;
+  }
+}
@@ -0,0 +1,156 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <hal/CANAPI.h>
+
+#include <adi/ADIS16470_CANForwarder.h>
+
+using namespace frc;
+
+ADIS16470CANForwarder::~ADIS16470CANForwarder() {
+  Stop();
+}
+
+int32_t ADIS16470CANForwarder::Start(int device_id, int api_id, double rate, uint64_t now) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  CloseDevice();
+  m_stats = ADIS16470CANStats();
+  m_interval_sum = 0.0;
+  m_send_time_sum = 0.0;
+  m_age_sum = 0.0;
+  m_counter = 0;
+
+  int32_t status = 0;
+  HAL_CANHandle handle = HAL_InitializeCAN(static_cast<HAL_CANManufacturer>(kManufacturer), device_id,
+                                           static_cast<HAL_CANDeviceType>(kDeviceType), &status);
+  if (status != 0) {
+    return status;
+  }
+  m_handle = handle;
+  m_api_id = std::min(std::max(api_id, 0), 1023);
+  m_period = static_cast<uint64_t>(std::llround(1000000.0 / std::min(std::max(rate, 1.0), kMaxRate)));
+  m_next = now;
+  m_last_send = 0;
+  return 0;
+}
+
+void ADIS16470CANForwarder::Stop() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  CloseDevice();
+}
+
+void ADIS16470CANForwarder::CloseDevice() {
+  if (m_handle != HAL_kInvalidHandle) {
+    HAL_CleanCAN(m_handle);
+    m_handle = HAL_kInvalidHandle;
+  }
+}
+
+bool ADIS16470CANForwarder::IsActive() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_handle != HAL_kInvalidHandle;
+}
+
+bool ADIS16470CANForwarder::GetTimeToNext(uint64_t now, uint64_t* wait) const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (m_handle == HAL_kInvalidHandle) {
+    return false;
+  }
+  *wait = m_next > now ? m_next - now : 0;
+  return true;
+}
+
+/**
+  * @brief Sends the heading if a frame is due, then schedules the next one a period after the slot it filled.
+  *
+  * Keeping the schedule on a fixed grid means a late wake-up doesn't push every later frame back.
+  * A wake-up more than a period late skips the slots in between.
+ **/
+void ADIS16470CANForwarder::Update(uint64_t now, ADIS16470CANHeading heading, uint32_t sample_timestamp) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (m_handle == HAL_kInvalidHandle || now < m_next) {
+    return;
+  }
+  uint64_t late = (now - m_next) / m_period;
+  m_stats.skipped += late;
+  m_next += (late + 1) * m_period;
+
+  heading.counter = m_counter;
+  heading.age = static_cast<uint32_t>(static_cast<uint32_t>(now) - sample_timestamp) / 1000000.0;
+  uint8_t data[kPayloadSize];
+  Encode(heading, data);
+
+  int32_t status = 0;
+  auto start = std::chrono::steady_clock::now();
+  HAL_WriteCANPacket(m_handle, data, kPayloadSize, m_api_id, &status);
+  double send_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  m_send_time_sum += send_time;
+  m_stats.max_send_time = std::max(m_stats.max_send_time, send_time);
+  if (status != 0) {
+    m_stats.dropped++;
+    m_stats.last_status = status;
+  }
+  else {
+    if (m_stats.sent > 0) {
+      double interval = (now - m_last_send) / 1000000.0;
+      m_interval_sum += interval;
+      m_stats.max_interval = std::max(m_stats.max_interval, interval);
+    }
+    m_stats.sent++;
+    m_last_send = now;
+    m_age_sum += heading.age;
+    // Only frames that went out advance the counter, so a receiver's gaps are lost frames
+    m_counter = (m_counter + 1) & 0xF;
+  }
+  uint64_t attempts = m_stats.sent + m_stats.dropped;
+  m_stats.mean_send_time = m_send_time_sum / attempts;
+  m_stats.mean_interval = m_stats.sent > 1 ? m_interval_sum / (m_stats.sent - 1) : 0.0;
+  m_stats.mean_age = m_stats.sent > 0 ? m_age_sum / m_stats.sent : 0.0;
+}
+
+ADIS16470CANStats ADIS16470CANForwarder::GetStats() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_stats;
+}
+
+void ADIS16470CANForwarder::Encode(const ADIS16470CANHeading& heading, uint8_t* data) {
+  // The angle wraps modulo 2^32 milli-degrees, so differences stay right across the wrap
+  uint32_t angle = static_cast<uint32_t>(static_cast<int64_t>(std::llround(heading.angle * 1000.0)));
+  // Symmetric limits, so a saturated rate reads the same size either way
+  int16_t rate = static_cast<int16_t>(std::lround(std::min(std::max(heading.rate * 10.0, -32767.0), 32767.0)));
+  int age = static_cast<int>(std::lround(std::min(std::max(heading.age * 10000.0, 0.0), 255.0)));
+  for (int i = 0; i < 4; i++) {
+    data[i] = (angle >> (8 * i)) & 0xFF;
+  }
+  data[4] = static_cast<uint16_t>(rate) & 0xFF;
+  data[5] = (static_cast<uint16_t>(rate) >> 8) & 0xFF;
+  data[6] = static_cast<uint8_t>((heading.counter & 0xF) | ((heading.flags & 0xF) << 4));
+  data[7] = static_cast<uint8_t>(age);
+}
+
+bool ADIS16470CANForwarder::Decode(const uint8_t* data, int size, ADIS16470CANHeading* heading) {
+  if (size < kPayloadSize) {
+    return false;
+  }
+  uint32_t angle = 0;
+  for (int i = 0; i < 4; i++) {
+    angle |= static_cast<uint32_t>(data[i]) << (8 * i);
+  }
+  int16_t rate = static_cast<int16_t>(data[4] | (data[5] << 8));
+  heading->angle = static_cast<int32_t>(angle) / 1000.0;
+  heading->rate = rate / 10.0;
+  heading->counter = data[6] & 0xF;
+  heading->flags = data[6] >> 4;
+  heading->age = data[7] / 10000.0;
+  return true;
+}
@@ -0,0 +1,339 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <memory>
+
+#include <adi/ADIS16470_CAPI.h>
+#include <adi/ADIS16470_IMU.h>
+#include <adi/ADIS16470_SimTransport.h>
+#include <hal/HAL.h>
+
+using namespace frc;
+
+struct ADIS16470_Instance {
+  std::unique_ptr<ADIS16470_IMU> imu;
+  // The simulated transport (owned by imu), or null for a real IMU
+  ADIS16470SimTransport* sim = nullptr;
+};
+
+/* No exception may cross the C boundary, so every entry point runs its body through here */
+template <typename Body>
+static int32_t Call(ADIS16470_Handle handle, Body body) {
+  if (handle == nullptr || !handle->imu) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  try {
+    return body(*handle);
+  }
+  catch (...) {
+    return ADIS16470_STATUS_INTERNAL_ERROR;
+  }
+}
+
+/* Checks the arguments shared by both create calls */
+static bool ValidCreateArguments(int32_t yaw_axis, int32_t cal_time, int32_t startup, ADIS16470_Handle* handle) {
+  return handle != nullptr && yaw_axis >= ADIS16470_IMU::kX && yaw_axis <= ADIS16470_IMU::kZ &&
+         cal_time >= static_cast<int32_t>(ADIS16470CalibrationTime::_32ms) &&
+         cal_time <= static_cast<int32_t>(ADIS16470CalibrationTime::_64s) &&
+         (startup == static_cast<int32_t>(ADIS16470StartupMode::kWaitForCalibration) ||
+          startup == static_cast<int32_t>(ADIS16470StartupMode::kStreamFirst));
+}
+
+static int32_t ToStatus(int result) {
+  switch (result) {
+    case 0:
+      return ADIS16470_STATUS_OK;
+    case 1:
+      return ADIS16470_STATUS_NO_CHANGE;
+    default:
+      return ADIS16470_STATUS_FAILED;
+  }
+}
+
+int32_t ADIS16470_GetAPIVersion(void) {
+  return ADIS16470_API_VERSION;
+}
+
+/**
+  * @brief Initializes the HAL if needed, then resets, calibrates and starts the IMU.
+  *
+  * HAL_Initialize() does nothing if the HAL is already up, so this is safe to call from a program
+  * that initialized it itself.
+ **/
+int32_t ADIS16470_Create(int32_t yaw_axis, int32_t spi_port, int32_t cal_time, int32_t startup,
+                         ADIS16470_Handle* handle) {
+  if (!ValidCreateArguments(yaw_axis, cal_time, startup, handle) ||
+      spi_port < SPI::Port::kOnboardCS0 || spi_port > SPI::Port::kMXP) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  *handle = nullptr;
+  try {
+    if (!HAL_Initialize(500, 0)) {
+      return ADIS16470_STATUS_FAILED;
+    }
+    auto instance = std::make_unique<ADIS16470_Instance>();
+    instance->imu = std::make_unique<ADIS16470_IMU>(static_cast<ADIS16470_IMU::IMUAxis>(yaw_axis),
+                                                    static_cast<SPI::Port>(spi_port),
+                                                    static_cast<ADIS16470CalibrationTime>(cal_time),
+                                                    static_cast<ADIS16470StartupMode>(startup));
+    // The constructor reports a missing IMU to the DS and returns; the instance would never produce data
+    if (!instance->imu->IsInitialized()) {
+      return ADIS16470_STATUS_FAILED;
+    }
+    *handle = instance.release();
+    return ADIS16470_STATUS_OK;
+  }
+  catch (...) {
+    return ADIS16470_STATUS_INTERNAL_ERROR;
+  }
+}
+
+/* Shared by both simulated create calls */
+static int32_t CreateSim(int32_t yaw_axis, int32_t cal_time, int32_t startup, uint32_t seed, uint16_t product_id,
+                         ADIS16470_Handle* handle) {
+  if (!ValidCreateArguments(yaw_axis, cal_time, startup, handle)) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  *handle = nullptr;
+  try {
+    if (!HAL_Initialize(500, 0)) {
+      return ADIS16470_STATUS_FAILED;
+    }
+    auto instance = std::make_unique<ADIS16470_Instance>();
+    auto transport = std::make_unique<ADIS16470SimTransport>(seed);
+    instance->sim = transport.get();
+    transport->SetProductID(product_id);
+    // The caller sleeps on the virtual clock too, and the clock must not run ahead of it
+    transport->AttachThread();
+    instance->imu = std::make_unique<ADIS16470_IMU>(static_cast<ADIS16470_IMU::IMUAxis>(yaw_axis),
+                                                    std::move(transport),
+                                                    static_cast<ADIS16470CalibrationTime>(cal_time),
+                                                    static_cast<ADIS16470StartupMode>(startup));
+    if (!instance->imu->IsInitialized()) {
+      return ADIS16470_STATUS_FAILED;
+    }
+    *handle = instance.release();
+    return ADIS16470_STATUS_OK;
+  }
+  catch (...) {
+    return ADIS16470_STATUS_INTERNAL_ERROR;
+  }
+}
+
+int32_t ADIS16470_CreateSim(int32_t yaw_axis, int32_t cal_time, int32_t startup, uint32_t seed,
+                            ADIS16470_Handle* handle) {
+  return CreateSim(yaw_axis, cal_time, startup, seed, 16470, handle);
+}
+
+int32_t ADIS16470_CreateSimWithProductID(int32_t yaw_axis, int32_t cal_time, int32_t startup, uint32_t seed,
+                                         int32_t product_id, ADIS16470_Handle* handle) {
+  if (product_id < 0 || product_id > 0xFFFF) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return CreateSim(yaw_axis, cal_time, startup, seed, static_cast<uint16_t>(product_id), handle);
+}
+
+int32_t ADIS16470_Destroy(ADIS16470_Handle handle) {
+  if (handle == nullptr) {
+    return ADIS16470_STATUS_OK;
+  }
+  try {
+    // The IMU destructor joins the acquisition thread, and the simulated transport goes with it
+    delete handle;
+    return ADIS16470_STATUS_OK;
+  }
+  catch (...) {
+    return ADIS16470_STATUS_INTERNAL_ERROR;
+  }
+}
+
+int32_t ADIS16470_GetSnapshot(ADIS16470_Handle handle, ADIS16470_Snapshot* snapshot) {
+  if (snapshot == nullptr) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    ADIS16470Snapshot latest = instance.imu->GetSnapshot();
+    snapshot->sequence = latest.sequence;
+    snapshot->timestamp = latest.timestamp;
+    snapshot->angle = latest.angle;
+    snapshot->rate = latest.rate;
+    snapshot->gyro_x = latest.gyro_x;
+    snapshot->gyro_y = latest.gyro_y;
+    snapshot->gyro_z = latest.gyro_z;
+    snapshot->accel_x = latest.accel_x;
+    snapshot->accel_y = latest.accel_y;
+    snapshot->accel_z = latest.accel_z;
+    snapshot->comp_angle_x = latest.comp_angle_x;
+    snapshot->comp_angle_y = latest.comp_angle_y;
+    snapshot->accel_angle_x = latest.accel_angle_x;
+    snapshot->accel_angle_y = latest.accel_angle_y;
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_GetLatestSequence(ADIS16470_Handle handle, uint64_t* sequence) {
+  if (sequence == nullptr) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    *sequence = instance.imu->GetLatestSequence();
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+/**
+  * @brief Copies samples out of the sample history as rows of ADIS16470_SAMPLE_FIELDS doubles.
+  *
+  * Samples are copied in chunks on the stack and widened into the caller's rows, so a LabVIEW 2D
+  * array can be passed straight in without any per-call allocation.
+ **/
+int32_t ADIS16470_GetSamples(ADIS16470_Handle handle, uint64_t* sequence, double* samples, int32_t max_samples,
+                             int32_t* count) {
+  if (sequence == nullptr || count == nullptr || max_samples < 0 || (samples == nullptr && max_samples > 0)) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  *count = 0;
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    constexpr int kChunk = 64;
+    ADIS16470Sample chunk[kChunk];
+    while (*count < max_samples) {
+      int copied = instance.imu->GetSamples(sequence, chunk, std::min(kChunk, max_samples - *count));
+      for (int i = 0; i < copied; i++) {
+        const ADIS16470Sample& sample = chunk[i];
+        double* row = &samples[(*count + i) * ADIS16470_SAMPLE_FIELDS];
+        row[ADIS16470_SAMPLE_TIMESTAMP] = sample.timestamp;
+        row[ADIS16470_SAMPLE_DT] = sample.dt;
+        row[ADIS16470_SAMPLE_GYRO_X] = sample.gyro_x;
+        row[ADIS16470_SAMPLE_GYRO_Y] = sample.gyro_y;
+        row[ADIS16470_SAMPLE_GYRO_Z] = sample.gyro_z;
+        row[ADIS16470_SAMPLE_ACCEL_X] = sample.accel_x;
+        row[ADIS16470_SAMPLE_ACCEL_Y] = sample.accel_y;
+        row[ADIS16470_SAMPLE_ACCEL_Z] = sample.accel_z;
+        row[ADIS16470_SAMPLE_ANGLE] = sample.angle;
+        row[ADIS16470_SAMPLE_DIAG_STAT] = sample.diag_stat;
+      }
+      *count += copied;
+      if (copied < kChunk) {
+        break;
+      }
+    }
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_Configure(ADIS16470_Handle handle, const ADIS16470_Config* config) {
+  if (config == nullptr ||
+      config->dec_rate < -1 || config->dec_rate > 1999 ||
+      config->filter < -1 || config->filter > 6 ||
+      config->cal_time < -1 || config->cal_time > static_cast<int32_t>(ADIS16470CalibrationTime::_64s) ||
+      config->yaw_axis < -1 || config->yaw_axis > ADIS16470_IMU::kZ ||
+      config->high_resolution_mask < -1 || config->high_resolution_mask > kADIS16470AllChannels ||
+      config->read_diag_stat < -1 || config->read_diag_stat > 1) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    ADIS16470Config changes;
+    if (config->dec_rate >= 0) {
+      changes.dec_rate = static_cast<uint16_t>(config->dec_rate);
+    }
+    if (config->filter >= 0) {
+      changes.filter = static_cast<uint16_t>(config->filter);
+    }
+    if (config->cal_time >= 0) {
+      changes.cal_time = static_cast<ADIS16470CalibrationTime>(config->cal_time);
+    }
+    if (config->yaw_axis >= 0) {
+      changes.yaw_axis = static_cast<ADIS16470_IMU::IMUAxis>(config->yaw_axis);
+    }
+    if (config->high_resolution_mask >= 0) {
+      changes.high_resolution_mask = static_cast<uint8_t>(config->high_resolution_mask);
+    }
+    if (config->read_diag_stat >= 0) {
+      changes.read_diag_stat = config->read_diag_stat == 1;
+    }
+    return ToStatus(instance.imu->Configure(changes));
+  });
+}
+
+int32_t ADIS16470_Calibrate(ADIS16470_Handle handle) {
+  return Call(handle, [](ADIS16470_Instance& instance) {
+    instance.imu->Calibrate();
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_ResetAngle(ADIS16470_Handle handle) {
+  return Call(handle, [](ADIS16470_Instance& instance) {
+    instance.imu->Reset();
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_StartRawLog(ADIS16470_Handle handle, const char* path) {
+  if (path == nullptr) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    return instance.imu->StartRawLog(path) ? ADIS16470_STATUS_OK : ADIS16470_STATUS_FAILED;
+  });
+}
+
+int32_t ADIS16470_StopRawLog(ADIS16470_Handle handle) {
+  return Call(handle, [](ADIS16470_Instance& instance) {
+    instance.imu->StopRawLog();
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_SimSetAngularRate(ADIS16470_Handle handle, double x, double y, double z) {
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    if (instance.sim == nullptr) {
+      return ADIS16470_STATUS_NOT_SIMULATED;
+    }
+    instance.sim->SetAngularRate(x, y, z);
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_SimSetAcceleration(ADIS16470_Handle handle, double x, double y, double z) {
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    if (instance.sim == nullptr) {
+      return ADIS16470_STATUS_NOT_SIMULATED;
+    }
+    instance.sim->SetAcceleration(x, y, z);
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_SimSleep(ADIS16470_Handle handle, double seconds) {
+  if (!(seconds >= 0.0)) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    if (instance.sim == nullptr) {
+      return ADIS16470_STATUS_NOT_SIMULATED;
+    }
+    instance.sim->Sleep(seconds);
+    return ADIS16470_STATUS_OK;
+  });
+}
+
+int32_t ADIS16470_SimGetTime(ADIS16470_Handle handle, double* seconds) {
+  if (seconds == nullptr) {
+    return ADIS16470_STATUS_INVALID_ARGUMENT;
+  }
+  return Call(handle, [&](ADIS16470_Instance& instance) {
+    if (instance.sim == nullptr) {
+      return ADIS16470_STATUS_NOT_SIMULATED;
+    }
+    *seconds = instance.sim->GetVirtualTime();
+    return ADIS16470_STATUS_OK;
+  });
+}
@@ -0,0 +1,214 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+
+#include <adi/ADIS16470_FaultTransport.h>
+
+using namespace frc;
+
+ADIS16470FaultTransport::ADIS16470FaultTransport(std::unique_ptr<ADIS16470Transport> inner, uint32_t seed)
+    : m_inner(std::move(inner)), m_rng(seed) {}
+
+const char* ADIS16470FaultTransport::GetFaultName(Fault fault) {
+  static const char* const names[kNumFaults] = {
+    "drop-frame", "bit-flip", "extra-word", "missing-word", "timestamp-jump",
+    "stall", "slow-read", "stray-words", "register-bit-flip"
+  };
+  return fault >= 0 && fault < kNumFaults ? names[fault] : "unknown";
+}
+
+void ADIS16470FaultTransport::SetProbability(Fault fault, double probability) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_probability[fault] = std::max(0.0, std::min(1.0, probability));
+}
+
+void ADIS16470FaultTransport::Inject(Fault fault) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_armed[fault]++;
+}
+
+void ADIS16470FaultTransport::SetStallTime(double seconds) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_stall_time = std::max(seconds, 0.0);
+}
+
+void ADIS16470FaultTransport::SetSlowReadTime(double seconds) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_slow_read_time = std::max(seconds, 0.0);
+}
+
+void ADIS16470FaultTransport::SetTimestampJump(uint32_t us) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_timestamp_jump = us;
+}
+
+ADIS16470FaultTransport::Stats ADIS16470FaultTransport::GetStats() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_stats;
+}
+
+/* Decides whether a fault happens at this chance and counts it */
+bool ADIS16470FaultTransport::Fire(Fault fault) {
+  bool fire = false;
+  if (m_armed[fault] > 0) {
+    m_armed[fault]--;
+    fire = true;
+  }
+  else if (m_probability[fault] > 0.0) {
+    fire = m_uniform(m_rng) < m_probability[fault];
+  }
+  if (fire) {
+    m_stats.injected[fault]++;
+  }
+  return fire;
+}
+
+int ADIS16470FaultTransport::Read(bool initiate, uint8_t* data, int size) {
+  int result = m_inner->Read(initiate, data, size);
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (size > 0 && Fire(kRegisterBitFlip)) {
+    int bit = std::uniform_int_distribution<int>(0, size * 8 - 1)(m_rng);
+    data[bit / 8] ^= 1 << (bit % 8);
+  }
+  return result;
+}
+
+void ADIS16470FaultTransport::InitAuto(int buffer_size) {
+  m_inner->InitAuto(buffer_size);
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_capacity = std::max(buffer_size, 0);
+  m_incoming.clear();
+  m_fifo.clear();
+}
+
+void ADIS16470FaultTransport::SetAutoTransmitData(const uint8_t* data, int size, int zero_size) {
+  m_inner->SetAutoTransmitData(data, size, zero_size);
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_frame_len = 1 + size + zero_size;
+  m_incoming.clear();
+}
+
+/**
+  * @brief Restarts auto SPI. Stray words from the last StopAuto() land in the FIFO first, like a partial frame.
+ **/
+void ADIS16470FaultTransport::StartAutoTrigger() {
+  m_inner->StartAutoTrigger();
+  uint32_t timestamp = static_cast<uint32_t>(m_inner->GetTime());
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (m_stray_pending) {
+    m_stray_pending = false;
+    int count = std::uniform_int_distribution<int>(1, std::max(m_frame_len - 1, 1))(m_rng);
+    std::uniform_int_distribution<uint32_t> byte(0, 0xFF);
+    std::vector<uint32_t> words(count);
+    words[0] = timestamp;
+    for (int i = 1; i < count; i++) {
+      words[i] = byte(m_rng);
+    }
+    Push(words.data(), words.size());
+  }
+  m_stalled = false;
+}
+
+void ADIS16470FaultTransport::StopAuto() {
+  m_inner->StopAuto();
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (Fire(kStrayWords)) {
+    m_stray_pending = true;
+  }
+}
+
+int ADIS16470FaultTransport::ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) {
+  double delay = 0.0;
+  int result;
+  {
+    std::lock_guard<std::mutex> sync(m_mutex);
+    Pump();
+    if (Fire(kSlowRead)) {
+      delay = m_slow_read_time;
+    }
+    if (num_to_read <= 0) {
+      result = static_cast<int>(m_fifo.size());
+    }
+    else {
+      int count = std::min(num_to_read, static_cast<int>(m_fifo.size()));
+      std::copy(m_fifo.begin(), m_fifo.begin() + count, buffer);
+      m_fifo.erase(m_fifo.begin(), m_fifo.begin() + count);
+      result = static_cast<int>(m_fifo.size());
+    }
+  }
+  // Block outside the lock, like a read stuck on the FPGA
+  if (delay > 0.0) {
+    m_inner->Sleep(delay);
+  }
+  return result;
+}
+
+/* Moves whole frames from the wrapped FIFO into this one, applying frame faults on the way */
+void ADIS16470FaultTransport::Pump() {
+  uint32_t unused;
+  int available = m_inner->ReadAutoReceivedData(&unused, 0, 0.0);
+  if (available > 0) {
+    size_t old_size = m_incoming.size();
+    m_incoming.resize(old_size + available);
+    m_inner->ReadAutoReceivedData(&m_incoming[old_size], available, 0.0);
+  }
+  const size_t frame_len = m_frame_len;
+  size_t offset = 0;
+  for (; offset + frame_len <= m_incoming.size(); offset += frame_len) {
+    PassFrame(&m_incoming[offset]);
+  }
+  m_incoming.erase(m_incoming.begin(), m_incoming.begin() + offset);
+}
+
+void ADIS16470FaultTransport::PassFrame(uint32_t* frame) {
+  const int frame_len = m_frame_len;
+  if (m_stalled && static_cast<int32_t>(frame[0] - m_stall_until) < 0) {
+    m_stats.frames_dropped++;
+    return;
+  }
+  m_stalled = false;
+  if (Fire(kStall)) {
+    m_stalled = true;
+    m_stall_until = frame[0] + static_cast<uint32_t>(m_stall_time * 1e6);
+    m_stats.frames_dropped++;
+    return;
+  }
+  if (Fire(kDropFrame)) {
+    m_stats.frames_dropped++;
+    return;
+  }
+  m_frame.assign(frame, frame + frame_len);
+  if (Fire(kTimestampJump)) {
+    m_frame[0] += m_timestamp_jump;
+  }
+  if (Fire(kBitFlip)) {
+    int bit = std::uniform_int_distribution<int>(0, frame_len * 32 - 1)(m_rng);
+    m_frame[bit / 32] ^= 1u << (bit % 32);
+  }
+  if (frame_len > 1 && Fire(kMissingWord)) {
+    int index = std::uniform_int_distribution<int>(1, frame_len - 1)(m_rng);
+    m_frame.erase(m_frame.begin() + index);
+  }
+  if (Fire(kExtraWord)) {
+    m_frame.push_back(std::uniform_int_distribution<uint32_t>(0, 0xFF)(m_rng));
+  }
+  if (Push(m_frame.data(), m_frame.size())) {
+    m_stats.frames_passed++;
+  }
+}
+
+bool ADIS16470FaultTransport::Push(const uint32_t* words, size_t count) {
+  if (m_fifo.size() + count > m_capacity) {
+    m_stats.frames_overflowed++;
+    return false;
+  }
+  m_fifo.insert(m_fifo.end(), words, words + count);
+  return true;
+}
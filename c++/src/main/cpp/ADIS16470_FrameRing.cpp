@@ -0,0 +1,94 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include <adi/ADIS16470_FrameRing.h>
+
+using namespace frc;
+
+/**
+  * @brief Allocates the frame and sample storage in one block and tries to page-lock it.
+  *
+  * Slots are sized for the longest frame, so the frame length can change without reallocating.
+  * The storage is touched once here so every page is resident before the acquisition thread runs.
+ **/
+ADIS16470FrameRing::ADIS16470FrameRing(int capacity, int write_reserve) :
+                    m_capacity(std::max(capacity, 1)),
+                    m_write_reserve(std::min(std::max(write_reserve, 0), m_capacity)),
+                    m_frame_len(1) {
+  size_t words_size = sizeof(uint32_t) * kADIS16470MaxFrameLen * m_capacity;
+  // Keep the samples aligned
+  words_size = (words_size + alignof(ADIS16470Sample) - 1) & ~(alignof(ADIS16470Sample) - 1);
+  m_storage_size = words_size + sizeof(ADIS16470Sample) * m_capacity;
+#ifndef _WIN32
+  void* storage = mmap(nullptr, m_storage_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (storage == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  m_storage = storage;
+  // Locking needs a high enough RLIMIT_MEMLOCK. Without it the ring still works, just pageable.
+  m_locked = mlock(m_storage, m_storage_size) == 0;
+#else
+  m_storage = std::calloc(1, m_storage_size);
+  if (!m_storage) {
+    throw std::bad_alloc();
+  }
+#endif
+  std::memset(m_storage, 0, m_storage_size);
+  m_words = static_cast<uint32_t*>(m_storage);
+  m_samples = reinterpret_cast<ADIS16470Sample*>(static_cast<char*>(m_storage) + words_size);
+  for (int i = 0; i < m_capacity; i++) {
+    new (&m_samples[i]) ADIS16470Sample();
+  }
+}
+
+ADIS16470FrameRing::~ADIS16470FrameRing() {
+#ifndef _WIN32
+  if (m_locked) {
+    munlock(m_storage, m_storage_size);
+  }
+  munmap(m_storage, m_storage_size);
+#else
+  std::free(m_storage);
+#endif
+}
+
+void ADIS16470FrameRing::Reset(int frame_len) {
+  m_frame_len = std::min(std::max(frame_len, 1), kADIS16470MaxFrameLen);
+  m_valid_from = m_head;
+}
+
+uint64_t ADIS16470FrameRing::GetOldest() const {
+  uint64_t span = uint64_t(m_capacity - m_write_reserve);
+  uint64_t oldest = m_head > span ? m_head - span : 0;
+  return std::max(oldest, m_valid_from);
+}
+
+/**
+  * @brief Returns where frame seq goes and how many frames fit before the end of the storage.
+  *
+  * @param seq Sequence number of the first frame to write (normally GetHead() plus frames already written).
+  *
+  * @param max_frames Receives the number of frames that can be written contiguously from the returned slot.
+  *
+  * A drain that crosses the end of the storage takes two reads: one up to the end and one from the start.
+ **/
+uint32_t* ADIS16470FrameRing::WriteSpan(uint64_t seq, int* max_frames) {
+  size_t slot = Slot(seq);
+  *max_frames = m_capacity - static_cast<int>(slot);
+  return &m_words[slot * m_frame_len];
+}
@@ -0,0 +1,135 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstring>
+
+#include <adi/ADIS16470_FrameSync.h>
+
+using namespace frc;
+
+/* Words held while searching. Older words are discarded. */
+static constexpr size_t kMaxPendingWords = 1 << 16;
+
+void ADIS16470FrameSync::Reset(int frame_len, uint32_t max_gap) {
+  m_frame_len = std::max(frame_len, 1);
+  m_max_gap = std::max<uint32_t>(max_gap, 1);
+  m_resyncing = false;
+  m_found = false;
+  m_skip = 0;
+  m_pending.clear();
+  m_start = 0;
+}
+
+bool ADIS16470FrameSync::IsValid(const uint32_t* frame, uint32_t previous_timestamp, bool check_timestamp) const {
+  if (frame[0] <= kMaxByte) {
+    return false;
+  }
+  // OR the data words together so the check is one compare per frame
+  uint32_t bits = 0;
+  for (int i = 1; i < m_frame_len; i++) {
+    bits |= frame[i];
+  }
+  if (bits > kMaxByte) {
+    return false;
+  }
+  if (check_timestamp) {
+    uint32_t elapsed = frame[0] - previous_timestamp;
+    return elapsed > 0 && elapsed <= m_max_gap;
+  }
+  return true;
+}
+
+void ADIS16470FrameSync::Begin(const uint32_t* words, size_t count) {
+  m_resyncing = true;
+  m_found = false;
+  m_skip = 0;
+  m_pending.assign(words, words + count);
+  m_start = 0;
+}
+
+void ADIS16470FrameSync::Append(const uint32_t* words, size_t count) {
+  m_pending.insert(m_pending.end(), words, words + count);
+  if (m_pending.size() - m_start > kMaxPendingWords) {
+    size_t drop = m_pending.size() - m_start - kMaxPendingWords;
+    m_discarded += drop;
+    m_start += drop;
+    m_found = false;
+  }
+}
+
+void ADIS16470FrameSync::Skipped(int words) {
+  m_skip = std::max(m_skip - words, 0);
+  m_discarded += words;
+}
+
+/* A frame boundary: a plausible frame followed by the timestamp of the next one */
+bool ADIS16470FrameSync::IsBoundary(size_t offset) const {
+  const uint32_t* frame = &m_pending[offset];
+  if (!IsValid(frame, 0, false)) {
+    return false;
+  }
+  uint32_t elapsed = frame[m_frame_len] - frame[0];
+  return frame[m_frame_len] > kMaxByte && elapsed > 0 && elapsed <= m_max_gap;
+}
+
+/**
+  * @brief Looks for the frame boundary in the words collected so far and returns the frames after it.
+  *
+  * Every frame returned after the first one is checked against the timestamp of the one before,
+  * so a second fault among the collected words restarts the search there.
+ **/
+int ADIS16470FrameSync::Recover(uint32_t* frames, int max_frames) {
+  if (!m_resyncing) {
+    return 0;
+  }
+  const size_t frame_len = m_frame_len;
+  int count = 0;
+  for (;;) {
+    if (!m_found) {
+      while (m_start + frame_len + 1 <= m_pending.size() && !IsBoundary(m_start)) {
+        m_start++;
+        m_discarded++;
+      }
+      if (m_start + frame_len + 1 > m_pending.size()) {
+        break;
+      }
+      m_found = true;
+      m_last_timestamp = m_pending[m_start] - 1;
+    }
+    if (count == max_frames || m_start + frame_len > m_pending.size()) {
+      break;
+    }
+    const uint32_t* frame = &m_pending[m_start];
+    if (!IsValid(frame, m_last_timestamp, true)) {
+      m_found = false;
+      continue;
+    }
+    std::memcpy(&frames[count * frame_len], frame, frame_len * sizeof(uint32_t));
+    m_last_timestamp = frame[0];
+    m_start += frame_len;
+    count++;
+  }
+
+  if (m_found && m_start + frame_len > m_pending.size()) {
+    // Every whole frame is out. The rest starts a frame that is still arriving, so drop it and its tail.
+    size_t rest = m_pending.size() - m_start;
+    m_discarded += rest;
+    m_skip = rest > 0 ? int(frame_len - rest) : 0;
+    m_resyncing = false;
+    m_found = false;
+    m_pending.clear();
+    m_start = 0;
+  }
+  else {
+    m_pending.erase(m_pending.begin(), m_pending.begin() + m_start);
+    m_start = 0;
+  }
+  return count;
+}
@@ -0,0 +1,107 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <adi/ADIS16470_HeadingStore.h>
+
+using namespace frc;
+
+static constexpr uint32_t kHeadingMagic = 0x48414449; // "IDAH"
+static constexpr uint32_t kHeadingVersion = 1;
+
+ADIS16470HeadingStore::~ADIS16470HeadingStore() {
+  Close();
+}
+
+/**
+  * @brief Opens (creating if needed) the shared memory segment.
+  *
+  * A new segment is zero filled, so its magic does not match and Load() reports nothing stored
+  * until the first Store().
+ **/
+bool ADIS16470HeadingStore::Open(const std::string& name) {
+  Close();
+#ifndef _WIN32
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  if (ftruncate(fd, sizeof(Segment)) != 0) {
+    close(fd);
+    return false;
+  }
+  void* segment = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (segment == MAP_FAILED) {
+    return false;
+  }
+  m_segment = static_cast<Segment*>(segment);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ADIS16470HeadingStore::Close() {
+#ifndef _WIN32
+  if (m_segment != nullptr) {
+    munmap(m_segment, sizeof(Segment));
+  }
+#endif
+  m_segment = nullptr;
+}
+
+void ADIS16470HeadingStore::Store(const ADIS16470HeadingState& state) {
+  if (m_segment == nullptr) {
+    return;
+  }
+  uint32_t sequence = m_segment->sequence.load(std::memory_order_relaxed);
+  // An odd count left behind by a writer that died mid-update is simply continued
+  sequence |= 1;
+  m_segment->sequence.store(sequence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  m_segment->state = state;
+  m_segment->magic = kHeadingMagic;
+  m_segment->version = kHeadingVersion;
+  m_segment->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+bool ADIS16470HeadingStore::Load(ADIS16470HeadingState* state) const {
+  if (m_segment == nullptr) {
+    return false;
+  }
+  // A bounded number of retries, since the writer may have died between its two counter updates
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    uint32_t before = m_segment->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+    ADIS16470HeadingState copy = m_segment->state;
+    bool valid = m_segment->magic == kHeadingMagic && m_segment->version == kHeadingVersion;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_segment->sequence.load(std::memory_order_relaxed) == before) {
+      *state = copy;
+      return valid;
+    }
+  }
+  return false;
+}
+
+uint64_t ADIS16470HeadingStore::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -7,11 +7,15 @@
 /* Juan Chong - frcsupport@analog.com                                         */
 /*----------------------------------------------------------------------------*/
 
+#include <array>
 #include <string>
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 
 #include <adi/ADIS16470_IMU.h>
+#include <adi/ADIS16470_Profile.h>
+#include <adi/ADIS16470_SPITransport.h>
 
 #include <frc/DigitalInput.h>
 #include <frc/DigitalSource.h>
@@ -23,18 +27,6 @@
 #include <hal/HAL.h>
 
 /* Helpful conversion functions */
-static inline int32_t ToInt(const uint32_t *buf){
-  return (int32_t)( (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3] );
-}
-
-static inline uint16_t BuffToUShort(const uint32_t* buf) {
-  return ((uint16_t)(buf[0]) << 8) | buf[1];
-}
-
-static inline int16_t BuffToShort(const uint32_t* buf) {
-  return ((int16_t)(buf[0]) << 8) | buf[1];
-}
-
 static inline uint16_t ToUShort(const uint8_t* buf) {
   return ((uint16_t)(buf[0]) << 8) | buf[1];
 }
@@ -45,59 +37,98 @@ static inline int16_t ToShort(const uint8_t* buf) {
 
 using namespace frc;
 
+/* Auto SPI FIFO depth in frames (about 1 second of data at 400Hz) */
+static constexpr int kAutoFifoFrames = 430;
+
+/* Longest time between two good frames, in sample periods. Three frames in a row can drop without a resync. */
+static constexpr int kMaxFrameGapPeriods = 4;
+
+/* Sample history length (about 10 seconds at 400Hz with the full profile). Kept out of the header, so robot code sees one class layout whatever profile the library was built with. */
+static constexpr int kHistoryFrames = ADIS16470Profile::kHistoryFrames;
+
 /**
  * Constructor.
  */
 ADIS16470_IMU::ADIS16470_IMU() : ADIS16470_IMU(kZ, SPI::Port::kOnboardCS0, ADIS16470CalibrationTime::_4s) {}
 
-ADIS16470_IMU::ADIS16470_IMU(IMUAxis yaw_axis, SPI::Port port, ADIS16470CalibrationTime cal_time) : 
+ADIS16470_IMU::ADIS16470_IMU(IMUAxis yaw_axis, SPI::Port port, ADIS16470CalibrationTime cal_time,
+                             ADIS16470StartupMode startup, const std::string& heading_store) : 
+                ADIS16470_IMU(yaw_axis, std::make_unique<ADIS16470SPITransport>(port), cal_time, startup, heading_store) {}
+
+ADIS16470_IMU::ADIS16470_IMU(IMUAxis yaw_axis, std::unique_ptr<ADIS16470Transport> transport, ADIS16470CalibrationTime cal_time,
+                             ADIS16470StartupMode startup, const std::string& heading_store) : 
                 m_yaw_axis(yaw_axis), 
-                m_spi_port(port),
-                m_calibration_time((uint16_t)cal_time) {
-
-  // Force the IMU reset pin to toggle on startup (doesn't require DS enable)
-  // Relies on the RIO hardware by default configuring an output as low
-  // and configuring an input as high Z. The 10k pull-up resistor internal to the
-  // IMU then forces the reset line high for normal operation.
-  DigitalOutput *m_reset_out = new DigitalOutput(27);  // Drive SPI CS2 (IMU RST) low
-  Wait(0.01);  // Wait 10ms
-  delete m_reset_out;
-  new DigitalInput(27);  // Set SPI CS2 (IMU RST) high
-  Wait(0.5); // Wait 500ms for reset to complete
+                m_calibration_time((uint16_t)cal_time),
+                m_transport(std::move(transport)),
+                m_ring(kHistoryFrames, kMaxFramesPerRead),
+                m_batch_samples(ADIS16470Profile::kHistory ? kHistoryFrames : 0) {
+
+  // Time the whole startup sequence like any other reconfiguration
+  BeginReconfig();
+
+  // A restarted robot program can pick up where the previous one left off, as long as the IMU kept running
+  if (!heading_store.empty() && m_heading_store.Open(heading_store)) {
+    m_heading_restored = RestoreHeading();
+  }
+
+  if (!m_heading_restored) {
+    // Force the IMU reset pin to toggle on startup (doesn't require DS enable)
+    m_transport->SetResetAsserted(true);  // Drive SPI CS2 (IMU RST) low
+    m_transport->Sleep(0.01);  // Wait 10ms
+    m_transport->SetResetAsserted(false);  // Set SPI CS2 (IMU RST) high
+    m_transport->Sleep(0.5); // Wait 500ms for reset to complete
+  }
 
   // Configure standard SPI
   if(!SwitchToStandardSPI()){
     return;
   }
+  ReadRegister(SERIAL_NUM); // Dummy read, responses lag one read behind
+  m_serial_number = ReadRegister(SERIAL_NUM);
 
   // Set IMU internal decimation to 4 (output data rate of 2000 SPS / (4 + 1) = 400Hz)
-  WriteRegister(DEC_RATE, 0x0004);
+  WriteRegister(DEC_RATE, m_dec_rate);
   // Set data ready polarity (HIGH = Good Data), Disable gSense Compensation and PoP
   WriteRegister(MSC_CTRL, 0x0001);
   // Configure IMU internal Bartlett filter
-  WriteRegister(FILT_CTRL, 0x0000);
+  WriteRegister(FILT_CTRL, m_filter);
   // Configure continuous bias calibration time based on user setting
   WriteRegister(NULL_CNFG, m_calibration_time | 0x700);
 
-  // Notify DS that IMU calibration delay is active
-  DriverStation::ReportWarning("ADIS16470 IMU Detected. Starting initial calibration delay.");
+  if (m_heading_restored) {
+    // The IMU was not reset, so its bias null (or the restored host-side bias) is still valid
+    DriverStation::ReportWarning("ADIS16470 IMU Detected. Restored the heading from before the restart.");
+  }
+  else if (startup == ADIS16470StartupMode::kStreamFirst) {
+    // Stream right away. The bias is estimated on the host, giving up after the usual null window.
+    DriverStation::ReportWarning("ADIS16470 IMU Detected. Streaming while the gyro bias is estimated.");
+    m_bias_estimator.Configure(m_bias_estimator.GetTargetStdError(), 2.0, pow(2, m_calibration_time) / 2000 * 64);
+    m_bias_estimator.Reset();
+    m_bias_estimating = true;
+  }
+  else {
+    // Notify DS that IMU calibration delay is active
+    DriverStation::ReportWarning("ADIS16470 IMU Detected. Starting initial calibration delay.");
 
-  // Wait for samples to accumulate internal to the IMU (110% of user-defined time)
-  Wait(pow(2, m_calibration_time) / 2000 * 64 * 1.1);
+    // Wait for samples to accumulate internal to the IMU (110% of user-defined time)
+    m_transport->Sleep(pow(2, m_calibration_time) / 2000 * 64 * 1.1);
 
-  // Write offset calibration command to IMU
-  WriteRegister(GLOB_CMD, 0x0001);
+    // Write offset calibration command to IMU
+    WriteRegister(GLOB_CMD, 0x0001);
+  }
 
   // Configure and enable auto SPI
   if(!SwitchToAutoSPI()) {
     return;
   }
 
+  m_initialized = true;
+
   // Let the user know the IMU was initiallized successfully
   DriverStation::ReportWarning("ADIS16470 IMU Successfully Initialized!");
 
   // Drive SPI CS3 (IMU ready LED) low (active low)
-  new DigitalOutput(28); 
+  m_transport->SetReadyLED(true);
 
   // Report usage and post data to DS
   HAL_Report(HALUsageReporting::kResourceType_ADIS16470, 0);
@@ -119,41 +150,33 @@ bool ADIS16470_IMU::SwitchToStandardSPI(){
   if (m_thread_active) {
     m_thread_active = false;
     while (!m_thread_idle) {
-      Wait(0.01);
+      m_transport->Sleep(0.01);
     }
     std::cout << "Paused the IMU processing thread successfully!" << std::endl;
     // Maybe we're in auto SPI mode? If so, kill auto SPI, and then SPI.
-    if (m_spi != nullptr && m_auto_configured) {
-      m_spi->StopAuto();
+    if (m_transport->IsOpen() && m_auto_configured) {
+      m_transport->StopAuto();
       // We need to get rid of all the garbage left in the auto SPI buffer after stopping it.
       // Sometimes data magically reappears, so we have to check the buffer size a couple of times
       //  to be sure we got it all. Yuck.
       uint32_t trashBuffer[200];
-      Wait(0.1);
-      int data_count = m_spi->ReadAutoReceivedData(trashBuffer, 0, 0_s);
+      m_transport->Sleep(0.1);
+      int data_count = m_transport->ReadAutoReceivedData(trashBuffer, 0, 0.0);
       while (data_count > 0) {
         /* Receive data, max of 200 words at a time (prevent potential segfault) */
-        m_spi->ReadAutoReceivedData(trashBuffer, std::min(data_count, 200), 0_s);
+        m_transport->ReadAutoReceivedData(trashBuffer, std::min(data_count, 200), 0.0);
         /*Get the reamining data count */
-        data_count = m_spi->ReadAutoReceivedData(trashBuffer, 0, 0_s);
+        data_count = m_transport->ReadAutoReceivedData(trashBuffer, 0, 0.0);
       }
       std::cout << "Paused the auto SPI successfully!" << std::endl;
       }
   }
   // There doesn't seem to be a SPI port active. Let's try to set one up
-  if (m_spi == nullptr) {
+  if (!m_transport->IsOpen()) {
     std::cout << "Setting up a new SPI port." << std::endl;
-    m_spi = new SPI(m_spi_port);
-    m_spi->SetClockRate(2000000);
-    m_spi->SetMSBFirst();
-    m_spi->SetSampleDataOnTrailingEdge();
-    m_spi->SetClockActiveLow();
-    m_spi->SetChipSelectActiveLow();
-    ReadRegister(PROD_ID); // Dummy read
-
+    m_transport->OpenSPI();
     // Validate the product ID
-    uint16_t prod_id = ReadRegister(PROD_ID);
-    if (prod_id != 16982 && prod_id != 16470) {
+    if (!ReadProductID()) {
       DriverStation::ReportError("Could not find ADIS16470!");
       Close();
       return false;
@@ -162,9 +185,7 @@ bool ADIS16470_IMU::SwitchToStandardSPI(){
   }
   else {
     // Maybe the SPI port is active, but not in auto SPI mode? Try to read the product ID.
-    ReadRegister(PROD_ID); // Dummy read
-    uint16_t prod_id = ReadRegister(PROD_ID);
-    if (prod_id != 16982 && prod_id != 16470) {
+    if (!ReadProductID()) {
       DriverStation::ReportError("Could not find ADIS16470!");
       Close();
       return false;
@@ -190,42 +211,38 @@ bool ADIS16470_IMU::SwitchToStandardSPI(){
 bool ADIS16470_IMU::SwitchToAutoSPI(){
 
   // No SPI port has been set up. Go set one up first.
-  if(m_spi == nullptr){
+  if(!m_transport->IsOpen()){
     if(!SwitchToStandardSPI()){
       DriverStation::ReportError("Failed to start/restart auto SPI");
       return false;
     }
   }
-  // Only set up the interrupt if needed.
-  if (m_auto_interrupt == nullptr) {
-    m_auto_interrupt = new DigitalInput(26);
-  }
   // The auto SPI controller gets angry if you try to set up two instances on one bus.
+  // Size the FIFO for the largest frame so the precision can change without re-initializing it.
   if (!m_auto_configured) {
-    m_spi->InitAuto(8200);
+    m_transport->InitAuto(kAutoFifoFrames * kADIS16470MaxFrameLen);
     m_auto_configured = true;
   }
   // Do we need to change auto SPI settings?
-  switch (m_yaw_axis) {
-  case kX:
-    m_spi->SetAutoTransmitData(m_autospi_x_packet, 2);
-    break;
-  case kY:
-    m_spi->SetAutoTransmitData(m_autospi_y_packet, 2);
-    break;
-  default:
-    m_spi->SetAutoTransmitData(m_autospi_z_packet, 2);
-    break;
+  m_frame_layout = ADIS16470MakeFrameLayout(m_yaw_axis, m_high_resolution_mask, m_read_diag_stat);
+  m_transport->SetAutoTransmitData(m_frame_layout.packet, m_frame_layout.packet_size, 2);
+  // Warn if the frame takes most of a sample period to read
+  if (ADIS16470FrameTransferTime(m_frame_layout) > 0.8 * m_scaled_sample_rate / 1000000.0) {
+    DriverStation::ReportWarning("ADIS16470 auto SPI frame is too long for the sample rate. Increase the decimation or stream fewer 32-bit channels.");
   }
   // Configure auto stall time  
-  m_spi->ConfigureAutoStall(HAL_SPI_kOnboardCS0, 5, 1000, 1);
+  m_transport->ConfigureAutoStall(5, 1000, 1);
   // Kick off DMA SPI (Note: Device configration impossible after SPI DMA is activated)
-  // DR High = Data good (data capture should be triggered on the rising edge)
-  m_spi->StartAutoTrigger(*m_auto_interrupt, true, false);
+  m_transport->StartAutoTrigger();
+  // The frame contents may have changed, so tell the log reader
+  LogConfig();
   // Check to see if the acquire thread is running. If not, kick one off.
-  if(!m_thread_idle) {
+  if(!m_acquire_task.joinable()) {
     m_first_run = true;
+    m_thread_exit = false;
     m_thread_active = true;
+    // Attach before starting so a simulated clock never runs ahead of the new thread
+    m_transport->AttachThread();
     m_acquire_task = std::thread(&ADIS16470_IMU::Acquire, this);
     std::cout << "New IMU Processing thread activated!" << std::endl;
   }
@@ -246,26 +263,114 @@ bool ADIS16470_IMU::SwitchToAutoSPI(){
 }
 
 /**
-  * @brief Switches the active SPI port to standard SPI mode, writes a new value to the NULL_CNFG register in the IMU, and re-enables auto SPI.
+  * @brief Marks the start of a configuration change for latency reporting.
   *
-  * @param new_cal_time Calibration time to be set.
+  * The acquisition thread completes the record when it processes the first frame after auto SPI is
+  * restarted. See GetLastReconfigStats().
+ **/
+void ADIS16470_IMU::BeginReconfig() {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_reconfig_start = m_transport->GetTime();
+  m_reconfig_stats = ADIS16470ReconfigStats();
+  m_reconfig_pending = true;
+}
+
+/**
+  * @brief Returns the timing of the most recent configuration call (or of the constructor).
+  *
+  * @return Time to first sample, data blackout, and lost frames. The complete flag stays false
+  * until the first frame after the call has been processed.
+ **/
+ADIS16470ReconfigStats ADIS16470_IMU::GetLastReconfigStats() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_reconfig_stats;
+}
+
+/**
+  * @brief Returns the group delay (us) of a Bartlett filter setting.
+  *
+  * FILT_CTRL = B cascades two moving averages of N = 2^B samples at the 2000 Hz internal rate. Each
+  * stage delays the signal by (N - 1) / 2 samples, so the filter delays it by N - 1 samples.
+ **/
+static uint32_t BartlettGroupDelay(uint16_t size) {
+  return static_cast<uint32_t>(((1u << size) - 1) * 1000000u / 2000u);
+}
+
+/**
+  * @brief Applies several configuration changes in a single auto SPI pause.
+  *
+  * @param config The settings to change. Unset fields keep their current value.
   * 
-  * @return An int indicating the success or failure of writing the new NULL_CNFG setting and returning to auto SPI mode. 0 = Success, 1 = No Change, 2 = Failure
+  * @return An int indicating the success or failure of writing the new settings and returning to auto SPI mode. 0 = Success, 1 = No Change, 2 = Failure
   *
-  * This function enters standard SPI mode, writes a new NULL_CNFG setting to the IMU, and re-enters auto SPI mode. 
-  * This function does not include a blocking sleep, so the user must keep track of the elapsed offset calibration time
-  * themselves. After waiting the configured calibration time, the Calibrate() function should be called to activate the new
-  * offset calibration. 
+  * Every change costs the same pause (stopping auto SPI, the register writes, and restarting the sample
+  * stream), so changing several settings at once is much cheaper than calling each Config function in turn.
  **/
-int ADIS16470_IMU::ConfigCalTime(ADIS16470CalibrationTime new_cal_time) { 
-  if(m_calibration_time == (uint16_t)new_cal_time)
+int ADIS16470_IMU::Configure(const ADIS16470Config& config) {
+  bool changed = (config.dec_rate && *config.dec_rate != m_dec_rate) ||
+                 (config.filter && *config.filter != m_filter) ||
+                 (config.cal_time && (uint16_t)*config.cal_time != m_calibration_time) ||
+                 (config.yaw_axis && *config.yaw_axis != m_yaw_axis) ||
+                 (config.high_resolution_mask &&
+                  (*config.high_resolution_mask & kADIS16470AllChannels) != m_high_resolution_mask) ||
+                 (config.read_diag_stat && *config.read_diag_stat != m_read_diag_stat);
+  if(!changed)
     return 1;
+  BeginReconfig();
   if(!SwitchToStandardSPI()) {
     DriverStation::ReportError("Failed to configure/reconfigure standard SPI.");
     return 2;
   }
-  m_calibration_time = (uint16_t)new_cal_time;
-  WriteRegister(NULL_CNFG, m_calibration_time | 0x700);
+  if(config.dec_rate) {
+    m_dec_rate = *config.dec_rate;
+    if(m_dec_rate > 1999) {
+      DriverStation::ReportError("Attempted to write an invalid decimation value.");
+      m_dec_rate = 1999;
+    }
+    m_scaled_sample_rate = (((m_dec_rate + 1.0)/2000.0) * 1000000.0);
+    WriteRegister(DEC_RATE, m_dec_rate);
+    // Allan deviation clusters are counted in samples, so a new sample rate invalidates them
+    ResetNoiseStatistics();
+  }
+  if(config.filter) {
+    m_filter = *config.filter;
+    if(m_filter > 6) {
+      DriverStation::ReportError("Attempted to write an invalid filter size.");
+      m_filter = 6;
+    }
+    WriteRegister(FILT_CTRL, m_filter);
+    m_group_delay = BartlettGroupDelay(m_filter);
+  }
+  if(config.cal_time) {
+    m_calibration_time = (uint16_t)*config.cal_time;
+    WriteRegister(NULL_CNFG, m_calibration_time | 0x700);
+  }
+  // Frame contents, picked up by SwitchToAutoSPI()
+  if(config.yaw_axis) {
+    std::lock_guard<wpi::mutex> sync(m_mutex);
+    if (*config.yaw_axis != m_yaw_axis && (m_bias_estimating || m_host_bias.converged)) {
+      // The host-side delta angle bias belongs to the old axis
+      if (ADIS16470Profile::kAllChannels && m_host_bias.converged) {
+        // The new axis's gyro was measured with the rest, and its rate carries the same bias as its delta angle
+        m_host_bias.yaw = *config.yaw_axis == kX ? m_host_bias.gyro_x :
+                          *config.yaw_axis == kY ? m_host_bias.gyro_y : m_host_bias.gyro_z;
+      }
+      else {
+        // Nothing is known about the new axis (the yaw-only profile never decodes it), so estimate again
+        DriverStation::ReportWarning("ADIS16470 yaw axis changed. Estimating the gyro bias again; keep the robot still.");
+        m_host_bias = ADIS16470HostBias();
+        m_bias_estimator.Reset();
+        m_bias_estimating = true;
+      }
+    }
+    m_yaw_axis = *config.yaw_axis;
+  }
+  if(config.high_resolution_mask) {
+    m_high_resolution_mask = *config.high_resolution_mask & kADIS16470AllChannels;
+  }
+  if(config.read_diag_stat) {
+    m_read_diag_stat = *config.read_diag_stat;
+  }
   if(!SwitchToAutoSPI()) {
     DriverStation::ReportError("Failed to configure/reconfigure auto SPI.");
     return 2;
@@ -273,6 +378,49 @@ int ADIS16470_IMU::ConfigCalTime(ADIS16470CalibrationTime new_cal_time) {
   return 0;
 }
 
+/**
+  * @brief Switches the active SPI port to standard SPI mode, writes a new value to the FILT_CTRL register in the IMU, and re-enables auto SPI.
+  *
+  * @param size Bartlett filter size B (0 = off, up to 6). Each averaging stage is 2^B samples long.
+  * 
+  * @return An int indicating the success or failure of writing the new FILT_CTRL setting and returning to auto SPI mode. 0 = Success, 1 = No Change, 2 = Failure
+  *
+  * Filtering inside the IMU saves host-side filtering, but delays the outputs by (2^B - 1) / 2000 s.
+  * That delay is removed from every sample timestamp from the first frame after the change, so
+  * timestamp-based latency compensation stays correct.
+ **/
+int ADIS16470_IMU::ConfigFilter(uint16_t size) {
+  ADIS16470Config config;
+  config.filter = size;
+  return Configure(config);
+}
+
+uint16_t ADIS16470_IMU::GetFilter() const {
+  return m_filter;
+}
+
+double ADIS16470_IMU::GetFilterGroupDelay() const {
+  return m_group_delay / 1000000.0;
+}
+
+/**
+  * @brief Switches the active SPI port to standard SPI mode, writes a new value to the NULL_CNFG register in the IMU, and re-enables auto SPI.
+  *
+  * @param new_cal_time Calibration time to be set.
+  * 
+  * @return An int indicating the success or failure of writing the new NULL_CNFG setting and returning to auto SPI mode. 0 = Success, 1 = No Change, 2 = Failure
+  *
+  * This function enters standard SPI mode, writes a new NULL_CNFG setting to the IMU, and re-enters auto SPI mode. 
+  * This function does not include a blocking sleep, so the user must keep track of the elapsed offset calibration time
+  * themselves. After waiting the configured calibration time, the Calibrate() function should be called to activate the new
+  * offset calibration. 
+ **/
+int ADIS16470_IMU::ConfigCalTime(ADIS16470CalibrationTime new_cal_time) { 
+  ADIS16470Config config;
+  config.cal_time = new_cal_time;
+  return Configure(config);
+}
+
 /**
   * @brief Switches the active SPI port to standard SPI mode, writes a new value to the DECIMATE register in the IMU, and re-enables auto SPI.
   *
@@ -283,22 +431,9 @@ int ADIS16470_IMU::ConfigCalTime(ADIS16470CalibrationTime new_cal_time) {
   * This function enters standard SPI mode, writes a new DECIMATE setting to the IMU, adjusts the sample scale factor, and re-enters auto SPI mode. 
  **/
 int ADIS16470_IMU::ConfigDecRate(uint16_t reg) { 
-  uint16_t m_reg = reg;
-  if(!SwitchToStandardSPI()) {
-    DriverStation::ReportError("Failed to configure/reconfigure standard SPI.");
-    return 2;
-  }
-  if(m_reg > 1999) {
-    DriverStation::ReportError("Attempted to write an invalid decimation value.");
-    m_reg = 1999;
-  }
-  m_scaled_sample_rate = (((m_reg + 1.0)/2000.0) * 1000000.0);
-  WriteRegister(DEC_RATE, m_reg);
-  if(!SwitchToAutoSPI()) {
-    DriverStation::ReportError("Failed to configure/reconfigure auto SPI.");
-    return 2;
-  }
-  return 0;
+  ADIS16470Config config;
+  config.dec_rate = reg;
+  return Configure(config);
 }
 
 /**
@@ -309,28 +444,81 @@ int ADIS16470_IMU::ConfigDecRate(uint16_t reg) {
   * themselves. 
  **/
 void ADIS16470_IMU::Calibrate() {
+  BeginReconfig();
   if(!SwitchToStandardSPI()) {
     DriverStation::ReportError("Failed to configure/reconfigure standard SPI.");
   }
   WriteRegister(GLOB_CMD, 0x0001);
+  {
+    // The IMU removes the bias itself from now on
+    std::lock_guard<wpi::mutex> sync(m_mutex);
+    m_bias_estimating = false;
+    m_host_bias = ADIS16470HostBias();
+  }
   if(!SwitchToAutoSPI()) {
     DriverStation::ReportError("Failed to configure/reconfigure auto SPI.");
   }
 }
 
+/**
+  * @brief Switches the yaw axis.
+  *
+  * A host-side gyro bias (ADIS16470StartupMode::kStreamFirst) moves over to the new axis from that gyro's estimate.
+  * In the yaw-only profile the other gyros are never measured, so the bias is estimated again and the robot has to
+  * be still for it.
+ **/
 int ADIS16470_IMU::SetYawAxis(IMUAxis yaw_axis) {
-  if(m_yaw_axis == yaw_axis)
-    return 1; 
-  if(!SwitchToStandardSPI()) {
-    DriverStation::ReportError("Failed to configure/reconfigure standard SPI.");
-    return 2;
+  ADIS16470Config config;
+  config.yaw_axis = yaw_axis;
+  return Configure(config);
+}
+
+/**
+  * @brief Switches the active SPI port to standard SPI mode, changes which channels are streamed at 32 bits, and re-enables auto SPI.
+  *
+  * @param channel_mask ADIS16470ChannelBit() of each gyro and accelerometer channel to stream at full precision.
+  * 
+  * @return An int indicating the success or failure of changing the frame and returning to auto SPI mode. 0 = Success, 1 = No Change, 2 = Failure
+  *
+  * Each 32-bit channel adds its *_LOW register to the auto SPI frame. Every extra read costs about 33us of
+  * SPI time and two more FIFO words per sample, so the frame grows from 19 words (all 16-bit) to 31 words 
+  * (all 32-bit). Decoding a 32-bit channel costs a few extra shifts. See the README for a bandwidth table.
+ **/
+int ADIS16470_IMU::ConfigHighResolution(uint8_t channel_mask) {
+  ADIS16470Config config;
+  config.high_resolution_mask = channel_mask;
+  return Configure(config);
+}
+
+int ADIS16470_IMU::ConfigHighResolution(ADIS16470Channel channel, bool enable) {
+  uint8_t mask = m_high_resolution_mask;
+  if (enable) {
+    mask |= ADIS16470ChannelBit(channel);
   }
-  m_yaw_axis = yaw_axis;
-  if(!SwitchToAutoSPI()) {
-    DriverStation::ReportError("Failed to configure/reconfigure auto SPI.");
-    return 2;
+  else {
+    mask &= ~ADIS16470ChannelBit(channel);
   }
-  return 0;
+  return ConfigHighResolution(mask);
+}
+
+/**
+  * @brief Switches the active SPI port to standard SPI mode, adds or removes DIAG_STAT from the auto SPI frame, and re-enables auto SPI.
+  *
+  * @param enable True to read DIAG_STAT with every sample.
+  *
+  * @return An int indicating the success or failure of changing the frame and returning to auto SPI mode. 0 = Success, 1 = No Change, 2 = Failure
+  *
+  * DIAG_STAT costs one more read (about 33us) per sample. The IMU clears it on every read, so each
+  * sample's diag_stat holds the error flags raised since the previous sample.
+ **/
+int ADIS16470_IMU::ConfigDiagStatRead(bool enable) {
+  ADIS16470Config config;
+  config.read_diag_stat = enable;
+  return Configure(config);
+}
+
+uint8_t ADIS16470_IMU::GetHighResolutionMask() const {
+  return m_high_resolution_mask;
 }
 
 /**
@@ -350,12 +538,29 @@ uint16_t ADIS16470_IMU::ReadRegister(uint8_t reg) {
   buf[0] = reg & 0x7f;
   buf[1] = 0;
 
-  m_spi->Write(buf, 2);
-  m_spi->Read(false, buf, 2);
+  m_transport->Write(buf, 2);
+  m_transport->Read(false, buf, 2);
 
   return ToUShort(buf);
 }
 
+/**
+  * @brief Reads and validates the product ID.
+  *
+  * @return True if the IMU answered with a known product ID. A mismatch is read again a few times
+  * so a single corrupted transfer is not mistaken for a missing IMU.
+ **/
+bool ADIS16470_IMU::ReadProductID() {
+  ReadRegister(PROD_ID); // Dummy read
+  for (int attempt = 0; attempt < 3; attempt++) {
+    uint16_t prod_id = ReadRegister(PROD_ID);
+    if (prod_id == 16982 || prod_id == 16470) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /**
   * @brief Writes an unsigned, 16-bit value to two adjacent, 8-bit register locations over SPI.
   *
@@ -372,10 +577,10 @@ void ADIS16470_IMU::WriteRegister(uint8_t reg, uint16_t val) {
   uint8_t buf[2];
   buf[0] = 0x80 | reg;
   buf[1] = val & 0xff;
-  m_spi->Write(buf, 2);
+  m_transport->Write(buf, 2);
   buf[0] = 0x81 | reg;
   buf[1] = val >> 8;
-  m_spi->Write(buf, 2);
+  m_transport->Write(buf, 2);
 }
 
 /**
@@ -386,24 +591,27 @@ void ADIS16470_IMU::WriteRegister(uint8_t reg, uint16_t val) {
 void ADIS16470_IMU::Reset() {
   std::lock_guard<wpi::mutex> sync(m_mutex);
   m_integ_angle = 0.0;
+  m_integ_time = 0.0;
 }
 
 void ADIS16470_IMU::Close() {
-  if (m_thread_active) {
+  StopRawLog();
+  StopBlackBox();
+  if (m_acquire_task.joinable()) {
+    m_thread_exit = true;
     m_thread_active = false;
-    if (m_acquire_task.joinable()) m_acquire_task.join();
+    // Don't hold a simulated clock back while waiting for the thread to exit
+    m_transport->DetachThread();
+    m_acquire_task.join();
+    m_transport->AttachThread();
   }
-  if (m_spi != nullptr) {
+  StopCANForwarding();
+  if (m_transport->IsOpen()) {
     if (m_auto_configured) {
-      m_spi->StopAuto();
+      m_transport->StopAuto();
     }
-  delete m_spi;
-  m_auto_configured = false;
-    if (m_auto_interrupt != nullptr) {
-      delete m_auto_interrupt;
-      m_auto_interrupt = nullptr;
-    }
-    m_spi = nullptr;
+    m_transport->CloseSPI();
+    m_auto_configured = false;
   }
   std::cout << "Finished cleaning up after the IMU driver." << std::endl;
 }
@@ -430,208 +638,779 @@ ADIS16470_IMU::~ADIS16470_IMU() {
   * Complementary filter code was borrowed from https://github.com/tcleg/Six_Axis_Complementary_Filter
  **/
 void ADIS16470_IMU::Acquire() {
-  // Set data packet length
-  const int dataset_len = 19; // 18 data points + timestamp
-
-  /* Fixed buffer size */
-  const int BUFFER_SIZE = 4000;
-
-  // This buffer can contain many datasets
-  uint32_t buffer[BUFFER_SIZE];
-  int data_count = 0;
-  int data_remainder = 0;
-  int data_to_read = 0;
+  // Data packet length, refreshed whenever the thread is (re)activated
+  int dataset_len = m_frame_layout.frame_len;
+  // Words the last FIFO read reported as left behind
+  int fifo_remaining = 0;
   uint32_t previous_timestamp = 0;
-  double delta_angle = 0.0;
-  double gyro_x = 0.0;
-  double gyro_y = 0.0;
-  double gyro_z = 0.0;
-  double accel_x = 0.0;
-  double accel_y = 0.0;
-  double accel_z = 0.0;
-  double gyro_x_si = 0.0;
-  double gyro_y_si = 0.0;
-  //double gyro_z_si = 0.0;
-  double accel_x_si = 0.0;
-  double accel_y_si = 0.0;
-  double accel_z_si = 0.0;
-  double compAngleX = 0.0;
-  double compAngleY = 0.0;
-  double accelAngleX = 0.0;
-  double accelAngleY = 0.0;
-
-  while (true) {
-
-    // Sleep loop for 10ms (wait for data)
-	  Wait(.01);
+  m_ring.Reset(dataset_len);
+  m_frame_sync.Reset(dataset_len, kMaxFrameGapPeriods * m_scaled_sample_rate);
+  // FIFO words handed to the frame resync, allocated once
+  std::vector<uint32_t> sync_words(kMaxFramesPerRead * kADIS16470MaxFrameLen);
+  // Stream health, published with each pass
+  ADIS16470StreamStats stream;
+  uint64_t last_frame_time = m_transport->GetTime();
+  uint64_t resync_start = 0;
+  // Optional per-stage hardware counters. perf_event_open counts the thread that opens them, so they live here.
+  ADIS16470PerfCounters perf;
+  bool perf_enabled = false;
+  // Latest published heading for the CAN forwarder, and the timestamp of its sample
+  ADIS16470CANHeading can_heading;
+  uint32_t can_timestamp = 0;
+
+  while (!m_thread_exit) {
+
+    // Sleep loop for 10ms (wait for data), or until the next CAN frame is due
+    double sleep = .01;
+    uint64_t can_wait = 0;
+    if (m_thread_active && m_can_forwarder.GetTimeToNext(m_transport->GetTime(), &can_wait)) {
+      sleep = std::min(sleep, can_wait / 1000000.0);
+    }
+    m_transport->Sleep(sleep);
 
     if (m_thread_active) {
 
+      if (m_thread_idle) {
+        // The frame may have changed while the thread was paused
+        dataset_len = m_frame_layout.frame_len;
+        m_frame_sync.Reset(dataset_len, kMaxFrameGapPeriods * m_scaled_sample_rate);
+        last_frame_time = m_transport->GetTime();
+        stream.resyncing = false;
+        stream.stalled = false;
+        std::lock_guard<wpi::mutex> sync(m_mutex);
+        m_ring.Reset(dataset_len);
+        if (m_black_box_active) {
+          uint32_t config[kLogConfigWords];
+          GetLogConfig(config);
+          m_black_box.Reset(dataset_len, config, kLogConfigWords);
+        }
+      }
       m_thread_idle = false;
+      uint16_t log_flags = 0;
 
-      data_count = m_spi->ReadAutoReceivedData(buffer, 0, 0_s); // Read number of bytes currently stored in the buffer
-      data_remainder = data_count % dataset_len; // Check if frame is incomplete. Add 1 because of timestamp
-      data_to_read = data_count - data_remainder;  // Remove incomplete data from read count
-      /* Want to cap the data to read in a single read at the buffer size */
-      if(data_to_read > BUFFER_SIZE)
-      {
-          DriverStation::ReportWarning("ADIS16470 data processing thread overrun has occurred!");
-          data_to_read = BUFFER_SIZE - (BUFFER_SIZE % dataset_len);
+      if (m_perf_enabled != perf_enabled) {
+        perf_enabled = m_perf_enabled;
+        if (!perf_enabled) {
+          perf.Close();
+        }
+        else if (!perf.Open()) {
+          DriverStation::ReportWarning("ADIS16470 performance counters are not available on this system.");
+        }
+        std::lock_guard<wpi::mutex> sync(m_mutex);
+        m_perf_profile = perf.GetProfile();
+      }
+      perf.Begin();
+
+      const uint64_t first = m_ring.GetHead();
+      int frames_read = 0;
+      int span_frames = 0;
+      uint32_t* span = m_ring.WriteSpan(first, &span_frames);
+      int available = fifo_remaining >= dataset_len ? fifo_remaining
+                                                     : m_transport->ReadAutoReceivedData(span, 0, 0.0);
+
+      // A resync in progress gets the new words first. Its frames go straight into the ring.
+      if (m_frame_sync.IsResyncing()) {
+        int words = std::min(available, static_cast<int>(sync_words.size()));
+        if (words > 0) {
+          available = m_transport->ReadAutoReceivedData(sync_words.data(), words, 0.0);
+          m_frame_sync.Append(sync_words.data(), words);
+        }
+        frames_read = RecoverFrames(first, 0);
       }
-      m_spi->ReadAutoReceivedData(buffer, data_to_read, 0_s); // Read data from DMA buffer (only complete sets)
+      // Drop the rest of the partial frame a resync ended on
+      if (m_frame_sync.GetSkip() > 0 && available > 0) {
+        int words = std::min(m_frame_sync.GetSkip(), available);
+        available = m_transport->ReadAutoReceivedData(sync_words.data(), words, 0.0);
+        m_frame_sync.Skipped(words);
+      }
+      const int recovered = frames_read;
 
       /*
-      // DEBUG: Print buffer size and contents to terminal
-      std::cout << "Start - " << data_count << "," << data_remainder << "," << data_to_read << std::endl;
-      for (int m = 0; m < data_to_read - 1; m++ )
-      {
-        std::cout << buffer[m] << ",";
+       * Drain the FIFO straight into the ring. Every read returns the number of words left behind,
+       * so the separate count query is only needed when the previous read left less than a frame.
+       */
+      const bool aligned = !m_frame_sync.IsResyncing() && m_frame_sync.GetSkip() == 0;
+      while (aligned && available >= dataset_len && frames_read < kMaxFramesPerRead) {
+        span = m_ring.WriteSpan(first + frames_read, &span_frames);
+        int frames = std::min({available / dataset_len, span_frames, kMaxFramesPerRead - frames_read});
+        available = m_transport->ReadAutoReceivedData(span, frames * dataset_len, 0.0);
+        frames_read += frames;
+      }
+      fifo_remaining = available;
+      /* Want to cap the data read in a single pass at the history headroom */
+      if (fifo_remaining >= dataset_len) {
+          DriverStation::ReportWarning("ADIS16470 data processing thread overrun has occurred!");
+          log_flags |= kADIS16470LogOverrun;
+          stream.overruns++;
       }
-      std::cout << " " << std::endl;
-      std::cout << "End" << std::endl;
-      std::cout << "Reading " << data_count << " bytes." << std::endl;
-      */
-      
-      // Could be multiple data sets in the buffer. Handle each one.
-      for (int i = 0; i < data_to_read; i += dataset_len) {
-        // Timestamp is at buffer[i]
-        m_dt = (buffer[i] - previous_timestamp) / 1000000.0;
-        /* Get delta angle value for selected yaw axis and scale by the elapsed time (based on timestamp) */
-        delta_angle = (ToInt(&buffer[i + 3]) * delta_angle_sf) / (m_scaled_sample_rate / (buffer[i] - previous_timestamp));
-        gyro_x = (BuffToShort(&buffer[i + 7]) / 10.0);
-        gyro_y = (BuffToShort(&buffer[i + 9]) / 10.0);
-        gyro_z = (BuffToShort(&buffer[i + 11]) / 10.0);
-        accel_x = (BuffToShort(&buffer[i + 13]) / 800.0);
-        accel_y = (BuffToShort(&buffer[i + 15]) / 800.0);
-        accel_z = (BuffToShort(&buffer[i + 17]) / 800.0);
-
-        // Convert scaled sensor data to SI units
-        gyro_x_si = gyro_x * deg_to_rad;
-        gyro_y_si = gyro_y * deg_to_rad;
-        //gyro_z_si = gyro_z * deg_to_rad;
-        accel_x_si = accel_x * grav;
-        accel_y_si = accel_y * grav;
-        accel_z_si = accel_z * grav;
+      uint64_t read_time = m_transport->GetTime();
+      perf.Mark(ADIS16470Stage::kRead);
+
+      // Check the drained frames. From the first bad one on, the words go to the resync.
+      for (uint64_t seq = first + recovered; seq < first + frames_read; seq++) {
+        const bool has_previous = seq > first || !m_first_run;
+        const uint32_t previous = seq > first ? m_ring.GetFrame(seq - 1)[0] : previous_timestamp;
+        if (m_frame_sync.IsValid(m_ring.GetFrame(seq), previous, has_previous)) {
+          continue;
+        }
+        stream.corrupt_frames++;
+        stream.resyncs++;
+        if (!stream.resyncing) {
+          resync_start = read_time;
+        }
+        size_t words = 0;
+        for (uint64_t bad = seq; bad < first + frames_read; bad++) {
+          std::copy_n(m_ring.GetFrame(bad), dataset_len, &sync_words[words]);
+          words += dataset_len;
+        }
+        m_frame_sync.Begin(sync_words.data(), words);
+        frames_read = static_cast<int>(seq - first);
+        frames_read = RecoverFrames(first, frames_read);
+        break;
+      }
+      const bool resyncing = m_frame_sync.IsResyncing() || m_frame_sync.GetSkip() > 0;
+      if (stream.resyncing && !resyncing) {
+        stream.resync_time += (read_time - resync_start) / 1000000.0;
+      }
+      stream.resyncing = resyncing;
+      stream.discarded_words = m_frame_sync.GetDiscardedWords();
+
+      // No frames for much longer than a sample period means data ready stopped
+      const uint64_t stall_limit = std::max<uint64_t>(50000, static_cast<uint64_t>(20 * m_scaled_sample_rate));
+      if (frames_read > 0) {
+        if (stream.stalled) {
+          stream.stalled = false;
+          stream.stall_time += (read_time - last_frame_time) / 1000000.0;
+        }
+        last_frame_time = read_time;
+      }
+      else if (!stream.stalled && read_time - last_frame_time > stall_limit) {
+        stream.stalled = true;
+        stream.stalls++;
+      }
+      perf.Mark(ADIS16470Stage::kCheck);
+      can_heading.flags = (stream.stalled || stream.resyncing) ? kADIS16470CANStreamFault : 0;
 
-        // Store timestamp for next iteration
-        previous_timestamp = buffer[i];
+      if (frames_read == 0) {
+        {
+          std::lock_guard<wpi::mutex> sync(m_mutex);
+          m_stream_stats = stream;
+          if (perf.IsOpen()) {
+            perf.EndPass(0);
+            m_perf_profile = perf.GetProfile();
+          }
+        }
+        // Keep the CAN frames going with the last heading while the stream is quiet
+        m_can_forwarder.Update(m_transport->GetTime(), can_heading, can_timestamp);
+        continue;
+      }
+
+      // Hand the raw words to the log writer before touching them (two records if the drain wrapped)
+      if (ADIS16470Profile::kTelemetry && m_log_active) {
+        span = m_ring.WriteSpan(first, &span_frames);
+        int frames = std::min(frames_read, span_frames);
+        m_log.Append(kADIS16470LogData, frames == frames_read ? log_flags : 0, read_time, span, frames * dataset_len);
+        if (frames < frames_read) {
+          m_log.Append(kADIS16470LogData, log_flags, read_time, m_ring.GetFrame(first + frames),
+                       (frames_read - frames) * dataset_len);
+        }
+      }
+      perf.Mark(ADIS16470Stage::kLog);
+
+      // Black box trigger causes found in this pass, and the timestamp of the first frame that caused one
+      uint32_t black_box_causes = 0;
+      uint32_t black_box_timestamp = 0;
+      const bool black_box = ADIS16470Profile::kTelemetry && m_black_box_active;
+      const ADIS16470Channel yaw_gyro = static_cast<ADIS16470Channel>(m_yaw_axis);
 
-        /*
-        // DEBUG: Print timestamp and delta values
-        std::cout << previous_timestamp << "," << delta_x << "," << delta_y << "," << delta_z << std::endl;
-        */
+      if constexpr (ADIS16470Profile::kTilt) {
+        m_comp_filter.SetTau(m_comp_tau);
+        m_comp_filter.SetAccelRejection(m_comp_accel_rejection);
+      }
+
+      // Could be multiple data sets in the ring. Decode each one in place.
+      for (uint64_t seq = first; seq < first + frames_read; seq++) {
+        const uint32_t* frame = m_ring.GetFrame(seq);
+        ADIS16470Sample& sample = m_ring.GetSample(seq);
+        ADIS16470DecodeProfileFrame<ADIS16470Profile>(frame, m_frame_layout, previous_timestamp,
+                                                      m_scaled_sample_rate, yaw_gyro, &sample);
+        // The outputs lag the motion by the Bartlett filter's group delay
+        sample.timestamp -= m_group_delay;
 
-        m_alpha = m_tau / (m_tau + m_dt);
+        // Store timestamp for next iteration
+        previous_timestamp = frame[0];
 
-        if (m_first_run) {
-          accelAngleX = atan2f(accel_x_si, sqrtf((accel_y_si * accel_y_si) + (accel_z_si * accel_z_si)));
-          accelAngleY = atan2f(accel_y_si, sqrtf((accel_x_si * accel_x_si) + (accel_z_si * accel_z_si)));
-          compAngleX = accelAngleX;
-          compAngleY = accelAngleY;
+        if (m_first_run && seq == first) {
+          /* previous_timestamp is "very" old on the first frame, so it has no usable dt or delta angle */
+          sample.dt = 0.0;
+          sample.delta_angle = 0.0;
+          m_comp_filter.Reset();
         }
-        else {
-          // Process X angle
-          accelAngleX = atan2f(accel_x_si, sqrtf((accel_y_si * accel_y_si) + (accel_z_si * accel_z_si)));
-          accelAngleY = atan2f(accel_y_si, sqrtf((accel_x_si * accel_x_si) + (accel_z_si * accel_z_si)));
-          accelAngleX = FormatAccelRange(accelAngleX, accel_z_si);
-          accelAngleY = FormatAccelRange(accelAngleY, accel_z_si);
-          compAngleX = CompFilterProcess(compAngleX, accelAngleX, -gyro_y_si);
-          compAngleY = CompFilterProcess(compAngleY, accelAngleY, gyro_x_si);
+        else if (m_host_bias.converged) {
+          sample.gyro_x -= m_host_bias.gyro_x;
+          sample.gyro_y -= m_host_bias.gyro_y;
+          sample.gyro_z -= m_host_bias.gyro_z;
+          sample.delta_angle -= m_host_bias.yaw * sample.dt;
         }
 
-        // DEBUG: Print accumulated values
-        //std::cout << m_compAngleX << "," << m_compAngleY << std::endl;
+        if (black_box) {
+          uint32_t causes = 0;
+          if (sample.diag_stat != 0) {
+            causes |= kADIS16470TriggerDiagStat;
+          }
+          if (sample.accel_x * sample.accel_x + sample.accel_y * sample.accel_y >
+              m_black_box_accel * m_black_box_accel) {
+            causes |= kADIS16470TriggerAccel;
+          }
+          if (causes != 0 && black_box_causes == 0) {
+            black_box_timestamp = frame[0];
+          }
+          black_box_causes |= causes;
+        }
+      }
+      perf.Mark(ADIS16470Stage::kDecode);
 
-        {
-          std::lock_guard<wpi::mutex> sync(m_mutex);
-          /* Push data to global variables */
+      // The complementary filter runs as its own loop so its cost shows up as its own stage
+      if constexpr (ADIS16470Profile::kTilt) {
+        for (uint64_t seq = first; seq < first + frames_read; seq++) {
+          ADIS16470UpdateTilt<ADIS16470Profile>(m_comp_filter, m_ring.GetSample(seq));
+        }
+      }
+      perf.Mark(ADIS16470Stage::kTilt);
+
+      {
+        std::lock_guard<wpi::mutex> sync(m_mutex);
+        /* Push data to global variables */
+        for (uint64_t seq = first; seq < first + frames_read; seq++) {
+          ADIS16470Sample& sample = m_ring.GetSample(seq);
+          const bool restarted = m_first_run;
           if(m_first_run) {
             /* Don't accumulate first run. previous_timestamp will be "very" old and the integration will end up way off */
-            m_integ_angle = 0.0;
+            if (!m_keep_angle) {
+              m_integ_angle = 0.0;
+              m_integ_time = 0.0;
+            }
+            m_keep_angle = false;
+            if (m_reconfig_pending) {
+              CompleteReconfig(m_ring.GetFrame(seq)[0], read_time);
+            }
+            if (m_bias_estimating && !m_host_bias.converged) {
+              m_bias_start = seq;
+              m_bias_time = 0.0;
+            }
+            m_first_run = false;
           }
           else {
-            m_integ_angle += delta_angle;
+            m_integ_angle += sample.delta_angle;
+            m_integ_time += sample.dt;
+            if (m_bias_estimating && !m_host_bias.converged) {
+              m_bias_time += sample.dt;
+              if (m_bias_estimator.Update(sample)) {
+                ApplyHostBias(seq, first + frames_read);
+              }
+            }
+          }
+          sample.angle = m_integ_angle;
+          if constexpr (ADIS16470Profile::kHistory) {
+            if (m_resampler) {
+              m_resampler->Process(sample, read_time);
+            }
+            if (m_preintegrator) {
+              // The first sample's time step reaches back to before the restart
+              if (restarted) {
+                m_preintegrator->Reset();
+              }
+              m_preintegrator->Process(sample, m_yaw_axis);
+            }
           }
-          m_gyro_x = gyro_x;
-          m_gyro_y = gyro_y;
-          m_gyro_z = gyro_z;
-          m_accel_x = accel_x;
-          m_accel_y = accel_y;
-          m_accel_z = accel_z;
-          m_compAngleX = compAngleX * rad_to_deg;
-          m_compAngleY = compAngleY * rad_to_deg;
-          m_accelAngleX = accelAngleX * rad_to_deg;
-          m_accelAngleY = accelAngleY * rad_to_deg;
+          /* Fold the sample into the running noise statistics */
+          ADIS16470UpdateNoiseStats<ADIS16470Profile>(sample, m_welford, m_allan);
+        }
+        const ADIS16470Sample& latest = m_ring.GetSample(first + frames_read - 1);
+        m_gyro_x = latest.gyro_x;
+        m_gyro_y = latest.gyro_y;
+        m_gyro_z = latest.gyro_z;
+        if constexpr (ADIS16470Profile::kAllChannels) {
+          m_accel_x = latest.accel_x;
+          m_accel_y = latest.accel_y;
+          m_accel_z = latest.accel_z;
+        }
+        if constexpr (ADIS16470Profile::kTilt) {
+          m_compAngleX = m_comp_filter.GetCompAngleX() * rad_to_deg;
+          m_compAngleY = m_comp_filter.GetCompAngleY() * rad_to_deg;
+          m_accelAngleX = m_comp_filter.GetAccelAngleX() * rad_to_deg;
+          m_accelAngleY = m_comp_filter.GetAccelAngleY() * rad_to_deg;
+        }
+        m_last_frame_timestamp = previous_timestamp;
+        m_last_sample_time = read_time;
+        can_heading.angle = m_integ_angle;
+        can_heading.rate = m_yaw_axis == kX ? m_gyro_x : m_yaw_axis == kY ? m_gyro_y : m_gyro_z;
+        can_timestamp = latest.timestamp;
+        StoreHeading(previous_timestamp);
+        if (black_box && m_black_box_active) {
+          // Copy the pass into the black box (in two parts if the drain wrapped), then check the triggers
+          span = m_ring.WriteSpan(first, &span_frames);
+          int frames = std::min(frames_read, span_frames);
+          m_black_box.Append(span, frames, read_time, log_flags);
+          if (frames < frames_read) {
+            m_black_box.Append(m_ring.GetFrame(first + frames), frames_read - frames, read_time, log_flags);
+          }
+          if (m_black_box_user_trigger.exchange(false)) {
+            black_box_causes |= kADIS16470TriggerUser;
+          }
+          if (log_flags & kADIS16470LogOverrun) {
+            black_box_causes |= kADIS16470TriggerOverrun;
+          }
+          black_box_causes &= m_black_box_triggers;
+          if (black_box_causes != 0) {
+            m_black_box.Trigger(black_box_causes, black_box_timestamp ? black_box_timestamp : previous_timestamp, read_time);
+          }
+        }
+        m_stream_stats = stream;
+        m_ring.Commit(frames_read);
+        if (perf.IsOpen()) {
+          perf.Mark(ADIS16470Stage::kPublish);
+          perf.EndPass(frames_read);
+          m_perf_profile = perf.GetProfile();
         }
-        m_first_run = false;
       }
+      m_can_forwarder.Update(m_transport->GetTime(), can_heading, can_timestamp);
     }
     else {
         m_thread_idle = true;
-        data_count = 0;
-        data_remainder = 0;
-        data_to_read = 0;
-        previous_timestamp = 0.0;
-        delta_angle = 0.0;
-        gyro_x = 0.0;
-        gyro_y = 0.0;
-        gyro_z = 0.0;
-        accel_x = 0.0;
-        accel_y = 0.0;
-        accel_z = 0.0;
-        gyro_x_si = 0.0;
-        gyro_y_si = 0.0;
-        //gyro_z_si = 0.0;
-        accel_x_si = 0.0;
-        accel_y_si = 0.0;
-        accel_z_si = 0.0;
-        compAngleX = 0.0;
-        compAngleY = 0.0;
-        accelAngleX = 0.0;
-        accelAngleY = 0.0;
+        fifo_remaining = 0;
+        previous_timestamp = 0;
     }
   }
+  m_transport->DetachThread();
 }
 
-/* Complementary filter functions */
-double ADIS16470_IMU::FormatFastConverge(double compAngle, double accAngle) {
-  if(compAngle > accAngle + M_PI) {
-    compAngle = compAngle - 2.0 * M_PI;
+/**
+  * @brief Moves the frames a resync has found into the ring, after the frames_read already drained this pass.
+  *
+  * @return The new frame count of the pass, at most kMaxFramesPerRead. Frames that don't fit stay with the resync.
+ **/
+int ADIS16470_IMU::RecoverFrames(uint64_t first, int frames_read) {
+  while (m_frame_sync.IsResyncing() && frames_read < kMaxFramesPerRead) {
+    int span_frames = 0;
+    uint32_t* span = m_ring.WriteSpan(first + frames_read, &span_frames);
+    int frames = m_frame_sync.Recover(span, std::min(span_frames, kMaxFramesPerRead - frames_read));
+    if (frames == 0) {
+      break;
+    }
+    frames_read += frames;
   }
-  else if (accAngle > compAngle + M_PI) {
-    compAngle = compAngle + 2.0 * M_PI;
+  return frames_read;
+}
+
+/**
+  * @brief Removes a newly converged host bias from everything acquired since the estimate started. Called with m_mutex held.
+  *
+  * @param current Sequence number of the sample the estimate converged on. It has been integrated, but its angle is not stored yet.
+  *
+  * @param end Sequence number just past the last decoded sample. Samples up to here are corrected in the history,
+  * including the rest of the current batch, which has not been integrated yet.
+  *
+  * Every angle since the estimate started carries the bias over the time integrated into it: the time since the
+  * estimate started, or since the last Reset() for angles after one. The integrated angle and every stored angle lose
+  * that much, so the history stays continuous with the corrected heading. The resampler's held and produced samples
+  * are corrected the same way. The complementary filter is not replayed; it converges to the corrected rates within a
+  * few time constants.
+ **/
+void ADIS16470_IMU::ApplyHostBias(uint64_t current, uint64_t end) {
+  // Far below any sample period: an angle this close to a zeroing was integrated before it
+  constexpr double kZeroTolerance = 1e-7;
+  m_host_bias = m_bias_estimator.GetBias();
+  m_integ_angle -= m_host_bias.yaw * std::min(m_integ_time, m_bias_time);
+  const uint64_t begin = std::max(m_bias_start, m_ring.GetOldest());
+  for (uint64_t seq = begin; seq < end; seq++) {
+    ADIS16470Sample& sample = m_ring.GetSample(seq);
+    sample.gyro_x -= m_host_bias.gyro_x;
+    sample.gyro_y -= m_host_bias.gyro_y;
+    sample.gyro_z -= m_host_bias.gyro_z;
+    sample.delta_angle -= m_host_bias.yaw * sample.dt;
+  }
+  // Walk the stored angles back from the converging sample, taking off the bias integrated into each one
+  double since_start = m_bias_time;
+  double since_zero = m_integ_time;
+  bool before_zero = false;
+  for (uint64_t seq = current; seq > begin; seq--) {
+    const double dt = m_ring.GetSample(seq).dt;
+    since_start -= dt;
+    since_zero -= dt;
+    before_zero = before_zero || since_zero < kZeroTolerance;
+    const double covered = before_zero ? since_start : std::min(since_start, since_zero);
+    m_ring.GetSample(seq - 1).angle -= m_host_bias.yaw * covered;
   }
-  return compAngle;  
+  if constexpr (ADIS16470Profile::kHistory) {
+    if (m_resampler && current > begin) {
+      const double gyro_bias[3] = {m_host_bias.gyro_x, m_host_bias.gyro_y, m_host_bias.gyro_z};
+      const double dt = m_ring.GetSample(current).dt;
+      m_resampler->RemoveBias(gyro_bias, m_host_bias.yaw, m_bias_time - dt, m_integ_time - dt);
+    }
+  }
+  if (m_host_bias.timed_out) {
+    DriverStation::ReportWarning("ADIS16470 gyro bias estimate timed out. Keep the robot still during startup.");
+  }
+}
+
+ADIS16470HostBias ADIS16470_IMU::GetHostBias() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  // Once converged, the bias in use (which follows a yaw axis change) rather than the estimator's
+  return m_bias_estimating && !m_host_bias.converged ? m_bias_estimator.GetBias() : m_host_bias;
 }
 
-double ADIS16470_IMU::FormatRange0to2PI(double compAngle) {
-  while(compAngle >= 2 * M_PI) {
-    compAngle = compAngle - 2.0 * M_PI;
+void ADIS16470_IMU::ConfigBiasConvergence(double std_error, double motion_threshold) {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_bias_estimator.Configure(std_error, motion_threshold, pow(2, m_calibration_time) / 2000 * 64);
+}
+
+/**
+  * @brief Returns the sequence number the next sample will get (the number of samples acquired so far).
+ **/
+uint64_t ADIS16470_IMU::GetLatestSequence() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_ring.GetHead();
+}
+
+uint64_t ADIS16470_IMU::GetFPGATime() const {
+  return m_transport->GetTime();
+}
+
+/**
+  * @brief Copies decoded samples out of the sample history.
+  *
+  * @param sequence Sequence number of the first sample wanted. Advanced past the last sample copied.
+  * If it is older than the history, copying starts at the oldest sample still held.
+  *
+  * @param samples Receives the samples.
+  *
+  * @param max_samples Size of the samples array.
+  *
+  * @return The number of samples copied.
+ **/
+int ADIS16470_IMU::GetSamples(uint64_t* sequence, ADIS16470Sample* samples, int max_samples) const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  uint64_t seq = std::max(*sequence, m_ring.GetOldest());
+  int count = 0;
+  for (; seq < m_ring.GetHead() && count < max_samples; seq++, count++) {
+    samples[count] = m_ring.GetSample(seq);
   }
-  while(compAngle < 0.0) {
-    compAngle = compAngle + 2.0 * M_PI;
+  *sequence = seq;
+  return count;
+}
+
+/**
+  * @brief Picks up the heading stored by a previous robot program. Called by the constructor before the IMU is reset.
+  *
+  * @return True if the stored state was accepted. The IMU is then left running, so its bias null survives too.
+  *
+  * The state is only accepted if it is recent (ADIS16470HeadingStore::kMaxAge), the bias was already
+  * known when it was stored, it was integrated about the same yaw axis, and the IMU answering on the bus has the serial number the state was recorded with.
+  * Rotation during the restart itself is not seen, so keep the robot still while the program restarts.
+ **/
+bool ADIS16470_IMU::RestoreHeading() {
+  ADIS16470HeadingState state;
+  if (!m_heading_store.Load(&state)) {
+    return false;
+  }
+  double age = (ADIS16470HeadingStore::Now() - state.update_time) / 1e9;
+  if (!state.calibrated || age > ADIS16470HeadingStore::kMaxAge || state.yaw_axis != m_yaw_axis) {
+    DriverStation::ReportWarning("ADIS16470 stored heading is too old, uncalibrated, or for another axis. Starting from zero.");
+    return false;
   }
-  return compAngle;
+  if (!m_transport->IsOpen()) {
+    m_transport->OpenSPI();
+  }
+  if (!ReadProductID()) {
+    return false;
+  }
+  ReadRegister(SERIAL_NUM); // Dummy read
+  if (ReadRegister(SERIAL_NUM) != state.serial_number) {
+    DriverStation::ReportWarning("ADIS16470 stored heading belongs to another IMU. Starting from zero.");
+    return false;
+  }
+  m_integ_angle = state.angle;
+  m_integ_time = state.integ_time;
+  if (state.host_bias) {
+    m_host_bias.converged = true;
+    m_host_bias.gyro_x = state.bias_gyro_x;
+    m_host_bias.gyro_y = state.bias_gyro_y;
+    m_host_bias.gyro_z = state.bias_gyro_z;
+    m_host_bias.yaw = state.bias_yaw;
+  }
+  m_keep_angle = true;
+  return true;
 }
 
-double ADIS16470_IMU::FormatAccelRange(double accelAngle, double accelZ) {
-  if(accelZ < 0.0) {
-    accelAngle = M_PI - accelAngle;
+/* Mirrors the integration state into shared memory. Called by the acquisition thread with m_mutex held. */
+void ADIS16470_IMU::StoreHeading(uint32_t timestamp) {
+  if (!m_heading_store.IsOpen()) {
+    return;
   }
-  else if(accelZ > 0.0 && accelAngle < 0.0) {
-    accelAngle = 2.0 * M_PI + accelAngle;
+  ADIS16470HeadingState state;
+  state.serial_number = m_serial_number;
+  state.yaw_axis = m_yaw_axis;
+  state.angle = m_integ_angle;
+  state.integ_time = m_integ_time;
+  state.calibrated = !m_bias_estimating || m_host_bias.converged;
+  state.host_bias = m_host_bias.converged;
+  state.bias_gyro_x = m_host_bias.gyro_x;
+  state.bias_gyro_y = m_host_bias.gyro_y;
+  state.bias_gyro_z = m_host_bias.gyro_z;
+  state.bias_yaw = m_host_bias.yaw;
+  state.last_timestamp = timestamp;
+  state.update_time = ADIS16470HeadingStore::Now();
+  m_heading_store.Store(state);
+}
+
+bool ADIS16470_IMU::IsHeadingRestored() const {
+  return m_heading_restored;
+}
+
+bool ADIS16470_IMU::IsInitialized() const {
+  return m_initialized;
+}
+
+/**
+  * @brief Starts resampling the sample stream onto a uniform time grid.
+  *
+  * @param rate Grid rate (Hz). It does not have to match the IMU output rate.
+  *
+  * The resampler runs in the acquisition thread on every new sample and adds at most two IMU
+  * sample periods of latency. Calling this again replaces the grid and empties its history.
+ **/
+void ADIS16470_IMU::EnableResampler(double rate) {
+  if constexpr (!ADIS16470Profile::kHistory) {
+    DriverStation::ReportWarning("ADIS16470 resampler is not available in this build profile.");
+    return;
+  }
+  auto resampler = std::make_unique<ADIS16470Resampler>(rate, kHistoryFrames);
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_resampler = std::move(resampler);
+}
+
+void ADIS16470_IMU::DisableResampler() {
+  std::unique_ptr<ADIS16470Resampler> resampler;
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_resampler.swap(resampler);
+}
+
+uint64_t ADIS16470_IMU::GetLatestResampledSequence() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_resampler ? m_resampler->GetHead() : 0;
+}
+
+int ADIS16470_IMU::GetResampledSamples(uint64_t* sequence, ADIS16470GridSample* samples, int max_samples) const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_resampler ? m_resampler->Read(sequence, samples, max_samples) : 0;
+}
+
+/**
+  * @brief Starts counting cycles, instructions, cache misses and branch misses per acquisition stage.
+  *
+  * The acquisition thread opens the counters at its next pass (perf_event_open counts the thread
+  * that opens them) and clears the totals. If the system offers no counters, a warning is
+  * reported and GetPerfProfile() marks every counter unavailable. Profiling adds a system call per
+  * stage to every pass, so leave it off in competition code.
+ **/
+void ADIS16470_IMU::EnablePerfProfiling() {
+  m_perf_enabled = true;
+}
+
+void ADIS16470_IMU::DisablePerfProfiling() {
+  m_perf_enabled = false;
+}
+
+ADIS16470PerfProfile ADIS16470_IMU::GetPerfProfile() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_perf_profile;
+}
+
+/**
+  * @brief Starts sending the yaw angle and rate as a CAN frame from the acquisition thread.
+  *
+  * Each frame carries the latest integrated angle and yaw rate, so a motor controller running its own heading loop
+  * sees new samples at the frame rate instead of the 20 ms robot loop. While forwarding, the acquisition thread
+  * wakes up for every frame instead of every 10 ms. Calling this again reopens the device and clears the stats.
+ **/
+int ADIS16470_IMU::StartCANForwarding(int device_id, double rate, int api_id) {
+  int32_t status = m_can_forwarder.Start(device_id, api_id, rate, m_transport->GetTime());
+  if (status != 0) {
+    DriverStation::ReportError("ADIS16470 could not open CAN device " + std::to_string(device_id) +
+                               " for heading forwarding (status " + std::to_string(status) + ").");
   }
-  return accelAngle;
+  return status;
+}
+
+void ADIS16470_IMU::StopCANForwarding() {
+  m_can_forwarder.Stop();
 }
 
-double ADIS16470_IMU::CompFilterProcess(double compAngle, double accelAngle, double omega) {
-  compAngle = FormatFastConverge(compAngle, accelAngle);
-  compAngle = m_alpha * (compAngle + omega * m_dt) + (1.0 - m_alpha) * accelAngle;
-  compAngle = FormatRange0to2PI(compAngle);
-  if(compAngle > M_PI) {
-    compAngle = compAngle - 2.0 * M_PI;
+ADIS16470CANStats ADIS16470_IMU::GetCANStats() const {
+  return m_can_forwarder.GetStats();
+}
+
+/**
+  * @brief Starts preintegrating every sample for GetPreintegration().
+  *
+  * The preintegrator keeps running totals for as many samples as the sample history, so a query
+  * can start up to about ten seconds back at the default rate. Calling this again empties it.
+ **/
+void ADIS16470_IMU::EnablePreintegration(double gyro_noise_density, double accel_noise_density) {
+  if constexpr (!ADIS16470Profile::kHistory) {
+    DriverStation::ReportWarning("ADIS16470 preintegration is not available in this build profile.");
+    return;
   }
-  return compAngle;
+  auto preintegrator = std::make_unique<ADIS16470Preintegrator>(kHistoryFrames);
+  preintegrator->SetNoiseDensity(gyro_noise_density, accel_noise_density);
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_preintegrator = std::move(preintegrator);
+}
+
+void ADIS16470_IMU::DisablePreintegration() {
+  std::unique_ptr<ADIS16470Preintegrator> preintegrator;
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_preintegrator.swap(preintegrator);
+}
+
+bool ADIS16470_IMU::GetPreintegration(uint32_t start_timestamp, uint32_t end_timestamp,
+                                      ADIS16470Preintegration* result) const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_preintegrator && m_preintegrator->Get(start_timestamp, end_timestamp, result);
+}
+
+/**
+  * @brief Fills in the reconfiguration record once the first new frame arrives. Called with m_mutex held.
+  *
+  * @param frame_timestamp FPGA timestamp of the first frame after the configuration change.
+  *
+  * @param read_time FPGA time at which the frame was read out of the FIFO.
+  *
+  * Lost frames are counted from the gap between the last frame processed before the change and the
+  * first frame after it, so frames the IMU produced while auto SPI was stopped (or that were flushed
+  * from the FIFO) are all included.
+ **/
+void ADIS16470_IMU::CompleteReconfig(uint32_t frame_timestamp, uint64_t read_time) {
+  m_reconfig_stats.time_to_first_sample = (read_time - m_reconfig_start) / 1000000.0;
+  if (m_last_sample_time != 0) {
+    m_reconfig_stats.blackout = (read_time - m_last_sample_time) / 1000000.0;
+    double periods = uint32_t(frame_timestamp - m_last_frame_timestamp) / m_scaled_sample_rate;
+    m_reconfig_stats.lost_frames = periods > 1.0 ? uint64_t(std::lround(periods)) - 1 : 0;
+  }
+  else {
+    m_reconfig_stats.blackout = m_reconfig_stats.time_to_first_sample;
+  }
+  m_reconfig_stats.complete = true;
+  m_reconfig_pending = false;
+}
+
+/**
+  * @brief Starts recording every raw auto SPI word read from the FPGA to a log file.
+  *
+  * @param path The log file to create. An existing file is overwritten.
+  *
+  * @return False if the file could not be created.
+  *
+  * Each acquisition pass appends one record holding the words exactly as they came out of the FIFO,
+  * tagged with the FPGA time of the read and an overrun flag. The file is written by a background
+  * thread, so logging never blocks the acquisition loop. If the disk can't keep up, records are dropped.
+ **/
+bool ADIS16470_IMU::StartRawLog(const std::string& path) {
+  if constexpr (!ADIS16470Profile::kTelemetry) {
+    DriverStation::ReportWarning("ADIS16470 raw logging is not available in this build profile.");
+    return false;
+  }
+  StopRawLog();
+  if (!m_log.Open(path, m_frame_layout.frame_len)) {
+    DriverStation::ReportError("Could not create the ADIS16470 raw log file.");
+    return false;
+  }
+  LogConfig();
+  m_log_active = true;
+  return true;
+}
+
+void ADIS16470_IMU::StopRawLog() {
+  m_log_active = false;
+  m_log.Close();
+}
+
+/* Fills in the kADIS16470LogConfig record words for the current frame */
+void ADIS16470_IMU::GetLogConfig(uint32_t* config) const {
+  config[0] = (uint32_t)m_yaw_axis;
+  config[1] = (uint32_t)(m_scaled_sample_rate * 1000.0);
+  config[2] = m_high_resolution_mask;
+  config[3] = m_read_diag_stat ? 1 : 0;
+  config[4] = m_filter;
+}
+
+/* Records the settings needed to decode the data records that follow */
+void ADIS16470_IMU::LogConfig() {
+  if (!m_log.IsOpen()) {
+    return;
+  }
+  uint32_t config[kLogConfigWords];
+  GetLogConfig(config);
+  m_log.Append(kADIS16470LogConfig, 0, m_transport->GetTime(), config, kLogConfigWords);
+}
+
+/**
+  * @brief Starts keeping the most recent raw frames in RAM and writing them out around trigger events.
+  *
+  * @param path_prefix Captures are written to path_prefix-NNN.adislog, numbered from the first file that doesn't exist yet.
+  *
+  * @param pre_seconds Time kept from before the trigger.
+  *
+  * @param post_seconds Time recorded after the trigger.
+  *
+  * @param triggers ADIS16470BlackBoxTrigger flags of the events that start a capture.
+  *
+  * The windows are converted to frames at the current sample rate. Both rings are allocated here,
+  * so the acquisition thread only copies frames while the black box runs.
+ **/
+void ADIS16470_IMU::StartBlackBox(const std::string& path_prefix, double pre_seconds, double post_seconds,
+                                  uint32_t triggers) {
+  if constexpr (!ADIS16470Profile::kTelemetry) {
+    DriverStation::ReportWarning("ADIS16470 black box is not available in this build profile.");
+    return;
+  }
+  StopBlackBox();
+  double rate = 1000000.0 / m_scaled_sample_rate;
+  m_black_box.Open(path_prefix, int(std::ceil(pre_seconds * rate)), int(std::ceil(post_seconds * rate)));
+  uint32_t config[kLogConfigWords];
+  GetLogConfig(config);
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  m_black_box.Reset(m_frame_layout.frame_len, config, kLogConfigWords);
+  m_black_box_triggers = triggers;
+  m_black_box_user_trigger = false;
+  m_black_box_active = true;
+}
+
+void ADIS16470_IMU::StopBlackBox() {
+  {
+    std::lock_guard<wpi::mutex> sync(m_mutex);
+    m_black_box_active = false;
+  }
+  // Outside the lock, so the acquisition thread never waits on the file write
+  m_black_box.Close();
+}
+
+void ADIS16470_IMU::TriggerBlackBox() {
+  m_black_box_user_trigger = true;
+}
+
+void ADIS16470_IMU::ConfigBlackBoxAccelThreshold(double threshold) {
+  m_black_box_accel = threshold;
+}
+
+ADIS16470BlackBoxStats ADIS16470_IMU::GetBlackBoxStats() const {
+  return m_black_box.GetStats();
+}
+
+ADIS16470StreamStats ADIS16470_IMU::GetStreamStats() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  return m_stream_stats;
 }
 
 /**
@@ -664,6 +1443,34 @@ double ADIS16470_IMU::GetRate() const {
   }
 }
 
+/**
+  * @brief Returns the angle, rates, accelerations and tilt angles of the latest sample in one call.
+  *
+  * The individual getters each take the lock, so values read one after another may come from
+  * different samples. The snapshot copies them all under a single lock.
+ **/
+ADIS16470Snapshot ADIS16470_IMU::GetSnapshot() const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  ADIS16470Snapshot snapshot;
+  snapshot.sequence = m_ring.GetHead();
+  if (snapshot.sequence > 0) {
+    snapshot.timestamp = m_ring.GetSample(snapshot.sequence - 1).timestamp;
+  }
+  snapshot.angle = m_integ_angle;
+  snapshot.rate = m_yaw_axis == kX ? m_gyro_x : m_yaw_axis == kY ? m_gyro_y : m_gyro_z;
+  snapshot.gyro_x = m_gyro_x;
+  snapshot.gyro_y = m_gyro_y;
+  snapshot.gyro_z = m_gyro_z;
+  snapshot.accel_x = m_accel_x;
+  snapshot.accel_y = m_accel_y;
+  snapshot.accel_z = m_accel_z;
+  snapshot.comp_angle_x = m_compAngleX;
+  snapshot.comp_angle_y = m_compAngleY;
+  snapshot.accel_angle_x = m_accelAngleX;
+  snapshot.accel_angle_y = m_accelAngleY;
+  return snapshot;
+}
+
 ADIS16470_IMU::IMUAxis ADIS16470_IMU::GetYawAxis() const {
   return m_yaw_axis;
 }
@@ -698,6 +1505,24 @@ double ADIS16470_IMU::GetAccelInstantZ() const {
   return m_accel_z;
 }
 
+/**
+  * @brief Tunes the complementary filter behind the X and Y tilt angles.
+  *
+  * @param tau Time constant (s). Larger values trust the gyro for longer.
+  *
+  * @param accel_rejection Acceleration magnitude error (g) above which the accelerometer is ignored, 0 to never ignore it.
+  *
+  * The filter runs in the acquisition thread, which picks up the new values on its next pass.
+ **/
+void ADIS16470_IMU::ConfigComplementaryFilter(double tau, double accel_rejection) {
+  if (tau <= 0.0 || accel_rejection < 0.0) {
+    DriverStation::ReportError("Attempted to set an invalid complementary filter setting.");
+    return;
+  }
+  m_comp_tau = tau;
+  m_comp_accel_rejection = accel_rejection;
+}
+
 double ADIS16470_IMU::GetXComplementaryAngle() const {
   std::lock_guard<wpi::mutex> sync(m_mutex);
   return m_compAngleX;
@@ -718,15 +1543,124 @@ double ADIS16470_IMU::GetYFilteredAccelAngle() const {
   return m_accelAngleY;
 }
 
+/**
+  * @brief Returns the running noise and bias stability estimates for one gyro or accelerometer channel.
+  *
+  * @param channel The sensor channel to report on.
+  *
+  * @return Mean, standard deviation, random walk, and bias instability of the channel since the last reset.
+  *
+  * The mean and standard deviation are tracked with Welford's algorithm. The random walk (deg/sqrt(s) for
+  * gyros, g/sqrt(s) for accelerometers) and bias instability are read from a streaming overlapping Allan
+  * deviation estimate. Both are only meaningful while the IMU is at rest, so this is best checked in the pits.
+ **/
+ADIS16470NoiseStatistics ADIS16470_IMU::GetNoiseStatistics(ADIS16470Channel channel) const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  int c = static_cast<int>(channel);
+  ADIS16470NoiseStatistics stats;
+  stats.samples = m_welford[c].GetCount();
+  stats.mean = m_welford[c].GetMean();
+  stats.std_dev = m_welford[c].GetStdDev();
+  m_allan[c].Summarize(m_scaled_sample_rate / 1000000.0, &stats);
+  return stats;
+}
+
+int ADIS16470_IMU::GetAllanDeviation(ADIS16470Channel channel, double* taus, double* adevs) const {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  int c = static_cast<int>(channel);
+  int points = 0;
+  for (int j = 0; j < ADIS16470AllanDeviation::kNumTaus; j++) {
+    if (m_allan[c].GetDeviation(j, m_scaled_sample_rate / 1000000.0, &taus[points], &adevs[points])) {
+      points++;
+    }
+  }
+  return points;
+}
+
+void ADIS16470_IMU::ResetNoiseStatistics() {
+  std::lock_guard<wpi::mutex> sync(m_mutex);
+  for (int c = 0; c < kADIS16470NumChannels; c++) {
+    m_welford[c].Reset();
+    m_allan[c].Reset();
+  }
+}
+
+void ADIS16470_IMU::ConfigSampleBatches(bool enable) {
+  m_batch_restart = true;
+  m_batch_enabled = enable && ADIS16470Profile::kHistory;
+}
+
+/**
+  * @brief Publishes every sample decoded since the previous call as packed arrays. Called from the dashboard update.
+  *
+  * The samples come from the history, so nothing is lost as long as the dashboard is updated at
+  * least once per history length (about 10 seconds at 400Hz). All arrays are written in the same
+  * update, so they always describe the same samples, and "Batch Sequence" is the sequence number
+  * of the first one so a viewer can detect gaps.
+ **/
+void ADIS16470_IMU::PublishSampleBatch(const nt::NT_Entry* entries) {
+  if (m_batch_restart) {
+    m_batch_sequence = GetLatestSequence();
+    m_batch_restart = false;
+  }
+  int count = GetSamples(&m_batch_sequence, m_batch_samples.data(), static_cast<int>(m_batch_samples.size()));
+  uint64_t first = m_batch_sequence - count;
+  for (auto& values : m_batch_values) {
+    values.resize(count);
+  }
+  for (int i = 0; i < count; i++) {
+    const ADIS16470Sample& sample = m_batch_samples[i];
+    m_batch_values[0][i] = sample.timestamp;
+    m_batch_values[1][i] = sample.gyro_x;
+    m_batch_values[2][i] = sample.gyro_y;
+    m_batch_values[3][i] = sample.gyro_z;
+    m_batch_values[4][i] = sample.accel_x;
+    m_batch_values[5][i] = sample.accel_y;
+    m_batch_values[6][i] = sample.accel_z;
+    m_batch_values[7][i] = sample.angle;
+  }
+  nt::NetworkTableEntry(entries[0]).SetDouble(static_cast<double>(first));
+  for (int a = 0; a < kBatchArrays; a++) {
+    nt::NetworkTableEntry(entries[a + 1]).SetDoubleArray(m_batch_values[a]);
+  }
+}
+
 /**
   * @brief Builds a Sendable object to push IMU data to the driver station.
   *
-  * This function pushes the most recent angle estimates for all axes to the driver station.
+  * This function pushes the most recent angle estimates for all axes to the driver station,
+  * along with the random walk and bias instability estimates for every sensor channel. With
+  * ConfigSampleBatches() enabled it also publishes every sample since the previous update.
  **/
 void ADIS16470_IMU::InitSendable(SendableBuilder& builder) {
+  static const char* channel_names[kADIS16470NumChannels] = {
+    "Gyro X", "Gyro Y", "Gyro Z", "Accel X", "Accel Y", "Accel Z"
+  };
   builder.SetSmartDashboardType("ADIS16470 IMU");
   auto yaw_angle = builder.GetEntry("Yaw Angle").GetHandle();
+  nt::NT_Entry random_walk[kADIS16470NumChannels];
+  nt::NT_Entry bias_instability[kADIS16470NumChannels];
+  for (int c = 0; c < kADIS16470NumChannels; c++) {
+    random_walk[c] = builder.GetEntry(std::string(channel_names[c]) + " Random Walk").GetHandle();
+    bias_instability[c] = builder.GetEntry(std::string(channel_names[c]) + " Bias Instability").GetHandle();
+  }
+  static const char* batch_names[kBatchArrays + 1] = {
+    "Batch Sequence", "Batch Timestamp", "Batch Gyro X", "Batch Gyro Y", "Batch Gyro Z",
+    "Batch Accel X", "Batch Accel Y", "Batch Accel Z", "Batch Angle"
+  };
+  std::array<nt::NT_Entry, kBatchArrays + 1> batch;
+  for (int a = 0; a <= kBatchArrays; a++) {
+    batch[a] = builder.GetEntry(batch_names[a]).GetHandle();
+  }
   builder.SetUpdateTable([=]() {
+    if (m_batch_enabled) {
+      PublishSampleBatch(batch.data());
+    }
     nt::NetworkTableEntry(yaw_angle).SetDouble(GetAngle());
+    for (int c = 0; c < kADIS16470NumChannels; c++) {
+      ADIS16470NoiseStatistics stats = GetNoiseStatistics(static_cast<ADIS16470Channel>(c));
+      nt::NetworkTableEntry(random_walk[c]).SetDouble(stats.random_walk);
+      nt::NetworkTableEntry(bias_instability[c]).SetDouble(stats.bias_instability);
+    }
   });
 }
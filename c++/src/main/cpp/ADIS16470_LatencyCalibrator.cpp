@@ -0,0 +1,295 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <adi/ADIS16470_LatencyCalibrator.h>
+
+using namespace frc;
+
+/* Samples copied out of the IMU history per call */
+static constexpr int kPullBatch = 256;
+
+/* How often the background thread empties the IMU history (s) */
+static constexpr double kPullPeriod = 0.1;
+
+ADIS16470LatencyCalibrator::ADIS16470LatencyCalibrator(ADIS16470_IMU& imu, double window, double max_lag) :
+                            m_imu(imu),
+                            m_window(window),
+                            m_max_lag(max_lag) {
+  // Only samples from now on are of interest
+  m_next_sequence = m_imu.GetLatestSequence();
+}
+
+ADIS16470LatencyCalibrator::~ADIS16470LatencyCalibrator() {
+  Stop();
+}
+
+void ADIS16470LatencyCalibrator::AddOdometrySample(uint64_t timestamp, double yaw_rate) {
+  std::lock_guard<std::mutex> sync(m_odometry_mutex);
+  m_odometry.push_back({timestamp, yaw_rate});
+  // Keep a little more than one window
+  while (m_odometry.size() > 1 && m_odometry.back().time - m_odometry.front().time > 2.0 * m_window * 1e6) {
+    m_odometry.pop_front();
+  }
+}
+
+/**
+  * @brief Copies new samples out of the IMU history and converts them to yaw rates.
+  *
+  * The yaw rate comes from the delta angle, which is what the heading integrates. IMU timestamps
+  * are 32-bit microseconds, so each one is placed at the latest 64-bit FPGA time at or before the
+  * time of the copy with the same low 32 bits, which puts it on the clock used for odometry however
+  * long the FPGA has been running. Each rate is stamped at the middle of the period its delta angle covers.
+ **/
+void ADIS16470LatencyCalibrator::PullImuSamples() {
+  std::lock_guard<std::mutex> sync(m_imu_mutex);
+  ADIS16470Sample batch[kPullBatch];
+  int count;
+  while ((count = m_imu.GetSamples(&m_next_sequence, batch, kPullBatch)) > 0) {
+    // Read after the copy, so every sample in the batch is older
+    const uint64_t now = m_imu.GetFPGATime();
+    for (int i = 0; i < count; i++) {
+      const ADIS16470Sample& sample = batch[i];
+      if (sample.dt <= 0.0) {
+        continue;
+      }
+      uint64_t timestamp = now - static_cast<uint32_t>(static_cast<uint32_t>(now) - sample.timestamp);
+      // The delta angle covers the whole sample period, so its average rate belongs to the middle of it
+      uint64_t time = timestamp - uint64_t(sample.dt * 0.5e6);
+      m_gyro.push_back({time, sample.delta_angle / sample.dt});
+    }
+  }
+  while (m_gyro.size() > 1 && m_gyro.back().time - m_gyro.front().time > 2.0 * m_window * 1e6) {
+    m_gyro.pop_front();
+  }
+}
+
+/**
+  * @brief Linear interpolation in a time-ordered sample list. index is a search hint that only moves forward.
+ **/
+double ADIS16470LatencyCalibrator::Interpolate(const std::vector<RateSample>& samples, size_t& index, uint64_t time) {
+  while (index + 2 < samples.size() && samples[index + 1].time <= time) {
+    index++;
+  }
+  const RateSample& a = samples[index];
+  const RateSample& b = samples[index + 1];
+  if (b.time == a.time) {
+    return a.rate;
+  }
+  double frac = (double(time) - double(a.time)) / double(b.time - a.time);
+  frac = std::min(std::max(frac, 0.0), 1.0);
+  return a.rate + frac * (b.rate - a.rate);
+}
+
+/**
+  * @brief In-place iterative radix-2 FFT. The size must be a power of two.
+ **/
+void ADIS16470LatencyCalibrator::FFT(std::vector<std::complex<double>>& data, bool inverse) {
+  const size_t n = data.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(data[i], data[j]);
+    }
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    double angle = 2.0 * M_PI / len * (inverse ? 1.0 : -1.0);
+    std::complex<double> step(std::cos(angle), std::sin(angle));
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<double> w(1.0, 0.0);
+      for (size_t k = 0; k < len / 2; k++) {
+        std::complex<double> u = data[i + k];
+        std::complex<double> v = data[i + k + len / 2] * w;
+        data[i + k] = u + v;
+        data[i + k + len / 2] = u - v;
+        w *= step;
+      }
+    }
+  }
+  if (inverse) {
+    for (auto& x : data) {
+      x /= double(n);
+    }
+  }
+}
+
+/**
+  * @brief Estimates the odometry latency over the most recent window.
+  *
+  * @return The estimate. It is invalid if the streams overlap for less than a few seconds or the
+  * robot did not turn enough during the window.
+  *
+  * Both yaw rates are resampled onto a grid at the median IMU sample period, mean removed, zero
+  * padded to twice their length, and correlated through the FFT. The gyro signal is trimmed by
+  * max_lag at both ends so every candidate lag is computed over the same overlap; otherwise the
+  * shrinking overlap would pull the peak towards zero. The peak within +/- max_lag is refined with
+  * a parabola through its neighbours.
+ **/
+ADIS16470LatencyEstimate ADIS16470LatencyCalibrator::Estimate() {
+  PullImuSamples();
+  std::vector<RateSample> gyro;
+  std::vector<RateSample> odometry;
+  {
+    std::lock_guard<std::mutex> sync(m_imu_mutex);
+    gyro.assign(m_gyro.begin(), m_gyro.end());
+  }
+  {
+    std::lock_guard<std::mutex> sync(m_odometry_mutex);
+    odometry.assign(m_odometry.begin(), m_odometry.end());
+  }
+  ADIS16470LatencyEstimate result;
+  if (gyro.size() < 16 || odometry.size() < 16) {
+    return result;
+  }
+
+  // Common time range, leaving room for the largest lag at both ends
+  const uint64_t max_lag_us = uint64_t(m_max_lag * 1e6);
+  uint64_t end = std::min(gyro.back().time, odometry.back().time);
+  uint64_t start = std::max(gyro.front().time, odometry.front().time);
+  if (end <= start + 2 * max_lag_us) {
+    return result;
+  }
+  start = std::max(start, end > uint64_t(m_window * 1e6) ? end - uint64_t(m_window * 1e6) : 0);
+
+  std::vector<uint64_t> periods;
+  periods.reserve(gyro.size());
+  for (size_t i = 1; i < gyro.size(); i++) {
+    periods.push_back(gyro[i].time - gyro[i - 1].time);
+  }
+  std::nth_element(periods.begin(), periods.begin() + periods.size() / 2, periods.end());
+  const double grid = std::max<double>(periods[periods.size() / 2], 1.0);
+  const size_t points = size_t((end - start) / grid);
+  if (points < 64) {
+    return result;
+  }
+
+  // Only the inner part of the gyro signal is correlated, so every lag up to max_lag sees full overlap
+  const int max_lag = std::min(int(m_max_lag * 1e6 / grid), int(points / 4));
+  const size_t inner_begin = max_lag, inner_end = points - max_lag;
+
+  size_t fft_size = 1;
+  while (fft_size < 2 * points) {
+    fft_size <<= 1;
+  }
+  std::vector<std::complex<double>> g(fft_size), o(fft_size);
+  size_t gi = 0, oi = 0;
+  double g_mean = 0.0, o_mean = 0.0;
+  for (size_t i = 0; i < points; i++) {
+    uint64_t t = start + uint64_t(i * grid);
+    g[i] = Interpolate(gyro, gi, t);
+    o[i] = Interpolate(odometry, oi, t);
+    o_mean += o[i].real();
+  }
+  for (size_t i = inner_begin; i < inner_end; i++) {
+    g_mean += g[i].real();
+  }
+  g_mean /= (inner_end - inner_begin);
+  o_mean /= points;
+  double g_energy = 0.0, o_energy = 0.0;
+  for (size_t i = 0; i < points; i++) {
+    g[i] = (i >= inner_begin && i < inner_end) ? g[i] - g_mean : 0.0;
+    o[i] -= o_mean;
+    g_energy += std::norm(g[i]);
+  }
+  for (size_t i = inner_begin; i < inner_end; i++) {
+    o_energy += std::norm(o[i]);
+  }
+  result.window = points * grid / 1e6;
+  result.odometry_samples = std::count_if(odometry.begin(), odometry.end(),
+                                          [&](const RateSample& s) { return s.time >= start && s.time <= end; });
+  if (std::sqrt(o_energy / (inner_end - inner_begin)) < kMinExcitation || g_energy <= 0.0) {
+    return result;
+  }
+
+  // r[k] = sum g[i] * o[i + k], so the peak sits at the lag of the odometry behind the gyro
+  FFT(g, false);
+  FFT(o, false);
+  for (size_t i = 0; i < fft_size; i++) {
+    g[i] = std::conj(g[i]) * o[i];
+  }
+  FFT(g, true);
+
+  auto at = [&](int lag) { return g[(lag + fft_size) % fft_size].real(); };
+  int best = 0;
+  for (int lag = -max_lag; lag <= max_lag; lag++) {
+    if (at(lag) > at(best)) {
+      best = lag;
+    }
+  }
+  double offset = 0.0;
+  if (best > -max_lag && best < max_lag) {
+    double y0 = at(best - 1), y1 = at(best), y2 = at(best + 1);
+    double denom = y0 - 2.0 * y1 + y2;
+    if (denom < 0.0) {
+      offset = 0.5 * (y0 - y2) / denom;
+    }
+  }
+  result.latency = (best + offset) * grid / 1e6;
+  result.correlation = at(best) / std::sqrt(g_energy * o_energy);
+  result.valid = best > -max_lag && best < max_lag;
+
+  if (result.valid) {
+    std::lock_guard<std::mutex> sync(m_result_mutex);
+    m_latest = result;
+  }
+  return result;
+}
+
+void ADIS16470LatencyCalibrator::Start(double period) {
+  Stop();
+  m_stop = false;
+  m_thread = std::thread(&ADIS16470LatencyCalibrator::Run, this, period);
+}
+
+void ADIS16470LatencyCalibrator::Stop() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> sync(m_cv_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  m_thread.join();
+}
+
+ADIS16470LatencyEstimate ADIS16470LatencyCalibrator::GetLatestEstimate() const {
+  std::lock_guard<std::mutex> sync(m_result_mutex);
+  return m_latest;
+}
+
+/**
+  * @brief Background loop. Keeps the IMU history drained and runs an estimate every period seconds.
+ **/
+void ADIS16470LatencyCalibrator::Run(double period) {
+  auto next_estimate = std::chrono::steady_clock::now() + std::chrono::duration<double>(period);
+  std::unique_lock<std::mutex> lock(m_cv_mutex);
+  while (!m_stop) {
+    m_cv.wait_for(lock, std::chrono::duration<double>(kPullPeriod));
+    if (m_stop) {
+      break;
+    }
+    lock.unlock();
+    if (std::chrono::steady_clock::now() >= next_estimate) {
+      Estimate();
+      next_estimate += std::chrono::duration<double>(period);
+    }
+    else {
+      PullImuSamples();
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,117 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <chrono>
+#include <cstring>
+
+#include <adi/ADIS16470_Log.h>
+
+using namespace frc;
+
+ADIS16470LogWriter::~ADIS16470LogWriter() {
+  Close();
+}
+
+bool ADIS16470LogWriter::Open(const std::string& path, uint32_t frame_len) {
+  if (IsOpen()) {
+    Close();
+  }
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  ADIS16470LogHeader header;
+  std::memcpy(header.magic, kADIS16470LogMagic, sizeof(header.magic));
+  header.version = kADIS16470LogVersion;
+  header.frame_len = frame_len;
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_file = file;
+  // Reserve both buffers up front so Append() never allocates
+  m_staging.clear();
+  m_staging.reserve(kStagingBytes);
+  m_writing.clear();
+  m_writing.reserve(kStagingBytes);
+  m_stop = false;
+  m_dropped = 0;
+  m_thread = std::thread(&ADIS16470LogWriter::WriterLoop, this);
+  return true;
+}
+
+/**
+  * @brief Flushes any staged records and closes the file.
+  *
+  * m_file is only checked under the lock, since other threads call IsOpen() and Append() meanwhile.
+  * Of two Close() calls racing each other, only the one that sets m_stop joins the writer thread.
+ **/
+void ADIS16470LogWriter::Close() {
+  {
+    std::lock_guard<std::mutex> sync(m_mutex);
+    if (m_file == nullptr || m_stop) {
+      return;
+    }
+    m_stop = true;
+  }
+  m_cv.notify_one();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  std::lock_guard<std::mutex> sync(m_mutex);
+  std::fclose(m_file);
+  m_file = nullptr;
+}
+
+bool ADIS16470LogWriter::IsOpen() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_file != nullptr;
+}
+
+bool ADIS16470LogWriter::Append(uint16_t type, uint16_t flags, uint64_t host_time, const uint32_t* words, uint32_t word_count) {
+  ADIS16470LogRecord record;
+  record.type = type;
+  record.flags = flags;
+  record.word_count = word_count;
+  record.host_time = host_time;
+  size_t payload = word_count * sizeof(uint32_t);
+
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (m_file == nullptr || m_staging.size() + sizeof(record) + payload > kStagingBytes) {
+    m_dropped++;
+    return false;
+  }
+  const uint8_t* rec = reinterpret_cast<const uint8_t*>(&record);
+  m_staging.insert(m_staging.end(), rec, rec + sizeof(record));
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(words);
+  m_staging.insert(m_staging.end(), data, data + payload);
+  return true;
+}
+
+/**
+  * @brief Background loop that moves staged records to disk.
+  *
+  * Wakes up every 100ms (or when closing), swaps the staging buffer with the idle one, and writes it
+  * out without holding the lock, so the acquisition thread only ever contends for a buffer swap.
+ **/
+void ADIS16470LogWriter::WriterLoop() {
+  bool stop = false;
+  while (!stop) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait_for(lock, std::chrono::milliseconds(100), [this] { return m_stop; });
+      stop = m_stop;
+      m_staging.swap(m_writing);
+    }
+    if (!m_writing.empty()) {
+      std::fwrite(m_writing.data(), 1, m_writing.size(), m_file);
+      m_writing.clear();
+    }
+  }
+  std::fflush(m_file);
+}
@@ -0,0 +1,155 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cmath>
+
+#include <adi/ADIS16470_NoiseStats.h>
+
+using namespace frc;
+
+/* Minimum number of squared differences before a cluster size is reported */
+static constexpr uint64_t kMinTerms = 8;
+
+/* Ratio between the Allan deviation floor and the bias instability (flicker noise) */
+static constexpr double kFlickerFloorRatio = 0.664;
+
+void ADIS16470WelfordStats::Reset() {
+  m_count = 0;
+  m_mean = 0.0;
+  m_m2 = 0.0;
+}
+
+void ADIS16470WelfordStats::Update(double x) {
+  m_count++;
+  double delta = x - m_mean;
+  m_mean += delta / m_count;
+  m_m2 += delta * (x - m_mean);
+}
+
+double ADIS16470WelfordStats::GetVariance() const {
+  if (m_count < 2) {
+    return 0.0;
+  }
+  return m_m2 / (m_count - 1);
+}
+
+double ADIS16470WelfordStats::GetStdDev() const {
+  return std::sqrt(GetVariance());
+}
+
+/* Stride (in samples) at which octave j records the running sum */
+static inline uint64_t OctaveStride(int j) {
+  return (j > 3) ? (uint64_t(1) << (j - 3)) : 1;
+}
+
+/* Number of recorded running sums spanning one cluster of octave j */
+static inline int OctaveSpan(int j) {
+  return (j > 3) ? ADIS16470AllanDeviation::kOverlap : (1 << j);
+}
+
+ADIS16470AllanDeviation::ADIS16470AllanDeviation() {
+  Reset();
+}
+
+void ADIS16470AllanDeviation::Reset() {
+  for (auto& octave : m_octaves) {
+    octave.sums[0] = 0.0;
+    octave.head = 0;
+    octave.filled = 1;
+    octave.accum = 0.0;
+    octave.terms = 0;
+  }
+  m_count = 0;
+  m_offset = 0.0;
+  m_sum = 0.0;
+}
+
+/**
+  * @brief Folds one sample into the running Allan variance accumulators.
+  *
+  * @param y The new sample (rate or acceleration).
+  *
+  * The running sum S_n of the input is recorded at each octave's stride. For a cluster of m samples
+  * the squared second difference (S_n - 2*S_(n-m) + S_(n-2m))^2 / m^2 is twice the Allan variance
+  * term for the two adjacent clusters ending at sample n. Strides are powers of two that grow with
+  * the cluster size, so the loop stops at the first octave the current sample does not land on.
+  * The first sample is used as an offset to keep the running sum small.
+ **/
+void ADIS16470AllanDeviation::Update(double y) {
+  if (m_count == 0) {
+    m_offset = y;
+  }
+  m_count++;
+  m_sum += y - m_offset;
+
+  for (int j = 0; j < kNumTaus; j++) {
+    if (m_count & (OctaveStride(j) - 1)) {
+      break;
+    }
+    Octave& octave = m_octaves[j];
+    octave.head = (octave.head + 1) % kRingLen;
+    octave.sums[octave.head] = m_sum;
+    if (octave.filled < kRingLen) {
+      octave.filled++;
+    }
+    int span = OctaveSpan(j);
+    if (octave.filled > 2 * span) {
+      double s1 = octave.sums[(octave.head + kRingLen - span) % kRingLen];
+      double s2 = octave.sums[(octave.head + kRingLen - 2 * span) % kRingLen];
+      double d = m_sum - 2.0 * s1 + s2;
+      octave.accum += d * d;
+      octave.terms++;
+    }
+  }
+}
+
+bool ADIS16470AllanDeviation::GetDeviation(int index, double sample_period, double* tau, double* adev) const {
+  if (index < 0 || index >= kNumTaus || m_octaves[index].terms < kMinTerms) {
+    return false;
+  }
+  double m = double(uint64_t(1) << index);
+  *tau = m * sample_period;
+  *adev = std::sqrt(m_octaves[index].accum / (2.0 * m * m * m_octaves[index].terms));
+  return true;
+}
+
+/**
+  * @brief Fills the noise statistics summary fields derived from the Allan deviation curve.
+  *
+  * The random walk coefficient is the Allan deviation scaled by sqrt(tau) at the cluster size
+  * closest to 1s. The bias instability is the lowest point of the curve found so far, so it only
+  * settles once enough data has been collected to see the curve flatten out.
+ **/
+void ADIS16470AllanDeviation::Summarize(double sample_period, ADIS16470NoiseStatistics* stats) const {
+  double best_rw_dist = 0.0;
+  double min_adev = 0.0;
+  bool have_any = false;
+  for (int j = 0; j < kNumTaus; j++) {
+    double tau, adev;
+    if (!GetDeviation(j, sample_period, &tau, &adev)) {
+      continue;
+    }
+    double rw_dist = std::fabs(std::log(tau));
+    if (!have_any || rw_dist < best_rw_dist) {
+      best_rw_dist = rw_dist;
+      stats->random_walk = adev * std::sqrt(tau);
+    }
+    if (!have_any || adev < min_adev) {
+      min_adev = adev;
+      stats->bias_instability = adev / kFlickerFloorRatio;
+      stats->bias_instability_tau = tau;
+    }
+    have_any = true;
+  }
+  if (!have_any) {
+    stats->random_walk = 0.0;
+    stats->bias_instability = 0.0;
+    stats->bias_instability_tau = 0.0;
+  }
+}
@@ -0,0 +1,151 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <adi/ADIS16470_PerfCounters.h>
+
+using namespace frc;
+
+/* Back to back reads used to measure the cost of a read */
+static constexpr int kOverheadReads = 32;
+
+#ifdef __linux__
+/* Opens one counter of the calling thread, as the group leader if group is -1 */
+static int OpenCounter(uint32_t type, uint64_t config, int group) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group < 0 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+ADIS16470PerfCounters::~ADIS16470PerfCounters() {
+  Close();
+}
+
+/**
+  * @brief Opens the task clock as the group leader, then every hardware counter the kernel accepts.
+ **/
+bool ADIS16470PerfCounters::Open() {
+  Close();
+  m_profile = ADIS16470PerfProfile();
+#ifdef __linux__
+  m_fds[0] = OpenCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, -1);
+  if (m_fds[0] < 0) {
+    return false;
+  }
+  m_order[m_count++] = 0;
+  m_profile.available[0] = true;
+
+  static const uint64_t kHardware[kADIS16470NumPerfCounters] = {
+    0, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+  };
+  for (int c = 1; c < kADIS16470NumPerfCounters; c++) {
+    m_fds[c] = OpenCounter(PERF_TYPE_HARDWARE, kHardware[c], m_fds[0]);
+    if (m_fds[c] >= 0) {
+      m_order[m_count++] = c;
+      m_profile.available[c] = true;
+    }
+  }
+  ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+  // The smallest count between two reads is what a read adds to the stage it ends
+  uint64_t previous[kADIS16470NumPerfCounters] = {};
+  uint64_t now[kADIS16470NumPerfCounters] = {};
+  std::fill(m_overhead, m_overhead + kADIS16470NumPerfCounters, UINT64_MAX);
+  Read(previous);
+  for (int r = 0; r < kOverheadReads; r++) {
+    Read(now);
+    for (int i = 0; i < m_count; i++) {
+      int c = m_order[i];
+      m_overhead[c] = std::min(m_overhead[c], now[c] - previous[c]);
+      previous[c] = now[c];
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ADIS16470PerfCounters::Close() {
+#ifdef __linux__
+  // Members first, then the leader
+  for (int c = kADIS16470NumPerfCounters - 1; c >= 0; c--) {
+    if (m_fds[c] >= 0) {
+      close(m_fds[c]);
+    }
+  }
+#endif
+  for (int c = 0; c < kADIS16470NumPerfCounters; c++) {
+    m_fds[c] = -1;
+  }
+  m_count = 0;
+}
+
+/* Reads the whole group in one system call, into values indexed by ADIS16470PerfCounter */
+bool ADIS16470PerfCounters::Read(uint64_t* values) {
+#ifdef __linux__
+  // Number of counters, then their values in the order they were opened
+  uint64_t buffer[1 + kADIS16470NumPerfCounters];
+  ssize_t size = read(m_fds[0], buffer, sizeof(buffer));
+  if (size < static_cast<ssize_t>(sizeof(uint64_t)) || buffer[0] != static_cast<uint64_t>(m_count)) {
+    return false;
+  }
+  for (int i = 0; i < m_count; i++) {
+    values[m_order[i]] = buffer[1 + i];
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ADIS16470PerfCounters::Begin() {
+  if (IsOpen()) {
+    Read(m_last);
+  }
+}
+
+void ADIS16470PerfCounters::Mark(ADIS16470Stage stage) {
+  uint64_t now[kADIS16470NumPerfCounters] = {};
+  if (!IsOpen() || !Read(now)) {
+    return;
+  }
+  uint64_t* totals = m_profile.totals[static_cast<int>(stage)];
+  for (int i = 0; i < m_count; i++) {
+    int c = m_order[i];
+    uint64_t delta = now[c] - m_last[c];
+    totals[c] += delta > m_overhead[c] ? delta - m_overhead[c] : 0;
+    m_last[c] = now[c];
+  }
+}
+
+void ADIS16470PerfCounters::EndPass(int samples) {
+  if (IsOpen()) {
+    m_profile.passes++;
+    m_profile.samples += samples;
+  }
+}
@@ -0,0 +1,410 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <adi/ADIS16470_Preintegrator.h>
+
+using namespace frc;
+
+/* deg_to_rad in ADIS16470_Processing.h is rounded to six digits, too coarse for long windows */
+static constexpr double kRadPerDeg = 3.14159265358979323846 / 180.0;
+
+/* Unit quaternions (w, x, y, z) and row major 3x3 matrices */
+static void QuatMultiply(const double* a, const double* b, double* out) {
+  double w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  double x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  double y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  double z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+  out[0] = w;
+  out[1] = x;
+  out[2] = y;
+  out[3] = z;
+}
+
+static void QuatConjugate(const double* q, double* out) {
+  out[0] = q[0];
+  out[1] = -q[1];
+  out[2] = -q[2];
+  out[3] = -q[3];
+}
+
+static void QuatNormalize(double* q) {
+  double norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (int i = 0; i < 4; i++) {
+    q[i] /= norm;
+  }
+}
+
+/* Quaternion of a rotation vector (rad) */
+static void QuatExp(const double* v, double* out) {
+  double angle = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  // sin(angle / 2) / angle, with its series below where the division loses precision
+  double k = angle < 1e-6 ? 0.5 - angle * angle / 48.0 : std::sin(0.5 * angle) / angle;
+  out[0] = std::cos(0.5 * angle);
+  out[1] = v[0] * k;
+  out[2] = v[1] * k;
+  out[3] = v[2] * k;
+}
+
+/* Rotation vector (rad) of a unit quaternion, the short way round */
+static void QuatLog(const double* q, double* out) {
+  double sign = q[0] < 0.0 ? -1.0 : 1.0;
+  double s = std::sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  double k = s < 1e-9 ? 2.0 : 2.0 * std::atan2(s, sign * q[0]) / s;
+  for (int i = 0; i < 3; i++) {
+    out[i] = sign * q[i + 1] * k;
+  }
+}
+
+static void QuatToMatrix(const double* q, double* r) {
+  double w = q[0], x = q[1], y = q[2], z = q[3];
+  r[0] = 1.0 - 2.0 * (y * y + z * z);
+  r[1] = 2.0 * (x * y - w * z);
+  r[2] = 2.0 * (x * z + w * y);
+  r[3] = 2.0 * (x * y + w * z);
+  r[4] = 1.0 - 2.0 * (x * x + z * z);
+  r[5] = 2.0 * (y * z - w * x);
+  r[6] = 2.0 * (x * z - w * y);
+  r[7] = 2.0 * (y * z + w * x);
+  r[8] = 1.0 - 2.0 * (x * x + y * y);
+}
+
+static void Rotate(const double* r, const double* v, double* out) {
+  for (int i = 0; i < 3; i++) {
+    out[i] = r[3 * i] * v[0] + r[3 * i + 1] * v[1] + r[3 * i + 2] * v[2];
+  }
+}
+
+static void RotateTransposed(const double* r, const double* v, double* out) {
+  for (int i = 0; i < 3; i++) {
+    out[i] = r[i] * v[0] + r[3 + i] * v[1] + r[6 + i] * v[2];
+  }
+}
+
+/* Full matrix of a symmetric one stored as xx, xy, xz, yy, yz, zz */
+static void Expand(const double* s, double* m) {
+  m[0] = s[0]; m[1] = s[1]; m[2] = s[2];
+  m[3] = s[1]; m[4] = s[3]; m[5] = s[4];
+  m[6] = s[2]; m[7] = s[4]; m[8] = s[5];
+}
+
+/* R^T * M * R for a symmetric M, stored compactly */
+static void Congruence(const double* r, const double* s, double* out) {
+  double m[9], mr[9], full[9];
+  Expand(s, m);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      mr[3 * i + j] = m[3 * i] * r[j] + m[3 * i + 1] * r[3 + j] + m[3 * i + 2] * r[6 + j];
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      full[3 * i + j] = r[i] * mr[j] + r[3 + i] * mr[3 + j] + r[6 + i] * mr[6 + j];
+    }
+  }
+  out[0] = full[0]; out[1] = full[1]; out[2] = full[2];
+  out[3] = full[4]; out[4] = full[5]; out[5] = full[8];
+}
+
+/* a * b^T + b * a^T, stored compactly */
+static void SymmetricOuter(const double* a, const double* b, double* out) {
+  out[0] = 2.0 * a[0] * b[0];
+  out[1] = a[0] * b[1] + b[0] * a[1];
+  out[2] = a[0] * b[2] + b[0] * a[2];
+  out[3] = 2.0 * a[1] * b[1];
+  out[4] = a[1] * b[2] + b[1] * a[2];
+  out[5] = 2.0 * a[2] * b[2];
+}
+
+ADIS16470Preintegrator::ADIS16470Preintegrator(int capacity) : m_ring(std::max(capacity, 2)) {
+  SetNoiseDensity(kDefaultGyroNoiseDensity, kDefaultAccelNoiseDensity);
+}
+
+void ADIS16470Preintegrator::SetNoiseDensity(double gyro_density, double accel_density) {
+  m_gyro_variance = std::pow(gyro_density * kRadPerDeg, 2);
+  m_accel_variance = std::pow(accel_density * grav, 2);
+}
+
+void ADIS16470Preintegrator::Reset() {
+  m_count = 0;
+  m_totals = Totals();
+  // Entries from before the reset are never converted, so the new epoch needs no origin
+  m_epoch++;
+  m_epoch_entries = 0;
+}
+
+/**
+  * @brief Integrates one sample into the running totals and stores them.
+  *
+  * The specific force is rotated with the orientation at the middle of the sample, and the
+  * moments are updated with the totals after it, which is what the covariance in Get() assumes.
+ **/
+void ADIS16470Preintegrator::Process(const ADIS16470Sample& sample, int yaw_axis) {
+  if (m_count > 0 && (sample.dt <= 0.0 || static_cast<int32_t>(sample.timestamp - At(m_head - 1).timestamp) <= 0)) {
+    Reset();
+  }
+
+  if (m_count > 0) {
+    // Restart the totals from the current orientation once per ring length
+    if (m_epoch_entries == static_cast<int>(m_ring.size())) {
+      m_epoch_origin = m_totals;
+      m_totals = Totals();
+      m_epoch++;
+      m_epoch_entries = 0;
+    }
+
+    const double dt = sample.dt;
+    double theta[3] = {sample.gyro_x * dt * kRadPerDeg, sample.gyro_y * dt * kRadPerDeg, sample.gyro_z * dt * kRadPerDeg};
+    if (yaw_axis >= 0 && yaw_axis < 3) {
+      theta[yaw_axis] = sample.delta_angle * kRadPerDeg;
+    }
+    const double force[3] = {sample.accel_x * grav * dt, sample.accel_y * grav * dt, sample.accel_z * grav * dt};
+
+    // Half a step to the middle of the sample for the force, then the other half
+    Totals& t = m_totals;
+    double half[3] = {0.5 * theta[0], 0.5 * theta[1], 0.5 * theta[2]};
+    double step[4], mid[4], r[9], du[3];
+    QuatExp(half, step);
+    QuatMultiply(t.q, step, mid);
+    QuatToMatrix(mid, r);
+    Rotate(r, force, du);
+    QuatMultiply(mid, step, t.q);
+    QuatNormalize(t.q);
+
+    for (int i = 0; i < 3; i++) {
+      t.u[i] += du[i];
+    }
+    t.t += dt;
+    for (int i = 0; i < 3; i++) {
+      t.p[i] += dt * t.u[i];
+    }
+    double outer[6];
+    SymmetricOuter(t.u, t.u, outer);
+    for (int i = 0; i < 6; i++) {
+      t.m[i] += 0.5 * dt * outer[i];
+    }
+  }
+
+  Entry& entry = m_ring[m_head % m_ring.size()];
+  entry.timestamp = sample.timestamp;
+  entry.epoch = m_epoch;
+  entry.totals = m_totals;
+  m_head++;
+  m_count++;
+  m_epoch_entries++;
+}
+
+bool ADIS16470Preintegrator::GetRange(uint32_t* oldest_timestamp, uint32_t* latest_timestamp) const {
+  if (m_count == 0) {
+    return false;
+  }
+  uint64_t held = std::min<uint64_t>(m_count, m_ring.size());
+  *oldest_timestamp = At(m_head - held).timestamp;
+  *latest_timestamp = At(m_head - 1).timestamp;
+  return true;
+}
+
+/**
+  * @brief Converts totals from the previous epoch into the current one.
+  *
+  * The sums over the samples between the totals and the start of the current epoch are moved to
+  * the current epoch's frame and origin and negated, so subtracting the result from totals of the
+  * current epoch gives the sums over the whole window.
+ **/
+void ADIS16470Preintegrator::ToCurrentEpoch(Totals* totals) const {
+  const Totals& origin = m_epoch_origin;
+  double r[9], q[4];
+  QuatToMatrix(origin.q, r);
+  QuatConjugate(origin.q, q);
+  QuatMultiply(q, totals->q, q);
+
+  double du[3], dp[3], dm[6];
+  const double dt = origin.t - totals->t;
+  for (int i = 0; i < 3; i++) {
+    du[i] = totals->u[i] - origin.u[i];
+    dp[i] = origin.p[i] - totals->p[i];
+  }
+  // Sum of dt * (u - u0) * (u - u0)^T over the window, from the raw moments
+  double cross[6], square[6];
+  SymmetricOuter(origin.u, dp, cross);
+  SymmetricOuter(origin.u, origin.u, square);
+  for (int i = 0; i < 6; i++) {
+    dm[i] = origin.m[i] - totals->m[i] - cross[i] + 0.5 * square[i] * dt;
+  }
+  for (int i = 0; i < 3; i++) {
+    dp[i] -= origin.u[i] * dt;
+  }
+
+  Totals converted;
+  std::copy(q, q + 4, converted.q);
+  RotateTransposed(r, du, converted.u);
+  converted.t = -dt;
+  RotateTransposed(r, dp, converted.p);
+  Congruence(r, dm, converted.m);
+  for (int i = 0; i < 3; i++) {
+    converted.p[i] = -converted.p[i];
+  }
+  for (int i = 0; i < 6; i++) {
+    converted.m[i] = -converted.m[i];
+  }
+  *totals = converted;
+}
+
+/**
+  * @brief Finds the totals at a timestamp, interpolated between the samples on either side.
+  *
+  * The rotation is interpolated along the sample's own rotation, and the sums linearly.
+ **/
+bool ADIS16470Preintegrator::TotalsAt(uint32_t timestamp, Totals* totals, uint64_t* epoch) const {
+  if (m_count == 0) {
+    return false;
+  }
+  // Offsets from the oldest sample held, which can't wrap within the ring
+  uint64_t lo = m_head - std::min<uint64_t>(m_count, m_ring.size());
+  uint64_t hi = m_head - 1;
+  const uint32_t oldest = At(lo).timestamp;
+  const uint32_t offset = timestamp - oldest;
+  if (offset > At(hi).timestamp - oldest) {
+    return false;
+  }
+  // Last sample at or before the timestamp
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo + 1) / 2;
+    if (At(mid).timestamp - oldest <= offset) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  const Entry& before = At(lo);
+  *totals = before.totals;
+  *epoch = before.epoch;
+  if (before.timestamp == timestamp) {
+    return true;
+  }
+
+  const Entry& after = At(lo + 1);
+  if (after.epoch != before.epoch) {
+    ToCurrentEpoch(totals);
+    *epoch = after.epoch;
+  }
+  const double f = double(timestamp - before.timestamp) / double(after.timestamp - before.timestamp);
+  double inverse[4], step[4], v[3];
+  QuatConjugate(totals->q, inverse);
+  QuatMultiply(inverse, after.totals.q, step);
+  QuatLog(step, v);
+  for (int i = 0; i < 3; i++) {
+    v[i] *= f;
+  }
+  QuatExp(v, step);
+  QuatMultiply(totals->q, step, totals->q);
+  QuatNormalize(totals->q);
+  for (int i = 0; i < 3; i++) {
+    totals->u[i] += f * (after.totals.u[i] - totals->u[i]);
+    totals->p[i] += f * (after.totals.p[i] - totals->p[i]);
+  }
+  totals->t += f * (after.totals.t - totals->t);
+  for (int i = 0; i < 6; i++) {
+    totals->m[i] += f * (after.totals.m[i] - totals->m[i]);
+  }
+  return true;
+}
+
+/**
+  * @brief Computes the motion between two timestamps from the totals at either end.
+  *
+  * With S the specific force integrated from each sample to the end of the window (in the frame
+  * of the totals), gyro noise perturbs the rotation by sigma_g^2 * dt per sample, and each of those
+  * errors turns the rest of the window's force, -[S]x. To first order:
+  *
+  *   rotation:          sigma_g^2 * T * I
+  *   velocity:          sigma_a^2 * T * I + sigma_g^2 * sum(dt * ([S]x [S]x^T))
+  *   velocity/rotation: -sigma_g^2 * [sum(dt * S)]x
+  *
+  * and both sums follow from the moments stored with the totals. The results are rotated into the start frame.
+ **/
+bool ADIS16470Preintegrator::Get(uint32_t start_timestamp, uint32_t end_timestamp,
+                                 ADIS16470Preintegration* result) const {
+  Totals start, end;
+  uint64_t start_epoch, end_epoch;
+  if (!TotalsAt(start_timestamp, &start, &start_epoch) || !TotalsAt(end_timestamp, &end, &end_epoch)) {
+    return false;
+  }
+  uint32_t oldest, latest;
+  GetRange(&oldest, &latest);
+  if (end_timestamp - oldest < start_timestamp - oldest) {
+    return false;
+  }
+  if (start_epoch != end_epoch) {
+    ToCurrentEpoch(&start);
+  }
+
+  double r[9], inverse[4];
+  QuatToMatrix(start.q, r);
+  QuatConjugate(start.q, inverse);
+  QuatMultiply(inverse, end.q, result->rotation);
+  QuatNormalize(result->rotation);
+  if (result->rotation[0] < 0.0) {
+    for (int i = 0; i < 4; i++) {
+      result->rotation[i] = -result->rotation[i];
+    }
+  }
+
+  double du[3], p[3], s[3], a[6];
+  const double t = end.t - start.t;
+  for (int i = 0; i < 3; i++) {
+    du[i] = end.u[i] - start.u[i];
+    p[i] = end.p[i] - start.p[i];
+    s[i] = end.u[i] * t - p[i];
+  }
+  RotateTransposed(r, du, result->delta_velocity);
+  result->start_timestamp = start_timestamp;
+  result->end_timestamp = end_timestamp;
+  result->dt = t;
+
+  // sum(dt * S * S^T) with S = u_end - u
+  double cross[6], square[6];
+  SymmetricOuter(end.u, p, cross);
+  SymmetricOuter(end.u, end.u, square);
+  for (int i = 0; i < 6; i++) {
+    a[i] = end.m[i] - start.m[i] - cross[i] + 0.5 * square[i] * t;
+  }
+  double a_start[6], s_start[3];
+  Congruence(r, a, a_start);
+  RotateTransposed(r, s, s_start);
+  const double trace = a_start[0] + a_start[3] + a_start[5];
+  double vv[9], av[9];
+  Expand(a_start, av);
+  for (int i = 0; i < 9; i++) {
+    vv[i] = -m_gyro_variance * av[i];
+  }
+  for (int i = 0; i < 3; i++) {
+    vv[4 * i] += m_accel_variance * t + m_gyro_variance * trace;
+  }
+  // -sigma_g^2 * [s]x
+  const double g = m_gyro_variance;
+  const double vr[9] = {0.0, g * s_start[2], -g * s_start[1],
+                        -g * s_start[2], 0.0, g * s_start[0],
+                        g * s_start[1], -g * s_start[0], 0.0};
+
+  double* c = result->covariance;
+  std::fill(c, c + 36, 0.0);
+  for (int i = 0; i < 3; i++) {
+    c[7 * i] = m_gyro_variance * t;
+    for (int j = 0; j < 3; j++) {
+      c[(3 + i) * 6 + 3 + j] = vv[3 * i + j];
+      c[(3 + i) * 6 + j] = vr[3 * i + j];
+      c[j * 6 + 3 + i] = vr[3 * i + j];
+    }
+  }
+  return true;
+}
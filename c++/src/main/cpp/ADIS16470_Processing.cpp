@@ -0,0 +1,152 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cmath>
+
+#include <adi/ADIS16470_Processing.h>
+#include <adi/ADIS16470_Registers.h>
+
+using namespace frc;
+
+/**
+  * @brief Builds the auto SPI transmit data and word offsets for a frame.
+  *
+  * @param yaw_axis The axis whose delta angle is streamed (0 = X, 1 = Y, 2 = Z).
+  *
+  * @param high_resolution_mask Channels (ADIS16470ChannelBit()) to stream at 32 bits.
+  *
+  * @param read_diag_stat Also read DIAG_STAT. The IMU clears it on every read, so each frame holds the faults since the previous one.
+  *
+  * @return The frame layout. With an empty mask the frame is the classic 19 word frame.
+ **/
+ADIS16470FrameLayout frc::ADIS16470MakeFrameLayout(int yaw_axis, uint8_t high_resolution_mask, bool read_diag_stat) {
+  static constexpr uint8_t deltang_out[3] = {X_DELTANG_OUT, Y_DELTANG_OUT, Z_DELTANG_OUT};
+  static constexpr uint8_t deltang_low[3] = {X_DELTANG_LOW, Y_DELTANG_LOW, Z_DELTANG_LOW};
+  static constexpr uint8_t channel_out[kADIS16470NumChannels] = {
+    X_GYRO_OUT, Y_GYRO_OUT, Z_GYRO_OUT, X_ACCL_OUT, Y_ACCL_OUT, Z_ACCL_OUT
+  };
+
+  ADIS16470FrameLayout layout;
+  layout.high_resolution_mask = high_resolution_mask & kADIS16470AllChannels;
+  int reads = 0;
+  auto add_read = [&](uint8_t reg) {
+    layout.packet[2 * reads] = reg;
+    layout.packet[2 * reads + 1] = FLASH_CNT;
+    reads++;
+  };
+  // Responses lag one read behind, so read n lands after the timestamp and the 2 junk words
+  auto word_index = [&]() { return 3 + 2 * reads; };
+
+  if (yaw_axis < 0 || yaw_axis > 2) {
+    yaw_axis = 2;
+  }
+  add_read(deltang_out[yaw_axis]);
+  add_read(deltang_low[yaw_axis]);
+  for (int c = 0; c < kADIS16470NumChannels; c++) {
+    layout.channel_index[c] = word_index();
+    add_read(channel_out[c]);
+    if (layout.high_resolution_mask & (1 << c)) {
+      // Each LOW register sits just below its OUT register
+      add_read(channel_out[c] - 2);
+    }
+  }
+  if (read_diag_stat) {
+    layout.diag_index = word_index();
+    add_read(DIAG_STAT);
+  }
+  layout.packet_size = 2 * reads;
+  layout.frame_len = word_index();
+  return layout;
+}
+
+/**
+  * @brief Runs one sample through the complementary filter.
+  *
+  * @param sample A decoded frame. The gyro rates are in deg/s and the accelerations in g.
+  *
+  * The first sample after a reset seeds both tilt estimates from the accelerometer alone, since
+  * the elapsed time to the previous frame is meaningless at that point.
+ **/
+void ADIS16470ComplementaryFilter::Process(const ADIS16470Sample& sample) {
+  // Convert scaled sensor data to SI units
+  double gyro_x_si = sample.gyro_x * deg_to_rad;
+  double gyro_y_si = sample.gyro_y * deg_to_rad;
+  double accel_x_si = sample.accel_x * grav;
+  double accel_y_si = sample.accel_y * grav;
+  double accel_z_si = sample.accel_z * grav;
+
+  m_dt = sample.dt;
+  m_alpha = m_tau / (m_tau + m_dt);
+  if (m_accel_rejection > 0.0) {
+    double accel_norm = sqrt(sample.accel_x * sample.accel_x + sample.accel_y * sample.accel_y +
+                             sample.accel_z * sample.accel_z);
+    if (fabs(accel_norm - 1.0) > m_accel_rejection) {
+      // Gravity is not the only acceleration, so the accelerometer tilt is wrong: integrate the gyro only
+      m_alpha = 1.0;
+    }
+  }
+
+  if (m_first_run) {
+    m_accelAngleX = atan2f(accel_x_si, sqrtf((accel_y_si * accel_y_si) + (accel_z_si * accel_z_si)));
+    m_accelAngleY = atan2f(accel_y_si, sqrtf((accel_x_si * accel_x_si) + (accel_z_si * accel_z_si)));
+    m_compAngleX = m_accelAngleX;
+    m_compAngleY = m_accelAngleY;
+    m_first_run = false;
+  }
+  else {
+    // Process X angle
+    m_accelAngleX = atan2f(accel_x_si, sqrtf((accel_y_si * accel_y_si) + (accel_z_si * accel_z_si)));
+    m_accelAngleY = atan2f(accel_y_si, sqrtf((accel_x_si * accel_x_si) + (accel_z_si * accel_z_si)));
+    m_accelAngleX = FormatAccelRange(m_accelAngleX, accel_z_si);
+    m_accelAngleY = FormatAccelRange(m_accelAngleY, accel_z_si);
+    m_compAngleX = CompFilterProcess(m_compAngleX, m_accelAngleX, -gyro_y_si);
+    m_compAngleY = CompFilterProcess(m_compAngleY, m_accelAngleY, gyro_x_si);
+  }
+}
+
+/* Complementary filter functions */
+double ADIS16470ComplementaryFilter::FormatFastConverge(double compAngle, double accAngle) {
+  if(compAngle > accAngle + M_PI) {
+    compAngle = compAngle - 2.0 * M_PI;
+  }
+  else if (accAngle > compAngle + M_PI) {
+    compAngle = compAngle + 2.0 * M_PI;
+  }
+  return compAngle;
+}
+
+double ADIS16470ComplementaryFilter::FormatRange0to2PI(double compAngle) {
+  while(compAngle >= 2 * M_PI) {
+    compAngle = compAngle - 2.0 * M_PI;
+  }
+  while(compAngle < 0.0) {
+    compAngle = compAngle + 2.0 * M_PI;
+  }
+  return compAngle;
+}
+
+double ADIS16470ComplementaryFilter::FormatAccelRange(double accelAngle, double accelZ) {
+  if(accelZ < 0.0) {
+    accelAngle = M_PI - accelAngle;
+  }
+  else if(accelZ > 0.0 && accelAngle < 0.0) {
+    accelAngle = 2.0 * M_PI + accelAngle;
+  }
+  return accelAngle;
+}
+
+double ADIS16470ComplementaryFilter::CompFilterProcess(double compAngle, double accelAngle, double omega) {
+  compAngle = FormatFastConverge(compAngle, accelAngle);
+  compAngle = m_alpha * (compAngle + omega * m_dt) + (1.0 - m_alpha) * accelAngle;
+  compAngle = FormatRange0to2PI(compAngle);
+  if(compAngle > M_PI) {
+    compAngle = compAngle - 2.0 * M_PI;
+  }
+  return compAngle;
+}
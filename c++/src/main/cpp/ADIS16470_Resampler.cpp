@@ -0,0 +1,155 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <adi/ADIS16470_Resampler.h>
+
+using namespace frc;
+
+ADIS16470Resampler::ADIS16470Resampler(double rate, int capacity) :
+                    m_period(std::max<uint64_t>(uint64_t(std::llround(1000000.0 / rate)), 1)),
+                    m_ring(std::max(capacity, 1)) {}
+
+void ADIS16470Resampler::Restart() {
+  m_count = 0;
+}
+
+/**
+  * @brief Removes the bias from the held inputs and from the outputs back to the start of the covered time.
+ **/
+void ADIS16470Resampler::RemoveBias(const double* gyro_bias, double yaw_bias, double covered, double zeroed) {
+  const uint64_t latest = m_latest;
+  auto correct = [&](uint64_t time, double* values) {
+    const double ago = (latest - time) / 1000000.0;
+    const double since_start = covered - ago;
+    if (since_start < 0.0) {
+      return false;
+    }
+    const double since_zero = zeroed - ago;
+    for (int c = 0; c < 3; c++) {
+      values[c] -= gyro_bias[c];
+    }
+    values[kADIS16470GridAngle] -= yaw_bias * (since_zero > 0.0 ? std::min(since_start, since_zero) : since_start);
+    return true;
+  };
+  for (int i = 0; i < m_count; i++) {
+    correct(m_times[i], m_values[i]);
+  }
+  std::lock_guard<std::mutex> sync(m_mutex);
+  uint64_t oldest = m_head > m_ring.size() ? m_head - m_ring.size() : 0;
+  for (uint64_t seq = m_head; seq > oldest; seq--) {
+    ADIS16470GridSample& out = m_ring[(seq - 1) % m_ring.size()];
+    if (out.time > latest || !correct(out.time, out.values)) {
+      break;
+    }
+  }
+}
+
+/**
+  * @brief Feeds one input sample and produces every grid sample it completes.
+  *
+  * Grid times between the second and third of the last four input samples are interpolated, so
+  * each output has two input samples on either side of it.
+ **/
+void ADIS16470Resampler::Process(const ADIS16470Sample& sample, uint64_t now) {
+  // Put the 32-bit timestamp on the 64-bit FPGA clock, the way ADIS16470LatencyCalibrator does
+  const uint64_t time = now - static_cast<uint32_t>(static_cast<uint32_t>(now) - sample.timestamp);
+  m_latest = time;
+
+  if (sample.dt <= 0.0 || (m_count > 0 && time <= m_times[m_count - 1])) {
+    Restart();
+  }
+  else if (m_count >= 2) {
+    uint64_t spacing = m_times[m_count - 1] - m_times[m_count - 2];
+    if (time - m_times[m_count - 1] > kMaxGapPeriods * spacing) {
+      Restart();
+    }
+  }
+
+  if (m_count == 4) {
+    std::memmove(&m_times[0], &m_times[1], 3 * sizeof(m_times[0]));
+    std::memmove(&m_values[0], &m_values[1], 3 * sizeof(m_values[0]));
+    m_count = 3;
+  }
+  m_times[m_count] = time;
+  double* values = m_values[m_count];
+  values[0] = sample.gyro_x;
+  values[1] = sample.gyro_y;
+  values[2] = sample.gyro_z;
+  values[3] = sample.accel_x;
+  values[4] = sample.accel_y;
+  values[5] = sample.accel_z;
+  values[kADIS16470GridAngle] = sample.angle;
+  values[kADIS16470GridAngle + 1] = 0.0;
+  m_count++;
+  if (m_count < 4) {
+    return;
+  }
+
+  // First grid point at or after the second input sample (the grid stays anchored to the FPGA clock)
+  if (m_next < m_times[1]) {
+    m_next = (m_times[1] + m_period - 1) / m_period * m_period;
+  }
+  if (m_next >= m_times[2]) {
+    return;
+  }
+
+  // Node positions relative to the second sample keep the weights well conditioned
+  double x[4];
+  for (int i = 0; i < 4; i++) {
+    x[i] = double(int64_t(m_times[i] - m_times[1]));
+  }
+  std::lock_guard<std::mutex> sync(m_mutex);
+  for (; m_next < m_times[2]; m_next += m_period) {
+    double t = double(m_next - m_times[1]);
+    double weights[4];
+    for (int i = 0; i < 4; i++) {
+      double w = 1.0;
+      for (int j = 0; j < 4; j++) {
+        if (j != i) {
+          w *= (t - x[j]) / (x[i] - x[j]);
+        }
+      }
+      weights[i] = w;
+    }
+    Emit(m_next, weights);
+  }
+}
+
+/* Writes one grid sample to the ring. Called with m_mutex held. */
+void ADIS16470Resampler::Emit(uint64_t time, const double* weights) {
+  ADIS16470GridSample& out = m_ring[m_head % m_ring.size()];
+  out.time = time;
+  // Same weights for every channel: one multiply-add per channel and input sample
+  for (int c = 0; c < kADIS16470GridChannels; c++) {
+    out.values[c] = weights[0] * m_values[0][c] + weights[1] * m_values[1][c] +
+                    weights[2] * m_values[2][c] + weights[3] * m_values[3][c];
+  }
+  m_head++;
+}
+
+uint64_t ADIS16470Resampler::GetHead() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_head;
+}
+
+int ADIS16470Resampler::Read(uint64_t* sequence, ADIS16470GridSample* samples, int max_samples) const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  uint64_t oldest = m_head > m_ring.size() ? m_head - m_ring.size() : 0;
+  uint64_t seq = std::max(*sequence, oldest);
+  int count = 0;
+  for (; seq < m_head && count < max_samples; seq++, count++) {
+    samples[count] = m_ring[seq % m_ring.size()];
+  }
+  *sequence = seq;
+  return count;
+}
@@ -0,0 +1,108 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <adi/ADIS16470_SPITransport.h>
+
+#include <frc/Timer.h>
+#include <hal/HAL.h>
+
+using namespace frc;
+
+ADIS16470SPITransport::ADIS16470SPITransport(SPI::Port port) : m_port(port) {}
+
+ADIS16470SPITransport::~ADIS16470SPITransport() {
+  CloseSPI();
+}
+
+/**
+  * @brief Drives the IMU reset line.
+  *
+  * Relies on the RIO hardware by default configuring an output as low and configuring an input
+  * as high Z. The 10k pull-up resistor internal to the IMU then forces the reset line high for
+  * normal operation once the line is released.
+ **/
+void ADIS16470SPITransport::SetResetAsserted(bool asserted) {
+  if (asserted) {
+    m_reset_in.reset();
+    m_reset_out = std::make_unique<DigitalOutput>(27);  // Drive SPI CS2 (IMU RST) low
+  }
+  else {
+    m_reset_out.reset();
+    m_reset_in = std::make_unique<DigitalInput>(27);  // Set SPI CS2 (IMU RST) high
+  }
+}
+
+void ADIS16470SPITransport::SetReadyLED(bool on) {
+  if (on) {
+    m_status_led = std::make_unique<DigitalOutput>(28);  // Drive SPI CS3 (IMU ready LED) low (active low)
+  }
+  else {
+    m_status_led.reset();
+  }
+}
+
+void ADIS16470SPITransport::OpenSPI() {
+  m_spi = std::make_unique<SPI>(m_port);
+  m_spi->SetClockRate(2000000);
+  m_spi->SetMSBFirst();
+  m_spi->SetSampleDataOnTrailingEdge();
+  m_spi->SetClockActiveLow();
+  m_spi->SetChipSelectActiveLow();
+}
+
+void ADIS16470SPITransport::CloseSPI() {
+  m_spi.reset();
+  m_auto_interrupt.reset();
+}
+
+int ADIS16470SPITransport::Write(uint8_t* data, int size) {
+  return m_spi->Write(data, size);
+}
+
+int ADIS16470SPITransport::Read(bool initiate, uint8_t* data, int size) {
+  return m_spi->Read(initiate, data, size);
+}
+
+void ADIS16470SPITransport::InitAuto(int buffer_size) {
+  m_spi->InitAuto(buffer_size);
+}
+
+void ADIS16470SPITransport::SetAutoTransmitData(const uint8_t* data, int size, int zero_size) {
+  m_spi->SetAutoTransmitData(wpi::ArrayRef<uint8_t>(data, size), zero_size);
+}
+
+void ADIS16470SPITransport::ConfigureAutoStall(int cs_to_sclk_ticks, int stall_ticks, int pow2_bytes_per_read) {
+  m_spi->ConfigureAutoStall(static_cast<HAL_SPIPort>(m_port), cs_to_sclk_ticks, stall_ticks, pow2_bytes_per_read);
+}
+
+void ADIS16470SPITransport::StartAutoTrigger() {
+  // Only set up the interrupt if needed.
+  if (m_auto_interrupt == nullptr) {
+    m_auto_interrupt = std::make_unique<DigitalInput>(26);
+  }
+  // DR High = Data good (data capture should be triggered on the rising edge)
+  m_spi->StartAutoTrigger(*m_auto_interrupt, true, false);
+}
+
+void ADIS16470SPITransport::StopAuto() {
+  m_spi->StopAuto();
+}
+
+int ADIS16470SPITransport::ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) {
+  return m_spi->ReadAutoReceivedData(buffer, num_to_read, units::second_t(timeout));
+}
+
+uint64_t ADIS16470SPITransport::GetTime() {
+  int32_t status = 0;
+  return HAL_GetFPGATime(&status);
+}
+
+void ADIS16470SPITransport::Sleep(double seconds) {
+  Wait(seconds);
+}
@@ -0,0 +1,400 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <adi/ADIS16470_Processing.h>
+#include <adi/ADIS16470_Registers.h>
+#include <adi/ADIS16470_SimTransport.h>
+
+using namespace frc;
+
+/* Internal sample clock of the IMU (2000 SPS) */
+static constexpr uint64_t kBasePeriodNs = 500000;
+
+/* Delta velocity scale factor (m/s per LSB of the 32-bit output) */
+static constexpr double kDeltaVelocitySf = 400.0 / 2147483648.0;
+
+/* Clamps and rounds a scaled value into a signed 32-bit register pair */
+static inline int32_t ToRegister32(double value) {
+  double rounded = std::round(value);
+  rounded = std::max(-2147483648.0, std::min(2147483647.0, rounded));
+  return static_cast<int32_t>(rounded);
+}
+
+ADIS16470SimTransport::ADIS16470SimTransport(uint32_t seed) : m_rng(seed) {
+  ResetRegisters();
+  m_booted_at = m_boot_ns;
+  m_next_edge = m_booted_at + SamplePeriod();
+}
+
+void ADIS16470SimTransport::SetAngularRate(double x, double y, double z) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  IntegrateRate(m_now);
+  m_rate[0] = x;
+  m_rate[1] = y;
+  m_rate[2] = z;
+}
+
+void ADIS16470SimTransport::SetAcceleration(double x, double y, double z) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_accel[0] = x;
+  m_accel[1] = y;
+  m_accel[2] = z;
+}
+
+void ADIS16470SimTransport::SetGyroBias(double x, double y, double z) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  IntegrateRate(m_now);
+  m_bias[0] = x;
+  m_bias[1] = y;
+  m_bias[2] = z;
+}
+
+void ADIS16470SimTransport::SetGyroNoise(double std_dev) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_gyro_noise = std_dev;
+}
+
+void ADIS16470SimTransport::SetAccelNoise(double std_dev) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_accel_noise = std_dev;
+}
+
+void ADIS16470SimTransport::SetSerialNumber(uint16_t serial) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_serial = serial;
+  Reg(SERIAL_NUM) = serial;
+}
+
+void ADIS16470SimTransport::SetProductID(uint16_t product_id) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_product_id = product_id;
+  Reg(PROD_ID) = product_id;
+}
+
+void ADIS16470SimTransport::SetBootTime(double seconds) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_boot_ns = static_cast<uint64_t>(seconds * 1e9);
+}
+
+ADIS16470SimTransport::Stats ADIS16470SimTransport::GetStats() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_stats;
+}
+
+double ADIS16470SimTransport::GetVirtualTime() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_now / 1e9;
+}
+
+void ADIS16470SimTransport::RaiseDiagStat(uint16_t flags) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  Reg(DIAG_STAT) |= flags;
+}
+
+uint16_t ADIS16470SimTransport::PeekRegister(uint8_t reg) const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_regs[(reg & 0x7f) >> 1];
+}
+
+/* Power-on register defaults (ADIS16470 datasheet, Table 8) */
+void ADIS16470SimTransport::ResetRegisters() {
+  std::memset(m_regs, 0, sizeof(m_regs));
+  Reg(MSC_CTRL) = 0x00C1;
+  Reg(NULL_CNFG) = 0x070A;
+  Reg(FIRM_REV) = 0x0104;
+  Reg(PROD_ID) = m_product_id;
+  Reg(SERIAL_NUM) = m_serial;
+  IntegrateRate(m_now);
+  for (double& correction : m_bias_correction) {
+    correction = 0.0;
+  }
+  m_pending_response = 0;
+}
+
+uint64_t ADIS16470SimTransport::SamplePeriod() const {
+  return kBasePeriodNs * (m_regs[DEC_RATE >> 1] % 2000 + 1);
+}
+
+void ADIS16470SimTransport::SetResetAsserted(bool asserted) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (asserted) {
+    m_in_reset = true;
+    m_next_edge = kNone;
+  }
+  else if (m_in_reset) {
+    m_in_reset = false;
+    ResetRegisters();
+    m_booted_at = m_now + m_boot_ns;
+    m_next_edge = m_booted_at + SamplePeriod();
+  }
+}
+
+void ADIS16470SimTransport::SetReadyLED(bool on) {}
+
+void ADIS16470SimTransport::OpenSPI() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_open = true;
+}
+
+void ADIS16470SimTransport::CloseSPI() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_open = false;
+  m_auto_running = false;
+}
+
+bool ADIS16470SimTransport::IsOpen() const {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_open;
+}
+
+/**
+  * @brief Runs a full duplex transfer through the IMU's SPI state machine.
+  *
+  * Every 16-bit transfer clocks out the response to the previous transfer and then decodes the new
+  * command: bit 7 of the first byte selects a write of the second byte, otherwise the addressed
+  * register is latched as the next response. An IMU that is in reset or still booting answers zeros.
+ **/
+void ADIS16470SimTransport::Transfer(const uint8_t* tx, uint8_t* rx, int size) {
+  bool alive = !m_in_reset && m_now >= m_booted_at;
+  for (int i = 0; i + 1 < size; i += 2) {
+    rx[i] = m_pending_response >> 8;
+    rx[i + 1] = m_pending_response & 0xff;
+    if (!alive) {
+      m_pending_response = 0;
+      continue;
+    }
+    if (tx[i] & 0x80) {
+      WriteByte(tx[i] & 0x7f, tx[i + 1]);
+      m_pending_response = 0;
+    }
+    else {
+      m_pending_response = Reg(tx[i]);
+      // DIAG_STAT clears on read
+      if ((tx[i] & 0x7e) == DIAG_STAT) {
+        Reg(DIAG_STAT) = 0;
+      }
+    }
+  }
+  if (size & 1) {
+    rx[size - 1] = 0;
+  }
+}
+
+void ADIS16470SimTransport::WriteByte(uint8_t addr, uint8_t val) {
+  uint8_t base = addr & 0x7e;
+  if (base == PROD_ID || base == SERIAL_NUM) {
+    return;
+  }
+  uint16_t& reg = Reg(base);
+  if (addr & 1) {
+    reg = (reg & 0x00ff) | (uint16_t(val) << 8);
+  }
+  else {
+    reg = (reg & 0xff00) | val;
+  }
+  if (base == DEC_RATE) {
+    // The new output rate takes effect from the next internal sample
+    if (m_next_edge != kNone) {
+      m_next_edge = m_now + SamplePeriod();
+    }
+  }
+  else if (base == GLOB_CMD && !(addr & 1)) {
+    if (val & 0x01) {
+      // Bias correction update: latch the bias averaged over the NULL_CNFG window
+      IntegrateRate(m_now);
+      for (int axis = 0; axis < 3; axis++) {
+        m_bias_correction[axis] = m_bias[axis];
+      }
+    }
+    reg = 0;
+  }
+}
+
+int ADIS16470SimTransport::Write(uint8_t* data, int size) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_last_rx_size = std::min(size, int(sizeof(m_last_rx)));
+  Transfer(data, m_last_rx, m_last_rx_size);
+  m_stats.spi_transfers += size / 2;
+  return size;
+}
+
+int ADIS16470SimTransport::Read(bool initiate, uint8_t* data, int size) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  size = std::min(size, int(sizeof(m_last_rx)));
+  if (initiate) {
+    uint8_t zeros[sizeof(m_last_rx)] = {0};
+    Transfer(zeros, m_last_rx, size);
+    m_last_rx_size = size;
+    m_stats.spi_transfers += size / 2;
+  }
+  std::memcpy(data, m_last_rx, std::min(size, m_last_rx_size));
+  return size;
+}
+
+void ADIS16470SimTransport::InitAuto(int buffer_size) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_fifo_capacity = buffer_size;
+  m_fifo.clear();
+}
+
+void ADIS16470SimTransport::SetAutoTransmitData(const uint8_t* data, int size, int zero_size) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_auto_tx.assign(data, data + size);
+  m_auto_tx.insert(m_auto_tx.end(), zero_size, 0);
+}
+
+void ADIS16470SimTransport::ConfigureAutoStall(int cs_to_sclk_ticks, int stall_ticks, int pow2_bytes_per_read) {}
+
+void ADIS16470SimTransport::StartAutoTrigger() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_auto_running = m_open;
+}
+
+void ADIS16470SimTransport::StopAuto() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_auto_running = false;
+}
+
+int ADIS16470SimTransport::ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  if (num_to_read <= 0) {
+    return static_cast<int>(m_fifo.size());
+  }
+  int count = std::min(num_to_read, static_cast<int>(m_fifo.size()));
+  std::copy(m_fifo.begin(), m_fifo.begin() + count, buffer);
+  m_fifo.erase(m_fifo.begin(), m_fifo.begin() + count);
+  return static_cast<int>(m_fifo.size());
+}
+
+/**
+  * @brief Produces one internal sample and, if auto SPI is running, captures one frame.
+  *
+  * The output registers are refreshed from the truth signal first so the auto SPI transfer that
+  * follows the data ready edge reads the new sample, just like on the real part.
+ **/
+void ADIS16470SimTransport::DataReady(uint64_t time_ns) {
+  double period = SamplePeriod() / 1e9;
+  static constexpr uint8_t gyro_regs[3] = {X_GYRO_LOW, Y_GYRO_LOW, Z_GYRO_LOW};
+  static constexpr uint8_t accel_regs[3] = {X_ACCL_LOW, Y_ACCL_LOW, Z_ACCL_LOW};
+  static constexpr uint8_t deltang_regs[3] = {X_DELTANG_LOW, Y_DELTANG_LOW, Z_DELTANG_LOW};
+  static constexpr uint8_t deltvel_regs[3] = {X_DELTVEL_LOW, Y_DELTVEL_LOW, Z_DELTVEL_LOW};
+  IntegrateRate(time_ns);
+  for (int axis = 0; axis < 3; axis++) {
+    double rate = m_rate[axis] + m_bias[axis] - m_bias_correction[axis];
+    double gyro_noise = m_gyro_noise * m_normal(m_rng);
+    double gyro = rate + gyro_noise;
+    double accel = m_accel[axis] + m_accel_noise * m_normal(m_rng);
+    // The delta angle integrates the rate over the whole sample period
+    double deltang = m_angle[axis] - m_edge_angle[axis] + gyro_noise * period;
+    m_edge_angle[axis] = m_angle[axis];
+    int32_t gyro_raw = ToRegister32(gyro * 10.0 * 65536.0);
+    int32_t accel_raw = ToRegister32(accel * 800.0 * 65536.0);
+    int32_t deltang_raw = ToRegister32(deltang / delta_angle_sf);
+    int32_t deltvel_raw = ToRegister32(accel * grav * period / kDeltaVelocitySf);
+    Reg(gyro_regs[axis]) = uint32_t(gyro_raw) & 0xffff;
+    Reg(gyro_regs[axis] + 2) = uint32_t(gyro_raw) >> 16;
+    Reg(accel_regs[axis]) = uint32_t(accel_raw) & 0xffff;
+    Reg(accel_regs[axis] + 2) = uint32_t(accel_raw) >> 16;
+    Reg(deltang_regs[axis]) = uint32_t(deltang_raw) & 0xffff;
+    Reg(deltang_regs[axis] + 2) = uint32_t(deltang_raw) >> 16;
+    Reg(deltvel_regs[axis]) = uint32_t(deltvel_raw) & 0xffff;
+    Reg(deltvel_regs[axis] + 2) = uint32_t(deltvel_raw) >> 16;
+  }
+  Reg(DATA_CNTR)++;
+  m_stats.frames_generated++;
+
+  if (!m_auto_running) {
+    m_stats.frames_missed++;
+    return;
+  }
+  size_t frame_len = m_auto_tx.size() + 1;
+  if (m_fifo.size() + frame_len > m_fifo_capacity) {
+    m_stats.frames_overflowed++;
+    return;
+  }
+  std::vector<uint8_t> rx(m_auto_tx.size());
+  Transfer(m_auto_tx.data(), rx.data(), static_cast<int>(rx.size()));
+  m_fifo.push_back(static_cast<uint32_t>(time_ns / 1000));
+  m_fifo.insert(m_fifo.end(), rx.begin(), rx.end());
+  m_stats.frames_captured++;
+}
+
+/**
+  * @brief Integrates the measured rate (truth plus uncorrected bias) up to time_ns.
+ **/
+void ADIS16470SimTransport::IntegrateRate(uint64_t time_ns) {
+  if (time_ns <= m_angle_time) {
+    return;
+  }
+  double elapsed = (time_ns - m_angle_time) / 1e9;
+  for (int axis = 0; axis < 3; axis++) {
+    m_angle[axis] += (m_rate[axis] + m_bias[axis] - m_bias_correction[axis]) * elapsed;
+  }
+  m_angle_time = time_ns;
+}
+
+void ADIS16470SimTransport::AdvanceTo(uint64_t time_ns) {
+  while (m_next_edge != kNone && m_next_edge <= time_ns) {
+    m_now = m_next_edge;
+    DataReady(m_next_edge);
+    m_next_edge += SamplePeriod();
+  }
+  m_now = std::max(m_now, time_ns);
+}
+
+uint64_t ADIS16470SimTransport::GetTime() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  return m_now / 1000;
+}
+
+/**
+  * @brief Moves the virtual clock forward once every attached thread is asleep.
+  *
+  * Only one sleeper is released at a time (earliest wake-up first, ties in sleep order), so the
+  * released thread runs alone until it sleeps again or detaches.
+ **/
+void ADIS16470SimTransport::Schedule() {
+  if (m_released != kNone || m_sleepers.empty() || m_sleeping < m_attached) {
+    return;
+  }
+  auto next = *m_sleepers.begin();
+  m_sleepers.erase(m_sleepers.begin());
+  m_sleeping--;
+  AdvanceTo(next.first);
+  m_released = next.second;
+  m_cv.notify_all();
+}
+
+void ADIS16470SimTransport::Sleep(double seconds) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  uint64_t wake = m_now + static_cast<uint64_t>(std::max(seconds, 0.0) * 1e9);
+  uint64_t id = m_next_sleeper++;
+  m_sleepers.emplace(wake, id);
+  m_sleeping++;
+  Schedule();
+  m_cv.wait(lock, [&] { return m_released == id; });
+  m_released = kNone;
+  // A thread that isn't attached may have been the last one holding the clock back
+  Schedule();
+}
+
+void ADIS16470SimTransport::AttachThread() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_attached++;
+}
+
+void ADIS16470SimTransport::DetachThread() {
+  std::lock_guard<std::mutex> sync(m_mutex);
+  m_attached--;
+  Schedule();
+}
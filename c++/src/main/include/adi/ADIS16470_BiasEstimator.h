@@ -0,0 +1,95 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <adi/ADIS16470_NoiseStats.h>
+#include <adi/ADIS16470_Processing.h>
+
+namespace frc {
+
+/**
+ * State of the host-side gyro bias estimate.
+ */
+struct ADIS16470HostBias {
+  // True once the estimate is final and is being removed from the samples
+  bool converged = false;
+  // True if the estimate was accepted at the time limit rather than at the target standard error
+  bool timed_out = false;
+  // Estimated gyro biases (deg/s)
+  double gyro_x = 0.0;
+  double gyro_y = 0.0;
+  double gyro_z = 0.0;
+  // Bias of the yaw axis measured from the 32-bit delta angle (deg/s)
+  double yaw = 0.0;
+  // Largest standard error of the mean across the gyro axes (deg/s)
+  double std_error = 0.0;
+  // Samples and time (s) behind the estimate
+  uint64_t samples = 0;
+  double time = 0.0;
+  // Number of times motion restarted the estimate
+  int restarts = 0;
+};
+
+/**
+ * Estimates the gyro bias from live samples while the robot is at rest.
+ *
+ * Each gyro axis (and the yaw delta angle rate) is averaged with Welford's algorithm. The estimate
+ * converges once the standard error of every mean drops below the target, which for a quiet IMU
+ * takes far less than the hardware null window. A sample further than the motion threshold from
+ * the running mean means the robot moved, and the estimate starts over. If the time limit is
+ * reached first, the current estimate is accepted and flagged as timed out.
+ */
+class ADIS16470BiasEstimator {
+ public:
+  // Samples needed before the standard error is trusted
+  static constexpr uint64_t kMinSamples = 50;
+
+  /**
+   * @param target_std_error Standard error of the mean (deg/s) at which the estimate is final.
+   *
+   * @param motion_threshold Distance from the running mean (deg/s) treated as motion.
+   *
+   * @param max_time Time (s) after which the current estimate is accepted.
+   */
+  void Configure(double target_std_error, double motion_threshold, double max_time);
+
+  void Reset();
+
+  /**
+   * @brief Folds one sample into the estimate.
+   *
+   * @param sample A decoded sample. Its dt must be valid (not the first sample after a restart).
+   *
+   * @return True on the sample that makes the estimate converge.
+   */
+  bool Update(const ADIS16470Sample& sample);
+
+  bool IsConverged() const { return m_bias.converged; }
+
+  const ADIS16470HostBias& GetBias() const { return m_bias; }
+
+  double GetTargetStdError() const { return m_target_std_error; }
+
+ private:
+  void Restart();
+
+  double m_target_std_error = 0.01;
+  double m_motion_threshold = 2.0;
+  double m_max_time = 4.0;
+  double m_total_time = 0.0;
+
+  // Gyro X, Y, Z and the yaw delta angle rate
+  ADIS16470WelfordStats m_stats[4];
+  ADIS16470HostBias m_bias;
+};
+
+} //namespace frc
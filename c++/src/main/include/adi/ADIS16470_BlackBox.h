@@ -0,0 +1,176 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <adi/ADIS16470_Log.h>
+#include <adi/ADIS16470_Processing.h>
+
+namespace frc {
+
+/* Events that can trigger a black box capture */
+enum ADIS16470BlackBoxTrigger : uint32_t {
+  // ADIS16470_IMU::TriggerBlackBox() was called
+  kADIS16470TriggerUser = 0x01,
+  // Horizontal acceleration above the configured threshold
+  kADIS16470TriggerAccel = 0x02,
+  // A DIAG_STAT error flag was set (needs ADIS16470_IMU::ConfigDiagStatRead())
+  kADIS16470TriggerDiagStat = 0x04,
+  // The acquisition thread fell behind the FIFO
+  kADIS16470TriggerOverrun = 0x08,
+  kADIS16470TriggerAll = 0x0f
+};
+
+/**
+ * Black box counters.
+ */
+struct ADIS16470BlackBoxStats {
+  // True while the post-trigger window is being recorded
+  bool capturing = false;
+  // Captures written to disk
+  uint64_t captures_written = 0;
+  // Captures thrown away because the previous one was still being written
+  uint64_t captures_dropped = 0;
+  // Captures that could not be written (file could not be created or the write failed)
+  uint64_t write_errors = 0;
+  // Path of the most recent capture written
+  std::string last_file;
+};
+
+/**
+ * Keeps the most recent raw auto SPI frames in RAM and writes them out around trigger events.
+ *
+ * Append() copies every frame into a preallocated ring sized for the pre- and post-trigger
+ * windows. Trigger() marks the current position. Once the post-trigger window has been recorded
+ * the whole ring (pre-trigger frames, trigger point, post-trigger frames) is handed to a writer
+ * thread and recording continues into a second ring, so the caller only ever copies frames and
+ * swaps a pointer. A trigger that completes while the previous capture is still being written is
+ * counted and dropped.
+ *
+ * Captures are written in the raw log format, with a kADIS16470LogEvent record at the trigger
+ * point, so they can be analyzed with the adis16470logtool like any raw log.
+ *
+ * Append(), Trigger() and Reset() must all be called from the same thread.
+ */
+class ADIS16470BlackBox {
+ public:
+  // Longest kADIS16470LogConfig record kept
+  static constexpr int kMaxConfigWords = 8;
+
+  ADIS16470BlackBox() = default;
+
+  ~ADIS16470BlackBox();
+
+  ADIS16470BlackBox(const ADIS16470BlackBox&) = delete;
+  ADIS16470BlackBox& operator=(const ADIS16470BlackBox&) = delete;
+
+  /**
+   * @brief Allocates both rings and starts the writer thread.
+   *
+   * @param path_prefix Captures are written to path_prefix-NNN.adislog, numbered from the first file that doesn't exist yet.
+   *
+   * @param pre_frames Frames kept from before the trigger.
+   *
+   * @param post_frames Frames recorded after the trigger.
+   */
+  void Open(const std::string& path_prefix, int pre_frames, int post_frames);
+
+  /**
+   * @brief Writes out a capture that is still pending and stops the writer thread.
+   */
+  void Close();
+
+  bool IsOpen() const { return m_thread.joinable(); }
+
+  /**
+   * @brief Starts a new history for a new frame layout. A capture in progress is finished early.
+   *
+   * @param frame_len Words per frame.
+   *
+   * @param config The kADIS16470LogConfig record words describing the frame.
+   *
+   * @param config_words Number of config words (at most kMaxConfigWords).
+   */
+  void Reset(int frame_len, const uint32_t* config, int config_words);
+
+  /**
+   * @brief Copies frames read in one acquisition pass into the ring.
+   *
+   * @param read_time FPGA time (us) at which the frames were read.
+   *
+   * @param flags kADIS16470LogRecordFlags for the pass.
+   */
+  void Append(const uint32_t* words, int frames, uint64_t read_time, uint16_t flags);
+
+  /**
+   * @brief Freezes the frames appended so far as the pre-trigger window. Ignored while a capture is in progress.
+   *
+   * @param causes ADIS16470BlackBoxTrigger flags.
+   *
+   * @param timestamp FPGA timestamp (us) of the frame that caused the trigger.
+   *
+   * @param host_time FPGA time (us) at which the trigger was detected.
+   */
+  void Trigger(uint32_t causes, uint32_t timestamp, uint64_t host_time);
+
+  ADIS16470BlackBoxStats GetStats() const;
+
+ private:
+  struct Capture {
+    // Frame slots, kADIS16470MaxFrameLen words each, with the read time and flags of every frame
+    std::vector<uint32_t> words;
+    std::vector<uint64_t> read_time;
+    std::vector<uint16_t> flags;
+    // Frames appended since the last reset, and the first one that belongs to this capture
+    uint64_t head = 0;
+    uint64_t start = 0;
+    int frame_len = 1;
+    uint32_t config[kMaxConfigWords];
+    int config_words = 0;
+    // Trigger point (a frame count), cause and time
+    uint64_t trigger_frame = 0;
+    uint32_t causes = 0;
+    uint32_t trigger_timestamp = 0;
+    uint64_t trigger_host_time = 0;
+  };
+
+  void Complete();
+
+  void WriterLoop();
+
+  bool Write(const Capture& capture, const std::string& path);
+
+  std::string m_prefix;
+  int m_pre_frames = 0;
+  int m_post_frames = 0;
+  int m_capacity = 0;
+
+  // Ring being recorded into (acquisition thread only)
+  Capture m_captures[2];
+  Capture* m_active = &m_captures[0];
+  std::atomic<bool> m_capturing{false};
+
+  // Completed capture waiting for or being written by the writer thread
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  Capture* m_pending = nullptr;
+  bool m_stop = false;
+  ADIS16470BlackBoxStats m_stats;
+  std::thread m_thread;
+};
+
+} //namespace frc
@@ -0,0 +1,157 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+namespace frc {
+
+/**
+ * Heading carried by one forwarded CAN frame.
+ */
+struct ADIS16470CANHeading {
+  // Integrated yaw angle, as GetAngle() reports it (deg). Sent with 0.001 deg resolution.
+  double angle = 0.0;
+  // Yaw rate (deg/s). Sent with 0.1 deg/s resolution, saturating at +/-3276.7 deg/s.
+  double rate = 0.0;
+  // Time from the sample to the transmission (s). Sent in 0.1 ms steps, saturating at 25.5 ms.
+  double age = 0.0;
+  // Rolling frame counter (0 to 15), for spotting lost frames
+  int counter = 0;
+  // ADIS16470CANFlags
+  uint8_t flags = 0;
+};
+
+enum ADIS16470CANFlags : uint8_t {
+  // The auto SPI stream is stalled or resyncing, so the heading is not advancing
+  kADIS16470CANStreamFault = 0x1
+};
+
+/**
+ * Transmit counters and timing of the CAN forwarder.
+ */
+struct ADIS16470CANStats {
+  // Frames the HAL accepted
+  uint64_t sent = 0;
+  // Transmits the HAL rejected (transmit buffer full, bus off, no CAN in the simulation)
+  uint64_t dropped = 0;
+  // Send slots missed because the acquisition thread woke up too late
+  uint64_t skipped = 0;
+  // HAL status of the latest rejected transmit
+  int32_t last_status = 0;
+  // Time between transmits (s)
+  double mean_interval = 0.0;
+  double max_interval = 0.0;
+  // Time spent in the HAL transmit call (s)
+  double mean_send_time = 0.0;
+  double max_send_time = 0.0;
+  // Heading age at transmission (s)
+  double mean_age = 0.0;
+};
+
+/**
+ * Sends the latest heading and yaw rate as an 8 byte CAN frame at a fixed rate, from the
+ * acquisition thread, so smart motor controllers can close heading loops without waiting for the
+ * robot loop.
+ *
+ * Frames go out through the HAL CAN API as a team-use (manufacturer 8) miscellaneous (device
+ * type 10) device, with a configurable device number and API ID. The payload is little endian:
+ *
+ *   bytes 0-3  angle, int32, 0.001 deg (continuous, like GetAngle())
+ *   bytes 4-5  yaw rate, int16, 0.1 deg/s (saturating at +/-32767)
+ *   byte 6     bits 0-3 rolling counter, bits 4-7 ADIS16470CANFlags
+ *   byte 7     age of the sample at transmission, 0.1 ms (saturating at 255)
+ *
+ * Decode() unpacks it for receivers written in C++. Update() is called on every acquisition pass
+ * and sends when a frame is due. Slots the thread slept through are counted as skipped, not made
+ * up. The acquisition thread shortens its poll to the frame period while forwarding is on.
+ * Thread safe.
+ */
+class ADIS16470CANForwarder {
+ public:
+  // Highest frame rate (Hz)
+  static constexpr double kMaxRate = 1000.0;
+  // FRC CAN IDs: team use manufacturer, miscellaneous device type
+  static constexpr int kManufacturer = 8;
+  static constexpr int kDeviceType = 10;
+  static constexpr int kPayloadSize = 8;
+
+  ADIS16470CANForwarder() = default;
+
+  ~ADIS16470CANForwarder();
+
+  ADIS16470CANForwarder(const ADIS16470CANForwarder&) = delete;
+  ADIS16470CANForwarder& operator=(const ADIS16470CANForwarder&) = delete;
+
+  /**
+   * @brief Opens the CAN device and starts sending. Replaces any earlier device and clears the stats.
+   *
+   * @param device_id CAN device number (0 to 63).
+   *
+   * @param api_id API ID of the frame (0 to 1023).
+   *
+   * @param rate Frame rate (Hz), limited to kMaxRate.
+   *
+   * @param now Current FPGA time (us). The first frame is due right away.
+   *
+   * @return The HAL status: 0 on success.
+   */
+  int32_t Start(int device_id, int api_id, double rate, uint64_t now);
+
+  void Stop();
+
+  bool IsActive() const;
+
+  /**
+   * @brief Returns the time (us) until the next frame is due (0 if it is due now), or false if not sending.
+   */
+  bool GetTimeToNext(uint64_t now, uint64_t* wait) const;
+
+  /**
+   * @brief Sends a frame if one is due.
+   *
+   * @param now Current FPGA time (us).
+   *
+   * @param heading Latest heading. The counter and age are filled in here.
+   *
+   * @param sample_timestamp FPGA timestamp (us) of the sample the heading comes from.
+   */
+  void Update(uint64_t now, ADIS16470CANHeading heading, uint32_t sample_timestamp);
+
+  ADIS16470CANStats GetStats() const;
+
+  static void Encode(const ADIS16470CANHeading& heading, uint8_t* data);
+
+  /**
+   * @brief Unpacks a frame payload. False if it is shorter than kPayloadSize.
+   */
+  static bool Decode(const uint8_t* data, int size, ADIS16470CANHeading* heading);
+
+ private:
+  void CloseDevice();
+
+  mutable std::mutex m_mutex;
+  // HAL CAN handle (0 when not sending)
+  int32_t m_handle = 0;
+  int m_api_id = 0;
+  uint64_t m_period = 1000;
+  uint64_t m_next = 0;
+  uint64_t m_last_send = 0;
+  int m_counter = 0;
+
+  ADIS16470CANStats m_stats;
+  // Sums for the means
+  double m_interval_sum = 0.0;
+  double m_send_time_sum = 0.0;
+  double m_age_sum = 0.0;
+};
+
+} //namespace frc
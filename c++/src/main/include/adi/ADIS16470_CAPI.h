@@ -0,0 +1,228 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * C interface to the ADIS16470 driver, for callers that can't use C++ (the LabVIEW library calls
+ * it through Call Library Function Nodes).
+ *
+ * Every function returns an ADIS16470_Status and passes results back through pointers. Structures
+ * only hold 8-byte or only 4-byte members, so they have no padding and map directly onto LabVIEW
+ * clusters on every target. The interface only grows: existing functions and structures keep
+ * their signatures and layout, and ADIS16470_GetAPIVersion() is bumped when something is added.
+ *
+ * A handle may be used from several threads at once, like the C++ class. It must not be used
+ * after ADIS16470_Destroy().
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADIS16470_API_VERSION 2
+
+/* Opaque driver instance */
+typedef struct ADIS16470_Instance* ADIS16470_Handle;
+
+typedef enum ADIS16470_Status {
+  ADIS16470_STATUS_OK = 0,
+  // The configuration already had the requested values
+  ADIS16470_STATUS_NO_CHANGE = 1,
+  // Null handle or pointer, or a value out of range
+  ADIS16470_STATUS_INVALID_ARGUMENT = -1,
+  // The IMU could not be configured, or the HAL could not be initialized
+  ADIS16470_STATUS_FAILED = -2,
+  // A simulation call on an instance that talks to a real IMU
+  ADIS16470_STATUS_NOT_SIMULATED = -3,
+  // Unexpected error inside the driver (for example out of memory)
+  ADIS16470_STATUS_INTERNAL_ERROR = -4
+} ADIS16470_Status;
+
+/* Columns of the sample rows returned by ADIS16470_GetSamples() */
+typedef enum ADIS16470_SampleField {
+  // FPGA timestamp (us)
+  ADIS16470_SAMPLE_TIMESTAMP = 0,
+  // Time since the previous sample (s)
+  ADIS16470_SAMPLE_DT = 1,
+  // Angular rates (deg/s)
+  ADIS16470_SAMPLE_GYRO_X = 2,
+  ADIS16470_SAMPLE_GYRO_Y = 3,
+  ADIS16470_SAMPLE_GYRO_Z = 4,
+  // Accelerations (g)
+  ADIS16470_SAMPLE_ACCEL_X = 5,
+  ADIS16470_SAMPLE_ACCEL_Y = 6,
+  ADIS16470_SAMPLE_ACCEL_Z = 7,
+  // Integrated yaw angle after the sample (deg)
+  ADIS16470_SAMPLE_ANGLE = 8,
+  // DIAG_STAT error flags (0 unless DIAG_STAT is read with every sample)
+  ADIS16470_SAMPLE_DIAG_STAT = 9,
+  ADIS16470_SAMPLE_FIELDS = 10
+} ADIS16470_SampleField;
+
+/* Latest outputs of the driver, all from the same sample */
+typedef struct ADIS16470_Snapshot {
+  // Sequence number the next sample will get (0 until the first sample arrives)
+  uint64_t sequence;
+  // FPGA timestamp of the latest sample (us)
+  double timestamp;
+  // Integrated yaw angle (deg) and yaw rate (deg/s)
+  double angle;
+  double rate;
+  // Angular rates (deg/s) and accelerations (g)
+  double gyro_x;
+  double gyro_y;
+  double gyro_z;
+  double accel_x;
+  double accel_y;
+  double accel_z;
+  // Complementary filter and filtered accelerometer tilt angles (deg)
+  double comp_angle_x;
+  double comp_angle_y;
+  double accel_angle_x;
+  double accel_angle_y;
+} ADIS16470_Snapshot;
+
+/* Configuration changes applied in a single auto SPI pause. Fields set to -1 keep their current value. */
+typedef struct ADIS16470_Config {
+  // DEC_RATE: output rate is 2000 Hz / (dec_rate + 1), 0 to 1999
+  int32_t dec_rate;
+  // FILT_CTRL: Bartlett filter size, 0 (off) to 6
+  int32_t filter;
+  // NULL_CNFG: bias null averaging time, 0 (32 ms) to 11 (64 s), takes effect at the next ADIS16470_Calibrate()
+  int32_t cal_time;
+  // 0 = X, 1 = Y, 2 = Z
+  int32_t yaw_axis;
+  // Bit 0..5 = gyro X/Y/Z, accel X/Y/Z streamed at 32 bits
+  int32_t high_resolution_mask;
+  // 1 to read DIAG_STAT with every sample, 0 not to
+  int32_t read_diag_stat;
+} ADIS16470_Config;
+
+/**
+ * @brief Returns ADIS16470_API_VERSION of the loaded library.
+ */
+int32_t ADIS16470_GetAPIVersion(void);
+
+/**
+ * @brief Initializes the HAL if needed, then resets, calibrates and starts the IMU. Blocks for the calibration time.
+ *
+ * @param yaw_axis 0 = X, 1 = Y, 2 = Z.
+ *
+ * @param spi_port 0..3 = onboard CS0..CS3, 4 = MXP.
+ *
+ * @param cal_time 0 (32 ms) to 11 (64 s). 7 (4 s) is the C++ default.
+ *
+ * @param startup 0 = wait for the IMU's bias null, 1 = stream first and estimate the bias on the host.
+ *
+ * @param handle Receives the new instance, or null if the IMU could not be found or started
+ * (ADIS16470_STATUS_FAILED).
+ */
+int32_t ADIS16470_Create(int32_t yaw_axis, int32_t spi_port, int32_t cal_time, int32_t startup,
+                         ADIS16470_Handle* handle);
+
+/**
+ * @brief Like ADIS16470_Create(), but against the simulated IMU on a virtual clock, for desktop testing.
+ *
+ * The calling thread is attached to the virtual clock, which then only advances inside
+ * ADIS16470_SimSleep(). Drive a simulated instance from that thread only.
+ *
+ * @param seed Seed of the simulated sensor noise.
+ */
+int32_t ADIS16470_CreateSim(int32_t yaw_axis, int32_t cal_time, int32_t startup, uint32_t seed,
+                            ADIS16470_Handle* handle);
+
+/**
+ * @brief Like ADIS16470_CreateSim(), but the simulated IMU reports the given PROD_ID. Anything other than
+ * 16470 or 16982 makes the create fail the way a missing IMU does. Added in API version 2.
+ */
+int32_t ADIS16470_CreateSimWithProductID(int32_t yaw_axis, int32_t cal_time, int32_t startup, uint32_t seed,
+                                         int32_t product_id, ADIS16470_Handle* handle);
+
+/**
+ * @brief Stops acquisition and frees the instance. A null handle is ignored.
+ */
+int32_t ADIS16470_Destroy(ADIS16470_Handle handle);
+
+/**
+ * @brief Copies the latest angle, rates, accelerations and tilt angles.
+ */
+int32_t ADIS16470_GetSnapshot(ADIS16470_Handle handle, ADIS16470_Snapshot* snapshot);
+
+/**
+ * @brief Returns the sequence number the next sample will get (the number of samples acquired so far).
+ */
+int32_t ADIS16470_GetLatestSequence(ADIS16470_Handle handle, uint64_t* sequence);
+
+/**
+ * @brief Copies samples out of the sample history (the last few seconds of samples).
+ *
+ * @param sequence Sequence number of the first sample wanted. Advanced past the last sample copied.
+ * If it is older than the history, copying starts at the oldest sample still held.
+ *
+ * @param samples Receives one row of ADIS16470_SAMPLE_FIELDS values per sample (a 2D array in LabVIEW).
+ *
+ * @param max_samples Number of rows in samples.
+ *
+ * @param count Receives the number of rows written.
+ */
+int32_t ADIS16470_GetSamples(ADIS16470_Handle handle, uint64_t* sequence, double* samples, int32_t max_samples,
+                             int32_t* count);
+
+/**
+ * @brief Applies the fields of config that are not -1, in a single auto SPI pause.
+ *
+ * @return ADIS16470_STATUS_OK, ADIS16470_STATUS_NO_CHANGE, or ADIS16470_STATUS_FAILED.
+ */
+int32_t ADIS16470_Configure(ADIS16470_Handle handle, const ADIS16470_Config* config);
+
+/**
+ * @brief Makes the IMU run its bias null with the configured calibration time.
+ */
+int32_t ADIS16470_Calibrate(ADIS16470_Handle handle);
+
+/**
+ * @brief Zeros the integrated yaw angle.
+ */
+int32_t ADIS16470_ResetAngle(ADIS16470_Handle handle);
+
+/**
+ * @brief Starts recording raw auto SPI data to a log file for the adis16470logtool.
+ *
+ * @return ADIS16470_STATUS_FAILED if the file could not be created.
+ */
+int32_t ADIS16470_StartRawLog(ADIS16470_Handle handle, const char* path);
+
+int32_t ADIS16470_StopRawLog(ADIS16470_Handle handle);
+
+/**
+ * @brief Sets the angular rate (deg/s) the simulated IMU measures.
+ */
+int32_t ADIS16470_SimSetAngularRate(ADIS16470_Handle handle, double x, double y, double z);
+
+/**
+ * @brief Sets the acceleration (g) the simulated IMU measures.
+ */
+int32_t ADIS16470_SimSetAcceleration(ADIS16470_Handle handle, double x, double y, double z);
+
+/**
+ * @brief Lets the virtual clock run for the given time (s) while the driver acquires.
+ */
+int32_t ADIS16470_SimSleep(ADIS16470_Handle handle, double seconds);
+
+/**
+ * @brief Returns the virtual time (s).
+ */
+int32_t ADIS16470_SimGetTime(ADIS16470_Handle handle, double* seconds);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,174 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include <adi/ADIS16470_Transport.h>
+
+namespace frc {
+
+/**
+ * Transport wrapper that injects faults into the auto SPI stream and the register reads of
+ * another transport, to reproduce FIFO trouble seen on real hardware.
+ *
+ * Auto SPI words are pulled from the wrapped transport's FIFO whenever the driver reads the FIFO,
+ * and whole frames are moved into this transport's own FIFO (same capacity as InitAuto()). Frame
+ * faults are applied on the way. Each fault fires at random with a set probability, and Inject()
+ * fires one at the next chance, so a benchmark can place a single fault and time the recovery.
+ * The random source is seeded, so runs are repeatable.
+ */
+class ADIS16470FaultTransport : public ADIS16470Transport {
+ public:
+  enum Fault {
+    // Frame lost in the FPGA
+    kDropFrame = 0,
+    // One random bit of one frame word inverted
+    kBitFlip,
+    // A stray data word after a frame, which shifts every later frame
+    kExtraWord,
+    // One data word of a frame lost, which shifts every later frame
+    kMissingWord,
+    // One frame timestamp jumps forward by the jump time
+    kTimestampJump,
+    // Data ready stops for the stall time (every frame in it is lost)
+    kStall,
+    // A FIFO read blocks for the slow read time (per call)
+    kSlowRead,
+    // Words of a partial frame show up after StopAuto() and reach the next StartAutoTrigger() (per restart)
+    kStrayWords,
+    // One random bit of a register read inverted (per transfer)
+    kRegisterBitFlip,
+    kNumFaults
+  };
+
+  struct Stats {
+    // Faults injected, indexed by Fault
+    uint64_t injected[kNumFaults] = {};
+    // Frames passed to the driver's FIFO
+    uint64_t frames_passed = 0;
+    // Frames removed by kDropFrame and kStall
+    uint64_t frames_dropped = 0;
+    // Frames lost because this FIFO was full
+    uint64_t frames_overflowed = 0;
+  };
+
+  explicit ADIS16470FaultTransport(std::unique_ptr<ADIS16470Transport> inner, uint32_t seed = 1);
+
+  ~ADIS16470FaultTransport() override = default;
+
+  ADIS16470Transport& GetInner() { return *m_inner; }
+
+  static const char* GetFaultName(Fault fault);
+
+  /**
+   * @brief Sets the chance of a fault per frame (per FIFO read, restart or register transfer where noted on Fault).
+   */
+  void SetProbability(Fault fault, double probability);
+
+  /**
+   * @brief Fires a fault at the next chance, on top of the random ones.
+   */
+  void Inject(Fault fault);
+
+  /**
+   * @brief Sets the length of a kStall (s). Default 0.2 s.
+   */
+  void SetStallTime(double seconds);
+
+  /**
+   * @brief Sets how long a kSlowRead blocks (s). Default 0.05 s.
+   */
+  void SetSlowReadTime(double seconds);
+
+  /**
+   * @brief Sets the size of a kTimestampJump (us). Default 2 s.
+   */
+  void SetTimestampJump(uint32_t us);
+
+  Stats GetStats() const;
+
+  /* ADIS16470Transport implementation */
+  void SetResetAsserted(bool asserted) override { m_inner->SetResetAsserted(asserted); }
+
+  void SetReadyLED(bool on) override { m_inner->SetReadyLED(on); }
+
+  void OpenSPI() override { m_inner->OpenSPI(); }
+
+  void CloseSPI() override { m_inner->CloseSPI(); }
+
+  bool IsOpen() const override { return m_inner->IsOpen(); }
+
+  int Write(uint8_t* data, int size) override { return m_inner->Write(data, size); }
+
+  int Read(bool initiate, uint8_t* data, int size) override;
+
+  void InitAuto(int buffer_size) override;
+
+  void SetAutoTransmitData(const uint8_t* data, int size, int zero_size) override;
+
+  void ConfigureAutoStall(int cs_to_sclk_ticks, int stall_ticks, int pow2_bytes_per_read) override {
+    m_inner->ConfigureAutoStall(cs_to_sclk_ticks, stall_ticks, pow2_bytes_per_read);
+  }
+
+  void StartAutoTrigger() override;
+
+  void StopAuto() override;
+
+  int ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) override;
+
+  uint64_t GetTime() override { return m_inner->GetTime(); }
+
+  void Sleep(double seconds) override { m_inner->Sleep(seconds); }
+
+  void AttachThread() override { m_inner->AttachThread(); }
+
+  void DetachThread() override { m_inner->DetachThread(); }
+
+ private:
+  // Called with m_mutex held
+  bool Fire(Fault fault);
+  void Pump();
+  void PassFrame(uint32_t* frame);
+  bool Push(const uint32_t* words, size_t count);
+
+  std::unique_ptr<ADIS16470Transport> m_inner;
+
+  mutable std::mutex m_mutex;
+  std::mt19937 m_rng;
+  std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+  double m_probability[kNumFaults] = {};
+  int m_armed[kNumFaults] = {};
+  double m_stall_time = 0.2;
+  double m_slow_read_time = 0.05;
+  uint32_t m_timestamp_jump = 2000000;
+
+  // Frame length in words, with the timestamp
+  int m_frame_len = 1;
+  size_t m_capacity = 0;
+  // Words read from the wrapped FIFO that don't make a whole frame yet
+  std::vector<uint32_t> m_incoming;
+  std::vector<uint32_t> m_frame;
+  // The FIFO the driver sees
+  std::deque<uint32_t> m_fifo;
+  // Frames with timestamps before this are lost to a stall
+  bool m_stalled = false;
+  uint32_t m_stall_until = 0;
+  bool m_stray_pending = false;
+
+  Stats m_stats;
+};
+
+} //namespace frc
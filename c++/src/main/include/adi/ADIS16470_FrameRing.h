@@ -0,0 +1,105 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <adi/ADIS16470_Processing.h>
+
+namespace frc {
+
+/**
+ * Preallocated ring of raw auto SPI frames and their decoded samples, addressed by a running
+ * sequence number.
+ *
+ * The acquisition thread reads the FPGA FIFO straight into the frame slots (WriteSpan()), decodes
+ * each frame into the matching sample slot, and then publishes the new frames with Commit(). Raw
+ * words are therefore copied exactly once, and every later stage refers to a frame by its sequence
+ * number instead of copying it.
+ *
+ * The last write_reserve frames before the oldest published frame are treated as already gone,
+ * because those slots are the ones the next drain overwrites. Storage is allocated once and
+ * page-locked where the OS allows it, so the acquisition thread never takes a page fault.
+ */
+class ADIS16470FrameRing {
+ public:
+  /**
+   * @param capacity Number of frame slots.
+   *
+   * @param write_reserve Most frames written by one drain before Commit().
+   */
+  ADIS16470FrameRing(int capacity, int write_reserve);
+
+  ~ADIS16470FrameRing();
+
+  ADIS16470FrameRing(const ADIS16470FrameRing&) = delete;
+  ADIS16470FrameRing& operator=(const ADIS16470FrameRing&) = delete;
+
+  /**
+   * @brief Changes the frame length and drops every stored frame. Sequence numbers keep counting.
+   */
+  void Reset(int frame_len);
+
+  int GetFrameLen() const { return m_frame_len; }
+
+  int GetCapacity() const { return m_capacity; }
+
+  /**
+   * @brief Returns true if the storage is page-locked.
+   */
+  bool IsLocked() const { return m_locked; }
+
+  /**
+   * @brief Sequence number the next written frame will get.
+   */
+  uint64_t GetHead() const { return m_head; }
+
+  /**
+   * @brief Sequence number of the oldest frame that is still valid.
+   */
+  uint64_t GetOldest() const;
+
+  bool Contains(uint64_t seq) const { return seq >= GetOldest() && seq < m_head; }
+
+  /**
+   * @brief Returns the slot for frame seq and the number of frames that fit contiguously from there.
+   */
+  uint32_t* WriteSpan(uint64_t seq, int* max_frames);
+
+  /**
+   * @brief Publishes the next count frames (and their samples) to readers.
+   */
+  void Commit(int count) { m_head += count; }
+
+  const uint32_t* GetFrame(uint64_t seq) const { return &m_words[Slot(seq) * m_frame_len]; }
+
+  ADIS16470Sample& GetSample(uint64_t seq) { return m_samples[Slot(seq)]; }
+
+  const ADIS16470Sample& GetSample(uint64_t seq) const { return m_samples[Slot(seq)]; }
+
+ private:
+  size_t Slot(uint64_t seq) const { return static_cast<size_t>(seq % m_capacity); }
+
+  int m_capacity;
+  int m_write_reserve;
+  int m_frame_len = 0;
+  uint64_t m_head = 0;
+  uint64_t m_valid_from = 0;
+
+  // One allocation holds the frame words followed by the samples
+  void* m_storage = nullptr;
+  size_t m_storage_size = 0;
+  bool m_locked = false;
+  uint32_t* m_words = nullptr;
+  ADIS16470Sample* m_samples = nullptr;
+};
+
+} //namespace frc
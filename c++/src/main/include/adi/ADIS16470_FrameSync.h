@@ -0,0 +1,109 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace frc {
+
+/**
+ * Checks auto SPI frames and finds the frame boundary again after the stream slips.
+ *
+ * The FIFO holds one word per frame for the timestamp and one word per received byte, so in a
+ * good frame every word after the timestamp is at most 0xFF, while the timestamp (FPGA time in us)
+ * is larger and moves forward by at most the maximum gap, a few sample periods. A word too many or too few shifts every
+ * later frame, which puts a timestamp where a data byte should be. Bit flips above the low byte
+ * and corrupted timestamps fail the same checks. Flips within a data byte can't be detected.
+ *
+ * Once a frame fails, the words from it onward are handed to Begin() and the search starts: the
+ * first offset that holds a plausible frame followed by the timestamp of the next one is the new
+ * boundary. A frame after a longer gap (a stall) fails the check too, but it is the boundary
+ * itself, so the search keeps it and nothing is lost. Recover() returns the whole frames after it, and GetSkip() tells the caller how many
+ * words to drop from the FIFO to finish the partial frame at the end. Words that don't belong to a
+ * returned frame are counted as discarded.
+ */
+class ADIS16470FrameSync {
+ public:
+  // Largest data byte word
+  static constexpr uint32_t kMaxByte = 0xFF;
+
+  /**
+   * @brief Forgets any search in progress and sets the frame length (words, with the timestamp).
+   *
+   * @param max_gap Longest accepted time between two frames (us). A timestamp that jumps by less
+   * than this can't be told from a good one, so keep it to a few sample periods.
+   */
+  void Reset(int frame_len, uint32_t max_gap);
+
+  /**
+   * @brief Checks one frame.
+   *
+   * @param previous_timestamp Timestamp of the frame before it.
+   *
+   * @param check_timestamp False if there is no usable previous frame (the first frame after a restart).
+   */
+  bool IsValid(const uint32_t* frame, uint32_t previous_timestamp, bool check_timestamp) const;
+
+  bool IsResyncing() const { return m_resyncing; }
+
+  /**
+   * @brief Starts a search with the words from the first bad frame onward.
+   */
+  void Begin(const uint32_t* words, size_t count);
+
+  /**
+   * @brief Adds words read from the FIFO during a search.
+   */
+  void Append(const uint32_t* words, size_t count);
+
+  /**
+   * @brief Looks for the frame boundary in the words collected so far.
+   *
+   * @param frames Receives whole frames after the boundary, in order.
+   *
+   * @param max_frames Room in frames.
+   *
+   * @return Frames written. The search ends once every collected frame after the boundary has
+   * been returned; it goes on (into the next Append()) if the words run out first, if the frames
+   * don't fit, or if another bad frame follows.
+   */
+  int Recover(uint32_t* frames, int max_frames);
+
+  /**
+   * @brief Words to drop from the FIFO before the next frame starts, after a search ended.
+   */
+  int GetSkip() const { return m_skip; }
+
+  /**
+   * @brief Counts words dropped toward GetSkip().
+   */
+  void Skipped(int words);
+
+  uint64_t GetDiscardedWords() const { return m_discarded; }
+
+ private:
+  bool IsBoundary(size_t offset) const;
+
+  int m_frame_len = 1;
+  uint32_t m_max_gap = 1;
+  bool m_resyncing = false;
+  // Boundary found, and the timestamp of the last frame returned after it
+  bool m_found = false;
+  uint32_t m_last_timestamp = 0;
+  int m_skip = 0;
+  uint64_t m_discarded = 0;
+  // Words collected during a search, and the first one not yet looked at
+  std::vector<uint32_t> m_pending;
+  size_t m_start = 0;
+};
+
+} //namespace frc
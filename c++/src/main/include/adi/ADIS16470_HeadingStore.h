@@ -0,0 +1,105 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace frc {
+
+/**
+ * Integration state mirrored into shared memory so a restarted robot program can continue it.
+ */
+struct ADIS16470HeadingState {
+  // SERIAL_NUM of the IMU the state belongs to
+  uint16_t serial_number = 0;
+  // Axis the angle was integrated about (ADIS16470_IMU::IMUAxis)
+  int32_t yaw_axis = 2;
+  // Integrated yaw angle (deg) and the time it covers (s)
+  double angle = 0.0;
+  double integ_time = 0.0;
+  // False while the gyro bias is still being estimated, when the heading is not worth keeping
+  bool calibrated = false;
+  // Host-side gyro bias being removed (ADIS16470StartupMode::kStreamFirst), deg/s
+  bool host_bias = false;
+  double bias_gyro_x = 0.0;
+  double bias_gyro_y = 0.0;
+  double bias_gyro_z = 0.0;
+  double bias_yaw = 0.0;
+  // FPGA timestamp of the last sample integrated (us)
+  uint32_t last_timestamp = 0;
+  // CLOCK_MONOTONIC time of the update (ns)
+  uint64_t update_time = 0;
+};
+
+/**
+ * Small POSIX shared memory segment holding an ADIS16470HeadingState.
+ *
+ * The segment lives in RAM (/dev/shm) until it is unlinked or the controller reboots, so it
+ * survives the robot program crashing or being redeployed. Updates are published with a sequence
+ * counter: the writer makes it odd, copies the state, and makes it even again, and a reader
+ * retries until it sees the same even count before and after its copy. The writer therefore never
+ * waits on a reader, even one in another process.
+ */
+class ADIS16470HeadingStore {
+ public:
+  // Oldest state (s) a restarted program accepts
+  static constexpr double kMaxAge = 60.0;
+
+  ADIS16470HeadingStore() = default;
+
+  ~ADIS16470HeadingStore();
+
+  ADIS16470HeadingStore(const ADIS16470HeadingStore&) = delete;
+  ADIS16470HeadingStore& operator=(const ADIS16470HeadingStore&) = delete;
+
+  /**
+   * @brief Opens (creating if needed) the shared memory segment.
+   *
+   * @param name POSIX shared memory name, for example "/adis16470_heading".
+   *
+   * @return False if the segment could not be mapped (or on platforms without POSIX shared memory).
+   */
+  bool Open(const std::string& name);
+
+  void Close();
+
+  bool IsOpen() const { return m_segment != nullptr; }
+
+  /**
+   * @brief Publishes a new state. Only one thread (in one process) may write.
+   */
+  void Store(const ADIS16470HeadingState& state);
+
+  /**
+   * @brief Reads the last state stored.
+   *
+   * @return False if nothing valid has been stored yet.
+   */
+  bool Load(ADIS16470HeadingState* state) const;
+
+  /**
+   * @brief Returns CLOCK_MONOTONIC time (ns), which keeps counting across program restarts.
+   */
+  static uint64_t Now();
+
+ private:
+  struct Segment {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    ADIS16470HeadingState state;
+  };
+
+  Segment* m_segment = nullptr;
+};
+
+} //namespace frc
@@ -12,7 +12,10 @@
 #include <atomic>
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <frc/DigitalOutput.h>
 #include <frc/DigitalSource.h>
@@ -20,9 +23,25 @@
 #include <frc/GyroBase.h>
 #include <frc/SPI.h>
 #include <frc/smartdashboard/SendableBuilder.h>
+#include <networktables/NetworkTableEntry.h>
 #include <wpi/mutex.h>
 #include <wpi/condition_variable.h>
 
+#include <adi/ADIS16470_BiasEstimator.h>
+#include <adi/ADIS16470_BlackBox.h>
+#include <adi/ADIS16470_CANForwarder.h>
+#include <adi/ADIS16470_FrameRing.h>
+#include <adi/ADIS16470_FrameSync.h>
+#include <adi/ADIS16470_HeadingStore.h>
+#include <adi/ADIS16470_Log.h>
+#include <adi/ADIS16470_NoiseStats.h>
+#include <adi/ADIS16470_Processing.h>
+#include <adi/ADIS16470_Registers.h>
+#include <adi/ADIS16470_PerfCounters.h>
+#include <adi/ADIS16470_Preintegrator.h>
+#include <adi/ADIS16470_Resampler.h>
+#include <adi/ADIS16470_Transport.h>
+
 namespace frc {
 
 /* ADIS16470 Calibration Time Enum Class */
@@ -41,127 +60,76 @@ enum class ADIS16470CalibrationTime {
   _64s = 11
 };
 
-/* ADIS16470 Register Map Declaration */
-static constexpr uint8_t FLASH_CNT      =   0x00;  //Flash memory write count
-static constexpr uint8_t DIAG_STAT      =   0x02;  //Diagnostic and operational status
-static constexpr uint8_t X_GYRO_LOW     =   0x04;  //X-axis gyroscope output, lower word
-static constexpr uint8_t X_GYRO_OUT     =   0x06;  //X-axis gyroscope output, upper word
-static constexpr uint8_t Y_GYRO_LOW     =   0x08;  //Y-axis gyroscope output, lower word
-static constexpr uint8_t Y_GYRO_OUT     =  	0x0A;  //Y-axis gyroscope output, upper word
-static constexpr uint8_t Z_GYRO_LOW     = 	0x0C;  //Z-axis gyroscope output, lower word
-static constexpr uint8_t Z_GYRO_OUT     =   0x0E;  //Z-axis gyroscope output, upper word
-static constexpr uint8_t X_ACCL_LOW     =   0x10;  //X-axis accelerometer output, lower word
-static constexpr uint8_t X_ACCL_OUT     =   0x12;  //X-axis accelerometer output, upper word
-static constexpr uint8_t Y_ACCL_LOW     =   0x14;  //Y-axis accelerometer output, lower word
-static constexpr uint8_t Y_ACCL_OUT     =   0x16;  //Y-axis accelerometer output, upper word
-static constexpr uint8_t Z_ACCL_LOW     =   0x18;  //Z-axis accelerometer output, lower word
-static constexpr uint8_t Z_ACCL_OUT     =   0x1A;  //Z-axis accelerometer output, upper word
-static constexpr uint8_t TEMP_OUT       =   0x1C;  //Temperature output (internal, not calibrated)
-static constexpr uint8_t TIME_STAMP     =   0x1E;  //PPS mode time stamp
-static constexpr uint8_t X_DELTANG_LOW  =   0x24;  //X-axis delta angle output, lower word
-static constexpr uint8_t X_DELTANG_OUT  =   0x26;  //X-axis delta angle output, upper word
-static constexpr uint8_t Y_DELTANG_LOW  =   0x28;  //Y-axis delta angle output, lower word
-static constexpr uint8_t Y_DELTANG_OUT  =   0x2A;  //Y-axis delta angle output, upper word
-static constexpr uint8_t Z_DELTANG_LOW  =   0x2C;  //Z-axis delta angle output, lower word
-static constexpr uint8_t Z_DELTANG_OUT  =   0x2E;  //Z-axis delta angle output, upper word
-static constexpr uint8_t X_DELTVEL_LOW  =   0x30;  //X-axis delta velocity output, lower word
-static constexpr uint8_t X_DELTVEL_OUT  =   0x32;  //X-axis delta velocity output, upper word
-static constexpr uint8_t Y_DELTVEL_LOW  =   0x34;  //Y-axis delta velocity output, lower word
-static constexpr uint8_t Y_DELTVEL_OUT  =   0x36;  //Y-axis delta velocity output, upper word
-static constexpr uint8_t Z_DELTVEL_LOW  =   0x38;  //Z-axis delta velocity output, lower word
-static constexpr uint8_t Z_DELTVEL_OUT  =   0x3A;  //Z-axis delta velocity output, upper word
-static constexpr uint8_t XG_BIAS_LOW    =   0x40;  //X-axis gyroscope bias offset correction, lower word
-static constexpr uint8_t XG_BIAS_HIGH   =   0x42;  //X-axis gyroscope bias offset correction, upper word
-static constexpr uint8_t YG_BIAS_LOW    =   0x44;  //Y-axis gyroscope bias offset correction, lower word
-static constexpr uint8_t YG_BIAS_HIGH 	=   0x46;  //Y-axis gyroscope bias offset correction, upper word
-static constexpr uint8_t ZG_BIAS_LOW    =   0x48;  //Z-axis gyroscope bias offset correction, lower word
-static constexpr uint8_t ZG_BIAS_HIGH   =   0x4A;  //Z-axis gyroscope bias offset correction, upper word
-static constexpr uint8_t XA_BIAS_LOW    =   0x4C;  //X-axis accelerometer bias offset correction, lower word
-static constexpr uint8_t XA_BIAS_HIGH   =   0x4E;  //X-axis accelerometer bias offset correction, upper word
-static constexpr uint8_t YA_BIAS_LOW    =   0x50;  //Y-axis accelerometer bias offset correction, lower word
-static constexpr uint8_t YA_BIAS_HIGH   =   0x52;  //Y-axis accelerometer bias offset correction, upper word
-static constexpr uint8_t ZA_BIAS_LOW    =   0x54;  //Z-axis accelerometer bias offset correction, lower word
-static constexpr uint8_t ZA_BIAS_HIGH   =   0x56;  //Z-axis accelerometer bias offset correction, upper word
-static constexpr uint8_t FILT_CTRL      =   0x5C;  //Filter control
-static constexpr uint8_t MSC_CTRL       =   0x60;  //Miscellaneous control
-static constexpr uint8_t UP_SCALE       =   0x62;  //Clock scale factor, PPS mode
-static constexpr uint8_t DEC_RATE       =   0x64;  //Decimation rate control (output data rate)
-static constexpr uint8_t NULL_CNFG      =   0x66;  //Auto-null configuration control
-static constexpr uint8_t GLOB_CMD       =   0x68;  //Global commands
-static constexpr uint8_t FIRM_REV       =   0x6C;  //Firmware revision
-static constexpr uint8_t FIRM_DM        =   0x6E;  //Firmware revision date, month and day
-static constexpr uint8_t FIRM_Y         =   0x70;  //Firmware revision date, year
-static constexpr uint8_t PROD_ID        =   0x72;  //Product identification 
-static constexpr uint8_t SERIAL_NUM     =   0x74;  //Serial number (relative to assembly lot)
-static constexpr uint8_t USER_SCR1      =   0x76;  //User scratch register 1 
-static constexpr uint8_t USER_SCR2      =   0x78;  //User scratch register 2 
-static constexpr uint8_t USER_SCR3      =   0x7A;  //User scratch register 3 
-static constexpr uint8_t FLSHCNT_LOW    =   0x7C;  //Flash update count, lower word 
-static constexpr uint8_t FLSHCNT_HIGH   =   0x7E;  //Flash update count, upper word 
-
-/* ADIS16470 Auto SPI Data Packets */
-static constexpr uint8_t m_autospi_x_packet [16] = {
-X_DELTANG_OUT, 
-FLASH_CNT, 
-X_DELTANG_LOW, 
-FLASH_CNT, 
-X_GYRO_OUT,
-FLASH_CNT, 
-Y_GYRO_OUT, 
-FLASH_CNT, 
-Z_GYRO_OUT, 
-FLASH_CNT, 
-X_ACCL_OUT, 
-FLASH_CNT, 
-Y_ACCL_OUT, 
-FLASH_CNT,
-Z_ACCL_OUT,
-FLASH_CNT
+/* ADIS16470 Startup Mode Enum Class */
+enum class ADIS16470StartupMode {
+  // Wait for the IMU's own bias null (the calibration time) before streaming
+  kWaitForCalibration = 0,
+  // Stream right after reset and estimate the gyro bias on the RoboRIO
+  kStreamFirst = 1
 };
 
-static constexpr uint8_t m_autospi_y_packet [16] = {
-Y_DELTANG_OUT, 
-FLASH_CNT, 
-Y_DELTANG_LOW, 
-FLASH_CNT, 
-X_GYRO_OUT,
-FLASH_CNT, 
-Y_GYRO_OUT, 
-FLASH_CNT, 
-Z_GYRO_OUT, 
-FLASH_CNT, 
-X_ACCL_OUT, 
-FLASH_CNT, 
-Y_ACCL_OUT, 
-FLASH_CNT,
-Z_ACCL_OUT,
-FLASH_CNT
+/**
+ * Timing of a configuration call, measured from the call until the first new sample was processed.
+ */
+struct ADIS16470ReconfigStats {
+  // Time from the start of the call until the first new sample was processed (s)
+  double time_to_first_sample = 0.0;
+  // Gap between the last sample before the call and the first sample after it (s)
+  double blackout = 0.0;
+  // Samples the IMU produced during the blackout that never reached the driver
+  uint64_t lost_frames = 0;
+  // False until the first sample after the call has been processed
+  bool complete = false;
+};
+
+/**
+ * Health of the auto SPI stream since the driver started. See ADIS16470FrameSync for the frame checks.
+ */
+struct ADIS16470StreamStats {
+  // Frames that failed the frame checks
+  uint64_t corrupt_frames = 0;
+  // Searches for the frame boundary. One that discards nothing was a long gap between frames.
+  uint64_t resyncs = 0;
+  // FIFO words thrown away while resyncing
+  uint64_t discarded_words = 0;
+  // Times no frame arrived for longer than the stall limit (50 ms or 20 sample periods)
+  uint64_t stalls = 0;
+  // Passes that left a whole frame or more in the FIFO
+  uint64_t overruns = 0;
+  // Total time spent resyncing and stalled (s)
+  double resync_time = 0.0;
+  double stall_time = 0.0;
+  // True while a resync or stall is in progress
+  bool resyncing = false;
+  bool stalled = false;
 };
 
-static constexpr uint8_t m_autospi_z_packet [16] = {
-Z_DELTANG_OUT, 
-FLASH_CNT, 
-Z_DELTANG_LOW, 
-FLASH_CNT, 
-X_GYRO_OUT,
-FLASH_CNT, 
-Y_GYRO_OUT, 
-FLASH_CNT, 
-Z_GYRO_OUT, 
-FLASH_CNT, 
-X_ACCL_OUT, 
-FLASH_CNT, 
-Y_ACCL_OUT, 
-FLASH_CNT,
-Z_ACCL_OUT,
-FLASH_CNT
+/**
+ * The driver's latest outputs, all taken under one lock so they belong to the same sample.
+ */
+struct ADIS16470Snapshot {
+  // Sequence number the next sample will get (0 until the first sample arrives)
+  uint64_t sequence = 0;
+  // FPGA timestamp of the latest sample (us)
+  uint32_t timestamp = 0;
+  // Integrated yaw angle (deg) and yaw rate (deg/s)
+  double angle = 0.0;
+  double rate = 0.0;
+  // Angular rates (deg/s) and accelerations (g)
+  double gyro_x = 0.0;
+  double gyro_y = 0.0;
+  double gyro_z = 0.0;
+  double accel_x = 0.0;
+  double accel_y = 0.0;
+  double accel_z = 0.0;
+  // Complementary filter and filtered accelerometer tilt angles (deg)
+  double comp_angle_x = 0.0;
+  double comp_angle_y = 0.0;
+  double accel_angle_x = 0.0;
+  double accel_angle_y = 0.0;
 };
 
-/* ADIS16470 Constants */
-const double delta_angle_sf = 2160.0 / 2147483648.0; /* 2160 / (2^31) */
-const double rad_to_deg = 57.2957795;
-const double deg_to_rad = 0.0174532;
-const double grav = 9.81;
+struct ADIS16470Config;
 
 /**
  * Use DMA SPI to read rate and acceleration data from the ADIS16470 IMU and return the
@@ -196,8 +164,32 @@ class ADIS16470_IMU : public GyroBase {
    * @param port The SPI port and CS where the IMU is connected.
    * 
    * @param cal_time The calibration time that should be used on start-up.
+   * 
+   * @param startup Whether to wait for the IMU's bias null or stream right away and estimate the bias on the host.
+   *
+   * @param heading_store POSIX shared memory name (for example "/adis16470_heading") to keep the heading in
+   * across robot program restarts. Empty to always start from zero.
    */
-  explicit ADIS16470_IMU(IMUAxis yaw_axis, SPI::Port port, ADIS16470CalibrationTime cal_time);
+  explicit ADIS16470_IMU(IMUAxis yaw_axis, SPI::Port port, ADIS16470CalibrationTime cal_time,
+                         ADIS16470StartupMode startup = ADIS16470StartupMode::kWaitForCalibration,
+                         const std::string& heading_store = "");
+
+  /**
+   * @brief Constructor for a custom transport, such as ADIS16470SimTransport for desktop simulation and benchmarks.
+   * 
+   * @param yaw_axis Selects the "default" axis to use for GetAngle() and GetRate()
+   * 
+   * @param transport The SPI, GPIO, and clock backend. The IMU takes ownership.
+   * 
+   * @param cal_time The calibration time that should be used on start-up.
+   * 
+   * @param startup Whether to wait for the IMU's bias null or stream right away and estimate the bias on the host.
+   *
+   * @param heading_store POSIX shared memory name to keep the heading in across robot program restarts. Empty to disable.
+   */
+  ADIS16470_IMU(IMUAxis yaw_axis, std::unique_ptr<ADIS16470Transport> transport, ADIS16470CalibrationTime cal_time,
+                ADIS16470StartupMode startup = ADIS16470StartupMode::kWaitForCalibration,
+                const std::string& heading_store = "");
 
   /**
    * @brief Destructor. Kills the acquisiton loop and closes the SPI peripheral.
@@ -209,6 +201,33 @@ class ADIS16470_IMU : public GyroBase {
 
   int ConfigDecRate(uint16_t reg);
 
+  /**
+   * @brief Sets the IMU's internal Bartlett filter (FILT_CTRL).
+   *
+   * @param size Filter size B: each of the two averaging stages is 2^B samples long at 2000 Hz. 0 turns the filter off, 6 is the largest.
+   *
+   * @return 0 = Success, 1 = No Change, 2 = Failure
+   *
+   * Sample timestamps are shifted back by the filter's group delay, so they still mark when the motion happened.
+   */
+  int ConfigFilter(uint16_t size);
+
+  uint16_t GetFilter() const;
+
+  /**
+   * @brief Returns the group delay of the current Bartlett filter setting (s), already removed from sample timestamps.
+   */
+  double GetFilterGroupDelay() const;
+
+  /**
+   * @brief Applies several configuration changes in a single auto SPI pause.
+   *
+   * @param config The settings to change. Unset fields keep their current value.
+   *
+   * @return 0 = Success, 1 = No Change, 2 = Failure
+   */
+  int Configure(const ADIS16470Config& config);
+
   /**
    * @brief Switches the active SPI port to standard SPI mode, writes the command to activate the new null configuration, and re-enables auto SPI.
    */
@@ -256,6 +275,17 @@ class ADIS16470_IMU : public GyroBase {
 
   double GetAccelInstantZ() const;
   
+  /**
+   * @brief Tunes the complementary filter behind the X and Y tilt angles.
+   *
+   * @param tau Time constant (s). Larger values trust the gyro for longer. Default 1 s.
+   *
+   * @param accel_rejection Acceleration magnitude error (g) above which the accelerometer is ignored. 0 (the default) never ignores it.
+   *
+   * The adis16470tune desktop tool searches for good values on recorded or synthetic data.
+   */
+  void ConfigComplementaryFilter(double tau, double accel_rejection = 0.0);
+
   double GetXComplementaryAngle() const;
 
   double GetYComplementaryAngle() const;
@@ -264,10 +294,269 @@ class ADIS16470_IMU : public GyroBase {
 
   double GetYFilteredAccelAngle() const;
 
+  /**
+   * @brief Returns the angle, rates, accelerations and tilt angles of the latest sample in one call.
+   */
+  ADIS16470Snapshot GetSnapshot() const;
+
   IMUAxis GetYawAxis() const;
 
   int SetYawAxis(IMUAxis yaw_axis);
 
+  /**
+   * @brief Selects which gyro and accelerometer channels are streamed at 32 bits.
+   *
+   * @param channel_mask ADIS16470ChannelBit() of each channel to stream at full precision.
+   *
+   * @return 0 = Success, 1 = No Change, 2 = Failure
+   *
+   * A 32-bit channel resolves 0.1 / 65536 deg/s or (1 / 800) / 65536 g instead of 0.1 deg/s or
+   * 1 / 800 g, at the cost of one more SPI read (about 33us) and two more FIFO words per sample.
+   */
+  int ConfigHighResolution(uint8_t channel_mask);
+
+  /**
+   * @brief Streams one channel at 32 bits (true) or 16 bits (false). See ConfigHighResolution(uint8_t).
+   */
+  int ConfigHighResolution(ADIS16470Channel channel, bool enable);
+
+  uint8_t GetHighResolutionMask() const;
+
+  /**
+   * @brief Adds (true) or removes (false) DIAG_STAT from the auto SPI frame.
+   *
+   * @return 0 = Success, 1 = No Change, 2 = Failure
+   *
+   * Each sample's diag_stat then holds the IMU error flags, and DIAG_STAT faults can trigger the black box.
+   */
+  int ConfigDiagStatRead(bool enable);
+
+  /**
+   * @brief Returns the running noise and bias stability estimates for one gyro or accelerometer channel.
+   *
+   * @param channel The sensor channel to report on.
+   *
+   * @return Mean, standard deviation, random walk, and bias instability of the channel since the last reset.
+   */
+  ADIS16470NoiseStatistics GetNoiseStatistics(ADIS16470Channel channel) const;
+
+  /**
+   * @brief Returns the Allan deviation curve for one gyro or accelerometer channel.
+   *
+   * @param channel The sensor channel to report on.
+   *
+   * @param taus Receives the averaging times in seconds. Must hold ADIS16470AllanDeviation::kNumTaus entries.
+   *
+   * @param adevs Receives the Allan deviation for each averaging time. Must hold ADIS16470AllanDeviation::kNumTaus entries.
+   *
+   * @return The number of valid points written.
+   */
+  int GetAllanDeviation(ADIS16470Channel channel, double* taus, double* adevs) const;
+
+  /**
+   * @brief Clears the running noise statistics for all channels.
+   */
+  void ResetNoiseStatistics();
+
+  /**
+   * @brief Returns true if the constructor picked up the heading of a previous robot program instead of starting from zero.
+   */
+  bool IsHeadingRestored() const;
+
+  /**
+   * @brief Returns true if the constructor found the IMU and started acquiring. False if it gave up early, for
+   * example because the product ID didn't match.
+   */
+  bool IsInitialized() const;
+
+  /**
+   * @brief Returns the state of the host-side gyro bias estimate used by ADIS16470StartupMode::kStreamFirst.
+   */
+  ADIS16470HostBias GetHostBias() const;
+
+  /**
+   * @brief Sets when the host-side bias estimate is considered final.
+   *
+   * @param std_error Standard error of the mean (deg/s) at which the estimate converges. Default 0.01 deg/s.
+   *
+   * @param motion_threshold Rate change (deg/s) treated as motion, which restarts the estimate. Default 2 deg/s.
+   */
+  void ConfigBiasConvergence(double std_error, double motion_threshold);
+
+  /**
+   * @brief Returns the sequence number the next sample will get (the number of samples acquired so far).
+   */
+  uint64_t GetLatestSequence() const;
+
+  /**
+   * @brief Returns the full 64-bit FPGA time (us) of the clock sample timestamps come from (the virtual clock in simulation).
+   *
+   * Sample timestamps carry only its low 32 bits, which wrap about every 71.6 minutes.
+   */
+  uint64_t GetFPGATime() const;
+
+  /**
+   * @brief Copies decoded samples out of the sample history (the last few seconds of samples).
+   *
+   * @param sequence Sequence number of the first sample wanted. Advanced past the last sample copied.
+   *
+   * @param samples Receives the samples.
+   *
+   * @param max_samples Size of the samples array.
+   *
+   * @return The number of samples copied.
+   */
+  int GetSamples(uint64_t* sequence, ADIS16470Sample* samples, int max_samples) const;
+
+  /**
+   * @brief Starts resampling every sample onto a uniform time grid (for spectral analysis or system identification).
+   *
+   * @param rate Grid rate (Hz).
+   */
+  void EnableResampler(double rate);
+
+  void DisableResampler();
+
+  /**
+   * @brief Returns the sequence number the next grid sample will get.
+   */
+  uint64_t GetLatestResampledSequence() const;
+
+  /**
+   * @brief Copies grid samples out of the resampler history. See GetSamples().
+   *
+   * @return The number of samples copied (0 if the resampler is disabled).
+   */
+  int GetResampledSamples(uint64_t* sequence, ADIS16470GridSample* samples, int max_samples) const;
+
+  /**
+   * @brief Starts keeping preintegrated motion for GetPreintegration() (for pose estimation and vision fusion).
+   *
+   * @param gyro_noise_density Gyro rate noise density for the covariance (deg/s/sqrt(Hz)).
+   *
+   * @param accel_noise_density Accelerometer noise density for the covariance (g/sqrt(Hz)).
+   */
+  void EnablePreintegration(double gyro_noise_density = ADIS16470Preintegrator::kDefaultGyroNoiseDensity,
+                            double accel_noise_density = ADIS16470Preintegrator::kDefaultAccelNoiseDensity);
+
+  void DisablePreintegration();
+
+  /**
+   * @brief Returns the rotation, delta velocity and their covariance between two FPGA timestamps.
+   *
+   * @param start_timestamp Start of the window (us, FPGA clock as in ADIS16470Sample::timestamp).
+   *
+   * @param end_timestamp End of the window, no later than the latest sample.
+   *
+   * @param result Receives the preintegrated motion.
+   *
+   * @return False if preintegration is disabled or the window is not covered by the samples held
+   * (about 10 s back, and not across a stream restart).
+   */
+  bool GetPreintegration(uint32_t start_timestamp, uint32_t end_timestamp, ADIS16470Preintegration* result) const;
+
+  /**
+   * @brief Publishes every sample decoded since the previous dashboard update, instead of only the latest values.
+   *
+   * @param enable True to publish sample batches with the Sendable data.
+   *
+   * Once per dashboard update (normally once per robot loop) the samples taken since the previous
+   * update are published as packed arrays: "Batch Timestamp" (FPGA us), "Batch Gyro X/Y/Z" (deg/s),
+   * "Batch Accel X/Y/Z" (g) and "Batch Angle" (deg), plus "Batch Sequence", the sequence number of
+   * the first sample in the arrays.
+   */
+  void ConfigSampleBatches(bool enable);
+
+  /**
+   * @brief Returns the timing of the most recent configuration call (or of the constructor).
+   */
+  ADIS16470ReconfigStats GetLastReconfigStats() const;
+
+  /**
+   * @brief Starts recording every raw auto SPI word read from the FPGA to a log file.
+   *
+   * @param path The log file to create. An existing file is overwritten.
+   *
+   * @return False if the file could not be created.
+   *
+   * Logs are written by a background thread and can be analyzed on a desktop with the adis16470logtool.
+   */
+  bool StartRawLog(const std::string& path);
+
+  /**
+   * @brief Stops raw logging and closes the log file.
+   */
+  void StopRawLog();
+
+  /**
+   * @brief Starts the black box: the last pre_seconds of raw frames are kept in RAM and written out with the following post_seconds whenever a trigger fires.
+   *
+   * @param path_prefix Captures are written to path_prefix-NNN.adislog, in the raw log format. Existing files are never overwritten.
+   *
+   * @param pre_seconds Time kept from before the trigger.
+   *
+   * @param post_seconds Time recorded after the trigger.
+   *
+   * @param triggers ADIS16470BlackBoxTrigger flags of the events that start a capture.
+   */
+  void StartBlackBox(const std::string& path_prefix, double pre_seconds = 5.0, double post_seconds = 2.0,
+                     uint32_t triggers = kADIS16470TriggerAll);
+
+  /**
+   * @brief Stops the black box. A capture that is already complete is still written.
+   */
+  void StopBlackBox();
+
+  /**
+   * @brief Starts a black box capture now (for example on a brownout or a driver button).
+   */
+  void TriggerBlackBox();
+
+  /**
+   * @brief Sets the horizontal acceleration (g) that triggers a black box capture. Default 2 g.
+   */
+  void ConfigBlackBoxAccelThreshold(double threshold);
+
+  ADIS16470BlackBoxStats GetBlackBoxStats() const;
+
+  /**
+   * @brief Returns the auto SPI stream health: corrupt frames, resyncs, stalls and overruns.
+   */
+  ADIS16470StreamStats GetStreamStats() const;
+
+  /**
+   * @brief Starts profiling the acquisition loop with the CPU's performance counters (Linux only).
+   *
+   * Enabling again clears the totals. Disabling keeps the last profile readable.
+   */
+  void EnablePerfProfiling();
+
+  void DisablePerfProfiling();
+
+  /**
+   * @brief Returns the per-stage counter totals. See ADIS16470PerfProfile::PerSample().
+   */
+  ADIS16470PerfProfile GetPerfProfile() const;
+
+  /**
+   * @brief Starts sending the heading and yaw rate on the CAN bus from the acquisition thread.
+   *
+   * @param device_id CAN device number (0 to 63) of the frames.
+   *
+   * @param rate Frame rate (Hz), up to 1 kHz.
+   *
+   * @param api_id API ID of the frames (0 to 1023).
+   *
+   * @return 0 on success, or the HAL status if the CAN device could not be opened.
+   *
+   * See ADIS16470CANForwarder for the frame layout.
+   */
+  int StartCANForwarding(int device_id, double rate = 1000.0, int api_id = 0);
+
+  void StopCANForwarding();
+
+  ADIS16470CANStats GetCANStats() const;
+
   // IMU yaw axis
   IMUAxis m_yaw_axis;
 
@@ -298,6 +587,8 @@ class ADIS16470_IMU : public GyroBase {
   */
   uint16_t ReadRegister(uint8_t reg);
 
+  bool ReadProductID();
+
   /**
   * @brief Writes an unsigned, 16-bit value to two adjacent, 8-bit register locations over SPI.
   *
@@ -314,36 +605,133 @@ class ADIS16470_IMU : public GyroBase {
 
   void Close();
 
+  void BeginReconfig();
+
+  void CompleteReconfig(uint32_t frame_timestamp, uint64_t read_time);
+
+  void ApplyHostBias(uint64_t current, uint64_t end);
+
+  int RecoverFrames(uint64_t first, int frames_read);
+
+  bool RestoreHeading();
+
+  void StoreHeading(uint32_t timestamp);
+
+  void PublishSampleBatch(const nt::NT_Entry* entries);
+
   // Integrated gyro value
   double m_integ_angle = 0.0;
 
+  // Time covered by m_integ_angle (s)
+  double m_integ_time = 0.0;
+
+  // Host-side gyro bias estimation (ADIS16470StartupMode::kStreamFirst)
+  ADIS16470BiasEstimator m_bias_estimator;
+  ADIS16470HostBias m_host_bias;
+  bool m_bias_estimating = false;
+  uint64_t m_bias_start = 0;
+  // Time integrated since m_bias_start (s). Unlike m_integ_time, Reset() leaves it alone.
+  double m_bias_time = 0.0;
+
+  // Heading kept in shared memory across program restarts
+  ADIS16470HeadingStore m_heading_store;
+  uint16_t m_serial_number = 0;
+  bool m_heading_restored = false;
+  // Set once the constructor has the IMU streaming
+  bool m_initialized = false;
+  // Keep the restored angle through the first frame instead of zeroing it
+  bool m_keep_angle = false;
+
   // Instant raw outputs
   double m_gyro_x, m_gyro_y, m_gyro_z, m_accel_x, m_accel_y, m_accel_z = 0.0;
 
   // Complementary filter variables
-  double m_tau = 1.0;
-  double m_dt, m_alpha = 0.0;
+  ADIS16470ComplementaryFilter m_comp_filter;
+  // Filter settings, picked up by the acquisition thread at the start of each pass
+  std::atomic<double> m_comp_tau{1.0};
+  std::atomic<double> m_comp_accel_rejection{0.0};
   double m_compAngleX, m_compAngleY, m_accelAngleX, m_accelAngleY = 0.0;
 
-  //Complementary filter functions
-  double FormatFastConverge(double compAngle, double accAngle);
+  // Raw log writer (fed from the acquisition thread)
+  ADIS16470LogWriter m_log;
+  std::atomic<bool> m_log_active{false};
+
+  void LogConfig();
+
+  static constexpr int kLogConfigWords = 5;
 
-  double FormatRange0to2PI(double compAngle);
+  void GetLogConfig(uint32_t* config) const;
 
-  double FormatAccelRange(double accelAngle, double accelZ);
+  // Black box (fed from the acquisition thread)
+  ADIS16470BlackBox m_black_box;
+  std::atomic<bool> m_black_box_active{false};
+  std::atomic<bool> m_black_box_user_trigger{false};
+  uint32_t m_black_box_triggers = kADIS16470TriggerAll;
+  std::atomic<double> m_black_box_accel{2.0};
 
-  double CompFilterProcess(double compAngle, double accelAngle, double omega);
+  // Online noise characterization, indexed by ADIS16470Channel
+  ADIS16470WelfordStats m_welford[kADIS16470NumChannels];
+  ADIS16470AllanDeviation m_allan[kADIS16470NumChannels];
 
   // State and resource variables
   volatile bool m_thread_active = false;
   volatile bool m_first_run = true;
   volatile bool m_thread_idle = false;
+  volatile bool m_thread_exit = false;
   bool m_auto_configured = false;
-  SPI::Port m_spi_port;
   uint16_t m_calibration_time;
-  SPI *m_spi = nullptr;
-  DigitalInput *m_auto_interrupt = nullptr;
+  std::unique_ptr<ADIS16470Transport> m_transport;
   double m_scaled_sample_rate = 2500.0; // Default sample rate setting
+
+  // Frames drained per acquisition pass at most
+  static constexpr int kMaxFramesPerRead = 210;
+
+  // Raw frames and decoded samples, filled in place by the acquisition thread. Sized by the build profile in the constructor.
+  ADIS16470FrameRing m_ring;
+
+  // Frame checks and resync (acquisition thread only), and the stream health published from it
+  ADIS16470FrameSync m_frame_sync;
+  ADIS16470StreamStats m_stream_stats;
+
+  // Per-stage counter profiling, requested by the user and run by the acquisition thread
+  std::atomic<bool> m_perf_enabled{false};
+  ADIS16470PerfProfile m_perf_profile;
+
+  // Heading frames for CAN-connected motor controllers, sent from the acquisition thread
+  ADIS16470CANForwarder m_can_forwarder;
+
+  // Full-rate dashboard batches: timestamp, gyro X/Y/Z, accel X/Y/Z, angle (only used by the dashboard update)
+  static constexpr int kBatchArrays = 8;
+  std::atomic<bool> m_batch_enabled{false};
+  std::atomic<bool> m_batch_restart{true};
+  uint64_t m_batch_sequence = 0;
+  std::vector<ADIS16470Sample> m_batch_samples;
+  std::vector<double> m_batch_values[kBatchArrays];
+
+  // Optional uniform-grid resampler, fed from the acquisition thread
+  std::unique_ptr<ADIS16470Resampler> m_resampler;
+
+  // Optional preintegration over recent samples, fed from the acquisition thread
+  std::unique_ptr<ADIS16470Preintegrator> m_preintegrator;
+
+  // Auto SPI frame contents (only changed while the acquisition thread is paused)
+  uint8_t m_high_resolution_mask = 0;
+  bool m_read_diag_stat = false;
+
+  // IMU register settings
+  uint16_t m_dec_rate = 4;
+  uint16_t m_filter = 0;
+
+  // Bartlett filter group delay removed from sample timestamps (us)
+  uint32_t m_group_delay = 0;
+  ADIS16470FrameLayout m_frame_layout = ADIS16470MakeFrameLayout(kZ, 0);
+
+  // Reconfiguration timing
+  ADIS16470ReconfigStats m_reconfig_stats;
+  bool m_reconfig_pending = false;
+  uint64_t m_reconfig_start = 0;
+  uint64_t m_last_sample_time = 0;
+  uint32_t m_last_frame_timestamp = 0;
   
   std::thread m_acquire_task;
 
@@ -351,4 +739,22 @@ class ADIS16470_IMU : public GyroBase {
 
 };
 
+/**
+ * A set of configuration changes for ADIS16470_IMU::Configure(), applied in a single auto SPI pause.
+ * Fields that are not set keep their current value.
+ */
+struct ADIS16470Config {
+  // DEC_RATE: output rate is 2000 Hz / (dec_rate + 1), 0 to 1999
+  std::optional<uint16_t> dec_rate;
+  // FILT_CTRL: Bartlett filter size, 0 (off) to 6
+  std::optional<uint16_t> filter;
+  // NULL_CNFG: bias null averaging time (takes effect at the next Calibrate())
+  std::optional<ADIS16470CalibrationTime> cal_time;
+  std::optional<ADIS16470_IMU::IMUAxis> yaw_axis;
+  // ADIS16470ChannelBit() of each channel streamed at 32 bits
+  std::optional<uint8_t> high_resolution_mask;
+  // Read DIAG_STAT with every sample
+  std::optional<bool> read_diag_stat;
+};
+
 } //namespace frc
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include <adi/ADIS16470_IMU.h>
+
+namespace frc {
+
+/**
+ * Result of a latency calibration run.
+ */
+struct ADIS16470LatencyEstimate {
+  // False if there was not enough overlapping data or not enough turning to correlate
+  bool valid = false;
+  // Odometry timestamp minus IMU timestamp for the same motion (s). Positive means the odometry lags.
+  double latency = 0.0;
+  // Normalized correlation at the peak (1 = identical shapes)
+  double correlation = 0.0;
+  // Length of the data window that was correlated (s)
+  double window = 0.0;
+  // Number of odometry samples in the window
+  uint64_t odometry_samples = 0;
+};
+
+/**
+ * Estimates the delay between drivetrain odometry and the IMU by cross-correlating yaw rates.
+ *
+ * Feed timestamped wheel-odometry yaw rates with AddOdometrySample(), using the same FPGA clock
+ * as the IMU (HAL_GetFPGATime() or Timer::GetFPGATimestamp()). The calibrator pulls the full rate
+ * gyro stream from the IMU sample history. Estimate() resamples both signals onto a common grid at
+ * the IMU sample rate, correlates them with an FFT, and refines the correlation peak with a
+ * parabolic fit, which resolves the delay to a fraction of a sample period. The robot has to turn
+ * during the window (a practice session driving around is plenty).
+ *
+ * Start() runs the estimate periodically on a background thread so it can be left on during
+ * practice. Subtract GetLatestEstimate().latency from odometry timestamps before fusing them with
+ * IMU samples.
+ */
+class ADIS16470LatencyCalibrator {
+ public:
+  // Minimum yaw rate standard deviation (deg/s) in the window for an estimate to be valid
+  static constexpr double kMinExcitation = 10.0;
+
+  /**
+   * @param imu The IMU whose sample history is correlated.
+   *
+   * @param window Length of the correlated window (s). Keep it within the IMU sample history.
+   *
+   * @param max_lag Largest delay searched for (s), in either direction.
+   */
+  explicit ADIS16470LatencyCalibrator(ADIS16470_IMU& imu, double window = 8.0, double max_lag = 0.25);
+
+  ~ADIS16470LatencyCalibrator();
+
+  ADIS16470LatencyCalibrator(const ADIS16470LatencyCalibrator&) = delete;
+  ADIS16470LatencyCalibrator& operator=(const ADIS16470LatencyCalibrator&) = delete;
+
+  /**
+   * @brief Adds one odometry yaw rate sample. Safe to call from any thread.
+   *
+   * @param timestamp FPGA time of the measurement (us).
+   *
+   * @param yaw_rate Yaw rate from the wheel encoders (deg/s), same sign convention as the IMU yaw axis.
+   */
+  void AddOdometrySample(uint64_t timestamp, double yaw_rate);
+
+  /**
+   * @brief Copies new samples out of the IMU history. Called by Estimate() and by the background thread.
+   */
+  void PullImuSamples();
+
+  /**
+   * @brief Runs one latency estimate over the most recent window, in the calling thread.
+   */
+  ADIS16470LatencyEstimate Estimate();
+
+  /**
+   * @brief Starts estimating on a background thread every period seconds.
+   */
+  void Start(double period = 2.0);
+
+  void Stop();
+
+  /**
+   * @brief Returns the most recent valid estimate (valid = false until there is one).
+   */
+  ADIS16470LatencyEstimate GetLatestEstimate() const;
+
+ private:
+  struct RateSample {
+    uint64_t time;
+    double rate;
+  };
+
+  void Run(double period);
+
+  static double Interpolate(const std::vector<RateSample>& samples, size_t& index, uint64_t time);
+
+  static void FFT(std::vector<std::complex<double>>& data, bool inverse);
+
+  ADIS16470_IMU& m_imu;
+  double m_window;
+  double m_max_lag;
+
+  // IMU yaw rates with 64-bit FPGA timestamps (only touched with m_imu_mutex held)
+  std::mutex m_imu_mutex;
+  std::deque<RateSample> m_gyro;
+  uint64_t m_next_sequence = 0;
+
+  // Odometry yaw rates
+  std::mutex m_odometry_mutex;
+  std::deque<RateSample> m_odometry;
+
+  // Background estimation
+  mutable std::mutex m_result_mutex;
+  ADIS16470LatencyEstimate m_latest;
+  std::thread m_thread;
+  std::condition_variable m_cv;
+  std::mutex m_cv_mutex;
+  bool m_stop = false;
+};
+
+} //namespace frc
@@ -0,0 +1,124 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Raw IMU log format. A log is a file header followed by a sequence of records. Each record is a
+ * record header followed by word_count 32-bit words. All values are little-endian (native on the
+ * RoboRIO and on x86 desktops).
+ *
+ * kData records hold the raw auto SPI words exactly as they were read from the FPGA FIFO in one
+ * acquisition pass, so the desktop tools can run them through the same decode code as the driver.
+ * kConfig records mark a change in the frame contents: [yaw_axis, sample period in ns, high
+ * resolution channel mask, DIAG_STAT read, FILT_CTRL]. Logs without the mask word were recorded with
+ * every channel at 16 bits, logs without the DIAG_STAT word did not read DIAG_STAT, and logs without
+ * the FILT_CTRL word had the Bartlett filter off. Frame timestamps are always the raw FPGA
+ * timestamps, without the filter's group delay removed. kEvent records mark
+ * a black box trigger: [ADIS16470BlackBoxTrigger causes, FPGA timestamp of the triggering frame].
+ */
+
+namespace frc {
+
+static constexpr char kADIS16470LogMagic[8] = {'A', 'D', 'I', 'S', 'L', 'O', 'G', '\0'};
+static constexpr uint32_t kADIS16470LogVersion = 1;
+
+struct ADIS16470LogHeader {
+  char magic[8];
+  uint32_t version;
+  // Number of words in each auto SPI frame when the log was opened (kConfig records may change it)
+  uint32_t frame_len;
+};
+
+enum ADIS16470LogRecordType : uint16_t {
+  kADIS16470LogData = 0,
+  kADIS16470LogConfig = 1,
+  kADIS16470LogEvent = 2
+};
+
+enum ADIS16470LogRecordFlags : uint16_t {
+  // The FIFO held more data than one acquisition pass could drain
+  kADIS16470LogOverrun = 0x0001
+};
+
+struct ADIS16470LogRecord {
+  uint16_t type;
+  uint16_t flags;
+  uint32_t word_count;
+  // FPGA time (us) at which the record was produced
+  uint64_t host_time;
+};
+
+/**
+ * Asynchronous writer for raw IMU logs.
+ *
+ * Append() only copies the record into a preallocated staging buffer, so it is safe to call from
+ * the acquisition thread. A background thread swaps the staging buffer out and writes it to disk.
+ * If the disk falls behind and the staging buffer fills up, records are dropped and counted rather
+ * than blocking the caller.
+ */
+class ADIS16470LogWriter {
+ public:
+  // Size of each of the two staging buffers
+  static constexpr size_t kStagingBytes = 1 << 20;
+
+  ADIS16470LogWriter() = default;
+
+  ~ADIS16470LogWriter();
+
+  ADIS16470LogWriter(const ADIS16470LogWriter&) = delete;
+  ADIS16470LogWriter& operator=(const ADIS16470LogWriter&) = delete;
+
+  /**
+   * @brief Creates the log file, writes the file header, and starts the writer thread.
+   *
+   * @return False if the file could not be created.
+   */
+  bool Open(const std::string& path, uint32_t frame_len);
+
+  /**
+   * @brief Flushes any staged records and closes the file.
+   */
+  void Close();
+
+  bool IsOpen() const;
+
+  /**
+   * @brief Stages one record for writing.
+   *
+   * @return False if the record was dropped because the staging buffer is full.
+   */
+  bool Append(uint16_t type, uint16_t flags, uint64_t host_time, const uint32_t* words, uint32_t word_count);
+
+  uint64_t GetDroppedRecords() const { return m_dropped; }
+
+ private:
+  void WriterLoop();
+
+  // Set and cleared under m_mutex, only while the writer thread is not running
+  std::FILE* m_file = nullptr;
+  std::vector<uint8_t> m_staging;
+  std::vector<uint8_t> m_writing;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stop = false;
+  std::atomic<uint64_t> m_dropped{0};
+  std::thread m_thread;
+};
+
+} //namespace frc
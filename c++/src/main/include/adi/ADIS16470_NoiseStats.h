@@ -0,0 +1,131 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace frc {
+
+/* ADIS16470 Sensor Channel Enum Class */
+enum class ADIS16470Channel {
+  kGyroX = 0,
+  kGyroY = 1,
+  kGyroZ = 2,
+  kAccelX = 3,
+  kAccelY = 4,
+  kAccelZ = 5
+};
+
+static constexpr int kADIS16470NumChannels = 6;
+
+/**
+ * Summary of the noise characteristics of a single sensor channel. All values are in the
+ * channel's native units (deg/s for gyros, g for accelerometers).
+ */
+struct ADIS16470NoiseStatistics {
+  // Number of samples folded into the statistics
+  uint64_t samples = 0;
+  // Running mean (the gyro bias while the robot is at rest)
+  double mean = 0.0;
+  // Running standard deviation
+  double std_dev = 0.0;
+  // Angle (or velocity) random walk in units/sqrt(s), read from the Allan deviation at tau = 1s
+  double random_walk = 0.0;
+  // Bias instability, the Allan deviation floor divided by 0.664
+  double bias_instability = 0.0;
+  // Averaging time (seconds) at which the Allan deviation floor was found
+  double bias_instability_tau = 0.0;
+};
+
+/**
+ * Incremental mean and variance using Welford's algorithm. Numerically stable and O(1) per sample.
+ */
+class ADIS16470WelfordStats {
+ public:
+  void Reset();
+
+  void Update(double x);
+
+  uint64_t GetCount() const { return m_count; }
+
+  double GetMean() const { return m_mean; }
+
+  double GetVariance() const;
+
+  double GetStdDev() const;
+
+ private:
+  uint64_t m_count = 0;
+  double m_mean = 0.0;
+  double m_m2 = 0.0;
+};
+
+/**
+ * Streaming overlapping Allan deviation estimator.
+ *
+ * Cluster sizes are octave spaced (1, 2, 4, ... 2^(kNumTaus-1) samples). Each octave keeps a short
+ * ring of the running sum of the input, decimated by a power-of-two stride so that at most
+ * kOverlap clusters overlap each other. Octave j is only touched on samples that are a multiple
+ * of its stride, which keeps the cost per sample O(1) amortized regardless of the longest tau.
+ */
+class ADIS16470AllanDeviation {
+ public:
+  // Number of octave-spaced cluster sizes tracked (2^15 samples = 82s at 400 SPS)
+  static constexpr int kNumTaus = 16;
+
+  // Maximum number of overlapping clusters per cluster length
+  static constexpr int kOverlap = 8;
+
+  ADIS16470AllanDeviation();
+
+  void Reset();
+
+  void Update(double y);
+
+  uint64_t GetCount() const { return m_count; }
+
+  /**
+   * @brief Returns the Allan deviation for one of the tracked cluster sizes.
+   *
+   * @param index Cluster size index (cluster size = 2^index samples).
+   *
+   * @param sample_period The input sample period in seconds.
+   *
+   * @param tau Set to the averaging time in seconds.
+   *
+   * @param adev Set to the Allan deviation in input units.
+   *
+   * @return False if not enough samples have been collected for this cluster size.
+   */
+  bool GetDeviation(int index, double sample_period, double* tau, double* adev) const;
+
+  /**
+   * @brief Fills the noise statistics summary fields derived from the Allan deviation curve.
+   */
+  void Summarize(double sample_period, ADIS16470NoiseStatistics* stats) const;
+
+ private:
+  static constexpr int kRingLen = 2 * kOverlap + 1;
+
+  struct Octave {
+    double sums[kRingLen];
+    int head;
+    int filled;
+    double accum;
+    uint64_t terms;
+  };
+
+  Octave m_octaves[kNumTaus];
+  uint64_t m_count = 0;
+  double m_offset = 0.0;
+  double m_sum = 0.0;
+};
+
+} //namespace frc
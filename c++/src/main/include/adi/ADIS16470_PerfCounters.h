@@ -0,0 +1,133 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace frc {
+
+/* Stages of one acquisition pass, in the order they run */
+enum class ADIS16470Stage {
+  // FIFO drain into the ring, with any resync in progress
+  kRead = 0,
+  // Frame checks
+  kCheck = 1,
+  // Raw log hand-off
+  kLog = 2,
+  // Frame decode, host bias and black box triggers
+  kDecode = 3,
+  // Complementary filter
+  kTilt = 4,
+  // Locked section: integration, history consumers, noise statistics and outputs
+  kPublish = 5
+};
+
+static constexpr int kADIS16470NumStages = 6;
+
+/* Counters read per stage */
+enum class ADIS16470PerfCounter {
+  // CPU time of the thread (ns). A software counter, so it works without a PMU.
+  kTaskClock = 0,
+  kCycles = 1,
+  kInstructions = 2,
+  // Last level cache misses as the kernel maps them (L1 data refills on some ARM cores)
+  kCacheMisses = 3,
+  kBranchMisses = 4
+};
+
+static constexpr int kADIS16470NumPerfCounters = 5;
+
+/**
+ * Per stage counter totals of the acquisition loop.
+ */
+struct ADIS16470PerfProfile {
+  // True for each counter the kernel opened, indexed by ADIS16470PerfCounter
+  bool available[kADIS16470NumPerfCounters] = {};
+  // Passes and samples profiled
+  uint64_t passes = 0;
+  uint64_t samples = 0;
+  // Totals, indexed by ADIS16470Stage and ADIS16470PerfCounter
+  uint64_t totals[kADIS16470NumStages][kADIS16470NumPerfCounters] = {};
+
+  /**
+   * @brief Returns a counter's average per sample in one stage (0 if nothing was profiled).
+   */
+  double PerSample(ADIS16470Stage stage, ADIS16470PerfCounter counter) const {
+    return samples > 0 ? double(totals[static_cast<int>(stage)][static_cast<int>(counter)]) / samples : 0.0;
+  }
+};
+
+/**
+ * Hardware performance counters of the calling thread, read between the stages of a pass.
+ *
+ * The counters are opened with perf_event_open as one group led by the task clock, so one read()
+ * returns all of them at once and they all cover the same instructions. Hardware counters the
+ * CPU or kernel doesn't offer (in most virtual machines, or with perf_event_paranoid above 2) are
+ * left out and reported unavailable; the task clock is always there on Linux. The hardware
+ * counters count user space only, while the task clock includes time spent in system calls. Each
+ * read is a system call; its smallest cost, measured when the counters are opened, is subtracted
+ * from every stage, but the rest of it (and its cache footprint) stays, so compare profiles with
+ * each other rather than with unprofiled timings.
+ *
+ * On other systems Open() fails and nothing is counted.
+ */
+class ADIS16470PerfCounters {
+ public:
+  ADIS16470PerfCounters() = default;
+
+  ~ADIS16470PerfCounters();
+
+  ADIS16470PerfCounters(const ADIS16470PerfCounters&) = delete;
+  ADIS16470PerfCounters& operator=(const ADIS16470PerfCounters&) = delete;
+
+  /**
+   * @brief Opens the counters for the calling thread and clears the totals.
+   *
+   * @return False if no counter could be opened.
+   */
+  bool Open();
+
+  void Close();
+
+  bool IsOpen() const { return m_fds[0] >= 0; }
+
+  /**
+   * @brief Starts a pass: the next stage is counted from here.
+   */
+  void Begin();
+
+  /**
+   * @brief Ends a stage: adds the counts since Begin() or the previous Mark() to it.
+   */
+  void Mark(ADIS16470Stage stage);
+
+  /**
+   * @brief Ends a pass that produced this many samples.
+   */
+  void EndPass(int samples);
+
+  const ADIS16470PerfProfile& GetProfile() const { return m_profile; }
+
+ private:
+  bool Read(uint64_t* values);
+
+  // File descriptors indexed by ADIS16470PerfCounter (-1 if not open). The task clock leads the group.
+  int m_fds[kADIS16470NumPerfCounters] = {-1, -1, -1, -1, -1};
+  // Counter at each position of the group read
+  int m_order[kADIS16470NumPerfCounters] = {};
+  int m_count = 0;
+
+  uint64_t m_last[kADIS16470NumPerfCounters] = {};
+  // Counts a read adds, subtracted from each stage
+  uint64_t m_overhead[kADIS16470NumPerfCounters] = {};
+  ADIS16470PerfProfile m_profile;
+};
+
+} //namespace frc
@@ -0,0 +1,152 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <adi/ADIS16470_Processing.h>
+
+namespace frc {
+
+/**
+ * Motion of the IMU between two FPGA timestamps, integrated at the full sample rate.
+ */
+struct ADIS16470Preintegration {
+  // FPGA timestamps (us) the window starts and ends at
+  uint32_t start_timestamp = 0;
+  uint32_t end_timestamp = 0;
+  // Elapsed time (s)
+  double dt = 0.0;
+  // Rotation of the body at the end relative to the body at the start, as a unit quaternion (w, x, y, z)
+  double rotation[4] = {1.0, 0.0, 0.0, 0.0};
+  // Integrated specific force in the start body frame (m/s). Gravity is not removed: subtract g * dt
+  // rotated into the start frame to get the change in velocity.
+  double delta_velocity[3] = {};
+  // 6x6 covariance, row major, of the rotation error (rad, a small rotation applied on the left in
+  // the start frame) followed by the delta velocity error (m/s)
+  double covariance[36] = {};
+};
+
+/**
+ * Prefix-integrated IMU motion over a ring of recent samples, for preintegration queries between
+ * arbitrary timestamps.
+ *
+ * Every sample adds its rotation and velocity increment to running totals, and the ring keeps the
+ * totals after each sample: the orientation relative to a reference frame, the integrated
+ * specific force in that frame, and the time weighted first and second moments of the integrated
+ * force that the covariance needs. The motion between two timestamps is then the difference of
+ * the totals at either end, interpolated between the nearest samples, so a query costs two binary
+ * searches and a few 3x3 products however long the window is, and overlapping windows share all
+ * the work.
+ *
+ * The rotation is integrated from the gyro rates times the sample time, with the 32-bit delta
+ * angle of the yaw axis in place of its gyro rate, and the velocity from the accelerations at the
+ * middle of each sample's rotation. The decimated outputs are averages over the sample period, so
+ * this matches the IMU's own delta angle and delta velocity registers up to coning and sculling.
+ * The covariance is propagated to first order from white gyro and accelerometer noise.
+ *
+ * The totals grow without bound (gravity alone adds 9.81 m/s every second), so they are restarted
+ * from the current orientation once per ring length to keep the differences accurate. A query
+ * reaches back at most one ring length, so it spans at most one restart, which is undone with the
+ * stored totals at the restart point.
+ *
+ * Not thread safe. The driver calls it with its mutex held.
+ */
+class ADIS16470Preintegrator {
+ public:
+  // Datasheet angle random walk (0.34 deg/sqrt(h)) as a rate noise density (deg/s/sqrt(Hz))
+  static constexpr double kDefaultGyroNoiseDensity = 0.34 / 60.0;
+  // Datasheet velocity random walk (0.037 m/s/sqrt(h)) as a noise density (g/sqrt(Hz))
+  static constexpr double kDefaultAccelNoiseDensity = 0.037 / 60.0 / 9.81;
+
+  /**
+   * @param capacity Samples held, which sets how far back a query can start.
+   */
+  explicit ADIS16470Preintegrator(int capacity = 4096);
+
+  /**
+   * @brief Sets the noise the covariance is computed from.
+   *
+   * @param gyro_density Gyro rate noise density (deg/s/sqrt(Hz)).
+   *
+   * @param accel_density Accelerometer noise density (g/sqrt(Hz)).
+   */
+  void SetNoiseDensity(double gyro_density, double accel_density);
+
+  /**
+   * @brief Adds one sample. Samples must arrive in timestamp order.
+   *
+   * @param yaw_axis Axis (0 to 2 for X to Z) whose delta angle replaces the gyro rate.
+   *
+   * A sample without a time step (the first after the stream restarts) or out of order starts the
+   * history over at that sample, so no window can span the restart.
+   */
+  void Process(const ADIS16470Sample& sample, int yaw_axis);
+
+  /**
+   * @brief Forgets every sample.
+   */
+  void Reset();
+
+  /**
+   * @brief Returns the range of timestamps a query can cover. False if there are no samples.
+   */
+  bool GetRange(uint32_t* oldest_timestamp, uint32_t* latest_timestamp) const;
+
+  /**
+   * @brief Computes the motion between two timestamps.
+   *
+   * @return False if either timestamp lies outside GetRange() or the end is before the start.
+   */
+  bool Get(uint32_t start_timestamp, uint32_t end_timestamp, ADIS16470Preintegration* result) const;
+
+ private:
+  // Running totals since the start of an epoch, in the body frame at the start of the epoch
+  struct Totals {
+    // Orientation (w, x, y, z)
+    double q[4] = {1.0, 0.0, 0.0, 0.0};
+    // Integrated specific force u (m/s)
+    double u[3] = {};
+    // Time (s)
+    double t = 0.0;
+    // Sum of dt * u
+    double p[3] = {};
+    // Sum of dt * u * u^T (xx, xy, xz, yy, yz, zz)
+    double m[6] = {};
+  };
+
+  struct Entry {
+    uint32_t timestamp = 0;
+    uint64_t epoch = 0;
+    Totals totals;
+  };
+
+  const Entry& At(uint64_t index) const { return m_ring[index % m_ring.size()]; }
+  bool TotalsAt(uint32_t timestamp, Totals* totals, uint64_t* epoch) const;
+  void ToCurrentEpoch(Totals* totals) const;
+
+  std::vector<Entry> m_ring;
+  // Entries added, and entries since the last Reset()
+  uint64_t m_head = 0;
+  uint64_t m_count = 0;
+
+  Totals m_totals;
+  uint64_t m_epoch = 0;
+  int m_epoch_entries = 0;
+  // Totals at the start of the current epoch, in the previous epoch's frame
+  Totals m_epoch_origin;
+
+  // Noise variances per second: (rad/s)^2/Hz and (m/s^2)^2/Hz
+  double m_gyro_variance = 0.0;
+  double m_accel_variance = 0.0;
+};
+
+} //namespace frc
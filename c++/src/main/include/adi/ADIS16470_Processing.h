@@ -0,0 +1,229 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <adi/ADIS16470_NoiseStats.h>
+
+/*
+ * Frame decode and filtering shared by the driver and the desktop tools. Nothing in this
+ * header depends on WPILib so it can be built for any platform.
+ */
+
+namespace frc {
+
+/* ADIS16470 Constants */
+const double delta_angle_sf = 2160.0 / 2147483648.0; /* 2160 / (2^31) */
+const double rad_to_deg = 57.2957795;
+const double deg_to_rad = 0.0174532;
+const double grav = 9.81;
+
+/* Register reads in the largest frame: 32-bit delta angle, six 32-bit channels, and DIAG_STAT */
+static constexpr int kADIS16470MaxReads = 15;
+
+/* Largest auto SPI frame: timestamp + 2 junk bytes + 2 bytes per register read */
+static constexpr int kADIS16470MaxFrameLen = 1 + 2 + 2 * kADIS16470MaxReads;
+
+/*
+ * Approximate time the auto SPI engine spends on one 16-bit register read (s): 8us of clocking at
+ * 2MHz plus the 25us stall (1000 FPGA ticks) the IMU needs between reads.
+ */
+static constexpr double kADIS16470ReadTime = 33e-6;
+
+/* Bit for a channel in a high resolution channel mask */
+static constexpr uint8_t ADIS16470ChannelBit(ADIS16470Channel channel) {
+  return uint8_t(1 << static_cast<int>(channel));
+}
+
+static constexpr uint8_t kADIS16470AllChannels = (1 << kADIS16470NumChannels) - 1;
+
+/* Helpful conversion functions */
+static inline int32_t ToInt(const uint32_t *buf){
+  return (int32_t)( (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3] );
+}
+
+static inline uint16_t BuffToUShort(const uint32_t* buf) {
+  return ((uint16_t)(buf[0]) << 8) | buf[1];
+}
+
+static inline int16_t BuffToShort(const uint32_t* buf) {
+  return ((int16_t)(buf[0]) << 8) | buf[1];
+}
+
+/**
+ * Contents of an auto SPI frame.
+ *
+ * The frame always starts with the 32-bit delta angle of the yaw axis, followed by the three gyro
+ * and three accelerometer channels. A channel in the high resolution mask is read as its *_OUT
+ * word followed by its *_LOW word and decoded as a 32-bit value, otherwise only the *_OUT word is
+ * read. DIAG_STAT can be read last. Each read adds two words (one per byte) to the frame.
+ */
+struct ADIS16470FrameLayout {
+  // Auto SPI transmit data: register address and a padding byte for each read
+  uint8_t packet[2 * kADIS16470MaxReads];
+  int packet_size = 0;
+  // Words per frame, including the timestamp
+  int frame_len = 0;
+  // Word index of the most significant byte of each channel, in ADIS16470Channel order
+  int channel_index[kADIS16470NumChannels];
+  uint8_t high_resolution_mask = 0;
+  // Word index of DIAG_STAT, or -1 if the frame does not read it
+  int diag_index = -1;
+};
+
+/**
+ * @brief Builds the auto SPI frame for a yaw axis (0 = X, 1 = Y, 2 = Z) and a high resolution channel mask.
+ */
+ADIS16470FrameLayout ADIS16470MakeFrameLayout(int yaw_axis, uint8_t high_resolution_mask, bool read_diag_stat = false);
+
+/**
+ * @brief Returns the approximate time (s) the auto SPI engine needs to clock out one frame.
+ *
+ * The frame must be read well within one IMU sample period, or the next data ready edge arrives
+ * while the transfer is still running.
+ */
+static inline double ADIS16470FrameTransferTime(const ADIS16470FrameLayout& layout) {
+  // One extra read clocks out the response to the last register read
+  return (layout.packet_size / 2 + 1) * kADIS16470ReadTime;
+}
+
+/**
+ * One decoded auto SPI frame, scaled to engineering units.
+ */
+struct ADIS16470Sample {
+  // FPGA timestamp (us)
+  uint32_t timestamp = 0;
+  // Time since the previous frame (s)
+  double dt = 0.0;
+  // Delta angle of the selected yaw axis (deg)
+  double delta_angle = 0.0;
+  // Angular rates (deg/s)
+  double gyro_x = 0.0;
+  double gyro_y = 0.0;
+  double gyro_z = 0.0;
+  // Accelerations (g)
+  double accel_x = 0.0;
+  double accel_y = 0.0;
+  double accel_z = 0.0;
+  // DIAG_STAT error flags (always 0 if the frame does not read DIAG_STAT)
+  uint16_t diag_stat = 0;
+  // Integrated yaw angle after this sample, as GetAngle() reported it (deg). Filled in by the driver.
+  double angle = 0.0;
+};
+
+/**
+ * @brief Decodes one gyro (scale 0.1 deg/s) or accelerometer (scale 1/800 g) channel.
+ */
+static inline double ADIS16470DecodeChannel(const uint32_t* frame, const ADIS16470FrameLayout& layout,
+                                            ADIS16470Channel channel, double scale) {
+  const uint32_t* word = &frame[layout.channel_index[static_cast<int>(channel)]];
+  if (layout.high_resolution_mask & ADIS16470ChannelBit(channel)) {
+    return ToInt(word) * (scale / 65536.0);
+  }
+  return BuffToShort(word) * scale;
+}
+
+/**
+ * @brief Decodes and scales one auto SPI frame.
+ *
+ * @param frame Pointer to the first (timestamp) word of the frame.
+ *
+ * @param layout The frame contents.
+ *
+ * @param previous_timestamp Timestamp of the previous frame, used to scale the delta angle.
+ *
+ * @param scaled_sample_rate The IMU sample period in microseconds.
+ *
+ * @param sample Receives the decoded frame.
+ *
+ * Data order with every channel at 16 bits: [timestamp, request_1, request_2, d_1, d_2, d_3, d_4,
+ * gx_1, gx_2, gy_1, gy_2, gz_1, gz_2, ax_1, ax_2, ay_1, ay_2, az_1, az_2]. A high resolution channel
+ * takes four words (x_1 = highest byte) instead of two.
+ */
+static inline void ADIS16470DecodeFrame(const uint32_t* frame, const ADIS16470FrameLayout& layout,
+                                        uint32_t previous_timestamp, double scaled_sample_rate,
+                                        ADIS16470Sample* sample) {
+  uint32_t elapsed = frame[0] - previous_timestamp;
+  sample->timestamp = frame[0];
+  sample->dt = elapsed / 1000000.0;
+  /* Get delta angle value for selected yaw axis and scale by the elapsed time (based on timestamp) */
+  sample->delta_angle = (ToInt(&frame[3]) * delta_angle_sf) / (scaled_sample_rate / elapsed);
+  sample->gyro_x = ADIS16470DecodeChannel(frame, layout, ADIS16470Channel::kGyroX, 0.1);
+  sample->gyro_y = ADIS16470DecodeChannel(frame, layout, ADIS16470Channel::kGyroY, 0.1);
+  sample->gyro_z = ADIS16470DecodeChannel(frame, layout, ADIS16470Channel::kGyroZ, 0.1);
+  sample->accel_x = ADIS16470DecodeChannel(frame, layout, ADIS16470Channel::kAccelX, 1.0 / 800.0);
+  sample->accel_y = ADIS16470DecodeChannel(frame, layout, ADIS16470Channel::kAccelY, 1.0 / 800.0);
+  sample->accel_z = ADIS16470DecodeChannel(frame, layout, ADIS16470Channel::kAccelZ, 1.0 / 800.0);
+  sample->diag_stat = layout.diag_index >= 0 ? BuffToUShort(&frame[layout.diag_index]) : 0;
+}
+
+/**
+ * Six axis complementary filter used to estimate X-Y tilt from the gyro and accelerometer outputs.
+ *
+ * Complementary filter code was borrowed from https://github.com/tcleg/Six_Axis_Complementary_Filter
+ */
+class ADIS16470ComplementaryFilter {
+ public:
+  explicit ADIS16470ComplementaryFilter(double tau = 1.0) : m_tau(tau) {}
+
+  /**
+   * @brief Sets the filter time constant in seconds. Larger values trust the gyro for longer.
+   */
+  void SetTau(double tau) { m_tau = tau; }
+
+  double GetTau() const { return m_tau; }
+
+  /**
+   * @brief Ignores the accelerometer while the acceleration magnitude is more than threshold (g) away from 1 g.
+   *
+   * The tilt then follows the gyro alone through bumps and hard acceleration. 0 (the default) always uses the accelerometer.
+   */
+  void SetAccelRejection(double threshold) { m_accel_rejection = threshold; }
+
+  double GetAccelRejection() const { return m_accel_rejection; }
+
+  /**
+   * @brief Re-seeds the filter from the accelerometer on the next sample.
+   */
+  void Reset() { m_first_run = true; }
+
+  /**
+   * @brief Runs one sample through the filter.
+   */
+  void Process(const ADIS16470Sample& sample);
+
+  // Filter outputs (radians)
+  double GetCompAngleX() const { return m_compAngleX; }
+  double GetCompAngleY() const { return m_compAngleY; }
+  double GetAccelAngleX() const { return m_accelAngleX; }
+  double GetAccelAngleY() const { return m_accelAngleY; }
+
+ private:
+  double FormatFastConverge(double compAngle, double accAngle);
+
+  double FormatRange0to2PI(double compAngle);
+
+  double FormatAccelRange(double accelAngle, double accelZ);
+
+  double CompFilterProcess(double compAngle, double accelAngle, double omega);
+
+  double m_tau = 1.0;
+  double m_accel_rejection = 0.0;
+  double m_dt = 0.0;
+  double m_alpha = 0.0;
+  bool m_first_run = true;
+  double m_compAngleX = 0.0;
+  double m_compAngleY = 0.0;
+  double m_accelAngleX = 0.0;
+  double m_accelAngleY = 0.0;
+};
+
+} //namespace frc
@@ -0,0 +1,148 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+
+#include <adi/ADIS16470_NoiseStats.h>
+#include <adi/ADIS16470_Processing.h>
+
+/*
+ * Compile-time feature profiles for the acquisition loop.
+ *
+ * A profile is a policy struct of constexpr flags. The per-sample stages below take the profile as
+ * a template argument and the driver tests the flags with if constexpr, so a stage a profile
+ * turns off is not compiled into the hot loop at all. The driver is built with the profile picked
+ * by a preprocessor define (see ADIS16470Profile at the bottom). The desktop adis16470profilebench
+ * builds every profile side by side.
+ *
+ * Only the library's sources include this header. The define is not visible to robot code, so
+ * ADIS16470_IMU.h must not depend on the profile: its class layout is the same in every build.
+ */
+
+namespace frc {
+
+/**
+ * Everything: all six channels, tilt, full sample history, raw log, black box and noise statistics.
+ */
+struct ADIS16470FullProfile {
+  static constexpr const char* kName = "full";
+  // Decode the X/Y gyro and the accelerometer channels. The yaw gyro and delta angle are always decoded.
+  static constexpr bool kAllChannels = true;
+  // Complementary filter tilt angles (GetXComplementaryAngle() and friends)
+  static constexpr bool kTilt = true;
+  // Long sample history (GetSamples()), the resampler and dashboard sample batches
+  static constexpr bool kHistory = true;
+  // Raw log, black box and noise statistics
+  static constexpr bool kTelemetry = true;
+  // Frames in the ring. Without the history it only needs room for two FIFO drains.
+  static constexpr int kHistoryFrames = 4096;
+};
+
+/**
+ * Every output, without the raw log, black box and noise statistics.
+ */
+struct ADIS16470NoTelemetryProfile : ADIS16470FullProfile {
+  static constexpr const char* kName = "no-telemetry";
+  static constexpr bool kTelemetry = false;
+};
+
+/**
+ * GetAngle() and GetRate() only. Tilt, accelerations, the history and telemetry read as zero or do nothing.
+ */
+struct ADIS16470YawOnlyProfile {
+  static constexpr const char* kName = "yaw-only";
+  static constexpr bool kAllChannels = false;
+  static constexpr bool kTilt = false;
+  static constexpr bool kHistory = false;
+  static constexpr bool kTelemetry = false;
+  static constexpr int kHistoryFrames = 512;
+};
+
+/**
+ * @brief Decodes the parts of a frame the profile uses.
+ *
+ * @param yaw_gyro The gyro channel of the yaw axis, decoded even without kAllChannels.
+ *
+ * Without kAllChannels the other gyro and accelerometer fields are left untouched.
+ */
+template <class Profile>
+inline void ADIS16470DecodeProfileFrame(const uint32_t* frame, const ADIS16470FrameLayout& layout,
+                                        uint32_t previous_timestamp, double scaled_sample_rate,
+                                        ADIS16470Channel yaw_gyro, ADIS16470Sample* sample) {
+  if constexpr (Profile::kAllChannels) {
+    ADIS16470DecodeFrame(frame, layout, previous_timestamp, scaled_sample_rate, sample);
+  }
+  else {
+    uint32_t elapsed = frame[0] - previous_timestamp;
+    sample->timestamp = frame[0];
+    sample->dt = elapsed / 1000000.0;
+    sample->delta_angle = (ToInt(&frame[3]) * delta_angle_sf) / (scaled_sample_rate / elapsed);
+    double rate = ADIS16470DecodeChannel(frame, layout, yaw_gyro, 0.1);
+    (yaw_gyro == ADIS16470Channel::kGyroX ? sample->gyro_x :
+     yaw_gyro == ADIS16470Channel::kGyroY ? sample->gyro_y : sample->gyro_z) = rate;
+    sample->diag_stat = layout.diag_index >= 0 ? BuffToUShort(&frame[layout.diag_index]) : 0;
+  }
+}
+
+/**
+ * @brief Runs a decoded sample through the complementary filter if the profile has tilt.
+ */
+template <class Profile>
+inline void ADIS16470UpdateTilt(ADIS16470ComplementaryFilter& filter, const ADIS16470Sample& sample) {
+  if constexpr (Profile::kTilt) {
+    filter.Process(sample);
+  }
+}
+
+/**
+ * @brief Folds a sample into the running noise statistics if the profile has telemetry.
+ *
+ * @param welford Per channel Welford statistics, in ADIS16470Channel order.
+ *
+ * @param allan Per channel Allan deviation, in ADIS16470Channel order.
+ */
+template <class Profile>
+inline void ADIS16470UpdateNoiseStats(const ADIS16470Sample& sample, ADIS16470WelfordStats* welford,
+                                      ADIS16470AllanDeviation* allan) {
+  if constexpr (Profile::kTelemetry) {
+    const double channels[kADIS16470NumChannels] = {
+      sample.gyro_x, sample.gyro_y, sample.gyro_z, sample.accel_x, sample.accel_y, sample.accel_z
+    };
+    for (int c = 0; c < kADIS16470NumChannels; c++) {
+      welford[c].Update(channels[c]);
+      allan[c].Update(channels[c]);
+    }
+  }
+}
+
+/**
+ * @brief Bytes of storage the profile decides: the frame ring and the dashboard batch buffer.
+ */
+template <class Profile>
+constexpr size_t ADIS16470ProfileFootprint() {
+  size_t ring = Profile::kHistoryFrames * (sizeof(uint32_t) * kADIS16470MaxFrameLen + sizeof(ADIS16470Sample));
+  size_t batch = Profile::kHistory ? Profile::kHistoryFrames * sizeof(ADIS16470Sample) : 0;
+  return ring + batch;
+}
+
+/*
+ * The profile the driver is built with. Define ADIS16470_PROFILE_YAW_ONLY or
+ * ADIS16470_PROFILE_NO_TELEMETRY for the smaller ones; the default keeps every feature.
+ */
+#if defined(ADIS16470_PROFILE_YAW_ONLY)
+using ADIS16470Profile = ADIS16470YawOnlyProfile;
+#elif defined(ADIS16470_PROFILE_NO_TELEMETRY)
+using ADIS16470Profile = ADIS16470NoTelemetryProfile;
+#else
+using ADIS16470Profile = ADIS16470FullProfile;
+#endif
+
+} //namespace frc
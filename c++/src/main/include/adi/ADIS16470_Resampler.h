@@ -0,0 +1,131 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <adi/ADIS16470_Processing.h>
+
+namespace frc {
+
+/* Channels carried by the resampler: the six ADIS16470Channel values, the yaw angle, and padding */
+static constexpr int kADIS16470GridAngle = kADIS16470NumChannels;
+static constexpr int kADIS16470GridChannels = 8;
+
+/**
+ * One output sample of the resampler, on a uniform time grid.
+ */
+struct ADIS16470GridSample {
+  // Grid time (us) on the 64-bit FPGA clock (ADIS16470_IMU::GetFPGATime()). Always a multiple of the grid period.
+  uint64_t time = 0;
+  // Gyro rates (deg/s) and accelerations (g) in ADIS16470Channel order, then the yaw angle (deg)
+  double values[kADIS16470GridChannels] = {};
+};
+
+/**
+ * Streaming resampler from the IMU's timestamped samples onto a uniform time grid.
+ *
+ * FPGA timestamps jitter from frame to frame, and the sample spacing changes with DEC_RATE. The
+ * resampler interpolates every channel at fixed grid times with a cubic Lagrange polynomial
+ * through the four nearest input samples, using their actual timestamps. The weights are computed
+ * once per output sample and applied to all channels in one loop over a contiguous array, which
+ * the compiler vectorizes.
+ *
+ * An output sample is produced as soon as the input sample after next has arrived, so the added
+ * latency is at most two input periods. The grid is anchored at multiples of the period on the
+ * FPGA clock, so it stays aligned across gaps and rate changes. Interpolation never spans a gap
+ * (a restarted stream or more than kMaxGapPeriods missing samples); the grid resumes once four
+ * samples are available again.
+ *
+ * Process() is called from one thread. Output samples go into a ring that any thread can read
+ * with Read(), addressed by a running sequence number like the IMU sample history.
+ */
+class ADIS16470Resampler {
+ public:
+  // Input spacing, in multiples of the previous spacing, treated as a gap
+  static constexpr double kMaxGapPeriods = 4.0;
+
+  /**
+   * @param rate Output rate (Hz).
+   *
+   * @param capacity Output samples held for readers.
+   */
+  explicit ADIS16470Resampler(double rate, int capacity = 4096);
+
+  /**
+   * @brief Feeds one input sample. Samples must arrive in timestamp order.
+   *
+   * @param now 64-bit FPGA time (us) read after the sample arrived. The sample's 32-bit timestamp is placed at the
+   * latest time at or before it with the same low 32 bits.
+   */
+  void Process(const ADIS16470Sample& sample, uint64_t now);
+
+  /**
+   * @brief Drops the interpolation history, for example when the stream restarts.
+   */
+  void Restart();
+
+  /**
+   * @brief Removes a gyro bias found after the fact from the input samples held and the output samples produced.
+   *
+   * @param gyro_bias Bias of the X, Y and Z gyros (deg/s).
+   *
+   * @param yaw_bias Bias integrated into the yaw angle (deg/s).
+   *
+   * @param covered Time (s) since the bias started to be integrated, at the latest input sample. Samples from
+   * before that time are left alone.
+   *
+   * @param zeroed Time (s) since the angle was last zeroed, at the latest input sample. Angles after the zeroing
+   * only carry the bias since then.
+   */
+  void RemoveBias(const double* gyro_bias, double yaw_bias, double covered, double zeroed);
+
+  double GetRate() const { return 1000000.0 / m_period; }
+
+  /**
+   * @brief Returns the sequence number the next output sample will get.
+   */
+  uint64_t GetHead() const;
+
+  /**
+   * @brief Copies output samples out of the ring.
+   *
+   * @param sequence Sequence number of the first sample wanted. Advanced past the last sample copied.
+   * If it is older than the ring, copying starts at the oldest sample still held.
+   *
+   * @return The number of samples copied.
+   */
+  int Read(uint64_t* sequence, ADIS16470GridSample* samples, int max_samples) const;
+
+ private:
+  void Emit(uint64_t time, const double* weights);
+
+  const uint64_t m_period;
+
+  // Last four input samples, oldest first: FPGA times (us) and channel values
+  int m_count = 0;
+  uint64_t m_times[4] = {};
+  alignas(64) double m_values[4][kADIS16470GridChannels] = {};
+
+  // FPGA time of the latest input sample (us)
+  uint64_t m_latest = 0;
+
+  // Next grid time to produce
+  uint64_t m_next = 0;
+
+  // Output ring
+  mutable std::mutex m_mutex;
+  std::vector<ADIS16470GridSample> m_ring;
+  uint64_t m_head = 0;
+};
+
+} //namespace frc
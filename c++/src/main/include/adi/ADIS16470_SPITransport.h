@@ -0,0 +1,71 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <memory>
+
+#include <frc/DigitalInput.h>
+#include <frc/DigitalOutput.h>
+#include <frc/SPI.h>
+
+#include <adi/ADIS16470_Transport.h>
+
+namespace frc {
+
+/**
+ * ADIS16470 transport for the RoboRIO. Uses the selected SPI port, DIO 26 as the auto SPI data
+ * ready trigger, SPI CS2 (DIO 27) as the IMU reset line, and SPI CS3 (DIO 28) as the ready LED.
+ */
+class ADIS16470SPITransport : public ADIS16470Transport {
+ public:
+  explicit ADIS16470SPITransport(SPI::Port port);
+
+  ~ADIS16470SPITransport() override;
+
+  void SetResetAsserted(bool asserted) override;
+
+  void SetReadyLED(bool on) override;
+
+  void OpenSPI() override;
+
+  void CloseSPI() override;
+
+  bool IsOpen() const override { return m_spi != nullptr; }
+
+  int Write(uint8_t* data, int size) override;
+
+  int Read(bool initiate, uint8_t* data, int size) override;
+
+  void InitAuto(int buffer_size) override;
+
+  void SetAutoTransmitData(const uint8_t* data, int size, int zero_size) override;
+
+  void ConfigureAutoStall(int cs_to_sclk_ticks, int stall_ticks, int pow2_bytes_per_read) override;
+
+  void StartAutoTrigger() override;
+
+  void StopAuto() override;
+
+  int ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) override;
+
+  uint64_t GetTime() override;
+
+  void Sleep(double seconds) override;
+
+ private:
+  SPI::Port m_port;
+  std::unique_ptr<SPI> m_spi;
+  std::unique_ptr<DigitalInput> m_auto_interrupt;
+  std::unique_ptr<DigitalOutput> m_reset_out;
+  std::unique_ptr<DigitalInput> m_reset_in;
+  std::unique_ptr<DigitalOutput> m_status_led;
+};
+
+} //namespace frc
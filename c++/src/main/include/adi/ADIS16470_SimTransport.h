@@ -0,0 +1,197 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <adi/ADIS16470_Transport.h>
+
+namespace frc {
+
+/**
+ * Simulated ADIS16470 and RoboRIO auto SPI engine running on a virtual clock.
+ *
+ * The IMU model keeps a register file, produces a data ready edge every (DEC_RATE + 1) / 2000 s,
+ * and answers SPI transfers with the same one-transfer pipeline delay as the real part. While
+ * auto SPI is running each edge pushes one frame (timestamp plus one word per received byte)
+ * into a FIFO sized by InitAuto(). Sensor outputs follow a configurable truth signal plus
+ * seeded Gaussian noise, so runs are repeatable.
+ *
+ * Time only advances inside Sleep(). Once every attached thread is sleeping, the clock jumps to
+ * the earliest wake-up time and releases exactly one thread, so the driver's threads run one at
+ * a time in a fixed order and a simulated startup that takes seconds finishes in microseconds.
+ * Any thread that sleeps on this transport should be attached with AttachThread().
+ */
+class ADIS16470SimTransport : public ADIS16470Transport {
+ public:
+  struct Stats {
+    // Data ready edges produced by the IMU
+    uint64_t frames_generated = 0;
+    // Frames pushed into the auto SPI FIFO
+    uint64_t frames_captured = 0;
+    // Edges that happened while auto SPI was stopped
+    uint64_t frames_missed = 0;
+    // Frames dropped because the FIFO was full
+    uint64_t frames_overflowed = 0;
+    // Standard SPI transfers (2 bytes each)
+    uint64_t spi_transfers = 0;
+  };
+
+  explicit ADIS16470SimTransport(uint32_t seed = 1);
+
+  ~ADIS16470SimTransport() override = default;
+
+  /* Truth model */
+  void SetAngularRate(double x, double y, double z);
+
+  void SetAcceleration(double x, double y, double z);
+
+  void SetGyroBias(double x, double y, double z);
+
+  void SetGyroNoise(double std_dev);
+
+  void SetAccelNoise(double std_dev);
+
+  void SetSerialNumber(uint16_t serial);
+
+  /**
+   * @brief Sets the PROD_ID the simulated IMU reports, to exercise the driver's check for a missing or wrong part.
+   */
+  void SetProductID(uint16_t product_id);
+
+  /**
+   * @brief Sets how long the IMU takes to come out of reset (seconds).
+   */
+  void SetBootTime(double seconds);
+
+  /**
+   * @brief Sets DIAG_STAT error flags. They stay set until DIAG_STAT is read.
+   */
+  void RaiseDiagStat(uint16_t flags);
+
+  Stats GetStats() const;
+
+  /**
+   * @brief Returns the virtual time in seconds.
+   */
+  double GetVirtualTime() const;
+
+  /**
+   * @brief Returns the current value of an IMU register.
+   */
+  uint16_t PeekRegister(uint8_t reg) const;
+
+  /* ADIS16470Transport implementation */
+  void SetResetAsserted(bool asserted) override;
+
+  void SetReadyLED(bool on) override;
+
+  void OpenSPI() override;
+
+  void CloseSPI() override;
+
+  bool IsOpen() const override;
+
+  int Write(uint8_t* data, int size) override;
+
+  int Read(bool initiate, uint8_t* data, int size) override;
+
+  void InitAuto(int buffer_size) override;
+
+  void SetAutoTransmitData(const uint8_t* data, int size, int zero_size) override;
+
+  void ConfigureAutoStall(int cs_to_sclk_ticks, int stall_ticks, int pow2_bytes_per_read) override;
+
+  void StartAutoTrigger() override;
+
+  void StopAuto() override;
+
+  int ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) override;
+
+  uint64_t GetTime() override;
+
+  void Sleep(double seconds) override;
+
+  void AttachThread() override;
+
+  void DetachThread() override;
+
+ private:
+  static constexpr uint64_t kNone = ~uint64_t(0);
+
+  void ResetRegisters();
+  uint16_t& Reg(uint8_t addr) { return m_regs[(addr & 0x7f) >> 1]; }
+  uint64_t SamplePeriod() const;
+  void Transfer(const uint8_t* tx, uint8_t* rx, int size);
+  void WriteByte(uint8_t addr, uint8_t val);
+  void AdvanceTo(uint64_t time_ns);
+  void DataReady(uint64_t time_ns);
+  void IntegrateRate(uint64_t time_ns);
+  void Schedule();
+
+  // Register file, indexed by address / 2
+  uint16_t m_regs[64];
+  uint16_t m_pending_response = 0;
+  uint8_t m_last_rx[32];
+  int m_last_rx_size = 0;
+
+  // Truth model
+  double m_rate[3] = {0.0, 0.0, 0.0};
+  double m_accel[3] = {0.0, 0.0, 1.0};
+  double m_bias[3] = {0.0, 0.0, 0.0};
+  double m_bias_correction[3] = {0.0, 0.0, 0.0};
+  double m_gyro_noise = 0.0;
+  double m_accel_noise = 0.0;
+  // Integrated measured rate, and its value at the last data ready edge (deg)
+  double m_angle[3] = {0.0, 0.0, 0.0};
+  double m_edge_angle[3] = {0.0, 0.0, 0.0};
+  uint64_t m_angle_time = 0;
+  uint16_t m_serial = 0x1234;
+  uint16_t m_product_id = 16470;
+  std::mt19937 m_rng;
+  std::normal_distribution<double> m_normal{0.0, 1.0};
+
+  // IMU state
+  bool m_in_reset = false;
+  uint64_t m_boot_ns = 250000000;
+  uint64_t m_booted_at = 0;
+  uint64_t m_next_edge = kNone;
+
+  // Auto SPI state
+  std::deque<uint32_t> m_fifo;
+  size_t m_fifo_capacity = 0;
+  bool m_open = false;
+  bool m_auto_running = false;
+  std::vector<uint8_t> m_auto_tx;
+  std::vector<uint32_t> m_frame;
+
+  // Guards all simulation state
+  mutable std::mutex m_mutex;
+
+  // Virtual clock
+  uint64_t m_now = 0;
+  int m_attached = 0;
+  int m_sleeping = 0;
+  uint64_t m_next_sleeper = 0;
+  uint64_t m_released = kNone;
+  std::set<std::pair<uint64_t, uint64_t>> m_sleepers;
+  std::condition_variable m_cv;
+
+  Stats m_stats;
+};
+
+} //namespace frc
@@ -0,0 +1,106 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace frc {
+
+/**
+ * Everything the ADIS16470 driver needs from the outside world: the SPI port (standard and auto
+ * SPI), the reset and status LED lines, and a clock.
+ *
+ * ADIS16470SPITransport talks to the real IMU through WPILib. ADIS16470SimTransport simulates the
+ * IMU and runs on a virtual clock so the driver can be exercised on a desktop. The methods mirror
+ * the frc::SPI calls the driver used before the transport was split out.
+ */
+class ADIS16470Transport {
+ public:
+  virtual ~ADIS16470Transport() = default;
+
+  /**
+   * @brief Drives the IMU reset line. The IMU starts booting when the line is released.
+   */
+  virtual void SetResetAsserted(bool asserted) = 0;
+
+  /**
+   * @brief Turns the "IMU ready" LED on the breakout board on or off.
+   */
+  virtual void SetReadyLED(bool on) = 0;
+
+  /**
+   * @brief Opens and configures the SPI port for standard SPI transactions.
+   */
+  virtual void OpenSPI() = 0;
+
+  /**
+   * @brief Releases the SPI port and the data ready input.
+   */
+  virtual void CloseSPI() = 0;
+
+  virtual bool IsOpen() const = 0;
+
+  /**
+   * @brief Full duplex write. The bytes clocked in are kept for a following Read(false, ...).
+   */
+  virtual int Write(uint8_t* data, int size) = 0;
+
+  /**
+   * @brief Returns the bytes clocked in by the last transfer, or runs a new transfer of zeros if initiate is set.
+   */
+  virtual int Read(bool initiate, uint8_t* data, int size) = 0;
+
+  virtual void InitAuto(int buffer_size) = 0;
+
+  virtual void SetAutoTransmitData(const uint8_t* data, int size, int zero_size) = 0;
+
+  virtual void ConfigureAutoStall(int cs_to_sclk_ticks, int stall_ticks, int pow2_bytes_per_read) = 0;
+
+  /**
+   * @brief Starts auto SPI transfers on each rising edge of the IMU data ready line.
+   */
+  virtual void StartAutoTrigger() = 0;
+
+  virtual void StopAuto() = 0;
+
+  /**
+   * @brief Reads words out of the auto SPI FIFO.
+   *
+   * @return The number of words available when num_to_read is 0, otherwise the number of words remaining.
+   */
+  virtual int ReadAutoReceivedData(uint32_t* buffer, int num_to_read, double timeout) = 0;
+
+  /**
+   * @brief Returns the FPGA time in microseconds. Auto SPI frame timestamps are on the same clock.
+   */
+  virtual uint64_t GetTime() = 0;
+
+  /**
+   * @brief Sleeps the calling thread for the given number of seconds.
+   */
+  virtual void Sleep(double seconds) = 0;
+
+  /**
+   * @brief Registers a thread that sleeps on this transport's clock.
+   *
+   * A virtual clock only moves forward once every attached thread is sleeping, which keeps
+   * simulated runs deterministic. The driver attaches its acquisition thread before starting it
+   * and detaches any thread that is about to block on something other than Sleep(). Real
+   * hardware clocks ignore these calls.
+   */
+  virtual void AttachThread() {}
+
+  /**
+   * @brief Unregisters a thread attached with AttachThread().
+   */
+  virtual void DetachThread() {}
+};
+
+} //namespace frc
@@ -0,0 +1,169 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470perfbench - hardware performance counters per stage of the acquisition loop.
+ *
+ * Usage: adis16470perfbench [--seconds s] [--csv results.csv] [--label name]
+ *
+ * The driver is run against ADIS16470SimTransport with EnablePerfProfiling() for --seconds of
+ * simulated time (default 10) in a few configurations: the default frame at 400 Hz, every
+ * channel at 32 bits with DIAG_STAT, the same at 2 kHz, and 400 Hz with the resampler and
+ * preintegration running. For every stage the bench prints the task clock (ns), cycles,
+ * instructions, cache misses and branch misses per sample. Counters the system doesn't offer
+ * (hardware counters in most virtual machines) print as "-". On the roboRIO, the same numbers
+ * come from GetPerfProfile() in robot code. With --csv, one row per configuration and stage is
+ * appended to the given file, tagged with --label (for example a commit hash).
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <adi/ADIS16470_IMU.h>
+#include <adi/ADIS16470_SimTransport.h>
+#include <hal/HAL.h>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+namespace {
+
+/* Simulated time before profiling starts (s) */
+constexpr double kSettle = 0.5;
+
+const char* const kStageNames[kADIS16470NumStages] = {"read", "check", "log", "decode", "tilt", "publish"};
+const char* const kCounterNames[kADIS16470NumPerfCounters] = {"task ns", "cycles", "instructions", "cache miss",
+                                                              "branch miss"};
+
+struct Case {
+  std::string name;
+  std::function<void(ADIS16470_IMU&)> configure;
+};
+
+struct Result {
+  std::string name;
+  ADIS16470PerfProfile profile;
+};
+
+Result Run(const Case& c, double seconds) {
+  auto sim_transport = std::make_unique<ADIS16470SimTransport>(1);
+  ADIS16470SimTransport& sim = *sim_transport;
+  sim.SetAngularRate(5.0, -3.0, 20.0);
+  sim.SetAcceleration(0.1, 0.0, 1.0);
+  // The bench thread sleeps on the virtual clock too
+  sim.AttachThread();
+
+  auto imu = std::make_unique<ADIS16470_IMU>(ADIS16470_IMU::kZ, std::move(sim_transport),
+                                             ADIS16470CalibrationTime::_32ms);
+  c.configure(*imu);
+  sim.Sleep(kSettle);
+  imu->EnablePerfProfiling();
+  sim.Sleep(seconds);
+  Result result;
+  result.name = c.name;
+  result.profile = imu->GetPerfProfile();
+  imu->DisablePerfProfiling();
+  // The destructor joins the acquisition thread, which must still see this thread on the clock
+  imu.reset();
+  return result;
+}
+
+std::vector<Case> MakeCases() {
+  auto wide = [](ADIS16470_IMU& imu) {
+    imu.ConfigHighResolution(0x3F);
+    imu.ConfigDiagStatRead(true);
+  };
+  std::vector<Case> cases;
+  cases.push_back({"default 400 Hz", [](ADIS16470_IMU&) {}});
+  cases.push_back({"32-bit + diag 400 Hz", wide});
+  cases.push_back({"32-bit + diag 2 kHz", [wide](ADIS16470_IMU& imu) {
+    wide(imu);
+    imu.ConfigDecRate(0);
+  }});
+  cases.push_back({"resampler + preint 400 Hz", [](ADIS16470_IMU& imu) {
+    imu.EnableResampler(400.0);
+    imu.EnablePreintegration();
+  }});
+  return cases;
+}
+
+void PrintTable(const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    const ADIS16470PerfProfile& p = r.profile;
+    std::printf("%s: %llu passes, %llu samples\n", r.name.c_str(), (unsigned long long)p.passes,
+                (unsigned long long)p.samples);
+    std::printf("  %-8s", "stage");
+    for (const char* name : kCounterNames) {
+      std::printf(" %12s", name);
+    }
+    std::printf("\n");
+    for (int s = 0; s < kADIS16470NumStages; s++) {
+      std::printf("  %-8s", kStageNames[s]);
+      for (int c = 0; c < kADIS16470NumPerfCounters; c++) {
+        if (p.available[c]) {
+          std::printf(" %12.1f", p.PerSample(static_cast<ADIS16470Stage>(s), static_cast<ADIS16470PerfCounter>(c)));
+        }
+        else {
+          std::printf(" %12s", "-");
+        }
+      }
+      std::printf("\n");
+    }
+  }
+}
+
+constexpr char kCsvHeader[] = "label,case,stage,samples,task_ns,cycles,instructions,cache_misses,branch_misses";
+
+void WriteCsvRows(std::FILE* f, const std::string& label, const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    const ADIS16470PerfProfile& p = r.profile;
+    for (int s = 0; s < kADIS16470NumStages; s++) {
+      std::fprintf(f, "%s,%s,%s,%llu", label.c_str(), r.name.c_str(), kStageNames[s], (unsigned long long)p.samples);
+      for (int c = 0; c < kADIS16470NumPerfCounters; c++) {
+        // Unavailable counters are left empty
+        if (p.available[c]) {
+          std::fprintf(f, ",%.2f", p.PerSample(static_cast<ADIS16470Stage>(s), static_cast<ADIS16470PerfCounter>(c)));
+        }
+        else {
+          std::fprintf(f, ",");
+        }
+      }
+      std::fprintf(f, "\n");
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ADIS16470BenchArgs args;
+  double seconds = 10.0;
+  const std::vector<ADIS16470BenchOption> options = {
+      {"--seconds", "s", [&](const char* value) { seconds = std::max(0.1, std::atof(value)); }},
+  };
+  if (!ADIS16470ParseBenchArgs(argc, argv, options, &args)) {
+    return 1;
+  }
+
+  HAL_Initialize(500, 0);
+
+  std::vector<Result> results;
+  for (const Case& c : MakeCases()) {
+    results.push_back(Run(c, seconds));
+  }
+
+  PrintTable(results);
+  return ADIS16470WriteBenchCsv(args, kCsvHeader, [&](std::FILE* f) { WriteCsvRows(f, args.label, results); });
+}
@@ -0,0 +1,474 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470preintbench - accuracy, covariance and query cost of ADIS16470Preintegrator.
+ *
+ * Usage: adis16470preintbench [--seconds s] [--runs n] [--csv results.csv] [--label name]
+ *
+ * A robot tumbling about all three axes while accelerating is sampled at 400 Hz (default 60 s,
+ * with timestamp jitter), the samples holding the period averages the IMU's decimation filter
+ * outputs. For windows of 20 ms, 33 ms and 1 s, starting at arbitrary times between samples, the
+ * bench reports:
+ *
+ *  - the rotation and delta velocity error against the motion integrated at 100 kHz,
+ *  - the largest difference between the covariance and the usual per-sample recursion,
+ *  - the mean normalized error squared (NEES, 6 if the covariance fits) over --runs noisy copies
+ *    of the stream (default 20), with noise at the datasheet densities,
+ *  - the cost of a query, next to recomputing the window from the samples with the recursion.
+ *
+ * The stream spans several restarts of the running totals, so some windows straddle one. With
+ * --csv, one row per window is appended to the given file, tagged with --label (for example a
+ * commit hash).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <adi/ADIS16470_Preintegrator.h>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kRadPerDeg = kPi / 180.0;
+
+constexpr double kRate = 400.0;
+
+/* Reference integration step (s) */
+constexpr double kTruthStep = 1e-5;
+
+/* Windows queried per length and noisy run */
+constexpr int kWindowsPerRun = 20;
+
+struct Window {
+  const char* name;
+  uint32_t length;
+};
+
+const Window kWindows[] = {{"20 ms (50 Hz)", 20000}, {"33 ms (30 Hz)", 33333}, {"1 s", 1000000}};
+
+struct Result {
+  const char* name = "";
+  int queries = 0;
+  double rotation_error = 0.0;
+  double velocity_error = 0.0;
+  double covariance_diff = 0.0;
+  double nees = 0.0;
+  int nees_count = 0;
+  double ns = 0.0;
+  double recompute_ns = 0.0;
+};
+
+/* Body rates (deg/s) and specific force (g) of the test motion */
+void Rates(double t, double* rate) {
+  rate[0] = 40.0 * std::sin(0.9 * t);
+  rate[1] = 30.0 * std::cos(0.6 * t + 1.0);
+  rate[2] = 120.0 * std::sin(0.35 * t);
+}
+
+void Force(double t, double* force) {
+  force[0] = 0.4 * std::sin(1.1 * t);
+  force[1] = 0.3 * std::cos(0.8 * t);
+  force[2] = 1.0 + 0.1 * std::sin(2.0 * t);
+}
+
+void QuatMultiply(const double* a, const double* b, double* out) {
+  double w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  double x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  double y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  double z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+  out[0] = w;
+  out[1] = x;
+  out[2] = y;
+  out[3] = z;
+}
+
+void QuatExp(const double* v, double* out) {
+  double angle = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  double k = angle < 1e-6 ? 0.5 : std::sin(0.5 * angle) / angle;
+  out[0] = std::cos(0.5 * angle);
+  out[1] = v[0] * k;
+  out[2] = v[1] * k;
+  out[3] = v[2] * k;
+}
+
+void QuatToMatrix(const double* q, double* r) {
+  double w = q[0], x = q[1], y = q[2], z = q[3];
+  r[0] = 1.0 - 2.0 * (y * y + z * z);
+  r[1] = 2.0 * (x * y - w * z);
+  r[2] = 2.0 * (x * z + w * y);
+  r[3] = 2.0 * (x * y + w * z);
+  r[4] = 1.0 - 2.0 * (x * x + z * z);
+  r[5] = 2.0 * (y * z - w * x);
+  r[6] = 2.0 * (x * z - w * y);
+  r[7] = 2.0 * (y * z + w * x);
+  r[8] = 1.0 - 2.0 * (x * x + y * y);
+}
+
+/* Rotation vector (rad) taking b to a, applied on the left: a = Exp(v) * b */
+void RotationError(const double* a, const double* b, double* v) {
+  double inverse[4] = {b[0], -b[1], -b[2], -b[3]};
+  double q[4];
+  QuatMultiply(a, inverse, q);
+  double sign = q[0] < 0.0 ? -1.0 : 1.0;
+  double s = std::sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  double k = s < 1e-12 ? 2.0 : 2.0 * std::atan2(s, sign * q[0]) / s;
+  for (int i = 0; i < 3; i++) {
+    v[i] = sign * q[i + 1] * k;
+  }
+}
+
+/* The sample stream: period averages of the motion at jittered timestamps, with noise if noise_seed isn't 0 */
+std::vector<ADIS16470Sample> MakeSamples(double seconds, uint32_t noise_seed) {
+  // The timestamps are the same for every noise seed
+  std::mt19937 rng(1);
+  std::mt19937 noise_rng(noise_seed);
+  std::uniform_int_distribution<int> jitter(-20, 20);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  const int count = int(seconds * kRate);
+  std::vector<ADIS16470Sample> samples(count);
+  uint32_t timestamp = 1000000;
+  samples[0].timestamp = timestamp;
+  for (int k = 1; k < count; k++) {
+    ADIS16470Sample& sample = samples[k];
+    uint32_t next = timestamp + 2500 + jitter(rng);
+    sample.timestamp = next;
+    sample.dt = (next - timestamp) * 1e-6;
+    double rate[3], force[3], sum_rate[3] = {}, sum_force[3] = {};
+    const int steps = 50;
+    for (int i = 0; i < steps; i++) {
+      double t = (timestamp + (i + 0.5) * (next - timestamp) / steps) * 1e-6;
+      Rates(t, rate);
+      Force(t, force);
+      for (int a = 0; a < 3; a++) {
+        sum_rate[a] += rate[a] / steps;
+        sum_force[a] += force[a] / steps;
+      }
+    }
+    if (noise_seed != 0) {
+      // Noise density over the sample period
+      const double scale = 1.0 / std::sqrt(sample.dt);
+      for (int a = 0; a < 3; a++) {
+        sum_rate[a] += normal(noise_rng) * ADIS16470Preintegrator::kDefaultGyroNoiseDensity * scale;
+        sum_force[a] += normal(noise_rng) * ADIS16470Preintegrator::kDefaultAccelNoiseDensity * scale;
+      }
+    }
+    sample.gyro_x = sum_rate[0];
+    sample.gyro_y = sum_rate[1];
+    sample.gyro_z = sum_rate[2];
+    sample.accel_x = sum_force[0];
+    sample.accel_y = sum_force[1];
+    sample.accel_z = sum_force[2];
+    sample.delta_angle = sum_rate[2] * sample.dt;
+    timestamp = next;
+  }
+  return samples;
+}
+
+/* A preintegrator with the driver's ring size, fed as far as the queries need */
+struct Stream {
+  explicit Stream(const std::vector<ADIS16470Sample>& samples) : samples(samples) {}
+
+  void AdvanceTo(uint32_t timestamp) {
+    while (next < samples.size() && (next == 0 || samples[next - 1].timestamp < timestamp)) {
+      preintegrator.Process(samples[next++], 2);
+    }
+  }
+
+  const std::vector<ADIS16470Sample>& samples;
+  ADIS16470Preintegrator preintegrator{4096};
+  size_t next = 0;
+};
+
+/* The motion between two timestamps, integrated finely from the continuous model */
+void Truth(uint32_t start, uint32_t end, double* rotation, double* velocity) {
+  double q[4] = {1.0, 0.0, 0.0, 0.0};
+  double v[3] = {};
+  const double t0 = start * 1e-6, t1 = end * 1e-6;
+  const int steps = std::max(1, int(std::ceil((t1 - t0) / kTruthStep)));
+  const double h = (t1 - t0) / steps;
+  for (int i = 0; i < steps; i++) {
+    double t = t0 + (i + 0.5) * h;
+    double rate[3], force[3], theta[3], step[4], mid[4], r[9];
+    Rates(t, rate);
+    Force(t, force);
+    for (int a = 0; a < 3; a++) {
+      theta[a] = 0.5 * rate[a] * kRadPerDeg * h;
+    }
+    QuatExp(theta, step);
+    QuatMultiply(q, step, mid);
+    QuatToMatrix(mid, r);
+    for (int a = 0; a < 3; a++) {
+      v[a] += (r[3 * a] * force[0] + r[3 * a + 1] * force[1] + r[3 * a + 2] * force[2]) * grav * h;
+    }
+    QuatMultiply(mid, step, q);
+  }
+  std::copy(q, q + 4, rotation);
+  std::copy(v, v + 3, velocity);
+}
+
+/**
+ * The window recomputed from the samples with the usual per-sample covariance recursion, which
+ * is what a query would cost without the prefix totals. Whole samples only, from the one after
+ * start to the one at or before end.
+ */
+void Recompute(const std::vector<ADIS16470Sample>& samples, uint32_t start, uint32_t end, double* covariance) {
+  const double gv = std::pow(ADIS16470Preintegrator::kDefaultGyroNoiseDensity * kRadPerDeg, 2);
+  const double av = std::pow(ADIS16470Preintegrator::kDefaultAccelNoiseDensity * grav, 2);
+  auto first = std::upper_bound(samples.begin(), samples.end(), start,
+                                [](uint32_t t, const ADIS16470Sample& s) { return t < s.timestamp; });
+  double q[4] = {1.0, 0.0, 0.0, 0.0};
+  double v[3] = {};
+  // Rotation, velocity and cross blocks of the covariance
+  double rr[9] = {}, vv[9] = {}, vr[9] = {};
+  for (auto it = first; it != samples.end() && it->timestamp <= end; ++it) {
+    const double dt = it->dt;
+    double theta[3] = {0.5 * it->gyro_x * kRadPerDeg * dt, 0.5 * it->gyro_y * kRadPerDeg * dt,
+                       0.5 * it->delta_angle * kRadPerDeg};
+    const double force[3] = {it->accel_x * grav * dt, it->accel_y * grav * dt, it->accel_z * grav * dt};
+    double step[4], mid[4], r[9], du[3];
+    QuatExp(theta, step);
+    QuatMultiply(q, step, mid);
+    QuatToMatrix(mid, r);
+    for (int a = 0; a < 3; a++) {
+      du[a] = r[3 * a] * force[0] + r[3 * a + 1] * force[1] + r[3 * a + 2] * force[2];
+      v[a] += du[a];
+    }
+    QuatMultiply(mid, step, q);
+
+    // dv error -= [du]x * rotation error, then this sample's noise
+    const double k[9] = {0.0, -du[2], du[1], du[2], 0.0, -du[0], -du[1], du[0], 0.0};
+    double k_rr[9], k_rv[9], new_vv[9], new_vr[9];
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        k_rr[3 * i + j] = k[3 * i] * rr[j] + k[3 * i + 1] * rr[3 + j] + k[3 * i + 2] * rr[6 + j];
+        // K * (vr)^T
+        k_rv[3 * i + j] = k[3 * i] * vr[3 * j] + k[3 * i + 1] * vr[3 * j + 1] + k[3 * i + 2] * vr[3 * j + 2];
+      }
+    }
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        double k_rr_k = k_rr[3 * i] * k[3 * j] + k_rr[3 * i + 1] * k[3 * j + 1] + k_rr[3 * i + 2] * k[3 * j + 2];
+        new_vv[3 * i + j] = vv[3 * i + j] - k_rv[3 * i + j] - k_rv[3 * j + i] + k_rr_k;
+        new_vr[3 * i + j] = vr[3 * i + j] - k_rr[3 * i + j];
+      }
+    }
+    std::copy(new_vv, new_vv + 9, vv);
+    std::copy(new_vr, new_vr + 9, vr);
+    for (int i = 0; i < 3; i++) {
+      rr[4 * i] += gv * dt;
+      vv[4 * i] += av * dt;
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      covariance[i * 6 + j] = rr[3 * i + j];
+      covariance[(3 + i) * 6 + 3 + j] = vv[3 * i + j];
+      covariance[(3 + i) * 6 + j] = vr[3 * i + j];
+      covariance[j * 6 + 3 + i] = vr[3 * i + j];
+    }
+  }
+}
+
+/* e^T * C^-1 * e for a 6x6 covariance, by Cholesky */
+double Nees(const double* c, const double* e) {
+  double l[36] = {};
+  for (int i = 0; i < 6; i++) {
+    for (int j = 0; j <= i; j++) {
+      double sum = c[i * 6 + j];
+      for (int k = 0; k < j; k++) {
+        sum -= l[i * 6 + k] * l[j * 6 + k];
+      }
+      l[i * 6 + j] = i == j ? std::sqrt(std::max(sum, 1e-300)) : sum / l[j * 6 + j];
+    }
+  }
+  double y[6], nees = 0.0;
+  for (int i = 0; i < 6; i++) {
+    double sum = e[i];
+    for (int k = 0; k < i; k++) {
+      sum -= l[i * 6 + k] * y[k];
+    }
+    y[i] = sum / l[i * 6 + i];
+    nees += y[i] * y[i];
+  }
+  return nees;
+}
+
+double Now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Sorted window start times between two timestamps, off the sample grid */
+std::vector<uint32_t> MakeStarts(uint32_t first, uint32_t last, int count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32_t> start(first, last);
+  std::vector<uint32_t> starts(count);
+  for (auto& s : starts) {
+    s = start(rng);
+  }
+  std::sort(starts.begin(), starts.end());
+  return starts;
+}
+
+/* Last sample at or before a timestamp */
+uint32_t SampleBefore(const std::vector<ADIS16470Sample>& samples, uint32_t timestamp) {
+  auto it = std::upper_bound(samples.begin(), samples.end(), timestamp,
+                             [](uint32_t t, const ADIS16470Sample& s) { return t < s.timestamp; });
+  return (it - 1)->timestamp;
+}
+
+void Measure(const std::vector<ADIS16470Sample>& samples, const Window& window, int runs, double seconds,
+             Result* result) {
+  result->name = window.name;
+  const uint32_t first = samples.front().timestamp;
+  const uint32_t last = samples.back().timestamp - window.length;
+
+  // Accuracy, and the covariance against the recursion, querying each window as soon as it is complete
+  Stream clean(samples);
+  for (uint32_t start : MakeStarts(first, last, 200, 7)) {
+    const uint32_t end = start + window.length;
+    clean.AdvanceTo(end);
+    ADIS16470Preintegration p;
+    if (!clean.preintegrator.Get(start, end, &p)) {
+      continue;
+    }
+    double rotation[4], velocity[3], error[3];
+    Truth(start, end, rotation, velocity);
+    RotationError(p.rotation, rotation, error);
+    result->rotation_error = std::max(result->rotation_error,
+                                      std::sqrt(error[0] * error[0] + error[1] * error[1] + error[2] * error[2]) / kRadPerDeg);
+    for (int a = 0; a < 3; a++) {
+      result->velocity_error = std::max(result->velocity_error, std::fabs(p.delta_velocity[a] - velocity[a]));
+    }
+    result->queries++;
+
+    // The recursion covers whole samples, so compare over those (the query interpolates the ends)
+    ADIS16470Preintegration whole;
+    double recursion[36];
+    const uint32_t whole_start = SampleBefore(samples, start);
+    const uint32_t whole_end = SampleBefore(samples, end);
+    clean.preintegrator.Get(whole_start, whole_end, &whole);
+    Recompute(samples, whole_start, whole_end, recursion);
+    double norm = 0.0, diff = 0.0;
+    for (int i = 0; i < 36; i++) {
+      norm += recursion[i] * recursion[i];
+      diff += (whole.covariance[i] - recursion[i]) * (whole.covariance[i] - recursion[i]);
+    }
+    result->covariance_diff = std::max(result->covariance_diff, std::sqrt(diff / norm));
+  }
+
+  // Query cost against recomputing, over windows still in the ring at the end of the stream
+  clean.AdvanceTo(samples.back().timestamp);
+  uint32_t oldest, latest;
+  clean.preintegrator.GetRange(&oldest, &latest);
+  const std::vector<uint32_t> starts = MakeStarts(std::max(oldest, latest - 9000000), latest - window.length, 200, 9);
+  double sink = 0.0;
+  double begin = Now();
+  for (int pass = 0; pass < 10; pass++) {
+    for (uint32_t start : starts) {
+      ADIS16470Preintegration p;
+      clean.preintegrator.Get(start, start + window.length, &p);
+      sink += p.covariance[21];
+    }
+  }
+  result->ns = (Now() - begin) / (10.0 * starts.size());
+  begin = Now();
+  for (uint32_t start : starts) {
+    double covariance[36];
+    Recompute(samples, start, start + window.length, covariance);
+    sink += covariance[21];
+  }
+  result->recompute_ns = (Now() - begin) / starts.size();
+  if (std::isnan(sink)) {
+    std::printf("NaN covariance\n");
+  }
+
+  // NEES of noisy copies of the stream against the clean one at the same timestamps
+  for (int run = 0; run < runs; run++) {
+    const std::vector<ADIS16470Sample> noisy_samples = MakeSamples(seconds, 100 + run);
+    Stream noisy(noisy_samples);
+    Stream reference(samples);
+    for (uint32_t start : MakeStarts(first, last, kWindowsPerRun, 1000 + run)) {
+      const uint32_t end = start + window.length;
+      noisy.AdvanceTo(end);
+      reference.AdvanceTo(end);
+      ADIS16470Preintegration p, r;
+      if (!noisy.preintegrator.Get(start, end, &p) || !reference.preintegrator.Get(start, end, &r)) {
+        continue;
+      }
+      double e[6];
+      RotationError(p.rotation, r.rotation, e);
+      for (int a = 0; a < 3; a++) {
+        e[3 + a] = p.delta_velocity[a] - r.delta_velocity[a];
+      }
+      result->nees += Nees(r.covariance, e);
+      result->nees_count++;
+    }
+  }
+}
+
+void PrintTable(const std::vector<Result>& results) {
+  std::printf("%-14s %8s %12s %12s %10s %7s %10s %13s\n", "window", "queries", "rot err deg",
+              "dv err mm/s", "cov diff", "NEES", "ns/query", "recompute ns");
+  for (const auto& r : results) {
+    std::printf("%-14s %8d %12.5f %12.4f %9.2f%% %7.2f %10.0f %13.0f\n", r.name, r.queries, r.rotation_error,
+                r.velocity_error * 1000.0, r.covariance_diff * 100.0, r.nees_count ? r.nees / r.nees_count : 0.0,
+                r.ns, r.recompute_ns);
+  }
+}
+
+constexpr char kCsvHeader[] =
+    "label,window,queries,rotation_err_deg,dv_err_mps,cov_diff,nees,ns_per_query,recompute_ns";
+
+void WriteCsvRows(std::FILE* f, const std::string& label, const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    std::fprintf(f, "%s,%s,%d,%.6f,%.6f,%.5f,%.3f,%.1f,%.1f\n", label.c_str(), r.name, r.queries, r.rotation_error,
+                 r.velocity_error, r.covariance_diff, r.nees_count ? r.nees / r.nees_count : 0.0, r.ns,
+                 r.recompute_ns);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ADIS16470BenchArgs args;
+  double seconds = 60.0;
+  int runs = 20;
+  const std::vector<ADIS16470BenchOption> options = {
+      {"--seconds", "s", [&](const char* value) { seconds = std::max(2.0, std::atof(value)); }},
+      {"--runs", "n", [&](const char* value) { runs = std::max(0, std::atoi(value)); }},
+  };
+  if (!ADIS16470ParseBenchArgs(argc, argv, options, &args)) {
+    return 1;
+  }
+
+  const std::vector<ADIS16470Sample> samples = MakeSamples(seconds, 0);
+
+  std::vector<Result> results;
+  for (const Window& window : kWindows) {
+    Result result;
+    Measure(samples, window, runs, seconds, &result);
+    results.push_back(result);
+  }
+
+  PrintTable(results);
+  return ADIS16470WriteBenchCsv(args, kCsvHeader, [&](std::FILE* f) { WriteCsvRows(f, args.label, results); });
+}
@@ -0,0 +1,225 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470profilebench - per-sample cost and memory of the driver's build profiles.
+ *
+ * Usage: adis16470profilebench [--frames n] [--csv results.csv] [--label name]
+ *
+ * Builds a synthetic 400 Hz frame stream (default 100000 frames) and runs it through the
+ * acquisition loop's per-sample stages (ADIS16470_Profile.h) once for every profile: decode,
+ * complementary filter, angle integration, noise statistics and the latest-output stores, with a
+ * sample ring of the profile's size. The best of five passes is reported as nanoseconds and, on
+ * x86, TSC cycles per sample, next to the storage the profile allocates. The integrated angle is
+ * printed as well and must match across profiles. With --csv, one row per profile is appended to
+ * the given file, tagged with --label (for example a commit hash).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ADIS16470_HAVE_TSC 1
+#endif
+
+#include <adi/ADIS16470_Profile.h>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+namespace {
+
+constexpr double kRate = 400.0;
+
+/* Frames drained per acquisition pass at 400 Hz and a 10 ms poll */
+constexpr int kFramesPerPass = 4;
+
+constexpr int kPasses = 5;
+
+struct Result {
+  const char* name = "";
+  double ns = 0.0;
+  double cycles = 0.0;
+  size_t footprint = 0;
+  double angle = 0.0;
+};
+
+void PutRegister(uint32_t* words, double value) {
+  int16_t reg = int16_t(std::lround(std::min(std::max(value, -32768.0), 32767.0)));
+  words[0] = (uint16_t(reg) >> 8) & 0xff;
+  words[1] = uint16_t(reg) & 0xff;
+}
+
+/* A robot turning and bumping around: slow sinusoids plus sensor noise, in the classic 19 word frame */
+std::vector<uint32_t> MakeFrames(const ADIS16470FrameLayout& layout, int count) {
+  std::mt19937 rng(1);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::vector<uint32_t> words(size_t(count) * layout.frame_len, 0);
+  for (int i = 0; i < count; i++) {
+    uint32_t* frame = &words[size_t(i) * layout.frame_len];
+    double t = i / kRate;
+    double rate = 90.0 * std::sin(0.5 * t);
+    frame[0] = uint32_t(std::llround((i + 1) * 1000000.0 / kRate));
+    int32_t deltang = int32_t(std::lround(rate / kRate / delta_angle_sf));
+    for (int b = 0; b < 4; b++) {
+      frame[3 + b] = (uint32_t(deltang) >> (24 - 8 * b)) & 0xff;
+    }
+    const double channels[kADIS16470NumChannels] = {
+      5.0 * std::sin(1.3 * t) + 0.1 * noise(rng), 5.0 * std::cos(1.1 * t) + 0.1 * noise(rng), rate + 0.1 * noise(rng),
+      0.2 * std::sin(0.7 * t) + 0.003 * noise(rng), 0.1 * std::cos(0.9 * t) + 0.003 * noise(rng),
+      1.0 + 0.003 * noise(rng)
+    };
+    for (int c = 0; c < kADIS16470NumChannels; c++) {
+      PutRegister(&frame[layout.channel_index[c]], channels[c] / (c < 3 ? 0.1 : 1.0 / 800.0));
+    }
+  }
+  return words;
+}
+
+double Now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+uint64_t Cycles() {
+#ifdef ADIS16470_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/* Driver state the per-sample stages touch, sized by the profile */
+template <class Profile>
+struct State {
+  std::vector<ADIS16470Sample> ring = std::vector<ADIS16470Sample>(Profile::kHistoryFrames);
+  ADIS16470ComplementaryFilter comp_filter;
+  ADIS16470WelfordStats welford[kADIS16470NumChannels];
+  ADIS16470AllanDeviation allan[kADIS16470NumChannels];
+  double angle = 0.0;
+  // Latest outputs, stored once per pass like the driver's members
+  double gyro[3] = {};
+  double accel[3] = {};
+  double tilt[4] = {};
+};
+
+/* The acquisition loop's per-sample work for one profile, in the driver's order */
+template <class Profile>
+void RunStream(const std::vector<uint32_t>& words, const ADIS16470FrameLayout& layout, State<Profile>& state) {
+  const int frames = int(words.size() / layout.frame_len);
+  const double period = 1000000.0 / kRate;
+  uint32_t previous_timestamp = words[0] - uint32_t(period);
+  for (int first = 0; first < frames; first += kFramesPerPass) {
+    const int end = std::min(first + kFramesPerPass, frames);
+    for (int i = first; i < end; i++) {
+      const uint32_t* frame = &words[size_t(i) * layout.frame_len];
+      ADIS16470Sample& sample = state.ring[i % Profile::kHistoryFrames];
+      ADIS16470DecodeProfileFrame<Profile>(frame, layout, previous_timestamp, period, ADIS16470Channel::kGyroZ, &sample);
+      previous_timestamp = frame[0];
+      ADIS16470UpdateTilt<Profile>(state.comp_filter, sample);
+    }
+    for (int i = first; i < end; i++) {
+      ADIS16470Sample& sample = state.ring[i % Profile::kHistoryFrames];
+      state.angle += sample.delta_angle;
+      sample.angle = state.angle;
+      ADIS16470UpdateNoiseStats<Profile>(sample, state.welford, state.allan);
+    }
+    const ADIS16470Sample& latest = state.ring[(end - 1) % Profile::kHistoryFrames];
+    state.gyro[0] = latest.gyro_x;
+    state.gyro[1] = latest.gyro_y;
+    state.gyro[2] = latest.gyro_z;
+    if constexpr (Profile::kAllChannels) {
+      state.accel[0] = latest.accel_x;
+      state.accel[1] = latest.accel_y;
+      state.accel[2] = latest.accel_z;
+    }
+    if constexpr (Profile::kTilt) {
+      state.tilt[0] = state.comp_filter.GetCompAngleX() * rad_to_deg;
+      state.tilt[1] = state.comp_filter.GetCompAngleY() * rad_to_deg;
+      state.tilt[2] = state.comp_filter.GetAccelAngleX() * rad_to_deg;
+      state.tilt[3] = state.comp_filter.GetAccelAngleY() * rad_to_deg;
+    }
+  }
+}
+
+template <class Profile>
+Result Measure(const std::vector<uint32_t>& words, const ADIS16470FrameLayout& layout) {
+  Result result;
+  result.name = Profile::kName;
+  result.footprint = ADIS16470ProfileFootprint<Profile>();
+  const double frames = double(words.size() / layout.frame_len);
+  for (int pass = 0; pass < kPasses; pass++) {
+    // Fresh state every pass, so each one does the same work
+    auto state = std::make_unique<State<Profile>>();
+    double start = Now();
+    uint64_t start_cycles = Cycles();
+    RunStream(words, layout, *state);
+    double ns = (Now() - start) / frames;
+    double cycles = double(Cycles() - start_cycles) / frames;
+    if (pass == 0 || ns < result.ns) {
+      result.ns = ns;
+      result.cycles = cycles;
+    }
+    result.angle = state->angle;
+  }
+  return result;
+}
+
+void PrintTable(const std::vector<Result>& results) {
+  std::printf("%-14s %10s %14s %14s %14s\n", "profile", "ns/sample", "cycles/sample", "footprint KiB", "angle deg");
+  for (const auto& r : results) {
+    char cycles[32] = "-";
+#ifdef ADIS16470_HAVE_TSC
+    std::snprintf(cycles, sizeof(cycles), "%.0f", r.cycles);
+#endif
+    std::printf("%-14s %10.1f %14s %14.1f %14.4f\n", r.name, r.ns, cycles, r.footprint / 1024.0, r.angle);
+  }
+}
+
+constexpr char kCsvHeader[] = "label,profile,ns_per_sample,cycles_per_sample,footprint_bytes,angle_deg";
+
+void WriteCsvRows(std::FILE* f, const std::string& label, const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    std::fprintf(f, "%s,%s,%.2f,%.0f,%zu,%.6f\n", label.c_str(), r.name, r.ns, r.cycles, r.footprint, r.angle);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ADIS16470BenchArgs args;
+  int frames = 100000;
+  const std::vector<ADIS16470BenchOption> options = {
+      {"--frames", "n", [&](const char* value) { frames = std::max(kFramesPerPass, std::atoi(value)); }},
+  };
+  if (!ADIS16470ParseBenchArgs(argc, argv, options, &args)) {
+    return 1;
+  }
+
+  const ADIS16470FrameLayout layout = ADIS16470MakeFrameLayout(2, 0);
+  const std::vector<uint32_t> words = MakeFrames(layout, frames);
+
+  std::vector<Result> results;
+  results.push_back(Measure<ADIS16470FullProfile>(words, layout));
+  results.push_back(Measure<ADIS16470NoTelemetryProfile>(words, layout));
+  results.push_back(Measure<ADIS16470YawOnlyProfile>(words, layout));
+
+  PrintTable(results);
+  return ADIS16470WriteBenchCsv(args, kCsvHeader, [&](std::FILE* f) { WriteCsvRows(f, args.label, results); });
+}
@@ -0,0 +1,160 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470reconfigbench - startup and mode switch latency of the ADIS16470 driver.
+ *
+ * Usage: adis16470reconfigbench [--csv results.csv] [--label name]
+ *
+ * The driver is run against ADIS16470SimTransport, so every number comes from the simulated
+ * FPGA clock and is the same on every run and every machine. For the constructor and each
+ * configuration call the bench reports how long the call blocked, the time until the first new
+ * sample was processed, the gap in the sample stream, and the frames lost in that gap. With
+ * --csv, one row per case is appended to the given file, tagged with --label (for example a
+ * commit hash), so results can be tracked over time.
+ */
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <adi/ADIS16470_IMU.h>
+#include <adi/ADIS16470_SimTransport.h>
+#include <hal/HAL.h>
+
+#include "ADIS16470_BenchCommon.h"
+
+using namespace frc;
+
+namespace {
+
+struct Result {
+  std::string name;
+  double call_time = 0.0;
+  ADIS16470ReconfigStats stats;
+  // Data ready edges the FPGA never captured (auto SPI stopped)
+  uint64_t missed = 0;
+};
+
+/* Give up on a case if no sample arrives within this much simulated time (s) */
+constexpr double kTimeout = 5.0;
+
+/* Lets the simulated clock run until the last configuration call has produced a sample */
+bool WaitForFirstSample(ADIS16470_IMU& imu, ADIS16470SimTransport& sim) {
+  double deadline = sim.GetVirtualTime() + kTimeout;
+  while (!imu.GetLastReconfigStats().complete) {
+    if (sim.GetVirtualTime() > deadline) {
+      return false;
+    }
+    sim.Sleep(0.001);
+  }
+  return true;
+}
+
+/* Runs a configuration call (which may construct the driver) and waits for the first sample after it */
+Result Measure(const std::string& name, std::unique_ptr<ADIS16470_IMU>& imu, ADIS16470SimTransport& sim,
+               const std::function<void()>& call) {
+  Result result;
+  result.name = name;
+  uint64_t missed = sim.GetStats().frames_missed;
+  double start = sim.GetVirtualTime();
+  call();
+  result.call_time = sim.GetVirtualTime() - start;
+  if (!WaitForFirstSample(*imu, sim)) {
+    std::fprintf(stderr, "%s: no sample after %.1f s\n", name.c_str(), kTimeout);
+  }
+  result.stats = imu->GetLastReconfigStats();
+  result.missed = sim.GetStats().frames_missed - missed;
+  // Settle between cases so every call starts from a steady sample stream
+  sim.Sleep(0.1);
+  return result;
+}
+
+/* Times the constructor on a fresh simulated IMU. With run_configs set, also times every configuration call. */
+void RunCase(ADIS16470CalibrationTime cal_time, ADIS16470StartupMode startup, const std::string& label,
+             bool run_configs, std::vector<Result>& results) {
+  auto transport = std::make_unique<ADIS16470SimTransport>();
+  ADIS16470SimTransport& sim = *transport;
+  sim.SetGyroBias(0.2, -0.1, 0.3);
+  sim.SetGyroNoise(0.1);
+  sim.SetAccelNoise(0.002);
+  // The bench thread sleeps on the virtual clock too
+  sim.AttachThread();
+
+  std::unique_ptr<ADIS16470_IMU> imu;
+  results.push_back(Measure("Constructor (" + label + ")", imu, sim, [&] {
+    imu = std::make_unique<ADIS16470_IMU>(ADIS16470_IMU::kZ, std::move(transport), cal_time, startup);
+  }));
+  if (run_configs) {
+    results.push_back(Measure("ConfigCalTime(_1s)", imu, sim, [&] {
+      imu->ConfigCalTime(ADIS16470CalibrationTime::_1s);
+    }));
+    results.push_back(Measure("ConfigDecRate(9)", imu, sim, [&] { imu->ConfigDecRate(9); }));
+    results.push_back(Measure("ConfigDecRate(4)", imu, sim, [&] { imu->ConfigDecRate(4); }));
+    results.push_back(Measure("Calibrate()", imu, sim, [&] { imu->Calibrate(); }));
+    results.push_back(Measure("SetYawAxis(kX)", imu, sim, [&] { imu->SetYawAxis(ADIS16470_IMU::kX); }));
+    results.push_back(Measure("SetYawAxis(kZ)", imu, sim, [&] { imu->SetYawAxis(ADIS16470_IMU::kZ); }));
+    results.push_back(Measure("ConfigFilter(2)", imu, sim, [&] { imu->ConfigFilter(2); }));
+    // The same three changes as separate calls would take three pauses
+    results.push_back(Measure("Configure(dec 9, filter 0, kX)", imu, sim, [&] {
+      ADIS16470Config config;
+      config.dec_rate = 9;
+      config.filter = 0;
+      config.yaw_axis = ADIS16470_IMU::kX;
+      imu->Configure(config);
+    }));
+  }
+  // The destructor joins the acquisition thread, which must still see this thread on the clock
+  imu.reset();
+}
+
+void PrintTable(const std::vector<Result>& results) {
+  std::printf("%-32s %10s %10s %12s %8s %8s\n",
+              "case", "call ms", "ttfs ms", "blackout ms", "lost", "missed");
+  for (const auto& r : results) {
+    std::printf("%-32s %10.2f %10.2f %12.2f %8llu %8llu%s\n",
+                r.name.c_str(), r.call_time * 1000.0, r.stats.time_to_first_sample * 1000.0,
+                r.stats.blackout * 1000.0, (unsigned long long)r.stats.lost_frames,
+                (unsigned long long)r.missed, r.stats.complete ? "" : "  (timeout)");
+  }
+}
+
+constexpr char kCsvHeader[] = "label,case,call_ms,ttfs_ms,blackout_ms,lost_frames,missed_frames,complete";
+
+void WriteCsvRows(std::FILE* f, const std::string& label, const std::vector<Result>& results) {
+  for (const auto& r : results) {
+    std::fprintf(f, "%s,%s,%.3f,%.3f,%.3f,%llu,%llu,%d\n",
+                 label.c_str(), r.name.c_str(), r.call_time * 1000.0, r.stats.time_to_first_sample * 1000.0,
+                 r.stats.blackout * 1000.0, (unsigned long long)r.stats.lost_frames,
+                 (unsigned long long)r.missed, r.stats.complete ? 1 : 0);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ADIS16470BenchArgs args;
+  if (!ADIS16470ParseBenchArgs(argc, argv, {}, &args)) {
+    return 1;
+  }
+
+  HAL_Initialize(500, 0);
+
+  std::vector<Result> results;
+  const auto wait = ADIS16470StartupMode::kWaitForCalibration;
+  RunCase(ADIS16470CalibrationTime::_32ms, wait, "_32ms", false, results);
+  RunCase(ADIS16470CalibrationTime::_1s, wait, "_1s", false, results);
+  RunCase(ADIS16470CalibrationTime::_4s, ADIS16470StartupMode::kStreamFirst, "_4s, stream first", false, results);
+  RunCase(ADIS16470CalibrationTime::_4s, wait, "_4s", true, results);
+
+  PrintTable(results);
+  return ADIS16470WriteBenchCsv(args, kCsvHeader, [&](std::FILE* f) { WriteCsvRows(f, args.label, results); });
+}
@@ -0,0 +1,188 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <random>
+
+#include <adi/ADIS16470_BiasEstimator.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+/* 400 Hz */
+constexpr double kDt = 0.0025;
+
+/* Simulated gyro at rest: a bias per axis plus white noise, with the yaw delta angle on Z */
+class Gyro {
+ public:
+  Gyro(double x, double y, double z, double noise) : m_bias{x, y, z}, m_noise(0.0, noise) {}
+
+  ADIS16470Sample Next() {
+    ADIS16470Sample sample;
+    sample.dt = kDt;
+    sample.gyro_x = m_bias[0] + m_noise(m_rng);
+    sample.gyro_y = m_bias[1] + m_noise(m_rng);
+    sample.gyro_z = m_bias[2] + m_noise(m_rng);
+    sample.delta_angle = sample.gyro_z * kDt;
+    return sample;
+  }
+
+  /* Moves the bias, as a robot starting to turn would */
+  void Set(double x, double y, double z) {
+    m_bias[0] = x;
+    m_bias[1] = y;
+    m_bias[2] = z;
+  }
+
+ private:
+  double m_bias[3];
+  std::mt19937 m_rng{3};
+  std::normal_distribution<double> m_noise;
+};
+
+/* Feeds samples until the estimate converges. Returns the number fed, or -1 if it doesn't within max_samples. */
+int RunToConvergence(ADIS16470BiasEstimator& estimator, Gyro& gyro, int max_samples) {
+  for (int i = 1; i <= max_samples; i++) {
+    if (estimator.Update(gyro.Next())) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+TEST(BiasEstimatorTest, QuietGyroConvergesAtTheTarget) {
+  ADIS16470BiasEstimator estimator;
+  estimator.Configure(0.01, 2.0, 4.0);
+  estimator.Reset();
+  Gyro gyro(0.3, -0.2, 0.1, 0.1);
+
+  // sigma / sqrt(n) reaches 0.01 after about 100 samples
+  int samples = RunToConvergence(estimator, gyro, 1600);
+  ASSERT_GT(samples, 0);
+  EXPECT_LT(samples, 200);
+  const ADIS16470HostBias& bias = estimator.GetBias();
+  EXPECT_TRUE(bias.converged);
+  EXPECT_FALSE(bias.timed_out);
+  EXPECT_EQ(0, bias.restarts);
+  EXPECT_EQ(static_cast<uint64_t>(samples), bias.samples);
+  EXPECT_NEAR(samples * kDt, bias.time, 1e-9);
+  EXPECT_LE(bias.std_error, 0.01);
+  EXPECT_NEAR(0.3, bias.gyro_x, 0.03);
+  EXPECT_NEAR(-0.2, bias.gyro_y, 0.03);
+  EXPECT_NEAR(0.1, bias.gyro_z, 0.03);
+  EXPECT_DOUBLE_EQ(bias.gyro_z, bias.yaw);
+
+  // Later samples leave the estimate alone
+  EXPECT_FALSE(estimator.Update(gyro.Next()));
+  EXPECT_EQ(static_cast<uint64_t>(samples), estimator.GetBias().samples);
+}
+
+TEST(BiasEstimatorTest, SampleWithoutTimeStepIsIgnored) {
+  ADIS16470BiasEstimator estimator;
+  estimator.Reset();
+  ADIS16470Sample sample;
+  sample.gyro_z = 100.0;
+  EXPECT_FALSE(estimator.Update(sample));
+  EXPECT_EQ(0u, estimator.GetBias().samples);
+}
+
+TEST(BiasEstimatorTest, YawBiasComesFromTheDeltaAngle) {
+  ADIS16470BiasEstimator estimator;
+  estimator.Configure(0.01, 2.0, 4.0);
+  estimator.Reset();
+  for (int i = 0; i < 100; i++) {
+    ADIS16470Sample sample;
+    sample.dt = kDt;
+    sample.gyro_z = 0.1;
+    // The 32-bit delta angle resolves what the 16-bit rate rounds away
+    sample.delta_angle = 0.1234 * kDt;
+    estimator.Update(sample);
+  }
+  ASSERT_TRUE(estimator.IsConverged());
+  EXPECT_DOUBLE_EQ(0.1, estimator.GetBias().gyro_z);
+  EXPECT_NEAR(0.1234, estimator.GetBias().yaw, 1e-12);
+}
+
+TEST(BiasEstimatorTest, MotionRestartsTheEstimate) {
+  ADIS16470BiasEstimator estimator;
+  // A target this tight is never reached, so only motion or the time limit end the estimate
+  estimator.Configure(1e-6, 2.0, 100.0);
+  estimator.Reset();
+  Gyro gyro(0.3, -0.2, 0.1, 0.1);
+  for (int i = 0; i < 200; i++) {
+    ASSERT_FALSE(estimator.Update(gyro.Next()));
+  }
+  EXPECT_EQ(0, estimator.GetBias().restarts);
+  EXPECT_EQ(200u, estimator.GetBias().samples);
+
+  // The robot turns at 10 deg/s: the first sample off the mean starts the estimate over from it
+  gyro.Set(0.3, -0.2, 10.0);
+  estimator.Update(gyro.Next());
+  EXPECT_EQ(1, estimator.GetBias().restarts);
+  EXPECT_EQ(1u, estimator.GetBias().samples);
+  EXPECT_NEAR(kDt, estimator.GetBias().time, 1e-12);
+
+  // Motion isn't checked until the new mean has kMinSamples behind it, then the estimate follows the turn
+  for (uint64_t i = 1; i < 2 * ADIS16470BiasEstimator::kMinSamples; i++) {
+    estimator.Update(gyro.Next());
+  }
+  EXPECT_EQ(1, estimator.GetBias().restarts);
+  EXPECT_NEAR(10.0, estimator.GetBias().gyro_z, 0.05);
+
+  // A 1 deg/s step, inside the 2 deg/s threshold, is not motion
+  gyro.Set(0.3, -0.2, 11.0);
+  for (int i = 0; i < 100; i++) {
+    estimator.Update(gyro.Next());
+  }
+  EXPECT_EQ(1, estimator.GetBias().restarts);
+
+  // Reset() clears the restart count along with the estimate
+  estimator.Reset();
+  EXPECT_EQ(0, estimator.GetBias().restarts);
+  EXPECT_EQ(0u, estimator.GetBias().samples);
+}
+
+TEST(BiasEstimatorTest, TimeLimitAcceptsTheCurrentEstimate) {
+  ADIS16470BiasEstimator estimator;
+  estimator.Configure(1e-6, 2.0, 1.0);
+  estimator.Reset();
+  Gyro gyro(0.3, -0.2, 0.1, 0.1);
+
+  // Converges on the sample that reaches one second (give or take rounding in the summed time steps)
+  EXPECT_NEAR(400, RunToConvergence(estimator, gyro, 1600), 1);
+  const ADIS16470HostBias& bias = estimator.GetBias();
+  EXPECT_TRUE(bias.converged);
+  EXPECT_TRUE(bias.timed_out);
+  EXPECT_GT(bias.std_error, 1e-6);
+  EXPECT_NEAR(0.3, bias.gyro_x, 0.02);
+  EXPECT_NEAR(0.1, bias.yaw, 0.02);
+}
+
+TEST(BiasEstimatorTest, TimeLimitCountsTimeBeforeARestart) {
+  ADIS16470BiasEstimator estimator;
+  estimator.Configure(1e-6, 2.0, 1.0);
+  estimator.Reset();
+  Gyro gyro(0.0, 0.0, 0.0, 0.1);
+  for (int i = 0; i < 390; i++) {
+    estimator.Update(gyro.Next());
+  }
+  gyro.Set(0.0, 0.0, 5.0);
+
+  // The time limit runs from Reset(), not from the restart, so it is up 25 ms later. The estimate
+  // still needs kMinSamples after the restart.
+  int samples = RunToConvergence(estimator, gyro, 1600);
+  EXPECT_EQ(static_cast<int>(ADIS16470BiasEstimator::kMinSamples), samples);
+  EXPECT_TRUE(estimator.GetBias().timed_out);
+  EXPECT_EQ(1, estimator.GetBias().restarts);
+  EXPECT_NEAR(5.0, estimator.GetBias().gyro_z, 0.05);
+}
@@ -0,0 +1,237 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <adi/ADIS16470_BlackBox.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+constexpr int kPreFrames = 4;
+constexpr int kPostFrames = 3;
+constexpr uint32_t kCauses = kADIS16470TriggerUser | kADIS16470TriggerAccel;
+constexpr uint32_t kTriggerTimestamp = 123456;
+constexpr uint64_t kTriggerTime = 450;
+
+struct Record {
+  uint16_t type;
+  uint16_t flags;
+  uint64_t host_time;
+  std::vector<uint32_t> words;
+};
+
+/* Reads a whole raw log back. The header's frame length goes to *frame_len. */
+std::vector<Record> ReadLog(const std::string& path, uint32_t* frame_len) {
+  std::vector<Record> records;
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    ADD_FAILURE() << "no capture at " << path;
+    return records;
+  }
+  ADIS16470LogHeader header;
+  EXPECT_EQ(1u, std::fread(&header, sizeof(header), 1, file));
+  EXPECT_EQ(0, std::memcmp(header.magic, kADIS16470LogMagic, sizeof(header.magic)));
+  EXPECT_EQ(kADIS16470LogVersion, header.version);
+  *frame_len = header.frame_len;
+  ADIS16470LogRecord record;
+  while (std::fread(&record, sizeof(record), 1, file) == 1) {
+    Record r{record.type, record.flags, record.host_time, std::vector<uint32_t>(record.word_count)};
+    EXPECT_EQ(record.word_count, std::fread(r.words.data(), sizeof(uint32_t), record.word_count, file));
+    records.push_back(r);
+  }
+  std::fclose(file);
+  return records;
+}
+
+class BlackBoxTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_prefix = ::testing::TempDir() + "adis16470_blackbox_" +
+               ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::remove(Path(0).c_str());
+    m_box.Open(m_prefix, kPreFrames, kPostFrames);
+  }
+
+  void TearDown() override {
+    m_box.Close();
+    std::remove(Path(0).c_str());
+  }
+
+  std::string Path(int index) const {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "-%03d.adislog", index);
+    return m_prefix + suffix;
+  }
+
+  /* Starts a frame layout of frame_len words, with a config record of one word holding frame_len */
+  void Reset(int frame_len) {
+    m_frame_len = frame_len;
+    const uint32_t config[1] = {static_cast<uint32_t>(frame_len)};
+    m_box.Reset(frame_len, config, 1);
+  }
+
+  /* Appends one acquisition pass of frames. Frame n holds n * 100 + word index. */
+  void Pass(int frames, uint64_t read_time, uint16_t flags = 0) {
+    std::vector<uint32_t> words;
+    for (int f = 0; f < frames; f++) {
+      for (int i = 0; i < m_frame_len; i++) {
+        words.push_back(m_next_frame * 100 + i);
+      }
+      m_next_frame++;
+    }
+    m_box.Append(words.data(), frames, read_time, flags);
+  }
+
+  /* Words of frames first .. last - 1 as written by Pass() */
+  std::vector<uint32_t> Frames(uint32_t first, uint32_t last) const {
+    std::vector<uint32_t> words;
+    for (uint32_t f = first; f < last; f++) {
+      for (int i = 0; i < m_frame_len; i++) {
+        words.push_back(f * 100 + i);
+      }
+    }
+    return words;
+  }
+
+  ADIS16470BlackBox m_box;
+  std::string m_prefix;
+  int m_frame_len = 2;
+  uint32_t m_next_frame = 0;
+};
+
+}  // namespace
+
+TEST_F(BlackBoxTest, PreAndPostTriggerWindows) {
+  Reset(2);
+  // Eight frames in passes of two: only the last kPreFrames make it into the capture
+  for (int p = 0; p < 4; p++) {
+    Pass(2, 100 * (p + 1));
+  }
+  m_box.Trigger(kCauses, kTriggerTimestamp, kTriggerTime);
+  EXPECT_TRUE(m_box.GetStats().capturing);
+  Pass(2, 500, kADIS16470LogOverrun);
+  EXPECT_TRUE(m_box.GetStats().capturing);
+  Pass(1, 600);
+  EXPECT_FALSE(m_box.GetStats().capturing);
+  m_box.Close();
+
+  ADIS16470BlackBoxStats stats = m_box.GetStats();
+  EXPECT_EQ(1u, stats.captures_written);
+  EXPECT_EQ(0u, stats.captures_dropped);
+  EXPECT_EQ(Path(0), stats.last_file);
+
+  uint32_t frame_len;
+  auto records = ReadLog(Path(0), &frame_len);
+  EXPECT_EQ(2u, frame_len);
+  ASSERT_EQ(6u, records.size());
+  // The config record carries the read time of the first frame kept
+  EXPECT_EQ(kADIS16470LogConfig, records[0].type);
+  EXPECT_EQ(300u, records[0].host_time);
+  EXPECT_EQ(std::vector<uint32_t>{2}, records[0].words);
+  // Pre-trigger frames 4 to 7, one record per pass
+  EXPECT_EQ(kADIS16470LogData, records[1].type);
+  EXPECT_EQ(300u, records[1].host_time);
+  EXPECT_EQ(Frames(4, 6), records[1].words);
+  EXPECT_EQ(400u, records[2].host_time);
+  EXPECT_EQ(Frames(6, 8), records[2].words);
+  // The event sits between the last frame before the trigger and the first after it
+  EXPECT_EQ(kADIS16470LogEvent, records[3].type);
+  EXPECT_EQ(kTriggerTime, records[3].host_time);
+  EXPECT_EQ((std::vector<uint32_t>{kCauses, kTriggerTimestamp}), records[3].words);
+  // Post-trigger frames 8 to 10, with their pass flags
+  EXPECT_EQ(kADIS16470LogData, records[4].type);
+  EXPECT_EQ(kADIS16470LogOverrun, records[4].flags);
+  EXPECT_EQ(500u, records[4].host_time);
+  EXPECT_EQ(Frames(8, 10), records[4].words);
+  EXPECT_EQ(0u, records[5].flags);
+  EXPECT_EQ(600u, records[5].host_time);
+  EXPECT_EQ(Frames(10, 11), records[5].words);
+}
+
+TEST_F(BlackBoxTest, ShortHistoryBeforeTheTrigger) {
+  Reset(2);
+  Pass(1, 100);
+  m_box.Trigger(kCauses, kTriggerTimestamp, kTriggerTime);
+  // A second trigger during the capture is ignored
+  m_box.Trigger(kADIS16470TriggerOverrun, 1, 1);
+  Pass(3, 500);
+  m_box.Close();
+
+  uint32_t frame_len;
+  auto records = ReadLog(Path(0), &frame_len);
+  ASSERT_EQ(4u, records.size());
+  EXPECT_EQ(kADIS16470LogConfig, records[0].type);
+  EXPECT_EQ(Frames(0, 1), records[1].words);
+  EXPECT_EQ(kADIS16470LogEvent, records[2].type);
+  EXPECT_EQ((std::vector<uint32_t>{kCauses, kTriggerTimestamp}), records[2].words);
+  EXPECT_EQ(Frames(1, 4), records[3].words);
+}
+
+TEST_F(BlackBoxTest, ResetStartsANewHistory) {
+  Reset(2);
+  Pass(3, 100);
+  // A new layout: frames from before it are never written with the new frame length
+  Reset(3);
+  Pass(2, 200);
+  m_box.Trigger(kCauses, kTriggerTimestamp, kTriggerTime);
+  Pass(3, 300);
+  m_box.Close();
+
+  uint32_t frame_len;
+  auto records = ReadLog(Path(0), &frame_len);
+  EXPECT_EQ(3u, frame_len);
+  ASSERT_EQ(4u, records.size());
+  EXPECT_EQ(std::vector<uint32_t>{3}, records[0].words);
+  EXPECT_EQ(200u, records[0].host_time);
+  EXPECT_EQ(Frames(3, 5), records[1].words);
+  EXPECT_EQ(kADIS16470LogEvent, records[2].type);
+  EXPECT_EQ(Frames(5, 8), records[3].words);
+}
+
+TEST_F(BlackBoxTest, ResetFinishesACaptureWithTheEventLast) {
+  Reset(2);
+  Pass(2, 100);
+  m_box.Trigger(kCauses, kTriggerTimestamp, kTriggerTime);
+  // The layout changes before any post-trigger frame arrives
+  Reset(3);
+  EXPECT_FALSE(m_box.GetStats().capturing);
+  m_box.Close();
+
+  uint32_t frame_len;
+  auto records = ReadLog(Path(0), &frame_len);
+  EXPECT_EQ(2u, frame_len);
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(kADIS16470LogConfig, records[0].type);
+  // Written with the old two word layout
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 100, 101}), records[1].words);
+  EXPECT_EQ(kADIS16470LogEvent, records[2].type);
+  EXPECT_EQ(kTriggerTime, records[2].host_time);
+}
+
+TEST_F(BlackBoxTest, NoCaptureWithoutATrigger) {
+  Reset(2);
+  for (int p = 0; p < 10; p++) {
+    Pass(2, 100 * (p + 1));
+  }
+  m_box.Close();
+  EXPECT_EQ(0u, m_box.GetStats().captures_written);
+  std::FILE* file = std::fopen(Path(0).c_str(), "rb");
+  EXPECT_EQ(nullptr, file);
+  if (file) {
+    std::fclose(file);
+  }
+}
@@ -0,0 +1,127 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <array>
+#include <cstdint>
+
+#include <adi/ADIS16470_CANForwarder.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+/*
+ * The payload is read by motor controller firmware, so these tests pin the exact bytes. Changing
+ * any of them breaks every receiver in the field.
+ */
+
+namespace {
+
+using Payload = std::array<uint8_t, ADIS16470CANForwarder::kPayloadSize>;
+
+Payload Encode(double angle, double rate, double age, int counter, uint8_t flags) {
+  ADIS16470CANHeading heading;
+  heading.angle = angle;
+  heading.rate = rate;
+  heading.age = age;
+  heading.counter = counter;
+  heading.flags = flags;
+  Payload data;
+  ADIS16470CANForwarder::Encode(heading, data.data());
+  return data;
+}
+
+ADIS16470CANHeading Decode(const Payload& data) {
+  ADIS16470CANHeading heading;
+  EXPECT_TRUE(ADIS16470CANForwarder::Decode(data.data(), static_cast<int>(data.size()), &heading));
+  return heading;
+}
+
+}  // namespace
+
+TEST(CANForwarderTest, KnownValues) {
+  // 123.456 deg = 123456 = 0x0001E240, 45.6 deg/s = 456 = 0x01C8, 1.2 ms = 12
+  EXPECT_EQ((Payload{0x40, 0xE2, 0x01, 0x00, 0xC8, 0x01, 0x15, 0x0C}),
+            Encode(123.456, 45.6, 0.0012, 5, kADIS16470CANStreamFault));
+  ADIS16470CANHeading heading = Decode(Payload{0x40, 0xE2, 0x01, 0x00, 0xC8, 0x01, 0x15, 0x0C});
+  EXPECT_DOUBLE_EQ(123.456, heading.angle);
+  EXPECT_DOUBLE_EQ(45.6, heading.rate);
+  EXPECT_DOUBLE_EQ(0.0012, heading.age);
+  EXPECT_EQ(5, heading.counter);
+  EXPECT_EQ(kADIS16470CANStreamFault, heading.flags);
+}
+
+TEST(CANForwarderTest, NegativeAngleAndRate) {
+  // -1.5 deg = -1500 = 0xFFFFFA24, -12.3 deg/s = -123 = 0xFF85
+  Payload data = Encode(-1.5, -12.3, 0.0, 0, 0);
+  EXPECT_EQ((Payload{0x24, 0xFA, 0xFF, 0xFF, 0x85, 0xFF, 0x00, 0x00}), data);
+  ADIS16470CANHeading heading = Decode(data);
+  EXPECT_DOUBLE_EQ(-1.5, heading.angle);
+  EXPECT_DOUBLE_EQ(-12.3, heading.rate);
+}
+
+TEST(CANForwarderTest, AngleWrapsModulo32Bits) {
+  EXPECT_EQ((Payload{0xFF, 0xFF, 0xFF, 0x7F, 0x00, 0x00, 0x00, 0x00}), Encode(2147483.647, 0.0, 0.0, 0, 0));
+  // One step further wraps to the most negative angle, so differences across the wrap stay right
+  Payload data = Encode(2147483.648, 0.0, 0.0, 0, 0);
+  EXPECT_EQ((Payload{0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00}), data);
+  EXPECT_DOUBLE_EQ(-2147483.648, Decode(data).angle);
+  EXPECT_EQ((Payload{0x01, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00}), Encode(2147483.649, 0.0, 0.0, 0, 0));
+  EXPECT_EQ((Payload{0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00}), Encode(-2147483.648, 0.0, 0.0, 0, 0));
+}
+
+TEST(CANForwarderTest, RateSaturates) {
+  Payload data = Encode(0.0, 5000.0, 0.0, 0, 0);
+  EXPECT_EQ((Payload{0x00, 0x00, 0x00, 0x00, 0xFF, 0x7F, 0x00, 0x00}), data);
+  EXPECT_DOUBLE_EQ(3276.7, Decode(data).rate);
+  data = Encode(0.0, -5000.0, 0.0, 0, 0);
+  EXPECT_EQ((Payload{0x00, 0x00, 0x00, 0x00, 0x01, 0x80, 0x00, 0x00}), data);
+  EXPECT_DOUBLE_EQ(-3276.7, Decode(data).rate);
+  EXPECT_EQ(Encode(0.0, 3276.7, 0.0, 0, 0), Encode(0.0, 3276.8, 0.0, 0, 0));
+}
+
+TEST(CANForwarderTest, AgeSaturates) {
+  Payload data = Encode(0.0, 0.0, 0.1, 0, 0);
+  EXPECT_EQ(0xFF, data[7]);
+  EXPECT_DOUBLE_EQ(0.0255, Decode(data).age);
+  EXPECT_EQ(0xFF, Encode(0.0, 0.0, 0.0255, 0, 0)[7]);
+  EXPECT_EQ(0xFE, Encode(0.0, 0.0, 0.0254, 0, 0)[7]);
+  EXPECT_EQ(0x00, Encode(0.0, 0.0, -0.001, 0, 0)[7]);
+}
+
+TEST(CANForwarderTest, CounterAndFlagNibbles) {
+  // Counter in the low nibble, flags in the high nibble, each cut to 4 bits
+  EXPECT_EQ(0x0F, Encode(0.0, 0.0, 0.0, 15, 0)[6]);
+  EXPECT_EQ(0x02, Encode(0.0, 0.0, 0.0, 18, 0)[6]);
+  EXPECT_EQ(0x10, Encode(0.0, 0.0, 0.0, 0, kADIS16470CANStreamFault)[6]);
+  EXPECT_EQ(0xA7, Encode(0.0, 0.0, 0.0, 7, 0xFA)[6]);
+  ADIS16470CANHeading heading = Decode(Payload{0, 0, 0, 0, 0, 0, 0xA7, 0});
+  EXPECT_EQ(7, heading.counter);
+  EXPECT_EQ(0xA, heading.flags);
+}
+
+TEST(CANForwarderTest, RoundTrip) {
+  const double angles[] = {0.0, 0.001, -0.001, 359.999, -720.5, 100000.25};
+  const double rates[] = {0.0, 0.1, -0.1, 250.3, -1999.9};
+  for (double angle : angles) {
+    for (double rate : rates) {
+      ADIS16470CANHeading heading = Decode(Encode(angle, rate, 0.0037, 9, 0));
+      EXPECT_NEAR(angle, heading.angle, 1e-9);
+      EXPECT_NEAR(rate, heading.rate, 1e-9);
+      EXPECT_NEAR(0.0037, heading.age, 1e-12);
+      EXPECT_EQ(9, heading.counter);
+    }
+  }
+}
+
+TEST(CANForwarderTest, ShortPayloadIsRejected) {
+  uint8_t data[ADIS16470CANForwarder::kPayloadSize] = {};
+  ADIS16470CANHeading heading;
+  EXPECT_FALSE(ADIS16470CANForwarder::Decode(data, ADIS16470CANForwarder::kPayloadSize - 1, &heading));
+}
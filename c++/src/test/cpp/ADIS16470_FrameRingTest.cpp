@@ -0,0 +1,144 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstdint>
+
+#include <adi/ADIS16470_FrameRing.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+constexpr int kCapacity = 8;
+constexpr int kReserve = 3;
+constexpr int kFrameLen = 3;
+
+uint32_t Word(uint64_t seq, int i) {
+  return static_cast<uint32_t>(seq * 100 + i);
+}
+
+/*
+ * Writes count frames the way the acquisition thread drains the FIFO: at most kReserve frames
+ * before each Commit(), taking a second span where the storage wraps.
+ */
+void DrainOnce(ADIS16470FrameRing& ring, int count) {
+  int written = 0;
+  while (written < count) {
+    int span_frames;
+    uint32_t* span = ring.WriteSpan(ring.GetHead() + written, &span_frames);
+    int frames = std::min(count - written, span_frames);
+    for (int f = 0; f < frames; f++) {
+      uint64_t seq = ring.GetHead() + written + f;
+      for (int i = 0; i < ring.GetFrameLen(); i++) {
+        span[f * ring.GetFrameLen() + i] = Word(seq, i);
+      }
+      ring.GetSample(seq).timestamp = static_cast<uint32_t>(seq);
+    }
+    written += frames;
+  }
+  ring.Commit(count);
+}
+
+void Drain(ADIS16470FrameRing& ring, int count) {
+  for (int done = 0; done < count; done += kReserve) {
+    DrainOnce(ring, std::min(kReserve, count - done));
+  }
+}
+
+class FrameRingTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ring.Reset(kFrameLen); }
+
+  ADIS16470FrameRing ring{kCapacity, kReserve};
+};
+
+}  // namespace
+
+TEST_F(FrameRingTest, Empty) {
+  EXPECT_EQ(kFrameLen, ring.GetFrameLen());
+  EXPECT_EQ(kCapacity, ring.GetCapacity());
+  EXPECT_EQ(0u, ring.GetHead());
+  EXPECT_EQ(0u, ring.GetOldest());
+  EXPECT_FALSE(ring.Contains(0));
+}
+
+TEST_F(FrameRingTest, SpanEndsAtTheEndOfTheStorage) {
+  int span_frames;
+  EXPECT_NE(nullptr, ring.WriteSpan(0, &span_frames));
+  EXPECT_EQ(kCapacity, span_frames);
+  Drain(ring, 6);
+  ring.WriteSpan(ring.GetHead(), &span_frames);
+  EXPECT_EQ(kCapacity - 6, span_frames);
+  // A drain that crosses the end of the storage lands in two spans
+  DrainOnce(ring, kReserve);
+  for (uint64_t seq = 6; seq < 9; seq++) {
+    EXPECT_EQ(Word(seq, kFrameLen - 1), ring.GetFrame(seq)[kFrameLen - 1]);
+  }
+  EXPECT_EQ(ring.GetFrame(0), ring.GetFrame(8));
+  // Back at the first slot after the end
+  EXPECT_EQ(ring.WriteSpan(0, &span_frames), ring.WriteSpan(kCapacity, &span_frames));
+  EXPECT_EQ(kCapacity, span_frames);
+}
+
+TEST_F(FrameRingTest, WrapKeepsTheNewestFrames) {
+  for (int i = 0; i < 4; i++) {
+    DrainOnce(ring, 3);
+    DrainOnce(ring, 2);
+  }
+  EXPECT_EQ(20u, ring.GetHead());
+  // The write reserve in front of the head is already gone
+  EXPECT_EQ(20u - (kCapacity - kReserve), ring.GetOldest());
+  EXPECT_FALSE(ring.Contains(ring.GetOldest() - 1));
+  EXPECT_FALSE(ring.Contains(ring.GetHead()));
+  for (uint64_t seq = ring.GetOldest(); seq < ring.GetHead(); seq++) {
+    ASSERT_TRUE(ring.Contains(seq));
+    for (int i = 0; i < kFrameLen; i++) {
+      EXPECT_EQ(Word(seq, i), ring.GetFrame(seq)[i]) << "frame " << seq;
+    }
+    EXPECT_EQ(static_cast<uint32_t>(seq), ring.GetSample(seq).timestamp);
+  }
+}
+
+TEST_F(FrameRingTest, OldestBeforeTheRingFills) {
+  Drain(ring, 3);
+  EXPECT_EQ(0u, ring.GetOldest());
+  Drain(ring, kCapacity - kReserve - 3);
+  EXPECT_EQ(0u, ring.GetOldest());
+  Drain(ring, 1);
+  EXPECT_EQ(1u, ring.GetOldest());
+}
+
+TEST_F(FrameRingTest, ResetDropsFramesAndKeepsCounting) {
+  Drain(ring, 10);
+  ring.Reset(5);
+  EXPECT_EQ(5, ring.GetFrameLen());
+  EXPECT_EQ(10u, ring.GetHead());
+  EXPECT_EQ(10u, ring.GetOldest());
+  EXPECT_FALSE(ring.Contains(9));
+
+  Drain(ring, 4);
+  EXPECT_EQ(10u, ring.GetOldest());
+  for (uint64_t seq = 10; seq < 14; seq++) {
+    for (int i = 0; i < 5; i++) {
+      EXPECT_EQ(Word(seq, i), ring.GetFrame(seq)[i]);
+    }
+  }
+  Drain(ring, 10);
+  EXPECT_EQ(24u - (kCapacity - kReserve), ring.GetOldest());
+}
+
+TEST_F(FrameRingTest, FrameLengthIsClamped) {
+  ring.Reset(0);
+  EXPECT_EQ(1, ring.GetFrameLen());
+  ring.Reset(kADIS16470MaxFrameLen + 1);
+  EXPECT_EQ(kADIS16470MaxFrameLen, ring.GetFrameLen());
+}
@@ -0,0 +1,234 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cstdint>
+#include <vector>
+
+#include <adi/ADIS16470_FrameSync.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+/* Timestamp and four data bytes */
+constexpr int kFrameLen = 5;
+constexpr uint32_t kPeriod = 2500;
+constexpr uint32_t kMaxGap = 4 * kPeriod;
+
+/* Frames with timestamps start, start + kPeriod, ... and data bytes that differ from frame to frame */
+std::vector<uint32_t> MakeStream(int frames, uint32_t start = 1000000) {
+  std::vector<uint32_t> words;
+  for (int f = 0; f < frames; f++) {
+    words.push_back(start + f * kPeriod);
+    for (int i = 1; i < kFrameLen; i++) {
+      words.push_back((f * 7 + i) & 0xFF);
+    }
+  }
+  return words;
+}
+
+std::vector<uint32_t> Frame(const std::vector<uint32_t>& stream, int index) {
+  return std::vector<uint32_t>(stream.begin() + index * kFrameLen, stream.begin() + (index + 1) * kFrameLen);
+}
+
+/* Frames that came out of the checks, whole */
+struct Outcome {
+  std::vector<std::vector<uint32_t>> frames;
+  // Frames accepted before the first bad one
+  int checked = 0;
+};
+
+/*
+ * Runs a word stream through the sync the way the acquisition loop does: whole frames are checked
+ * in order, and from the first bad one on the words go to Begin() and Recover().
+ */
+Outcome Feed(ADIS16470FrameSync& sync, const std::vector<uint32_t>& words) {
+  Outcome outcome;
+  size_t pos = 0;
+  uint32_t previous = 0;
+  while (pos + kFrameLen <= words.size() && sync.IsValid(&words[pos], previous, pos > 0)) {
+    outcome.frames.emplace_back(words.begin() + pos, words.begin() + pos + kFrameLen);
+    previous = words[pos];
+    pos += kFrameLen;
+  }
+  outcome.checked = static_cast<int>(outcome.frames.size());
+  if (pos + kFrameLen <= words.size()) {
+    sync.Begin(&words[pos], words.size() - pos);
+    std::vector<uint32_t> recovered(words.size());
+    int count = sync.Recover(recovered.data(), static_cast<int>(words.size() / kFrameLen));
+    for (int f = 0; f < count; f++) {
+      outcome.frames.emplace_back(recovered.begin() + f * kFrameLen, recovered.begin() + (f + 1) * kFrameLen);
+    }
+  }
+  return outcome;
+}
+
+class FrameSyncTest : public ::testing::Test {
+ protected:
+  void SetUp() override { sync.Reset(kFrameLen, kMaxGap); }
+
+  ADIS16470FrameSync sync;
+};
+
+}  // namespace
+
+TEST_F(FrameSyncTest, CleanStreamPassesTheChecks) {
+  auto stream = MakeStream(10);
+  Outcome outcome = Feed(sync, stream);
+  EXPECT_EQ(10, outcome.checked);
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(0u, sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, DroppedWord) {
+  auto stream = MakeStream(10);
+  auto faulty = stream;
+  // Lose a data byte of frame 2: its last word is now frame 3's timestamp
+  faulty.erase(faulty.begin() + 2 * kFrameLen + 2);
+  Outcome outcome = Feed(sync, faulty);
+
+  EXPECT_EQ(2, outcome.checked);
+  ASSERT_EQ(9u, outcome.frames.size());
+  for (int f = 0; f < 2; f++) {
+    EXPECT_EQ(Frame(stream, f), outcome.frames[f]);
+  }
+  for (int f = 3; f < 10; f++) {
+    EXPECT_EQ(Frame(stream, f), outcome.frames[f - 1]);
+  }
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(0, sync.GetSkip());
+  // The four words left of frame 2
+  EXPECT_EQ(4u, sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, ExtraWord) {
+  auto stream = MakeStream(10);
+  auto faulty = stream;
+  // A stray byte inside frame 2 still checks out, but pushes its last byte into frame 3's timestamp slot
+  faulty.insert(faulty.begin() + 2 * kFrameLen + 3, 0x42);
+  Outcome outcome = Feed(sync, faulty);
+
+  EXPECT_EQ(3, outcome.checked);
+  ASSERT_EQ(10u, outcome.frames.size());
+  for (int f = 3; f < 10; f++) {
+    EXPECT_EQ(Frame(stream, f), outcome.frames[f]);
+  }
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(0, sync.GetSkip());
+  // Frame 2's displaced last byte
+  EXPECT_EQ(1u, sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, TimestampJump) {
+  auto stream = MakeStream(10);
+  auto faulty = stream;
+  faulty[4 * kFrameLen] += 1000000;
+  Outcome outcome = Feed(sync, faulty);
+
+  EXPECT_EQ(4, outcome.checked);
+  // The glitched frame can't start a boundary (the next timestamp is behind it), so it is dropped whole
+  ASSERT_EQ(9u, outcome.frames.size());
+  for (int f = 5; f < 10; f++) {
+    EXPECT_EQ(Frame(stream, f), outcome.frames[f - 1]);
+  }
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(0, sync.GetSkip());
+  EXPECT_EQ(static_cast<uint64_t>(kFrameLen), sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, StallKeepsTheFrameAfterIt) {
+  auto stream = MakeStream(10);
+  // Data ready stopped for a while before frame 4: every later timestamp moves on by the stall
+  for (int f = 4; f < 10; f++) {
+    stream[f * kFrameLen] += 500000;
+  }
+  Outcome outcome = Feed(sync, stream);
+
+  EXPECT_EQ(4, outcome.checked);
+  ASSERT_EQ(10u, outcome.frames.size());
+  EXPECT_EQ(Frame(stream, 4), outcome.frames[4]);
+  EXPECT_EQ(0u, sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, TimestampWrap) {
+  // Frame 2 is the last one before the 32-bit FPGA timestamp wraps
+  auto stream = MakeStream(10, 0xFFFFFFFFu - 2 * kPeriod - 1000);
+  Outcome outcome = Feed(sync, stream);
+  EXPECT_EQ(10, outcome.checked);
+  EXPECT_FALSE(sync.IsResyncing());
+
+  // A search that runs across the wrap finds the boundary too
+  sync.Reset(kFrameLen, kMaxGap);
+  auto faulty = stream;
+  faulty.erase(faulty.begin() + 1 * kFrameLen + 1);
+  outcome = Feed(sync, faulty);
+  EXPECT_EQ(1, outcome.checked);
+  ASSERT_EQ(9u, outcome.frames.size());
+  for (int f = 2; f < 10; f++) {
+    EXPECT_EQ(Frame(stream, f), outcome.frames[f - 1]);
+  }
+  EXPECT_EQ(4u, sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, PartialTrailingFrame) {
+  auto stream = MakeStream(10);
+  auto faulty = stream;
+  faulty.erase(faulty.begin() + 2 * kFrameLen + 2);
+  // Only the first two words of frame 9 have arrived
+  faulty.resize(faulty.size() - (kFrameLen - 2));
+  Outcome outcome = Feed(sync, faulty);
+
+  ASSERT_EQ(8u, outcome.frames.size());
+  for (int f = 3; f < 9; f++) {
+    EXPECT_EQ(Frame(stream, f), outcome.frames[f - 1]);
+  }
+  // The start of frame 9 is dropped and the rest of it must be dropped from the FIFO
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(kFrameLen - 2, sync.GetSkip());
+  EXPECT_EQ(4u + 2u, sync.GetDiscardedWords());
+
+  sync.Skipped(kFrameLen - 2);
+  EXPECT_EQ(0, sync.GetSkip());
+  EXPECT_EQ(4u + static_cast<uint64_t>(kFrameLen), sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, SearchGoesOnIntoTheNextAppend) {
+  auto stream = MakeStream(10);
+  auto faulty = stream;
+  faulty.erase(faulty.begin() + 2 * kFrameLen + 2);
+  const size_t bad = 2 * kFrameLen;
+  // Frame 3 has arrived, but not the timestamp of frame 4 that confirms the boundary
+  const size_t split = bad + (kFrameLen - 1) + kFrameLen;
+  sync.Begin(&faulty[bad], split - bad);
+  std::vector<uint32_t> frames(faulty.size());
+  EXPECT_EQ(0, sync.Recover(frames.data(), 10));
+  EXPECT_TRUE(sync.IsResyncing());
+
+  sync.Append(&faulty[split], faulty.size() - split);
+  ASSERT_EQ(7, sync.Recover(frames.data(), 10));
+  EXPECT_EQ(Frame(stream, 3), std::vector<uint32_t>(frames.begin(), frames.begin() + kFrameLen));
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(4u, sync.GetDiscardedWords());
+}
+
+TEST_F(FrameSyncTest, FramesThatDontFitStayWithTheSearch) {
+  auto stream = MakeStream(10);
+  auto faulty = stream;
+  faulty.erase(faulty.begin() + 2 * kFrameLen + 2);
+  sync.Begin(&faulty[2 * kFrameLen], faulty.size() - 2 * kFrameLen);
+  std::vector<uint32_t> frames(faulty.size());
+  ASSERT_EQ(3, sync.Recover(frames.data(), 3));
+  EXPECT_TRUE(sync.IsResyncing());
+  ASSERT_EQ(4, sync.Recover(frames.data(), 10));
+  EXPECT_EQ(Frame(stream, 6), std::vector<uint32_t>(frames.begin(), frames.begin() + kFrameLen));
+  EXPECT_FALSE(sync.IsResyncing());
+  EXPECT_EQ(0, sync.GetSkip());
+}
@@ -0,0 +1,132 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <adi/ADIS16470_NoiseStats.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+/* 400 SPS, the driver's default output rate */
+constexpr double kPeriod = 0.0025;
+
+/* Angle random walk of the synthetic gyro (deg/s/sqrt(Hz), i.e. deg/sqrt(s)) */
+constexpr double kDensity = 0.008;
+
+/* Feeds white noise of density kDensity on top of a bias, 10 minutes of it by default */
+void FeedWhiteNoise(ADIS16470AllanDeviation& allan, double bias, int samples = 240000) {
+  std::mt19937 rng(5);
+  std::normal_distribution<double> noise(0.0, kDensity / std::sqrt(kPeriod));
+  for (int i = 0; i < samples; i++) {
+    allan.Update(bias + noise(rng));
+  }
+}
+
+}  // namespace
+
+TEST(WelfordStatsTest, KnownSequence) {
+  ADIS16470WelfordStats stats;
+  EXPECT_EQ(0u, stats.GetCount());
+  EXPECT_DOUBLE_EQ(0.0, stats.GetVariance());
+
+  for (double x : {2.0, 4.0, 4.0, 4.0, 5.0, 5.0, 7.0, 9.0}) {
+    stats.Update(x);
+  }
+  EXPECT_EQ(8u, stats.GetCount());
+  EXPECT_DOUBLE_EQ(5.0, stats.GetMean());
+  // Sum of squared deviations is 32, over n - 1
+  EXPECT_DOUBLE_EQ(32.0 / 7.0, stats.GetVariance());
+  EXPECT_DOUBLE_EQ(std::sqrt(32.0 / 7.0), stats.GetStdDev());
+
+  stats.Reset();
+  EXPECT_EQ(0u, stats.GetCount());
+  EXPECT_DOUBLE_EQ(0.0, stats.GetMean());
+}
+
+TEST(WelfordStatsTest, LargeOffset) {
+  // A bias many times the spread must not cost precision in the variance
+  ADIS16470WelfordStats stats;
+  for (int i = 0; i < 1000; i++) {
+    stats.Update(1e9 + (i % 2 ? 1.0 : -1.0));
+  }
+  EXPECT_DOUBLE_EQ(1e9, stats.GetMean());
+  EXPECT_NEAR(1000.0 / 999.0, stats.GetVariance(), 1e-6);
+}
+
+TEST(AllanDeviationTest, NotEnoughSamples) {
+  ADIS16470AllanDeviation allan;
+  double tau, adev;
+  EXPECT_FALSE(allan.GetDeviation(0, kPeriod, &tau, &adev));
+  EXPECT_FALSE(allan.GetDeviation(-1, kPeriod, &tau, &adev));
+  EXPECT_FALSE(allan.GetDeviation(ADIS16470AllanDeviation::kNumTaus, kPeriod, &tau, &adev));
+
+  ADIS16470NoiseStatistics stats;
+  allan.Summarize(kPeriod, &stats);
+  EXPECT_EQ(0.0, stats.random_walk);
+  EXPECT_EQ(0.0, stats.bias_instability);
+}
+
+TEST(AllanDeviationTest, WhiteNoiseSlope) {
+  ADIS16470AllanDeviation allan;
+  FeedWhiteNoise(allan, 0.3);
+
+  // Least squares slope of log(adev) against log(tau) over the octaves with plenty of clusters
+  std::vector<double> x, y;
+  for (int j = 0; j <= 10; j++) {
+    double tau, adev;
+    ASSERT_TRUE(allan.GetDeviation(j, kPeriod, &tau, &adev));
+    EXPECT_DOUBLE_EQ(std::ldexp(kPeriod, j), tau);
+    x.push_back(std::log(tau));
+    y.push_back(std::log(adev));
+  }
+  double mx = 0.0, my = 0.0;
+  for (size_t i = 0; i < x.size(); i++) {
+    mx += x[i] / x.size();
+    my += y[i] / y.size();
+  }
+  double sxy = 0.0, sxx = 0.0;
+  for (size_t i = 0; i < x.size(); i++) {
+    sxy += (x[i] - mx) * (y[i] - my);
+    sxx += (x[i] - mx) * (x[i] - mx);
+  }
+  EXPECT_NEAR(-0.5, sxy / sxx, 0.02);
+}
+
+TEST(AllanDeviationTest, WhiteNoiseDensityAtOneSecond) {
+  ADIS16470AllanDeviation allan;
+  FeedWhiteNoise(allan, -1.2);
+
+  // 2^9 samples = 1.28 s is the cluster size closest to 1 s. About 470 independent clusters in
+  // 10 minutes leave a 5% spread on the estimate, so allow two of that.
+  double tau, adev;
+  ASSERT_TRUE(allan.GetDeviation(9, kPeriod, &tau, &adev));
+  EXPECT_NEAR(kDensity, adev * std::sqrt(tau), 0.1 * kDensity);
+
+  ADIS16470NoiseStatistics stats;
+  allan.Summarize(kPeriod, &stats);
+  EXPECT_DOUBLE_EQ(adev * std::sqrt(tau), stats.random_walk);
+  // White noise keeps falling, so the floor is at the longest cluster size with enough terms
+  EXPECT_GT(stats.bias_instability_tau, 10.0);
+}
+
+TEST(AllanDeviationTest, ResetClearsTheCurve) {
+  ADIS16470AllanDeviation allan;
+  FeedWhiteNoise(allan, 0.0, 4000);
+  double tau, adev;
+  EXPECT_TRUE(allan.GetDeviation(0, kPeriod, &tau, &adev));
+  allan.Reset();
+  EXPECT_EQ(0u, allan.GetCount());
+  EXPECT_FALSE(allan.GetDeviation(0, kPeriod, &tau, &adev));
+}
@@ -0,0 +1,238 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <adi/ADIS16470_Preintegrator.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kRadPerDeg = kPi / 180.0;
+
+/* 400 Hz */
+constexpr uint32_t kPeriod = 2500;
+
+/* Z is the yaw axis in every test */
+constexpr int kYawAxis = 2;
+
+ADIS16470Sample MakeSample(uint32_t timestamp, double dt, double gx, double gy, double gz,
+                           double ax, double ay, double az) {
+  ADIS16470Sample sample;
+  sample.timestamp = timestamp;
+  sample.dt = dt;
+  sample.gyro_x = gx;
+  sample.gyro_y = gy;
+  sample.gyro_z = gz;
+  sample.delta_angle = gz * dt;
+  sample.accel_x = ax;
+  sample.accel_y = ay;
+  sample.accel_z = az;
+  return sample;
+}
+
+/* Samples at a steady rate with a constant turn and specific force. The first one has no time step. */
+std::vector<ADIS16470Sample> ConstantMotion(int count, double gz, double ax, double az) {
+  std::vector<ADIS16470Sample> samples;
+  for (int i = 0; i < count; i++) {
+    samples.push_back(MakeSample(1000000 + i * kPeriod, i > 0 ? kPeriod / 1e6 : 0.0, 0.0, 0.0, gz, ax, 0.0, az));
+  }
+  return samples;
+}
+
+/* Samples with jittered timestamps, turning about all three axes and accelerating */
+std::vector<ADIS16470Sample> TumblingMotion(int count) {
+  std::vector<ADIS16470Sample> samples;
+  uint32_t timestamp = 1000000;
+  for (int i = 0; i < count; i++) {
+    uint32_t step = kPeriod + (i % 3) * 10;
+    timestamp += step;
+    samples.push_back(MakeSample(timestamp, i > 0 ? step / 1e6 : 0.0, 30.0 * std::sin(0.1 * i),
+                                 20.0 * std::cos(0.07 * i), 45.0 + 10.0 * std::sin(0.05 * i),
+                                 0.1 * std::sin(0.2 * i), 0.2 * std::cos(0.1 * i), 1.0));
+  }
+  return samples;
+}
+
+void QuatMultiply(const double* a, const double* b, double* out) {
+  double w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  double x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  double y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  double z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+  out[0] = w;
+  out[1] = x;
+  out[2] = y;
+  out[3] = z;
+}
+
+/* Rotates v by the unit quaternion q */
+void QuatRotate(const double* q, const double* v, double* out) {
+  const double p[4] = {0.0, v[0], v[1], v[2]};
+  const double conjugate[4] = {q[0], -q[1], -q[2], -q[3]};
+  double qp[4], result[4];
+  QuatMultiply(q, p, qp);
+  QuatMultiply(qp, conjugate, result);
+  for (int i = 0; i < 3; i++) {
+    out[i] = result[i + 1];
+  }
+}
+
+/*
+ * Integrates samples (first, last] one at a time, the way the preintegrator documents it: half of
+ * each sample's rotation, its specific force, then the other half.
+ */
+ADIS16470Preintegration Integrate(const std::vector<ADIS16470Sample>& samples, int first, int last) {
+  ADIS16470Preintegration result;
+  double* q = result.rotation;
+  for (int i = first + 1; i <= last; i++) {
+    const ADIS16470Sample& s = samples[i];
+    double half[3] = {0.5 * s.gyro_x * s.dt * kRadPerDeg, 0.5 * s.gyro_y * s.dt * kRadPerDeg,
+                      0.5 * s.delta_angle * kRadPerDeg};
+    double angle = std::sqrt(half[0] * half[0] + half[1] * half[1] + half[2] * half[2]);
+    double k = angle > 0.0 ? std::sin(0.5 * angle) / angle : 0.5;
+    const double step[4] = {std::cos(0.5 * angle), half[0] * k, half[1] * k, half[2] * k};
+    double mid[4], du[3];
+    QuatMultiply(q, step, mid);
+    const double force[3] = {s.accel_x * grav * s.dt, s.accel_y * grav * s.dt, s.accel_z * grav * s.dt};
+    QuatRotate(mid, force, du);
+    QuatMultiply(mid, step, q);
+    for (int j = 0; j < 3; j++) {
+      result.delta_velocity[j] += du[j];
+    }
+    result.dt += s.dt;
+  }
+  return result;
+}
+
+void ExpectSameMotion(const ADIS16470Preintegration& expected, const ADIS16470Preintegration& actual) {
+  for (int i = 0; i < 4; i++) {
+    EXPECT_NEAR(expected.rotation[i], actual.rotation[i], 1e-9) << "rotation " << i;
+  }
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(expected.delta_velocity[i], actual.delta_velocity[i], 1e-9) << "delta velocity " << i;
+  }
+  EXPECT_NEAR(expected.dt, actual.dt, 1e-12);
+}
+
+}  // namespace
+
+TEST(PreintegratorTest, ConstantRateRotation) {
+  // 90 deg/s about Z for one second, with gravity on Z and 1 g of specific force on body X
+  const double rate = 90.0;
+  auto samples = ConstantMotion(801, rate, 1.0, 1.0);
+  ADIS16470Preintegrator preintegrator;
+  for (const auto& sample : samples) {
+    preintegrator.Process(sample, kYawAxis);
+  }
+  uint32_t oldest, latest;
+  ASSERT_TRUE(preintegrator.GetRange(&oldest, &latest));
+  EXPECT_EQ(samples.front().timestamp, oldest);
+  EXPECT_EQ(samples.back().timestamp, latest);
+
+  ADIS16470Preintegration result;
+  ASSERT_TRUE(preintegrator.Get(samples[200].timestamp, samples[600].timestamp, &result));
+  EXPECT_EQ(samples[200].timestamp, result.start_timestamp);
+  EXPECT_EQ(samples[600].timestamp, result.end_timestamp);
+  EXPECT_NEAR(1.0, result.dt, 1e-12);
+  EXPECT_NEAR(std::cos(kPi / 4.0), result.rotation[0], 1e-9);
+  EXPECT_NEAR(0.0, result.rotation[1], 1e-12);
+  EXPECT_NEAR(0.0, result.rotation[2], 1e-12);
+  EXPECT_NEAR(std::sin(kPi / 4.0), result.rotation[3], 1e-9);
+
+  // Body X sweeps a quarter turn: g/w * (sin(wT), 1 - cos(wT)) in the start frame
+  const double w = rate * kRadPerDeg;
+  EXPECT_NEAR(grav / w * std::sin(w), result.delta_velocity[0], 1e-5);
+  EXPECT_NEAR(grav / w * (1.0 - std::cos(w)), result.delta_velocity[1], 1e-5);
+  EXPECT_NEAR(grav, result.delta_velocity[2], 1e-9);
+
+  // Rotation noise grows with time alone
+  const double gyro_variance = std::pow(ADIS16470Preintegrator::kDefaultGyroNoiseDensity * kRadPerDeg, 2);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(gyro_variance * result.dt, result.covariance[7 * i], 1e-6 * gyro_variance);
+  }
+}
+
+TEST(PreintegratorTest, WindowAcrossAnEpochRestart) {
+  // A 64 sample ring restarts its totals every 64 samples; the window holds the restart at sample 64
+  auto samples = TumblingMotion(100);
+  ADIS16470Preintegrator small(64);
+  ADIS16470Preintegrator large(1024);
+  for (const auto& sample : samples) {
+    small.Process(sample, kYawAxis);
+    large.Process(sample, kYawAxis);
+  }
+  uint32_t oldest, latest;
+  ASSERT_TRUE(small.GetRange(&oldest, &latest));
+  EXPECT_EQ(samples[36].timestamp, oldest);
+
+  ADIS16470Preintegration across, reference;
+  ASSERT_TRUE(small.Get(samples[40].timestamp, samples[95].timestamp, &across));
+  ExpectSameMotion(Integrate(samples, 40, 95), across);
+
+  // The covariance doesn't care where the restart falls either
+  ASSERT_TRUE(large.Get(samples[40].timestamp, samples[95].timestamp, &reference));
+  for (int i = 0; i < 36; i++) {
+    EXPECT_NEAR(reference.covariance[i], across.covariance[i], 1e-6 * std::abs(reference.covariance[i]) + 1e-18)
+        << "covariance " << i;
+  }
+
+  // Samples that have left the ring can't be reached
+  EXPECT_FALSE(small.Get(samples[30].timestamp, samples[95].timestamp, &across));
+}
+
+TEST(PreintegratorTest, InterpolatedTimestamps) {
+  // Start and end half way between samples: a constant turn and force still integrate exactly
+  const double rate = 60.0;
+  auto samples = ConstantMotion(401, rate, 0.0, 1.0);
+  ADIS16470Preintegrator preintegrator;
+  for (const auto& sample : samples) {
+    preintegrator.Process(sample, kYawAxis);
+  }
+  const uint32_t start = samples[100].timestamp + kPeriod / 2;
+  const uint32_t end = samples[300].timestamp + kPeriod / 5;
+  ADIS16470Preintegration result;
+  ASSERT_TRUE(preintegrator.Get(start, end, &result));
+  const double dt = (end - start) / 1e6;
+  EXPECT_NEAR(dt, result.dt, 1e-12);
+  const double half_angle = 0.5 * rate * kRadPerDeg * dt;
+  EXPECT_NEAR(std::cos(half_angle), result.rotation[0], 1e-9);
+  EXPECT_NEAR(std::sin(half_angle), result.rotation[3], 1e-9);
+  EXPECT_NEAR(0.0, result.delta_velocity[0], 1e-9);
+  EXPECT_NEAR(0.0, result.delta_velocity[1], 1e-9);
+  EXPECT_NEAR(grav * dt, result.delta_velocity[2], 1e-9);
+
+  // Windows outside the samples held, or backwards, are refused
+  EXPECT_FALSE(preintegrator.Get(samples[0].timestamp - 1, end, &result));
+  EXPECT_FALSE(preintegrator.Get(start, samples.back().timestamp + 1, &result));
+  EXPECT_FALSE(preintegrator.Get(end, start, &result));
+}
+
+TEST(PreintegratorTest, RestartedStreamStartsOver) {
+  auto samples = ConstantMotion(100, 10.0, 0.0, 1.0);
+  ADIS16470Preintegrator preintegrator;
+  for (int i = 0; i < 100; i++) {
+    ADIS16470Sample sample = samples[i];
+    // The stream restarts at sample 50, which has no time step
+    if (i == 50) {
+      sample.dt = 0.0;
+    }
+    preintegrator.Process(sample, kYawAxis);
+  }
+  uint32_t oldest, latest;
+  ASSERT_TRUE(preintegrator.GetRange(&oldest, &latest));
+  EXPECT_EQ(samples[50].timestamp, oldest);
+  ADIS16470Preintegration result;
+  EXPECT_FALSE(preintegrator.Get(samples[40].timestamp, samples[60].timestamp, &result));
+}
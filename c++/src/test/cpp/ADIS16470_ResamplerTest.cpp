@@ -0,0 +1,183 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <adi/ADIS16470_Resampler.h>
+
+#include "gtest/gtest.h"
+
+using namespace frc;
+
+namespace {
+
+/* 400 Hz input, 1 kHz grid */
+constexpr uint64_t kInputPeriod = 2500;
+constexpr double kGridRate = 1000.0;
+constexpr uint64_t kGridPeriod = 1000;
+
+/* Jitter added to successive input timestamps (us) */
+constexpr int64_t kJitter[] = {0, 37, -21, 12, -40};
+
+/* Every channel a different function of the time (s) */
+using Signal = std::function<double(int channel, double t)>;
+
+/* Feeds an input sample at a 64-bit FPGA time, read back 300 us later */
+void Feed(ADIS16470Resampler& resampler, uint64_t time, double dt, const Signal& signal) {
+  const double t = time / 1e6;
+  ADIS16470Sample sample;
+  sample.timestamp = static_cast<uint32_t>(time);
+  sample.dt = dt;
+  sample.gyro_x = signal(0, t);
+  sample.gyro_y = signal(1, t);
+  sample.gyro_z = signal(2, t);
+  sample.accel_x = signal(3, t);
+  sample.accel_y = signal(4, t);
+  sample.accel_z = signal(5, t);
+  sample.angle = signal(kADIS16470GridAngle, t);
+  resampler.Process(sample, time + 300);
+}
+
+/* Feeds count jittered samples from start on. Returns the time of the last one. */
+uint64_t FeedStream(ADIS16470Resampler& resampler, uint64_t start, int count, const Signal& signal) {
+  uint64_t previous = 0;
+  uint64_t time = 0;
+  for (int i = 0; i < count; i++) {
+    time = start + i * kInputPeriod + kJitter[i % 5];
+    Feed(resampler, time, previous ? (time - previous) / 1e6 : 0.0, signal);
+    previous = time;
+  }
+  return time;
+}
+
+std::vector<ADIS16470GridSample> ReadAll(const ADIS16470Resampler& resampler) {
+  std::vector<ADIS16470GridSample> samples(resampler.GetHead());
+  uint64_t sequence = 0;
+  samples.resize(resampler.Read(&sequence, samples.data(), static_cast<int>(samples.size())));
+  return samples;
+}
+
+double Ramp(int channel, double t) {
+  return 1.5 * channel - 0.25 + (channel + 1) * 20.0 * t;
+}
+
+double Cubic(int channel, double t) {
+  return channel + 3.0 * t - 40.0 * t * t + (channel + 1) * 500.0 * t * t * t;
+}
+
+}  // namespace
+
+TEST(ResamplerTest, LinearRampIsExact) {
+  ADIS16470Resampler resampler(kGridRate);
+  EXPECT_DOUBLE_EQ(kGridRate, resampler.GetRate());
+  const uint64_t start = 1000000;
+  const uint64_t last = FeedStream(resampler, start, 400, Ramp);
+
+  auto samples = ReadAll(resampler);
+  // One grid point per ms from the second input sample to the one before last
+  ASSERT_GE(samples.size(), 990u);
+  EXPECT_LE(samples.size(), 1000u);
+  EXPECT_GE(samples.front().time, start + kInputPeriod + kJitter[1]);
+  EXPECT_LT(samples.back().time, last);
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(0u, samples[i].time % kGridPeriod);
+    if (i > 0) {
+      EXPECT_EQ(kGridPeriod, samples[i].time - samples[i - 1].time);
+    }
+    for (int c = 0; c <= kADIS16470GridAngle; c++) {
+      EXPECT_NEAR(Ramp(c, samples[i].time / 1e6), samples[i].values[c], 1e-9) << "channel " << c;
+    }
+  }
+}
+
+TEST(ResamplerTest, CubicIsExact) {
+  // A cubic through four jittered samples reproduces any cubic
+  ADIS16470Resampler resampler(kGridRate);
+  FeedStream(resampler, 2000000, 100, Cubic);
+  auto samples = ReadAll(resampler);
+  ASSERT_GT(samples.size(), 200u);
+  for (const auto& s : samples) {
+    for (int c = 0; c <= kADIS16470GridAngle; c++) {
+      EXPECT_NEAR(Cubic(c, s.time / 1e6), s.values[c], 1e-7) << "channel " << c;
+    }
+  }
+}
+
+TEST(ResamplerTest, GapRestartsTheInterpolation) {
+  ADIS16470Resampler resampler(kGridRate);
+  uint64_t before = FeedStream(resampler, 1000000, 40, Ramp);
+  const uint64_t head = resampler.GetHead();
+
+  // Ten periods without data, then the stream carries on
+  const uint64_t after = before + 10 * kInputPeriod;
+  for (int i = 0; i < 3; i++) {
+    Feed(resampler, after + i * kInputPeriod, kInputPeriod / 1e6, Ramp);
+  }
+  // Three samples after the gap are not enough to interpolate anything
+  EXPECT_EQ(head, resampler.GetHead());
+  Feed(resampler, after + 3 * kInputPeriod, kInputPeriod / 1e6, Ramp);
+  EXPECT_GT(resampler.GetHead(), head);
+
+  auto samples = ReadAll(resampler);
+  for (size_t i = 0; i < samples.size(); i++) {
+    const uint64_t time = samples[i].time;
+    // Nothing inside the gap, and the grid resumes on the same multiples of the period
+    EXPECT_TRUE(time < before || time >= after + kInputPeriod) << time;
+    EXPECT_EQ(0u, time % kGridPeriod);
+    for (int c = 0; c <= kADIS16470GridAngle; c++) {
+      EXPECT_NEAR(Ramp(c, time / 1e6), samples[i].values[c], 1e-9);
+    }
+  }
+}
+
+TEST(ResamplerTest, SampleWithoutTimeStepRestarts) {
+  ADIS16470Resampler resampler(kGridRate);
+  uint64_t last = FeedStream(resampler, 1000000, 20, Ramp);
+  const uint64_t head = resampler.GetHead();
+  // A restarted stream (dt = 0) has to build up four samples again
+  Feed(resampler, last + kInputPeriod, 0.0, Ramp);
+  for (int i = 2; i <= 3; i++) {
+    Feed(resampler, last + i * kInputPeriod, kInputPeriod / 1e6, Ramp);
+  }
+  EXPECT_EQ(head, resampler.GetHead());
+}
+
+TEST(ResamplerTest, TimesFollowTheFPGAClockAcrossTheTimestampWrap) {
+  ADIS16470Resampler resampler(kGridRate);
+  // The FPGA has been up for more than 71 minutes, and its 32-bit timestamps wrap mid-stream
+  const uint64_t start = (uint64_t(3) << 32) - 50 * kInputPeriod;
+  const uint64_t last = FeedStream(resampler, start, 100, Ramp);
+
+  auto samples = ReadAll(resampler);
+  ASSERT_GT(samples.size(), 200u);
+  EXPECT_GT(samples.front().time, start);
+  EXPECT_LT(samples.back().time, last);
+  for (size_t i = 1; i < samples.size(); i++) {
+    EXPECT_EQ(kGridPeriod, samples[i].time - samples[i - 1].time);
+  }
+}
+
+TEST(ResamplerTest, ReadStartsAtTheOldestSampleHeld) {
+  ADIS16470Resampler resampler(kGridRate, 16);
+  FeedStream(resampler, 1000000, 40, Ramp);
+  const uint64_t head = resampler.GetHead();
+  ASSERT_GT(head, 16u);
+
+  ADIS16470GridSample samples[32];
+  uint64_t sequence = 0;
+  EXPECT_EQ(16, resampler.Read(&sequence, samples, 32));
+  EXPECT_EQ(head, sequence);
+  EXPECT_EQ(0, resampler.Read(&sequence, samples, 32));
+
+  sequence = head - 4;
+  EXPECT_EQ(2, resampler.Read(&sequence, samples, 2));
+  EXPECT_EQ(head - 2, sequence);
+}
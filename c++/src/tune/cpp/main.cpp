@@ -0,0 +1,808 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2016-2020 Analog Devices Inc. All Rights Reserved.           */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*                                                                            */
+/* Juan Chong - frcsupport@analog.com                                         */
+/*----------------------------------------------------------------------------*/
+
+/*
+ * adis16470tune - searches tilt filter settings by replaying IMU streams through the driver's processing.
+ *
+ * Usage: adis16470tune [-j threads] [--seconds s] [--seed n] [--tau list] [--accel-rejection list]
+ *                      [--dec-rate list] [--filter list] [--csv results.csv]
+ *                      [--log run.adislog --truth run.csv ...]
+ *
+ * Every combination of complementary filter time constant, accelerometer rejection threshold,
+ * DEC_RATE and FILT_CTRL (lists are comma separated) is scored on every stream: the frames are
+ * decoded with ADIS16470DecodeFrame() and run through ADIS16470ComplementaryFilter exactly like
+ * ADIS16470_IMU::Acquire() does, and the tilt estimate of each sample is compared with the true
+ * tilt at the time the sample reached the driver, so filter lag counts as error. The decode and
+ * filter loop is timed for the per-sample CPU cost.
+ *
+ * By default the streams are synthetic: three seeded scenarios (level, charge station ramps, and
+ * driving with bumps and collisions) generated at the IMU's internal 2000 Hz rate, then Bartlett
+ * filtered, averaged down by DEC_RATE and quantized to 16-bit register values like the IMU does.
+ * With --log, raw logs recorded with ADIS16470_IMU::StartRawLog() are replayed instead, scored
+ * against the ground truth CSV given with --truth (FPGA timestamp in us, X angle, Y angle in deg,
+ * e.g. from a motion capture rig). A recorded log has a fixed DEC_RATE and FILT_CTRL, so only the
+ * filter settings are searched.
+ *
+ * Scoring tasks are spread over all cores with a work-stealing pool. The settings on the Pareto
+ * front of RMS error against CPU time per second of data are printed as code to paste into the
+ * robot program. With --csv every scored combination is written out.
+ */
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <adi/ADIS16470_Log.h>
+#include <adi/ADIS16470_Processing.h>
+
+using namespace frc;
+
+namespace {
+
+/* The IMU's internal sample rate (Hz) */
+constexpr double kInternalRate = 2000.0;
+
+/* Time (s) at the start of each stream not scored, while the filter settles from its accelerometer seed */
+constexpr double kSettleTime = 1.0;
+
+/* Timed passes over each stream; the fastest one counts */
+constexpr int kTimingPasses = 3;
+
+struct Options {
+  int threads = 0;
+  double seconds = 30.0;
+  uint32_t seed = 1;
+  std::vector<double> taus = {0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0};
+  std::vector<double> accel_rejections = {0.0, 0.05, 0.1, 0.2, 0.5};
+  std::vector<int> dec_rates = {0, 1, 4, 9, 19};
+  std::vector<int> filters = {0, 1, 2, 3, 4};
+  std::string csv_path;
+  std::vector<std::string> logs;
+  std::vector<std::string> truths;
+};
+
+/* A synthetic stream at the internal rate: truth and sensor outputs of every internal sample */
+struct RawStream {
+  std::string name;
+  // Gyro rates (deg/s) and accelerations (g) in ADIS16470Channel order
+  std::vector<double> channels[kADIS16470NumChannels];
+  // True tilt (deg) in the complementary filter's convention
+  std::vector<double> truth_x;
+  std::vector<double> truth_y;
+};
+
+/* Auto SPI frames as the driver receives them, with the true tilt when each frame was read */
+struct FrameSet {
+  struct Segment {
+    ADIS16470FrameLayout layout;
+    // Sample period (us), as ADIS16470DecodeFrame() expects it
+    double period = 0.0;
+    size_t first_frame = 0;
+    size_t frames = 0;
+  };
+  std::vector<uint32_t> words;
+  // Word offset of each frame
+  std::vector<size_t> offsets;
+  std::vector<Segment> segments;
+  // NaN where there is no truth
+  std::vector<double> truth_x;
+  std::vector<double> truth_y;
+  double rate = 0.0;
+};
+
+/* A recorded log and its ground truth */
+struct Recording {
+  std::string name;
+  FrameSet frames;
+  uint16_t dec_rate = 0;
+  uint16_t filter = 0;
+};
+
+struct Settings {
+  int dec_rate = 4;
+  int filter = 0;
+  double tau = 1.0;
+  double accel_rejection = 0.0;
+};
+
+struct Score {
+  Settings settings;
+  double sum_squares = 0.0;
+  double max_error = 0.0;
+  uint64_t scored = 0;
+  double ns_per_sample = 0.0;
+  double cpu_us_per_second = 0.0;
+  double rms = 0.0;
+  bool pareto = false;
+};
+
+/**
+ * Runs a fixed set of independent tasks on a pool of threads.
+ *
+ * Tasks are dealt round robin into one deque per worker. A worker takes from the back of its own
+ * deque (the most recently dealt task) and, once that is empty, steals from the front of the
+ * others, so workers that drew cheap tasks help out with the expensive ones instead of idling.
+ * Tasks never add tasks, so a worker that finds every deque empty is done.
+ */
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(int threads) : m_queues(std::max(threads, 1)) {}
+
+  void Run(std::vector<std::function<void()>>& tasks) {
+    const size_t workers = m_queues.size();
+    for (size_t i = 0; i < tasks.size(); i++) {
+      m_queues[i % workers].tasks.push_back(i);
+    }
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; w++) {
+      threads.emplace_back([&, w] {
+        size_t task;
+        while (Pop(w, &task) || Steal(w, &task)) {
+          tasks[task]();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  uint64_t GetSteals() const { return m_steals; }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  bool Pop(size_t worker, size_t* task) {
+    Queue& queue = m_queues[worker];
+    std::lock_guard<std::mutex> sync(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    *task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+  }
+
+  bool Steal(size_t worker, size_t* task) {
+    for (size_t i = 1; i < m_queues.size(); i++) {
+      Queue& victim = m_queues[(worker + i) % m_queues.size()];
+      std::lock_guard<std::mutex> sync(victim.mutex);
+      if (!victim.tasks.empty()) {
+        *task = victim.tasks.front();
+        victim.tasks.pop_front();
+        m_steals++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<Queue> m_queues;
+  std::atomic<uint64_t> m_steals{0};
+};
+
+/* Smooth step from 0 to 1 over [0, 1] */
+double SmoothStep(double x) {
+  x = std::min(std::max(x, 0.0), 1.0);
+  return 0.5 - 0.5 * std::cos(M_PI * x);
+}
+
+/**
+ * Generates one synthetic scenario at the internal rate.
+ *
+ * The tilt trajectory is chosen first. The gyros see its rate of change (the filter integrates
+ * -gyro_y into the X angle and gyro_x into the Y angle) and the accelerometers see gravity rotated
+ * by it plus the scenario's linear acceleration, vibration and collisions.
+ */
+RawStream Synthesize(const std::string& name, double seconds, uint32_t seed) {
+  RawStream stream;
+  stream.name = name;
+  const size_t n = size_t(seconds * kInternalRate);
+  const double dt = 1.0 / kInternalRate;
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  std::vector<double> angle_x(n, 0.0), angle_y(n, 0.0), linear_x(n, 0.0), linear_y(n, 0.0);
+  double vibration = 0.002;
+  if (name == "ramp") {
+    // Drive onto a 15 deg charge station every 4 s: 1 s up, 1 s level on top, 1 s down, about a random axis
+    for (size_t i = 0; i < n; i++) {
+      double t = i * dt;
+      double phase = std::fmod(t, 4.0);
+      double tilt = 15.0 * (SmoothStep(phase - 0.5) - SmoothStep(phase - 2.5));
+      bool about_y = int(t / 4.0) % 2 == 1;
+      (about_y ? angle_y : angle_x)[i] = tilt;
+      // Pushing up the ramp takes some acceleration too
+      (about_y ? linear_y : linear_x)[i] = 0.15 * (SmoothStep(phase - 0.3) - SmoothStep(phase - 0.8));
+    }
+  }
+  else if (name == "drive") {
+    // Pushes of up to 0.8 g, pitching the chassis a few degrees, and a 3 g collision every 5 s or so
+    vibration = 0.05;
+    double push_x = 0.0, push_y = 0.0, target_x = 0.0, target_y = 0.0, next_change = 0.0, next_hit = 2.0;
+    for (size_t i = 0; i < n; i++) {
+      double t = i * dt;
+      if (t >= next_change) {
+        target_x = (uniform(rng) * 2.0 - 1.0) * 0.8;
+        target_y = (uniform(rng) * 2.0 - 1.0) * 0.8;
+        next_change = t + 0.5 + uniform(rng);
+      }
+      push_x += (target_x - push_x) * dt / 0.1;
+      push_y += (target_y - push_y) * dt / 0.1;
+      linear_x[i] = push_x;
+      linear_y[i] = push_y;
+      if (t >= next_hit && t < next_hit + 0.03) {
+        linear_x[i] += 3.0;
+      }
+      else if (t >= next_hit + 0.03) {
+        next_hit = t + 3.0 + 4.0 * uniform(rng);
+      }
+      // Suspension pitch follows the acceleration
+      angle_x[i] = -2.0 * push_x;
+      angle_y[i] = 2.0 * push_y;
+    }
+  }
+
+  for (int c = 0; c < kADIS16470NumChannels; c++) {
+    stream.channels[c].resize(n);
+  }
+  stream.truth_x.resize(n);
+  stream.truth_y.resize(n);
+  const double gyro_bias[3] = {0.05 * gauss(rng), 0.05 * gauss(rng), 0.05 * gauss(rng)};
+  for (size_t i = 0; i < n; i++) {
+    double a = angle_x[i] * deg_to_rad;
+    double b = angle_y[i] * deg_to_rad;
+    size_t prev = i > 0 ? i - 1 : 0;
+    size_t next = i + 1 < n ? i + 1 : n - 1;
+    double span = (next - prev) * dt;
+    double rate_x = span > 0.0 ? (angle_x[next] - angle_x[prev]) / span : 0.0;
+    double rate_y = span > 0.0 ? (angle_y[next] - angle_y[prev]) / span : 0.0;
+    // Gravity in the body frame: its X and Y tilts are exactly the filter's accelerometer angles
+    double gravity_x = std::sin(a);
+    double gravity_y = std::cos(a) * std::sin(b);
+    double gravity_z = std::cos(a) * std::cos(b);
+    stream.truth_x[i] = angle_x[i];
+    stream.truth_y[i] = std::atan2(gravity_y, std::sqrt(gravity_x * gravity_x + gravity_z * gravity_z)) * rad_to_deg;
+    stream.channels[0][i] = rate_y + gyro_bias[0] + 0.2 * gauss(rng);
+    stream.channels[1][i] = -rate_x + gyro_bias[1] + 0.2 * gauss(rng);
+    stream.channels[2][i] = gyro_bias[2] + 0.2 * gauss(rng);
+    stream.channels[3][i] = gravity_x + linear_x[i] + vibration * gauss(rng);
+    stream.channels[4][i] = gravity_y + linear_y[i] + vibration * gauss(rng);
+    stream.channels[5][i] = gravity_z + vibration * gauss(rng);
+  }
+  return stream;
+}
+
+/* Big-endian byte pair of a register value, one byte per word like the auto SPI FIFO */
+void PutRegister(uint32_t* words, double value) {
+  int16_t reg = int16_t(std::lround(std::min(std::max(value, -32768.0), 32767.0)));
+  words[0] = (uint16_t(reg) >> 8) & 0xff;
+  words[1] = uint16_t(reg) & 0xff;
+}
+
+/**
+ * Turns a synthetic stream into the frames the driver would read at a DEC_RATE and FILT_CTRL setting.
+ *
+ * The Bartlett filter is two cascaded moving averages of 2^filter internal samples, and each output
+ * sample averages dec_rate + 1 filtered samples. Frames carry the raw FPGA timestamp of the last
+ * internal sample, and the truth is taken at that time, so the filter's delay shows up as error.
+ */
+FrameSet MakeFrames(const RawStream& stream, int dec_rate, int filter) {
+  FrameSet set;
+  const size_t n = stream.truth_x.size();
+  const int length = 1 << filter;
+  const int block = dec_rate + 1;
+  FrameSet::Segment segment;
+  segment.layout = ADIS16470MakeFrameLayout(2, 0);
+  segment.period = block * 1000000.0 / kInternalRate;
+  set.rate = kInternalRate / block;
+  const int frame_len = segment.layout.frame_len;
+
+  double sums1[kADIS16470NumChannels] = {}, sums2[kADIS16470NumChannels] = {}, block_sums[kADIS16470NumChannels] = {};
+  std::vector<double> history1(size_t(length) * kADIS16470NumChannels, 0.0);
+  std::vector<double> history2(size_t(length) * kADIS16470NumChannels, 0.0);
+  set.words.reserve(n / block * frame_len);
+  for (size_t i = 0; i < n; i++) {
+    size_t slot = (i % length) * kADIS16470NumChannels;
+    for (int c = 0; c < kADIS16470NumChannels; c++) {
+      // Both stages start out full of the first sample, as if the IMU had been running
+      double x = stream.channels[c][i];
+      if (i == 0) {
+        for (int k = 0; k < length; k++) {
+          history1[k * kADIS16470NumChannels + c] = x;
+          history2[k * kADIS16470NumChannels + c] = x;
+        }
+        sums1[c] = sums2[c] = x * length;
+      }
+      sums1[c] += x - history1[slot + c];
+      history1[slot + c] = x;
+      double y = sums1[c] / length;
+      sums2[c] += y - history2[slot + c];
+      history2[slot + c] = y;
+      block_sums[c] += sums2[c] / length;
+    }
+    if ((i + 1) % block != 0) {
+      continue;
+    }
+    size_t offset = set.words.size();
+    set.offsets.push_back(offset);
+    set.words.resize(offset + frame_len, 0);
+    uint32_t* frame = &set.words[offset];
+    frame[0] = uint32_t(std::llround((i + 1) * 1000000.0 / kInternalRate));
+    for (int c = 0; c < kADIS16470NumChannels; c++) {
+      double scale = c < 3 ? 0.1 : 1.0 / 800.0;
+      PutRegister(&frame[segment.layout.channel_index[c]], block_sums[c] / block / scale);
+      block_sums[c] = 0.0;
+    }
+    set.truth_x.push_back(stream.truth_x[i]);
+    set.truth_y.push_back(stream.truth_y[i]);
+  }
+  segment.frames = set.offsets.size();
+  set.segments.push_back(segment);
+  return set;
+}
+
+/* Reads a ground truth CSV: FPGA timestamp (us), X angle, Y angle (deg). Lines that don't parse are skipped. */
+bool LoadTruth(const std::string& path, std::vector<double>* times, std::vector<double>* xs, std::vector<double>* ys) {
+  std::FILE* file = std::fopen(path.c_str(), "r");
+  if (file == nullptr) {
+    return false;
+  }
+  char line[256];
+  while (std::fgets(line, sizeof(line), file)) {
+    double t, x, y;
+    if (std::sscanf(line, "%lf,%lf,%lf", &t, &x, &y) == 3) {
+      times->push_back(t);
+      xs->push_back(x);
+      ys->push_back(y);
+    }
+  }
+  std::fclose(file);
+  return !times->empty();
+}
+
+/**
+ * Reads a raw log into frames, split into segments at every kADIS16470LogConfig record, and
+ * interpolates the ground truth at each frame's timestamp.
+ */
+bool LoadRecording(const std::string& log_path, const std::string& truth_path, Recording* recording,
+                   std::string* error) {
+  recording->name = log_path;
+  std::vector<double> truth_t, truth_x, truth_y;
+  if (!LoadTruth(truth_path, &truth_t, &truth_x, &truth_y)) {
+    *error = "could not read truth " + truth_path;
+    return false;
+  }
+  std::FILE* file = std::fopen(log_path.c_str(), "rb");
+  if (file == nullptr) {
+    *error = "could not open " + log_path;
+    return false;
+  }
+  ADIS16470LogHeader header;
+  if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+      std::memcmp(header.magic, kADIS16470LogMagic, sizeof(header.magic)) != 0 ||
+      header.version != kADIS16470LogVersion) {
+    std::fclose(file);
+    *error = log_path + " is not a supported ADIS16470 log";
+    return false;
+  }
+
+  FrameSet& set = recording->frames;
+  FrameSet::Segment segment;
+  segment.layout = ADIS16470MakeFrameLayout(2, 0);
+  segment.period = 2500.0;
+  std::vector<uint32_t> words;
+  ADIS16470LogRecord record;
+  // Timestamp unwrapping for the truth lookup
+  uint64_t high = 0;
+  uint32_t last = 0;
+  size_t cursor = 0;
+  auto close_segment = [&] {
+    segment.frames = set.offsets.size() - segment.first_frame;
+    if (segment.frames > 0) {
+      set.segments.push_back(segment);
+    }
+    segment.first_frame = set.offsets.size();
+  };
+  while (std::fread(&record, sizeof(record), 1, file) == 1) {
+    words.resize(record.word_count);
+    if (record.word_count > 0 && std::fread(words.data(), sizeof(uint32_t), record.word_count, file) != record.word_count) {
+      break;
+    }
+    if (record.type == kADIS16470LogConfig && record.word_count >= 2) {
+      close_segment();
+      segment.layout = ADIS16470MakeFrameLayout(words[0], record.word_count >= 3 ? words[2] : 0,
+                                                record.word_count >= 4 && words[3] != 0);
+      segment.period = words[1] / 1000.0;
+      recording->dec_rate = uint16_t(std::lround(segment.period * kInternalRate / 1000000.0) - 1);
+      recording->filter = record.word_count >= 5 ? uint16_t(words[4]) : 0;
+      continue;
+    }
+    const uint32_t frame_len = segment.layout.frame_len;
+    if (record.type != kADIS16470LogData || record.word_count < frame_len) {
+      continue;
+    }
+    for (uint32_t i = 0; i + frame_len <= record.word_count; i += frame_len) {
+      uint32_t timestamp = words[i];
+      if (timestamp < last && last - timestamp > 0x80000000u) {
+        high += uint64_t(1) << 32;
+      }
+      last = timestamp;
+      double t = double(high | timestamp);
+      while (cursor + 1 < truth_t.size() && truth_t[cursor + 1] <= t) {
+        cursor++;
+      }
+      double x = NAN, y = NAN;
+      if (t >= truth_t.front() && cursor + 1 < truth_t.size()) {
+        double w = (t - truth_t[cursor]) / (truth_t[cursor + 1] - truth_t[cursor]);
+        x = truth_x[cursor] + w * (truth_x[cursor + 1] - truth_x[cursor]);
+        y = truth_y[cursor] + w * (truth_y[cursor + 1] - truth_y[cursor]);
+      }
+      set.offsets.push_back(set.words.size());
+      set.words.insert(set.words.end(), words.begin() + i, words.begin() + i + frame_len);
+      set.truth_x.push_back(x);
+      set.truth_y.push_back(y);
+    }
+  }
+  std::fclose(file);
+  close_segment();
+  if (set.offsets.empty()) {
+    *error = log_path + " holds no frames";
+    return false;
+  }
+  set.rate = 1000000.0 / set.segments.back().period;
+  return true;
+}
+
+/* CPU time (ns) of the calling thread, which unlike wall time does not count while other workers hold the core */
+double ThreadTime() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Difference of two angles (deg), wrapped to [-180, 180) */
+double AngleError(double estimate, double truth) {
+  return std::remainder(estimate - truth, 360.0);
+}
+
+/**
+ * Decodes and filters a frame set with one filter setting, the same per-frame work as
+ * ADIS16470_IMU::Acquire(), and scores the tilt estimates against the truth.
+ */
+void Evaluate(const FrameSet& set, double tau, double accel_rejection, Score* score) {
+  const size_t frames = set.offsets.size();
+  std::vector<float> estimate_x(frames), estimate_y(frames);
+  ADIS16470ComplementaryFilter filter(tau);
+  filter.SetAccelRejection(accel_rejection);
+  ADIS16470Sample sample;
+
+  double best_ns = INFINITY;
+  for (int pass = 0; pass < kTimingPasses; pass++) {
+    double start = ThreadTime();
+    for (const auto& segment : set.segments) {
+      uint32_t previous_timestamp = 0;
+      for (size_t f = segment.first_frame; f < segment.first_frame + segment.frames; f++) {
+        const uint32_t* frame = &set.words[set.offsets[f]];
+        ADIS16470DecodeFrame(frame, segment.layout, previous_timestamp, segment.period, &sample);
+        previous_timestamp = frame[0];
+        if (f == segment.first_frame) {
+          sample.dt = 0.0;
+          sample.delta_angle = 0.0;
+          filter.Reset();
+        }
+        filter.Process(sample);
+        estimate_x[f] = float(filter.GetCompAngleX() * rad_to_deg);
+        estimate_y[f] = float(filter.GetCompAngleY() * rad_to_deg);
+      }
+    }
+    double elapsed = ThreadTime() - start;
+    best_ns = std::min(best_ns, elapsed / std::max<size_t>(frames, 1));
+  }
+
+  const size_t settle = size_t(kSettleTime * set.rate);
+  for (size_t f = settle; f < frames; f++) {
+    if (std::isnan(set.truth_x[f])) {
+      continue;
+    }
+    double ex = AngleError(estimate_x[f], set.truth_x[f]);
+    double ey = AngleError(estimate_y[f], set.truth_y[f]);
+    score->sum_squares += ex * ex + ey * ey;
+    score->max_error = std::max(score->max_error, std::max(std::fabs(ex), std::fabs(ey)));
+    score->scored += 2;
+  }
+  score->ns_per_sample = best_ns;
+  score->cpu_us_per_second = best_ns * set.rate / 1000.0;
+}
+
+/* Marks the scores no other score beats on both RMS error and CPU time */
+void MarkParetoFront(std::vector<Score>& scores) {
+  std::vector<Score*> sorted;
+  for (auto& s : scores) {
+    if (s.scored > 0) {
+      sorted.push_back(&s);
+    }
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const Score* a, const Score* b) {
+    return a->cpu_us_per_second != b->cpu_us_per_second ? a->cpu_us_per_second < b->cpu_us_per_second
+                                                         : a->rms < b->rms;
+  });
+  double best_rms = INFINITY;
+  for (Score* s : sorted) {
+    if (s->rms < best_rms) {
+      s->pareto = true;
+      best_rms = s->rms;
+    }
+  }
+}
+
+std::vector<std::string> Split(const std::string& list) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t comma = list.find(',', start);
+    if (comma == std::string::npos) {
+      comma = list.size();
+    }
+    if (comma > start) {
+      items.push_back(list.substr(start, comma - start));
+    }
+    start = comma + 1;
+  }
+  return items;
+}
+
+std::vector<double> ParseDoubles(const std::string& list) {
+  std::vector<double> values;
+  for (const auto& item : Split(list)) {
+    values.push_back(std::atof(item.c_str()));
+  }
+  return values;
+}
+
+std::vector<int> ParseInts(const std::string& list) {
+  std::vector<int> values;
+  for (const auto& item : Split(list)) {
+    values.push_back(std::atoi(item.c_str()));
+  }
+  return values;
+}
+
+void PrintFront(const std::vector<Score>& scores) {
+  std::vector<const Score*> front;
+  for (const auto& s : scores) {
+    if (s.pareto) {
+      front.push_back(&s);
+    }
+  }
+  std::sort(front.begin(), front.end(), [](const Score* a, const Score* b) { return a->rms < b->rms; });
+  std::printf("%8s %6s %8s %10s %10s %10s %10s %10s\n",
+              "dec_rate", "filter", "tau", "rejection", "rms(deg)", "max(deg)", "ns/sample", "us/s");
+  for (const Score* s : front) {
+    std::printf("%8d %6d %8.3f %10.3f %10.4f %10.3f %10.1f %10.2f\n",
+                s->settings.dec_rate, s->settings.filter, s->settings.tau, s->settings.accel_rejection,
+                s->rms, s->max_error, s->ns_per_sample, s->cpu_us_per_second);
+  }
+  std::printf("\nRobot code for each point on the front, most accurate first:\n");
+  for (const Score* s : front) {
+    std::printf("  // %.4f deg RMS, %.2f us of CPU per second\n", s->rms, s->cpu_us_per_second);
+    std::printf("  config.dec_rate = %d; config.filter = %d; imu.Configure(config); "
+                "imu.ConfigComplementaryFilter(%g, %g);\n",
+                s->settings.dec_rate, s->settings.filter, s->settings.tau, s->settings.accel_rejection);
+  }
+}
+
+bool WriteCSV(const std::string& path, const std::vector<Score>& scores) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file, "dec_rate,filter,tau,accel_rejection,rms_deg,max_deg,ns_per_sample,cpu_us_per_s,pareto\n");
+  for (const auto& s : scores) {
+    std::fprintf(file, "%d,%d,%.6f,%.6f,%.6f,%.6f,%.3f,%.4f,%d\n",
+                 s.settings.dec_rate, s.settings.filter, s.settings.tau, s.settings.accel_rejection,
+                 s.rms, s.max_error, s.ns_per_sample, s.cpu_us_per_second, s.pareto ? 1 : 0);
+  }
+  return std::fclose(file) == 0;
+}
+
+void Usage() {
+  std::fprintf(stderr,
+               "usage: adis16470tune [-j threads] [--seconds s] [--seed n] [--tau list] [--accel-rejection list]\n"
+               "                     [--dec-rate list] [--filter list] [--csv results.csv]\n"
+               "                     [--log run.adislog --truth run.csv ...]\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "-j" && has_value) {
+      options->threads = std::atoi(argv[++i]);
+    }
+    else if (arg == "--seconds" && has_value) {
+      options->seconds = std::atof(argv[++i]);
+    }
+    else if (arg == "--seed" && has_value) {
+      options->seed = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (arg == "--tau" && has_value) {
+      options->taus = ParseDoubles(argv[++i]);
+    }
+    else if (arg == "--accel-rejection" && has_value) {
+      options->accel_rejections = ParseDoubles(argv[++i]);
+    }
+    else if (arg == "--dec-rate" && has_value) {
+      options->dec_rates = ParseInts(argv[++i]);
+    }
+    else if (arg == "--filter" && has_value) {
+      options->filters = ParseInts(argv[++i]);
+    }
+    else if (arg == "--csv" && has_value) {
+      options->csv_path = argv[++i];
+    }
+    else if (arg == "--log" && has_value) {
+      options->logs.push_back(argv[++i]);
+    }
+    else if (arg == "--truth" && has_value) {
+      options->truths.push_back(argv[++i]);
+    }
+    else {
+      return false;
+    }
+  }
+  for (double tau : options->taus) {
+    if (tau <= 0.0) {
+      return false;
+    }
+  }
+  for (int dec_rate : options->dec_rates) {
+    if (dec_rate < 0 || dec_rate > 1999) {
+      return false;
+    }
+  }
+  for (int filter : options->filters) {
+    if (filter < 0 || filter > 6) {
+      return false;
+    }
+  }
+  return options->logs.size() == options->truths.size() && options->seconds > kSettleTime &&
+         !options->taus.empty() && !options->accel_rejections.empty() &&
+         !options->dec_rates.empty() && !options->filters.empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, &options)) {
+    Usage();
+    return 1;
+  }
+  int threads = options.threads > 0 ? options.threads : int(std::thread::hardware_concurrency());
+  WorkStealingPool pool(threads);
+
+  // One frame set per stream and (DEC_RATE, FILT_CTRL) pair, shared by every filter setting
+  struct Input {
+    Settings settings;
+    std::vector<FrameSet> streams;
+  };
+  std::vector<Input> inputs;
+  if (!options.logs.empty()) {
+    std::vector<Recording> recordings(options.logs.size());
+    for (size_t i = 0; i < options.logs.size(); i++) {
+      std::string error;
+      if (!LoadRecording(options.logs[i], options.truths[i], &recordings[i], &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+      }
+    }
+    // A recorded log can't be re-decimated, so the logs fix DEC_RATE and FILT_CTRL
+    Input input;
+    input.settings.dec_rate = recordings[0].dec_rate;
+    input.settings.filter = recordings[0].filter;
+    for (auto& recording : recordings) {
+      input.streams.push_back(std::move(recording.frames));
+    }
+    inputs.push_back(std::move(input));
+  }
+  else {
+    const char* scenarios[] = {"level", "ramp", "drive"};
+    std::vector<RawStream> raw(3);
+    std::vector<std::function<void()>> tasks;
+    for (int s = 0; s < 3; s++) {
+      tasks.push_back([&, s] { raw[s] = Synthesize(scenarios[s], options.seconds, options.seed + s); });
+    }
+    pool.Run(tasks);
+    for (int dec_rate : options.dec_rates) {
+      for (int filter : options.filters) {
+        Input input;
+        input.settings.dec_rate = dec_rate;
+        input.settings.filter = filter;
+        input.streams.resize(raw.size());
+        inputs.push_back(std::move(input));
+      }
+    }
+    tasks.clear();
+    for (auto& input : inputs) {
+      for (size_t s = 0; s < raw.size(); s++) {
+        tasks.push_back([&, s] { input.streams[s] = MakeFrames(raw[s], input.settings.dec_rate, input.settings.filter); });
+      }
+    }
+    pool.Run(tasks);
+  }
+
+  // One task per setting and stream; costs differ by DEC_RATE, which is what the stealing evens out
+  std::vector<Score> scores;
+  for (const auto& input : inputs) {
+    for (double tau : options.taus) {
+      for (double rejection : options.accel_rejections) {
+        Score score;
+        score.settings = input.settings;
+        score.settings.tau = tau;
+        score.settings.accel_rejection = rejection;
+        scores.push_back(score);
+      }
+    }
+  }
+  const size_t per_input = options.taus.size() * options.accel_rejections.size();
+  std::vector<std::vector<Score>> partial(scores.size());
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i < scores.size(); i++) {
+    const Input& input = inputs[i / per_input];
+    partial[i].resize(input.streams.size());
+    for (size_t s = 0; s < input.streams.size(); s++) {
+      tasks.push_back([&, i, s] {
+        Evaluate(input.streams[s], scores[i].settings.tau, scores[i].settings.accel_rejection, &partial[i][s]);
+      });
+    }
+  }
+  auto start = std::chrono::steady_clock::now();
+  pool.Run(tasks);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (size_t i = 0; i < scores.size(); i++) {
+    Score& score = scores[i];
+    for (const auto& p : partial[i]) {
+      score.sum_squares += p.sum_squares;
+      score.scored += p.scored;
+      score.max_error = std::max(score.max_error, p.max_error);
+      score.ns_per_sample += p.ns_per_sample / partial[i].size();
+      score.cpu_us_per_second += p.cpu_us_per_second / partial[i].size();
+    }
+    score.rms = score.scored > 0 ? std::sqrt(score.sum_squares / score.scored) : NAN;
+  }
+  MarkParetoFront(scores);
+
+  std::printf("%zu settings x %zu streams scored in %.2f s on %d threads (%llu tasks stolen)\n\n",
+              scores.size(), inputs[0].streams.size(), elapsed, threads, (unsigned long long)pool.GetSteals());
+  PrintFront(scores);
+  if (!options.csv_path.empty() && !WriteCSV(options.csv_path, scores)) {
+    std::fprintf(stderr, "could not write %s\n", options.csv_path.c_str());
+    return 1;
+  }
+  return 0;
+}